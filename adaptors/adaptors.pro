@@ -46,6 +46,7 @@ SUBDIRS += iioadaptor
 SUBDIRS += humidityadaptor
 SUBDIRS += pressureadaptor
 SUBDIRS += temperatureadaptor
+SUBDIRS += replayadaptor
 
 config_hybris {
     SUBDIRS += hybrisaccelerometer
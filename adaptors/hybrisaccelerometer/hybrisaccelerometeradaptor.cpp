@@ -29,7 +29,7 @@
 HybrisAccelerometerAdaptor::HybrisAccelerometerAdaptor(const QString& id) :
     HybrisAdaptor(id,SENSOR_TYPE_ACCELEROMETER)
 {
-    buffer = new DeviceAdaptorRingBuffer<AccelerationData>(1);
+    buffer = new DeviceAdaptorRingBuffer<AccelerationData>(HybrisManager::POLL_BATCH_SIZE);
     setAdaptedSensor("accelerometer", "Internal accelerometer coordinates", buffer);
 
     setDescription("Hybris accelerometer");
@@ -63,7 +63,7 @@ void HybrisAccelerometerAdaptor::stopSensor()
 void HybrisAccelerometerAdaptor::processSample(const sensors_event_t& data)
 {
     AccelerationData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
+    d->timestamp_ = eventTimestamp(data);
     // sensorfw wants milli-G'
 
     d->x_ = data.acceleration.x * GRAVITY_RECIPROCAL_THOUSANDS;
@@ -71,6 +71,10 @@ void HybrisAccelerometerAdaptor::processSample(const sensors_event_t& data)
     d->z_ = data.acceleration.z * GRAVITY_RECIPROCAL_THOUSANDS;
 
     buffer->commit();
+}
+
+void HybrisAccelerometerAdaptor::commitSamples()
+{
     buffer->wakeUpReaders();
 }
 
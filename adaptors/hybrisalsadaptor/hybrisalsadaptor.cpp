@@ -34,7 +34,7 @@ HybrisAlsAdaptor::HybrisAlsAdaptor(const QString& id) :
     HybrisAdaptor(id,SENSOR_TYPE_LIGHT),
     lastLightValue(9999)
 {
-    buffer = new DeviceAdaptorRingBuffer<TimedUnsigned>(1);
+    buffer = new DeviceAdaptorRingBuffer<TimedUnsigned>(HybrisManager::POLL_BATCH_SIZE);
     setAdaptedSensor("als", "Internal ambient light sensor lux values", buffer);
     setDescription("Hybris als");
     powerStatePath = SensorFrameworkConfig::configuration()->value("als/powerstate_path").toByteArray();
@@ -128,10 +128,14 @@ void HybrisAlsAdaptor::stopSensor()
 void HybrisAlsAdaptor::processSample(const sensors_event_t& data)
 {
     TimedUnsigned *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
+    d->timestamp_ = eventTimestamp(data);
     d->value_ = data.light;
     lastLightValue = d->value_;
     buffer->commit();
+}
+
+void HybrisAlsAdaptor::commitSamples()
+{
     buffer->wakeUpReaders();
 }
 
@@ -31,7 +31,7 @@
 HybrisGyroscopeAdaptor::HybrisGyroscopeAdaptor(const QString& id) :
     HybrisAdaptor(id,SENSOR_TYPE_GYROSCOPE)
 {
-    buffer = new DeviceAdaptorRingBuffer<TimedXyzData>(1);
+    buffer = new DeviceAdaptorRingBuffer<TimedXyzData>(HybrisManager::POLL_BATCH_SIZE);
     setAdaptedSensor("gyroscopeadaptor", "Internal gyroscope coordinates", buffer);
 
     setDescription("Hybris gyroscope");
@@ -72,11 +72,15 @@ void HybrisGyroscopeAdaptor::processSample(const sensors_event_t& data)
 {
 
     TimedXyzData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
+    d->timestamp_ = eventTimestamp(data);
     d->x_ = (data.gyro.x) * RADIANS_TO_DEGREES * 1000;
     d->y_ = (data.gyro.y) * RADIANS_TO_DEGREES * 1000;
     d->z_ = (data.gyro.z) * RADIANS_TO_DEGREES * 1000;
     buffer->commit();
+}
+
+void HybrisGyroscopeAdaptor::commitSamples()
+{
     buffer->wakeUpReaders();
 }
 
@@ -27,7 +27,7 @@
 HybrisMagnetometerAdaptor::HybrisMagnetometerAdaptor(const QString& id) :
     HybrisAdaptor(id,SENSOR_TYPE_MAGNETIC_FIELD)
 {
-    buffer = new DeviceAdaptorRingBuffer<CalibratedMagneticFieldData>(1);
+    buffer = new DeviceAdaptorRingBuffer<CalibratedMagneticFieldData>(HybrisManager::POLL_BATCH_SIZE);
     setAdaptedSensor("magnetometer", "Internal magnetometer coordinates", buffer);
 
     setDescription("Hybris magnetometer");
@@ -67,7 +67,7 @@ void HybrisMagnetometerAdaptor::stopSensor()
 void HybrisMagnetometerAdaptor::processSample(const sensors_event_t& data)
 {
     CalibratedMagneticFieldData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
+    d->timestamp_ = eventTimestamp(data);
     //uT
     d->x_ = (data.magnetic.x * 1000);
     d->y_ = (data.magnetic.y * 1000);
@@ -84,6 +84,10 @@ void HybrisMagnetometerAdaptor::processSample(const sensors_event_t& data)
 
 #endif
     buffer->commit();
+}
+
+void HybrisMagnetometerAdaptor::commitSamples()
+{
     buffer->wakeUpReaders();
 }
 
@@ -44,7 +44,7 @@
 HybrisOrientationAdaptor::HybrisOrientationAdaptor(const QString& id) :
     HybrisAdaptor(id,SENSOR_TYPE_ORIENTATION)
 {
-    buffer = new DeviceAdaptorRingBuffer<CompassData>(1);
+    buffer = new DeviceAdaptorRingBuffer<CompassData>(HybrisManager::POLL_BATCH_SIZE);
     setAdaptedSensor("hybrisorientation", "Internal orientation coordinates", buffer);
 
     setDescription("Hybris orientation");
@@ -83,12 +83,16 @@ void HybrisOrientationAdaptor::stopSensor()
 void HybrisOrientationAdaptor::processSample(const sensors_event_t& data)
 {
     CompassData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
+    d->timestamp_ = eventTimestamp(data);
     d->degrees_ = data.orientation.azimuth; //azimuth
     d->rawDegrees_ = d->degrees_;
     d->level_ = data.orientation.status;
 
     buffer->commit();
+}
+
+void HybrisOrientationAdaptor::commitSamples()
+{
     buffer->wakeUpReaders();
 }
 
@@ -32,7 +32,7 @@
 HybrisPressureAdaptor::HybrisPressureAdaptor(const QString& id) :
     HybrisAdaptor(id,SENSOR_TYPE_PRESSURE)
 {
-    buffer = new DeviceAdaptorRingBuffer<TimedUnsigned>(1);
+    buffer = new DeviceAdaptorRingBuffer<TimedUnsigned>(HybrisManager::POLL_BATCH_SIZE);
     setAdaptedSensor("pressure", "Internal ambient pressure sensor values", buffer);
     setDescription("Hybris pressure");
     powerStatePath = SensorFrameworkConfig::configuration()->value("pressure/powerstate_path").toByteArray();
@@ -69,9 +69,13 @@ void HybrisPressureAdaptor::stopSensor()
 void HybrisPressureAdaptor::processSample(const sensors_event_t& data)
 {
     TimedUnsigned *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
+    d->timestamp_ = eventTimestamp(data);
     d->value_ = data.pressure * 100;//From hPa to Pa
     buffer->commit();
+}
+
+void HybrisPressureAdaptor::commitSamples()
+{
     buffer->wakeUpReaders();
 }
 
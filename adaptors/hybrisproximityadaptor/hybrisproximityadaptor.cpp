@@ -35,7 +35,7 @@ HybrisProximityAdaptor::HybrisProximityAdaptor(const QString& id) :
     lastNearValue(-1)
 {
     if (isValid()) {
-        buffer = new DeviceAdaptorRingBuffer<ProximityData>(1);
+        buffer = new DeviceAdaptorRingBuffer<ProximityData>(HybrisManager::POLL_BATCH_SIZE);
         setAdaptedSensor("proximity", "Internal proximity coordinates", buffer);
 
         setDescription("Hybris proximity");
@@ -136,7 +136,7 @@ void HybrisProximityAdaptor::stopSensor()
 void HybrisProximityAdaptor::processSample(const sensors_event_t& data)
 {
     ProximityData *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
+    d->timestamp_ = eventTimestamp(data);
     bool near = false;
     if (data.distance < maxRange()) {
         near = true;
@@ -146,6 +146,10 @@ void HybrisProximityAdaptor::processSample(const sensors_event_t& data)
 
     lastNearValue = near;
     buffer->commit();
+}
+
+void HybrisProximityAdaptor::commitSamples()
+{
     buffer->wakeUpReaders();
 }
 
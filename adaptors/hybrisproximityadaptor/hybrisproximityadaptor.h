@@ -56,6 +56,7 @@ public:
 
 protected:
     void processSample(const sensors_event_t& data);
+    void commitSamples();
     void init();
 
 private:
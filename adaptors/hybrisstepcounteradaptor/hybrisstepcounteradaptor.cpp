@@ -38,7 +38,7 @@
 HybrisStepCounterAdaptor::HybrisStepCounterAdaptor(const QString& id) :
     HybrisAdaptor(id, SENSOR_TYPE_STEP_COUNTER)
 {
-    buffer = new DeviceAdaptorRingBuffer<TimedUnsigned>(1);
+    buffer = new DeviceAdaptorRingBuffer<TimedUnsigned>(HybrisManager::POLL_BATCH_SIZE);
     setAdaptedSensor("stepcounter", "Internal step counter steps since reboot", buffer);
     setDescription("Hybris step counter");
     powerStatePath = SensorFrameworkConfig::configuration()->value("stepcounter/powerstate_path").toByteArray();
@@ -80,7 +80,7 @@ void HybrisStepCounterAdaptor::stopSensor()
 void HybrisStepCounterAdaptor::processSample(const sensors_event_t& data)
 {
     TimedUnsigned *d = buffer->nextSlot();
-    d->timestamp_ = quint64(data.timestamp * .001);
+    d->timestamp_ = eventTimestamp(data);
 #ifdef NO_SENSORS_EVENT_U64
     uint64_t value = 0;
     memcpy(&value, data.data, sizeof value);
@@ -89,6 +89,10 @@ void HybrisStepCounterAdaptor::processSample(const sensors_event_t& data)
     d->value_ = data.u64.step_counter;
 #endif
     buffer->commit();
+}
+
+void HybrisStepCounterAdaptor::commitSamples()
+{
     buffer->wakeUpReaders();
 }
 
@@ -60,6 +60,7 @@ public:
 
 protected:
     void processSample(const sensors_event_t& data);
+    void commitSamples();
     void init();
 
 private:
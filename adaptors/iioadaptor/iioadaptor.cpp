@@ -58,9 +58,17 @@
 #define CONVERT_A_Z(x)  ((float(x) / 1000) * (GRAVITY * 1.0))
 
 IioAdaptor::IioAdaptor(const QString &id) :
-        SysfsAdaptor(id, SysfsAdaptor::IntervalMode, true),
-        deviceId(id)
+        SysfsAdaptor(id, bufferedMode(id) ? SysfsAdaptor::SelectMode : SysfsAdaptor::IntervalMode, !bufferedMode(id)),
+        iioXyzBuffer_(0),
+        alsBuffer_(0),
+        magnetometerBuffer_(0),
+        deviceId(id),
+        buffered_(bufferedMode(id)),
+        timestampChannel_(-1)
 {
+    scanChannels_[0] = scanChannels_[1] = scanChannels_[2] = -1;
+    // Polled samples are stamped when read, so smooth out the scheduling jitter
+    timestampMapper_.configure(sensorName(id), TimestampMapper::Monotonic, !buffered_);
     sensordLogD() << "Creating IioAdaptor with id: " << id;
     setup();
 }
@@ -75,10 +83,34 @@ IioAdaptor::~IioAdaptor()
         delete magnetometerBuffer_;
 }
 
+QString IioAdaptor::sensorName(const QString& id)
+{
+    if (id.startsWith("accel"))
+        return "accelerometer";
+    if (id.startsWith("gyro"))
+        return "gyroscope";
+    if (id.startsWith("mag"))
+        return "magnetometer";
+    if (id.startsWith("als"))
+        return "als";
+    return QString();
+}
+
+bool IioAdaptor::bufferedMode(const QString& id)
+{
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    if (!config)
+        return false;
+    return config->value<bool>(sensorName(id) + "/iio_buffered", false);
+}
+
 void IioAdaptor::setup()
 {
     qDebug() << Q_FUNC_INFO << deviceId;
 
+    // In buffered mode one read may deliver a whole batch of scans
+    const unsigned bufferSize = buffered_ ? IIO_BUFFER_LEN : 1;
+
     if (deviceId.startsWith("accel")) {
         const QString name = "accelerometer";
         const QString inputMatch = SensorFrameworkConfig::configuration()->value<QString>(name + "/input_match");
@@ -88,7 +120,7 @@ void IioAdaptor::setup()
         if (devNodeNumber!= -1) {
             const QString desc = "Industrial I/O accelerometer (" + iioDevice.name +")";
             qDebug() << Q_FUNC_INFO << "Accelerometer found";
-            iioXyzBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(1);
+            iioXyzBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(bufferSize);
             setAdaptedSensor(name, desc, iioXyzBuffer_);
 
             iioDevice.sensorType = IioAdaptor::IIO_ACCELEROMETER;
@@ -102,7 +134,7 @@ void IioAdaptor::setup()
         devNodeNumber = findSensor(inputMatch);
         if (devNodeNumber!= -1) {
             const QString desc = "Industrial I/O gyroscope (" + iioDevice.name +")";
-            iioXyzBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(1);
+            iioXyzBuffer_ = new DeviceAdaptorRingBuffer<TimedXyzData>(bufferSize);
             setAdaptedSensor(name, desc, iioXyzBuffer_);
 
             iioDevice.sensorType = IioAdaptor::IIO_GYROSCOPE;
@@ -117,7 +149,7 @@ void IioAdaptor::setup()
 
         if (devNodeNumber!= -1) {
             const QString desc = "Industrial I/O magnetometer (" + iioDevice.name +")";
-            magnetometerBuffer_ = new DeviceAdaptorRingBuffer<CalibratedMagneticFieldData>(1);
+            magnetometerBuffer_ = new DeviceAdaptorRingBuffer<CalibratedMagneticFieldData>(bufferSize);
             setAdaptedSensor(name, desc, magnetometerBuffer_);
 
             iioDevice.sensorType = IioAdaptor::IIO_MAGNETOMETER;
@@ -131,7 +163,7 @@ void IioAdaptor::setup()
         if (devNodeNumber!= -1) {
             QString desc = "Industrial I/O light sensor (" + iioDevice.name +")";
             qDebug() << desc;
-            alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(1);
+            alsBuffer_ = new DeviceAdaptorRingBuffer<TimedUnsigned>(bufferSize);
             setAdaptedSensor(name, desc, alsBuffer_);
             iioDevice.sensorType = IioAdaptor::IIO_ALS;
         }
@@ -142,8 +174,21 @@ void IioAdaptor::setup()
 //        setValid(false);
         return;
     }
+
+    if (buffered_) {
+        const QString chardev = QString("/dev/iio:device%1").arg(devNodeNumber);
+        if (!addPath(chardev, IIO_BUFFER_PATH_ID))
+            sensordLogW() << "IIO buffer device" << chardev << "not found";
+    }
+
     iioDevice.channels = scanElementsEnable(devNodeNumber,1);
     scanElementsEnable(devNodeNumber,0);
+    if (iioDevice.channels < 0) {
+        // Scans could not be split into channels
+        sensordLogW() << "IIO device" << iioDevice.name << "has unsupported scan elements, buffered mode not possible";
+        setValid(false);
+        return;
+    }
 
     introduceAvailableDataRange(DataRange(0, 65535, 1));
     introduceAvailableInterval(DataRange(0, 586, 0));
@@ -210,7 +255,7 @@ int IioAdaptor::findSensor(const QString &sensorName)
                         if (ok)
                        //     frequency = num;
                         qDebug() << "frequency is" << iioDevice.frequency;
-                    } else if (attributeName.endsWith("raw")) {
+                    } else if (attributeName.endsWith("raw") && !buffered_) {
                         qDebug() << "adding to paths:" << iioDevice.devicePath
                                    << attributeName << iioDevice.index;
                         addPath(iioDevice.devicePath + attributeName, j);
@@ -263,7 +308,22 @@ bool IioAdaptor::deviceEnable(int device, int enable)
 
     if (enable == 1) {
         // FIXME: should enable sensors for this device? Assuming enabled already
-        iioDevice.channels = scanElementsEnable(device, enable);
+        int channels = scanElementsEnable(device, enable);
+        if (channels < 0) {
+            sensordLogW() << "IIO device" << iioDevice.name << "has unsupported scan elements";
+            scanElementsEnable(device, 0);
+            return false;
+        }
+        iioDevice.channels = channels;
+        if (buffered_) {
+            // Kernel timestamps in the same clock as Utils::getTimeStamp().
+            // Without the switch they are CLOCK_REALTIME and get mapped.
+            QString pathClock = iioDevice.devicePath + "current_timestamp_clock";
+            if (!QFile::exists(pathClock) || !writeToFile(pathClock.toLatin1(), "monotonic\n")) {
+                if (timestampMapper_.clock() == TimestampMapper::Monotonic)
+                    timestampMapper_.setClock(TimestampMapper::Realtime);
+            }
+        }
         sysfsWriteInt(pathLength, IIO_BUFFER_LEN);
         sysfsWriteInt(pathEnable, enable);
     } else {
@@ -324,7 +384,7 @@ int IioAdaptor::sysfsReadInt(QString filename)
 	return value;
 }
 
-// Return the number of channels
+// Return the number of channels, -1 if buffered scans can not be decoded
 int IioAdaptor::scanElementsEnable(int device, int enable)
 {
     Q_UNUSED(device);
@@ -343,6 +403,9 @@ int IioAdaptor::scanElementsEnable(int device, int enable)
     dir.setNameFilters(filters);
 
     QFileInfoList list = dir.entryInfoList();
+    bool decodable = true;
+    if (enable)
+        decoder_.clear();
     for (int i = 0; i < list.size(); ++i) {
         QFileInfo fileInfo = list.at(i);
 
@@ -354,12 +417,25 @@ int IioAdaptor::scanElementsEnable(int device, int enable)
             int index = sysfsReadInt(base + "_index");
             int bytes = deviceChannelParseBytes(base + "_type");
 
-           iioDevice.channel_bytes[index] = bytes;
+            if (index >= 0 && index < IIO_MAX_DEVICE_CHANNELS)
+                iioDevice.channel_bytes[index] = bytes;
+            if (!decoder_.addChannel(QFileInfo(base).fileName(), index, sysfsReadString(base + "_type"))) {
+                sensordLogW() << "Unsupported scan element" << base;
+                decodable = false;
+            }
         }
 
         sysfsWriteInt(fileInfo.filePath(), enable);
     }
 
+    if (enable) {
+        decoder_.finalize();
+        mapScanChannels();
+        // Polled mode reads the raw attributes and never decodes scans
+        if (!decodable && buffered_)
+            return -1;
+    }
+
     return list.size();
 }
 
@@ -373,13 +449,31 @@ int IioAdaptor::deviceChannelParseBytes(QString filename)
         return 4;
     } else if (type.compare("le:s64/64>>0") == 0) {
         return 8;
-    } else {
+    } else if (!buffered_) {
         sensordLogW() << "ERROR: invalid type from file " << filename << ": " << type;
     }
 
     return 0;
 }
 
+void IioAdaptor::mapScanChannels()
+{
+    static const char* const axes[3] = { "_x", "_y", "_z" };
+
+    timestampChannel_ = decoder_.findChannel("_timestamp");
+    for (int axis = 0; axis < 3; ++axis)
+        scanChannels_[axis] = decoder_.findChannel(axes[axis]);
+
+    // Channels without axis suffix, e.g. illuminance, in scan order
+    if (scanChannels_[0] == -1) {
+        int axis = 0;
+        for (int i = 0; i < decoder_.channelCount() && axis < 3; ++i) {
+            if (i != timestampChannel_)
+                scanChannels_[axis++] = i;
+        }
+    }
+}
+
 void IioAdaptor::processSample(int fileId, int fd)
 {
     char buf[IIO_BUFFER_LEN];
@@ -388,6 +482,11 @@ void IioAdaptor::processSample(int fileId, int fd)
     int channel = fileId%IIO_MAX_DEVICE_CHANNELS;
     int device = (fileId - channel)/IIO_MAX_DEVICE_CHANNELS;
 
+    if (fileId == IIO_BUFFER_PATH_ID) {
+        processBuffer(fd);
+        return;
+    }
+
     if (device == 0) {
         readBytes = read(fd, buf, sizeof(buf));
 
@@ -400,88 +499,136 @@ void IioAdaptor::processSample(int fileId, int fd)
         if (result == 0)
             return;
 
-        switch(channel) {
-        case 0: {
-            switch (iioDevice.sensorType) {
-            case IioAdaptor::IIO_ACCELEROMETER:
-            case IioAdaptor::IIO_GYROSCOPE:
-                timedData = iioXyzBuffer_->nextSlot();
-                timedData->x_= -(result + iioDevice.offset) * iioDevice.scale * 1000 * REV_GRAVITY;
-                break;
-            case IioAdaptor::IIO_MAGNETOMETER:
-                calData = magnetometerBuffer_->nextSlot();
-                calData->rx_ = (result + iioDevice.offset) * iioDevice.scale;
-                break;
-            case IioAdaptor::IIO_ALS:
-                uData = alsBuffer_->nextSlot();
-                uData->value_ = (result + iioDevice.offset) * iioDevice.scale;
-                break;
-            default:
-                break;
-            };
-        }
-            break;
+        storeChannel(channel, result);
 
-        case 1: {
-            switch (iioDevice.sensorType) {
-            case IioAdaptor::IIO_ACCELEROMETER:
-            case IioAdaptor::IIO_GYROSCOPE:
-                timedData = iioXyzBuffer_->nextSlot();
-                timedData->y_= -(result + iioDevice.offset) * iioDevice.scale * 1000 * REV_GRAVITY;
-                break;
-            case IioAdaptor::IIO_MAGNETOMETER:
-                calData = magnetometerBuffer_->nextSlot();
-                result = (result * iioDevice.scale);
-                calData->y_ = result;
-                break;
-            default:
-                break;
-            };
+        if (channel == iioDevice.channels - 1) {
+            quint64 now = Utils::getTimeStampNs();
+            commitSample(timestampMapper_.mapArrivalToMicroseconds(now));
+            wakeUpReaders();
         }
-            break;
+    }
+}
 
-        case 2: {
-            switch (iioDevice.sensorType) {
-            case IioAdaptor::IIO_ACCELEROMETER:
-            case IioAdaptor::IIO_GYROSCOPE:
-                timedData = iioXyzBuffer_->nextSlot();
-                timedData->z_ = -(result + iioDevice.offset) * iioDevice.scale * 1000 * REV_GRAVITY;
-                break;
-            case IioAdaptor::IIO_MAGNETOMETER:
-                calData = magnetometerBuffer_->nextSlot();
-                result = ((result + iioDevice.offset) * iioDevice.scale) * 100;
-                calData->rz_ = result;
-                break;
-            default:
-                break;
-            };
+void IioAdaptor::processBuffer(int fd)
+{
+    int scans = decoder_.readScans(fd, IIO_BUFFER_LEN);
+    if (scans <= 0 || scanChannels_[0] == -1)
+        return;
+
+    quint64 now = Utils::getTimeStampNs();
+    for (int i = 0; i < scans; ++i) {
+        const char* scan = decoder_.scan(i);
+        for (int axis = 0; axis < 3; ++axis) {
+            if (scanChannels_[axis] != -1)
+                storeChannel(axis, decoder_.value(scan, scanChannels_[axis]));
         }
+        if (timestampChannel_ != -1)
+            commitSample(timestampMapper_.mapToMicroseconds(decoder_.value(scan, timestampChannel_), now));
+        else
+            commitSample(timestampMapper_.mapArrivalToMicroseconds(now));
+    }
+    wakeUpReaders();
+}
+
+void IioAdaptor::storeChannel(int channel, qreal result)
+{
+    switch(channel) {
+    case 0: {
+        switch (iioDevice.sensorType) {
+        case IioAdaptor::IIO_ACCELEROMETER:
+        case IioAdaptor::IIO_GYROSCOPE:
+            timedData = iioXyzBuffer_->nextSlot();
+            timedData->x_= -(result + iioDevice.offset) * iioDevice.scale * 1000 * REV_GRAVITY;
+            break;
+        case IioAdaptor::IIO_MAGNETOMETER:
+            calData = magnetometerBuffer_->nextSlot();
+            calData->rx_ = (result + iioDevice.offset) * iioDevice.scale;
+            break;
+        case IioAdaptor::IIO_ALS:
+            uData = alsBuffer_->nextSlot();
+            uData->value_ = (result + iioDevice.offset) * iioDevice.scale;
+            break;
+        default:
+            break;
+        };
+    }
+        break;
+
+    case 1: {
+        switch (iioDevice.sensorType) {
+        case IioAdaptor::IIO_ACCELEROMETER:
+        case IioAdaptor::IIO_GYROSCOPE:
+            timedData = iioXyzBuffer_->nextSlot();
+            timedData->y_= -(result + iioDevice.offset) * iioDevice.scale * 1000 * REV_GRAVITY;
+            break;
+        case IioAdaptor::IIO_MAGNETOMETER:
+            calData = magnetometerBuffer_->nextSlot();
+            result = (result * iioDevice.scale);
+            calData->y_ = result;
+            break;
+        default:
             break;
         };
-
-        if (channel == iioDevice.channels - 1) {
-            switch (iioDevice.sensorType) {
-            case IioAdaptor::IIO_ACCELEROMETER:
-            case IioAdaptor::IIO_GYROSCOPE:
-                timedData->timestamp_ = Utils::getTimeStamp();
-                iioXyzBuffer_->commit();
-                iioXyzBuffer_->wakeUpReaders();
-                break;
-            case IioAdaptor::IIO_MAGNETOMETER:
-                calData->timestamp_ = Utils::getTimeStamp();
-                magnetometerBuffer_->commit();
-                magnetometerBuffer_->wakeUpReaders();
-                break;
-            case IioAdaptor::IIO_ALS:
-                uData->timestamp_ = Utils::getTimeStamp();
-                alsBuffer_->commit();
-                alsBuffer_->wakeUpReaders();
-                break;
-            default:
-                break;
-            };
-        }
     }
+        break;
+
+    case 2: {
+        switch (iioDevice.sensorType) {
+        case IioAdaptor::IIO_ACCELEROMETER:
+        case IioAdaptor::IIO_GYROSCOPE:
+            timedData = iioXyzBuffer_->nextSlot();
+            timedData->z_ = -(result + iioDevice.offset) * iioDevice.scale * 1000 * REV_GRAVITY;
+            break;
+        case IioAdaptor::IIO_MAGNETOMETER:
+            calData = magnetometerBuffer_->nextSlot();
+            result = ((result + iioDevice.offset) * iioDevice.scale) * 100;
+            calData->rz_ = result;
+            break;
+        default:
+            break;
+        };
+    }
+        break;
+    };
+}
+
+void IioAdaptor::commitSample(quint64 timestamp)
+{
+    switch (iioDevice.sensorType) {
+    case IioAdaptor::IIO_ACCELEROMETER:
+    case IioAdaptor::IIO_GYROSCOPE:
+        timedData->timestamp_ = timestamp;
+        iioXyzBuffer_->commit();
+        break;
+    case IioAdaptor::IIO_MAGNETOMETER:
+        calData->timestamp_ = timestamp;
+        magnetometerBuffer_->commit();
+        break;
+    case IioAdaptor::IIO_ALS:
+        uData->timestamp_ = timestamp;
+        alsBuffer_->commit();
+        break;
+    default:
+        break;
+    };
+}
+
+void IioAdaptor::wakeUpReaders()
+{
+    switch (iioDevice.sensorType) {
+    case IioAdaptor::IIO_ACCELEROMETER:
+    case IioAdaptor::IIO_GYROSCOPE:
+        iioXyzBuffer_->wakeUpReaders();
+        break;
+    case IioAdaptor::IIO_MAGNETOMETER:
+        magnetometerBuffer_->wakeUpReaders();
+        break;
+    case IioAdaptor::IIO_ALS:
+        alsBuffer_->wakeUpReaders();
+        break;
+    default:
+        break;
+    };
 }
 
 bool IioAdaptor::setInterval(const unsigned int value, const int sessionId)
@@ -508,7 +655,8 @@ bool IioAdaptor::startSensor()
         return false;
 
     qDebug() << Q_FUNC_INFO;
-    deviceEnable(devNodeNumber, true);
+    if (!deviceEnable(devNodeNumber, true))
+        return false;
     return SysfsAdaptor::startSensor();
 }
 
@@ -29,6 +29,7 @@
 
 #include <sysfsadaptor.h>
 #include <datatypes/orientationdata.h>
+#include "iioscandecoder.h"
 
 // FIXME: shouldn't assume any number of channels per device
 #define IIO_MAX_DEVICE_CHANNELS     20
@@ -36,15 +37,26 @@
 // FIXME: no idea what would be reasonable length
 #define IIO_BUFFER_LEN              256
 
+// Path ID of the character device in buffered mode
+#define IIO_BUFFER_PATH_ID          IIO_MAX_DEVICE_CHANNELS
+
 /**
  * @brief Adaptor for Industrial I/O.
  *
- * Adaptor for Industrial I/O. Uses SysFs driver interface in
+ * Adaptor for Industrial I/O. By default uses SysFs driver interface in
  * polling mode, i.e. values are read with given constant interval.
  *
  * Driver interface is located in @e /sys/bus/iio/devices/iio:deviceX/ .
  * <ul><li>@e angular_rate filehandle provides measurement values.</li></ul>
  * No other filehandles are currently in use by this adaptor.
+ *
+ * With @e iio_buffered set in the sensor's configuration group the
+ * adaptor instead waits on the buffer character device
+ * @e /dev/iio:deviceX and decodes all scans available with a single
+ * read(). Samples are then stamped with the kernel @e in_timestamp
+ * channel when it is enabled, mapped to CLOCK_MONOTONIC if the kernel
+ * can not be switched to it. Polled samples are stamped when read with
+ * the jitter smoothed, see TimestampMapper.
  */
 class IioAdaptor : public SysfsAdaptor
 {
@@ -117,6 +129,47 @@ private:
      */
     void processSample(int pathId, int fd);
 
+    /**
+     * Decode scans available on the buffer character device.
+     *
+     * @param fd Character device.
+     */
+    void processBuffer(int fd);
+
+    /**
+     * Store converted channel value into the current sample.
+     *
+     * @param channel 0, 1 or 2 for x, y and z.
+     * @param result Raw value.
+     */
+    void storeChannel(int channel, qreal result);
+
+    /**
+     * Publish current sample.
+     *
+     * @param timestamp Sample time.
+     */
+    void commitSample(quint64 timestamp);
+
+    /**
+     * Wake up readers of the sensor buffer.
+     */
+    void wakeUpReaders();
+
+    /**
+     * Is buffered mode configured for the adaptor.
+     *
+     * @param id Identifier for the adaptor.
+     */
+    static bool bufferedMode(const QString& id);
+
+    /**
+     * Configuration group of the sensor handled by the adaptor.
+     *
+     * @param id Identifier for the adaptor.
+     */
+    static QString sensorName(const QString& id);
+
     int findSensor(const QString &name);
     bool deviceEnable(int device, int enable);
 
@@ -125,6 +178,7 @@ private:
     int sysfsReadInt(QString filename);
     int scanElementsEnable(int device, int enable);
     int deviceChannelParseBytes(QString filename);
+    void mapScanChannels();
 
     // Device number for the sensor (-1 if not found)
     int devNodeNumber;
@@ -141,6 +195,11 @@ private:
     CalibratedMagneticFieldData *calData;
     TimedUnsigned *uData;
 
+    bool buffered_;                /**< read scans from character device */
+    IioScanDecoder decoder_;       /**< scan layout in buffered mode */
+    int scanChannels_[3];          /**< decoder channels of x, y and z */
+    int timestampChannel_;         /**< decoder channel of in_timestamp or -1 */
+
 private slots:
     void setup();
 };
@@ -2,10 +2,12 @@ TARGET = iioaccelerometeradaptor
 #TARGET = iiosensorsadaptor
 
 HEADERS += iioadaptor.h \
-           iioadaptorplugin.h
+           iioadaptorplugin.h \
+           iioscandecoder.h
 
 SOURCES += iioadaptor.cpp \
-           iioadaptorplugin.cpp
+           iioadaptorplugin.cpp \
+           iioscandecoder.cpp
 
 CONFIG += qt debug warn_on link_prl link_pkgconfig plugin
 
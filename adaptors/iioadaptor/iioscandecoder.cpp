@@ -0,0 +1,134 @@
+/**
+   @file iioscandecoder.cpp
+   @brief Decoder for IIO buffer scans
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "iioscandecoder.h"
+#include <logging.h>
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+IioScanDecoder::IioScanDecoder() :
+    scanSize_(0),
+    pending_(0),
+    pendingOffset_(0)
+{
+}
+
+void IioScanDecoder::clear()
+{
+    channels_.clear();
+    scanSize_ = 0;
+    pending_ = 0;
+    pendingOffset_ = 0;
+}
+
+bool IioScanDecoder::addChannel(const QString& name, int index, const QString& type)
+{
+    // [be|le]:[s|u]bits/storagebits[Xrepeat]>>shift
+    char endian;
+    char sign;
+    unsigned bits, storageBits, shift, repeat = 1;
+    QByteArray latin = type.toLatin1();
+    if (sscanf(latin.constData(), "%ce:%c%u/%uX%u>>%u", &endian, &sign, &bits, &storageBits, &repeat, &shift) != 6 &&
+        sscanf(latin.constData(), "%ce:%c%u/%u>>%u", &endian, &sign, &bits, &storageBits, &shift) != 5) {
+        sensordLogW() << "Unsupported scan element type" << type << "for" << name;
+        return false;
+    }
+    if ((endian != 'b' && endian != 'l') || (sign != 's' && sign != 'u') ||
+        bits == 0 || bits > storageBits || shift + bits > storageBits ||
+        (storageBits != 8 && storageBits != 16 && storageBits != 32 && storageBits != 64) ||
+        repeat != 1) {
+        sensordLogW() << "Unsupported scan element type" << type << "for" << name;
+        return false;
+    }
+
+    Channel channel;
+    channel.name = name;
+    channel.index = index;
+    channel.offset = 0;
+    channel.bytes = storageBits / 8;
+    channel.shift = shift;
+    channel.mask = bits == 64 ? ~0ULL : (1ULL << bits) - 1;
+    channel.signBit = sign == 's' ? 1ULL << (bits - 1) : 0;
+    channel.bigEndian = endian == 'b';
+
+    int i = 0;
+    while (i < channels_.size() && channels_.at(i).index < index)
+        ++i;
+    channels_.insert(i, channel);
+    return true;
+}
+
+void IioScanDecoder::finalize()
+{
+    // Every element is aligned to its own size and the scan to the
+    // largest element, as done by the kernel.
+    int offset = 0;
+    int largest = 1;
+    for (int i = 0; i < channels_.size(); ++i) {
+        Channel& channel = channels_[i];
+        offset = (offset + channel.bytes - 1) / channel.bytes * channel.bytes;
+        channel.offset = offset;
+        offset += channel.bytes;
+        largest = qMax(largest, channel.bytes);
+    }
+    scanSize_ = (offset + largest - 1) / largest * largest;
+    pending_ = 0;
+    pendingOffset_ = 0;
+}
+
+int IioScanDecoder::findChannel(const QString& suffix) const
+{
+    for (int i = 0; i < channels_.size(); ++i) {
+        if (channels_.at(i).name.endsWith(suffix))
+            return i;
+    }
+    return -1;
+}
+
+int IioScanDecoder::readScans(int fd, int maxScans)
+{
+    if (!scanSize_)
+        return -1;
+
+    // Move incomplete scan left over by the previous read to the front
+    if (pending_ && pendingOffset_)
+        memmove(buffer_.data(), buffer_.constData() + pendingOffset_, pending_);
+    pendingOffset_ = 0;
+
+    int capacity = qMax(maxScans, 1) * scanSize_;
+    if (buffer_.size() < capacity)
+        buffer_.resize(capacity);
+
+    ssize_t bytes = read(fd, buffer_.data() + pending_, capacity - pending_);
+    if (bytes < 0) {
+        if (errno != EAGAIN)
+            sensordLogW() << "read():" << strerror(errno);
+        return -1;
+    }
+
+    int total = pending_ + bytes;
+    int scans = total / scanSize_;
+    pending_ = total - scans * scanSize_;
+    pendingOffset_ = scans * scanSize_;
+    return scans;
+}
@@ -0,0 +1,155 @@
+/**
+   @file iioscandecoder.h
+   @brief Decoder for IIO buffer scans
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef IIOSCANDECODER_H
+#define IIOSCANDECODER_H
+
+#include <QString>
+#include <QVector>
+#include <QByteArray>
+
+/**
+ * Decoder for binary scans read from an IIO character device
+ * (@e /dev/iio:deviceX). Channels are described with the contents of
+ * their @e _type files in @e scan_elements, e.g. "le:s12/16>>4". The layout
+ * of a scan is computed once so decoding a channel is a load, a shift
+ * and a sign extension.
+ */
+class IioScanDecoder
+{
+public:
+    /**
+     * Precomputed unpacking of one channel.
+     */
+    struct Channel
+    {
+        QString  name;        /**< scan element name, e.g. in_accel_x */
+        int      index;       /**< position in scan */
+        int      offset;      /**< byte offset in scan */
+        int      bytes;       /**< storage bytes */
+        int      shift;       /**< right shift of stored value */
+        quint64  mask;        /**< mask of valid bits after shift */
+        quint64  signBit;     /**< sign bit, 0 for unsigned */
+        bool     bigEndian;   /**< byte order */
+    };
+
+    /**
+     * Constructor.
+     */
+    IioScanDecoder();
+
+    /**
+     * Forget channels and pending data.
+     */
+    void clear();
+
+    /**
+     * Add enabled channel. Layout is computed by finalize().
+     *
+     * @param name Scan element name.
+     * @param index Value of the _index file.
+     * @param type Value of the _type file.
+     * @return false if type could not be parsed.
+     */
+    bool addChannel(const QString& name, int index, const QString& type);
+
+    /**
+     * Compute channel offsets and scan size.
+     */
+    void finalize();
+
+    /**
+     * Bytes per scan.
+     */
+    int scanSize() const { return scanSize_; }
+
+    /**
+     * Number of channels.
+     */
+    int channelCount() const { return channels_.size(); }
+
+    /**
+     * Get channel in scan order.
+     *
+     * @param i Channel number.
+     */
+    const Channel& channel(int i) const { return channels_.at(i); }
+
+    /**
+     * Find channel whose name ends with given suffix.
+     *
+     * @param suffix Name suffix, e.g. "_x" or "timestamp".
+     * @return channel number or -1.
+     */
+    int findChannel(const QString& suffix) const;
+
+    /**
+     * Read as many complete scans as fit into the internal buffer with a
+     * single read(). Bytes of an incomplete scan are kept for the next
+     * call. Scans stay valid until the next call.
+     *
+     * @param fd Character device or other descriptor delivering scans.
+     * @param maxScans Capacity of the internal buffer in scans.
+     * @return number of complete scans available with scan(), -1 on error.
+     */
+    int readScans(int fd, int maxScans);
+
+    /**
+     * Get scan read by the last readScans().
+     *
+     * @param i Scan number.
+     */
+    const char* scan(int i) const { return buffer_.constData() + i * scanSize_; }
+
+    /**
+     * Decode value of channel from scan.
+     *
+     * @param scan Scan data.
+     * @param channel Channel number.
+     * @return value, sign extended for signed channels.
+     */
+    qint64 value(const char* scan, int channel) const
+    {
+        const Channel& c = channels_.at(channel);
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(scan) + c.offset;
+        quint64 raw = 0;
+        if (c.bigEndian) {
+            for (int i = 0; i < c.bytes; ++i)
+                raw = (raw << 8) | p[i];
+        } else {
+            for (int i = c.bytes - 1; i >= 0; --i)
+                raw = (raw << 8) | p[i];
+        }
+        raw = (raw >> c.shift) & c.mask;
+        if (raw & c.signBit)
+            raw |= ~c.mask;
+        return (qint64)raw;
+    }
+
+private:
+    QVector<Channel> channels_; /**< channels in scan order */
+    int              scanSize_; /**< bytes per scan */
+    QByteArray       buffer_;   /**< scans of last read */
+    int              pending_;  /**< bytes of incomplete scan kept in buffer */
+    int              pendingOffset_; /**< position of incomplete scan */
+};
+
+#endif // IIOSCANDECODER_H
@@ -74,7 +74,7 @@ void PegatronAccelerometerAdaptor::commitOutput(struct input_event *ev)
 {
     OrientationData* d = accelerometerBuffer_->nextSlot();
 
-    d->timestamp_ = Utils::getTimeStamp(&(ev->time));
+    d->timestamp_ = eventTimestamp(ev);
     d->x_ = orientationValue_.x_;
     d->y_ = orientationValue_.y_;
     d->z_ = orientationValue_.z_;
@@ -0,0 +1,406 @@
+/**
+   @file replayadaptor.cpp
+   @brief Adaptor replaying recorded traces
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "replayadaptor.h"
+#include "tracerecorder.h"
+#include "sensormanager.h"
+#include "config.h"
+#include "logging.h"
+#include "datatypes/utils.h"
+#include <QDir>
+#include <limits>
+#include <time.h>
+
+static const unsigned REPLAY_BUFFER_SIZE = 1024;
+static const quint64  COARSE_SLEEP_US = 2000;
+
+/* ------------------------------------------------------------------------- *
+ * ReplayPlayer
+ * ------------------------------------------------------------------------- */
+
+ReplayPlayer& ReplayPlayer::instance()
+{
+    static ReplayPlayer player;
+    return player;
+}
+
+ReplayPlayer::ReplayPlayer() :
+    realtime_(true),
+    loop_(false),
+    held_(false),
+    running_(true),
+    base_(0),
+    origin_(0),
+    traceTime_(0),
+    loopShift_(0),
+    replayed_(0)
+{
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    if (config) {
+        realtime_ = config->value<bool>("trace/replay_realtime", true);
+        loop_ = config->value<bool>("trace/replay_loop", false);
+    }
+}
+
+ReplayPlayer::~ReplayPlayer()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        running_ = false;
+        wake_.wakeAll();
+    }
+    wait();
+}
+
+void ReplayPlayer::setRealtime(bool realtime)
+{
+    QMutexLocker locker(&mutex_);
+    realtime_ = realtime;
+    restart();
+    wake_.wakeAll();
+}
+
+bool ReplayPlayer::realtime() const
+{
+    QMutexLocker locker(&mutex_);
+    return realtime_;
+}
+
+void ReplayPlayer::setLoop(bool loop)
+{
+    QMutexLocker locker(&mutex_);
+    loop_ = loop;
+    wake_.wakeAll();
+}
+
+void ReplayPlayer::setHeld(bool held)
+{
+    QMutexLocker locker(&mutex_);
+    held_ = held;
+    if (!held_)
+        restart();
+    wake_.wakeAll();
+}
+
+bool ReplayPlayer::isIdle() const
+{
+    QMutexLocker locker(&mutex_);
+    if (held_ || (loop_ && !active_.isEmpty()))
+        return false;
+    foreach (ReplayAdaptor* adaptor, active_) {
+        if (!adaptor->atEnd())
+            return false;
+    }
+    return true;
+}
+
+quint64 ReplayPlayer::replayed() const
+{
+    QMutexLocker locker(&mutex_);
+    return replayed_;
+}
+
+void ReplayPlayer::add(ReplayAdaptor* adaptor)
+{
+    QMutexLocker locker(&mutex_);
+    if (active_.contains(adaptor))
+        return;
+
+    active_.append(adaptor);
+    if (active_.size() == 1) {
+        restart();
+    } else if (realtime_) {
+        qint64 now = (qint64)Utils::getTimeStamp() - (qint64)origin_ + (qint64)base_ - loopShift_;
+        adaptor->seek(now > 0 ? (quint64)now : 0);
+    } else {
+        adaptor->seek(traceTime_);
+    }
+
+    if (!isRunning())
+        start();
+    wake_.wakeAll();
+}
+
+void ReplayPlayer::remove(ReplayAdaptor* adaptor)
+{
+    QMutexLocker locker(&mutex_);
+    active_.removeAll(adaptor);
+    wake_.wakeAll();
+}
+
+void ReplayPlayer::restart()
+{
+    base_ = std::numeric_limits<quint64>::max();
+    foreach (ReplayAdaptor* adaptor, active_) {
+        adaptor->seek(0);
+        if (!adaptor->atEnd())
+            base_ = qMin(base_, adaptor->nextTimestamp());
+    }
+    if (base_ == std::numeric_limits<quint64>::max())
+        base_ = 0;
+    origin_ = Utils::getTimeStamp();
+    traceTime_ = base_;
+    loopShift_ = 0;
+}
+
+bool ReplayPlayer::rewind()
+{
+    quint64 end = 0;
+    quint64 gap = std::numeric_limits<quint64>::max();
+    foreach (ReplayAdaptor* adaptor, active_) {
+        const TraceReader& trace = adaptor->trace();
+        if (!trace.count())
+            continue;
+        end = qMax(end, trace.timestamp(trace.count() - 1));
+        gap = qMin(gap, adaptor->meanPeriod());
+    }
+    if (end < base_ || gap == std::numeric_limits<quint64>::max())
+        return false;
+
+    // Next loop continues one period after the last sample
+    loopShift_ += (qint64)(end - base_ + gap);
+    foreach (ReplayAdaptor* adaptor, active_)
+        adaptor->seek(0);
+    traceTime_ = base_;
+    return true;
+}
+
+void ReplayPlayer::sleepUntil(quint64 due)
+{
+    quint64 now = Utils::getTimeStamp();
+    if (due > now + COARSE_SLEEP_US) {
+        // Long waits are cut short by add() and remove()
+        wake_.wait(&mutex_, (due - now - COARSE_SLEEP_US) / 1000 + 1);
+        return;
+    }
+
+    struct timespec ts;
+    ts.tv_sec = due / 1000000;
+    ts.tv_nsec = (due % 1000000) * 1000;
+    mutex_.unlock();
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+    mutex_.lock();
+}
+
+void ReplayPlayer::run()
+{
+    QMutexLocker locker(&mutex_);
+    while (running_) {
+        // Earliest pending sample, and the time up to which its trace
+        // can be written before another trace is due
+        ReplayAdaptor* next = 0;
+        quint64 nextTime = 0;
+        quint64 until = std::numeric_limits<quint64>::max();
+        if (!held_) {
+            foreach (ReplayAdaptor* adaptor, active_) {
+                if (adaptor->atEnd())
+                    continue;
+                quint64 time = adaptor->nextTimestamp();
+                if (!next || time < nextTime) {
+                    if (next)
+                        until = nextTime;
+                    next = adaptor;
+                    nextTime = time;
+                } else if (time < until) {
+                    until = time;
+                }
+            }
+        }
+
+        if (!next) {
+            if (!held_ && loop_ && rewind())
+                continue;
+            wake_.wait(&mutex_);
+            continue;
+        }
+
+        qint64 shift = loopShift_;
+        if (realtime_) {
+            shift += (qint64)origin_ - (qint64)base_;
+            qint64 now = Utils::getTimeStamp();
+            qint64 due = (qint64)nextTime + shift;
+            if (due > now) {
+                sleepUntil(due);
+                continue;
+            }
+            // Write everything already due at once
+            until = qMin(until, (quint64)(now - shift));
+        }
+
+        replayed_ += next->replay(until, shift);
+        traceTime_ = next->trace_.timestamp(next->position_ - 1);
+
+        // Executors only get the wakeup posted. Without waiting for them
+        // the next chunks would lap their readers.
+        if (!realtime_)
+            SensorManager::instance().waitForExecutors();
+    }
+}
+
+/* ------------------------------------------------------------------------- *
+ * ReplayAdaptor
+ * ------------------------------------------------------------------------- */
+
+QString ReplayAdaptor::tracePath(const QString& id)
+{
+    QString dir(SensorFrameworkConfig::configuration()->value<QString>("trace/replay"));
+    return QString("%1/%2.trace").arg(dir).arg(id);
+}
+
+QStringList ReplayAdaptor::registerTraces()
+{
+    QStringList ids;
+    QString dir(SensorFrameworkConfig::configuration()->value<QString>("trace/replay"));
+    if (dir.isEmpty())
+        return ids;
+
+    SensorManager& sm = SensorManager::instance();
+    foreach (const QString& file, QDir(dir).entryList(QStringList() << "*.trace", QDir::Files, QDir::Name)) {
+        TraceReader trace;
+        if (!trace.open(QDir(dir).filePath(file))) {
+            sensordLogW() << "Skipping trace:" << trace.errorString();
+            continue;
+        }
+        // Adaptor looks the trace up by id
+        QString id(trace.adaptor());
+        if (file != id + ".trace") {
+            sensordLogW() << "Skipping trace" << file << "recorded from" << id;
+            continue;
+        }
+        sensordLogD() << "registering replayadaptor for" << id;
+        sm.registerDeviceAdaptor<ReplayAdaptor>(id);
+        ids << id;
+    }
+    return ids;
+}
+
+ReplayAdaptor::ReplayAdaptor(const QString& id) :
+    DeviceAdaptor(id),
+    type_(0),
+    buffer_(0),
+    position_(0),
+    chunk_(REPLAY_BUFFER_SIZE / 4),
+    starts_(0)
+{
+    QString path(tracePath(id));
+    if (!trace_.open(path)) {
+        sensordLogW() << "Replay of" << id << "failed:" << trace_.errorString();
+        setValid(false);
+        return;
+    }
+
+    type_ = TraceType::find(trace_.typeName());
+    if (!type_ || type_->sampleSize != trace_.sampleSize()) {
+        sensordLogW() << "Replay of" << id << "failed: unsupported sample type" << trace_.typeName();
+        trace_.close();
+        setValid(false);
+        return;
+    }
+
+    buffer_ = type_->createBuffer(REPLAY_BUFFER_SIZE);
+    setAdaptedSensor(trace_.buffer(), QString("Replay of %1").arg(path), buffer_);
+    setDescription(QString("Replay of %1 recorded from %2").arg(path).arg(trace_.adaptor()));
+
+    introduceAvailableDataRanges(id);
+    if (SensorFrameworkConfig::configuration()->value(id + "/intervals").isValid()) {
+        introduceAvailableIntervals(id);
+    } else {
+        unsigned period = qMax(1u, (unsigned)(meanPeriod() / 1000));
+        introduceAvailableInterval(DataRange(period, qMax(period, 1000u), 0));
+    }
+}
+
+ReplayAdaptor::~ReplayAdaptor()
+{
+    if (starts_)
+        ReplayPlayer::instance().remove(this);
+    delete buffer_;
+}
+
+bool ReplayAdaptor::startAdaptor()
+{
+    return isValid();
+}
+
+void ReplayAdaptor::stopAdaptor()
+{
+    if (starts_) {
+        starts_ = 0;
+        ReplayPlayer::instance().remove(this);
+    }
+}
+
+bool ReplayAdaptor::startSensor()
+{
+    if (starts_++ == 0)
+        ReplayPlayer::instance().add(this);
+    return true;
+}
+
+void ReplayAdaptor::stopSensor()
+{
+    if (starts_ > 0 && --starts_ == 0)
+        ReplayPlayer::instance().remove(this);
+}
+
+bool ReplayAdaptor::setInterval(unsigned int value, int sessionId)
+{
+    // Samples come at the recorded rate
+    Q_UNUSED(value);
+    Q_UNUSED(sessionId);
+    return true;
+}
+
+quint64 ReplayAdaptor::meanPeriod() const
+{
+    quint64 count = trace_.count();
+    if (count < 2 || trace_.timestamp(count - 1) <= trace_.timestamp(0))
+        return 100000;
+    return qMax((quint64)1, (trace_.timestamp(count - 1) - trace_.timestamp(0)) / (count - 1));
+}
+
+void ReplayAdaptor::seek(quint64 time)
+{
+    // Recorded timestamps are increasing
+    quint64 low = 0;
+    quint64 high = trace_.count();
+    while (low < high) {
+        quint64 middle = low + (high - low) / 2;
+        if (trace_.timestamp(middle) < time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    position_ = low;
+}
+
+unsigned ReplayAdaptor::replay(quint64 until, qint64 shift)
+{
+    quint64 end = position_ + 1;
+    quint64 limit = qMin(trace_.count(), position_ + chunk_);
+    while (end < limit && trace_.timestamp(end) <= until)
+        ++end;
+
+    unsigned n = end - position_;
+    type_->replay(buffer_, trace_.sample(position_), n, shift);
+    position_ = end;
+    return n;
+}
@@ -0,0 +1,203 @@
+/**
+   @file replayadaptor.h
+   @brief Adaptor replaying recorded traces
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef REPLAYADAPTOR_H
+#define REPLAYADAPTOR_H
+
+#include "deviceadaptor.h"
+#include "tracefile.h"
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QStringList>
+
+class ReplayAdaptor;
+struct TraceType;
+
+/**
+ * Thread writing the samples of all started replay adaptors in the
+ * order of their recorded timestamps. One thread feeds every trace, so
+ * chains reading several adaptors see the same interleaving on every
+ * run.
+ *
+ * In real time mode samples are written when they are due relative to
+ * the start of the replay and their timestamps are moved to that time,
+ * so the rest of sensord sees live data. Otherwise samples are written
+ * as fast as the chains consume them with their original timestamps:
+ * after each chunk the player waits until chain executors are idle.
+ * With looping the traces start over after the last sample, timestamps
+ * continuing from where they ended.
+ *
+ * An adaptor started while others are replaying joins at the current
+ * trace time, like a real sensor would.
+ */
+class ReplayPlayer : public QThread
+{
+    Q_OBJECT
+public:
+    static ReplayPlayer& instance();
+
+    /**
+     * Replay in real time or as fast as possible.
+     */
+    void setRealtime(bool realtime);
+    bool realtime() const;
+
+    /**
+     * Start over after the end of the traces.
+     */
+    void setLoop(bool loop);
+
+    /**
+     * Hold the replay, e.g. until all adaptors of a chain are started.
+     * The replay starts from the beginning of the traces when released.
+     */
+    void setHeld(bool held);
+
+    /**
+     * Have all started traces been replayed to the end.
+     */
+    bool isIdle() const;
+
+    /**
+     * Samples written so far.
+     */
+    quint64 replayed() const;
+
+    /**
+     * Start replaying an adaptor.
+     */
+    void add(ReplayAdaptor* adaptor);
+
+    /**
+     * Stop replaying an adaptor.
+     */
+    void remove(ReplayAdaptor* adaptor);
+
+protected:
+    void run();
+
+private:
+    ReplayPlayer();
+    ~ReplayPlayer();
+
+    void restart();
+    bool rewind();
+    void sleepUntil(quint64 due);
+
+    mutable QMutex         mutex_;      /**< protects everything below */
+    QWaitCondition         wake_;       /**< wakes the thread on changes */
+    QList<ReplayAdaptor*>  active_;     /**< started adaptors */
+    bool                   realtime_;   /**< follow recorded timing */
+    bool                   loop_;       /**< start over at the end */
+    bool                   held_;       /**< replay is held */
+    bool                   running_;    /**< thread keeps running */
+    quint64                base_;       /**< trace time at origin_ */
+    quint64                origin_;     /**< monotonic time of replay start, us */
+    quint64                traceTime_;  /**< timestamp of last replayed sample */
+    qint64                 loopShift_;  /**< timestamp shift of current loop */
+    quint64                replayed_;   /**< samples written */
+};
+
+/**
+ * Adaptor replaying a trace recorded from another adaptor, see
+ * TraceRecorder. The trace is "<trace/replay>/<id>.trace" and the buffer
+ * has the name and sample type of the recorded one, so chains can not
+ * tell the replay from the adaptor.
+ *
+ * The rate is that of the recording, interval requests are accepted
+ * and ignored. Intervals and data ranges configured for the original
+ * adaptor id are reported; without them the recorded period is.
+ */
+class ReplayAdaptor : public DeviceAdaptor
+{
+    Q_OBJECT
+public:
+    static DeviceAdaptor* factoryMethod(const QString& id)
+    {
+        return new ReplayAdaptor(id);
+    }
+
+    /**
+     * Trace file replayed for adaptor id.
+     *
+     * @param id Adaptor id.
+     */
+    static QString tracePath(const QString& id);
+
+    /**
+     * Register a ReplayAdaptor for every trace in the "trace/replay"
+     * directory, under the id of the adaptor the trace was recorded
+     * from.
+     *
+     * @return registered adaptor ids.
+     */
+    static QStringList registerTraces();
+
+    bool startAdaptor();
+    void stopAdaptor();
+    bool startSensor();
+    void stopSensor();
+    void init() {}
+
+    /**
+     * Replayed trace.
+     */
+    const TraceReader& trace() const { return trace_; }
+
+protected:
+    ReplayAdaptor(const QString& id);
+    ~ReplayAdaptor();
+
+    bool setInterval(unsigned int value, int sessionId);
+
+private:
+    friend class ReplayPlayer;
+
+    bool atEnd() const { return position_ >= trace_.count(); }
+    quint64 nextTimestamp() const { return trace_.timestamp(position_); }
+    quint64 meanPeriod() const;
+
+    /**
+     * Move to the first sample not earlier than given trace time.
+     */
+    void seek(quint64 time);
+
+    /**
+     * Write the next sample and the following ones not later than
+     * until, at most one chunk.
+     *
+     * @param until Trace time.
+     * @param shift Added to timestamps.
+     * @return number of samples written.
+     */
+    unsigned replay(quint64 until, qint64 shift);
+
+    TraceReader      trace_;    /**< mapped trace */
+    const TraceType* type_;     /**< sample type of the trace */
+    RingBufferBase*  buffer_;   /**< output buffer */
+    quint64          position_; /**< next sample */
+    unsigned         chunk_;    /**< samples written per wakeup at most */
+    int              starts_;   /**< startSensor() nesting */
+};
+
+#endif // REPLAYADAPTOR_H
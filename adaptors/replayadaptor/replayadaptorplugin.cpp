@@ -1,12 +1,8 @@
 /**
-   @file fakeadaptorplugin.cpp
-   @brief Plugin for fake adaptor
+   @file replayadaptorplugin.cpp
+   @brief Plugin for ReplayAdaptor
 
    <p>
-   Copyright (C) 2009-2010 Nokia Corporation
-
-   @author Timo Rongas <ext-timo.2.rongas@nokia.com>
-
    This file is part of Sensord.
 
    Sensord is free software; you can redistribute it and/or modify
@@ -23,18 +19,17 @@
    </p>
 */
 
-#include "fakeadaptorplugin.h"
-#include "fakeadaptor.h"
-#include "sensormanager.h"
-#include <QtDebug>
+#include "replayadaptorplugin.h"
+#include "replayadaptor.h"
+#include "config.h"
+#include "logging.h"
 
-void FakeAdaptorPlugin::Register(class Loader&)
+void ReplayAdaptorPlugin::Register(class Loader&)
 {
-    qDebug() << "registering FAKE adaptor";
-    SensorManager& sm = SensorManager::instance();
-    sm.registerDeviceAdaptor<FakeAdaptor>("alsadaptor");
+    if (ReplayAdaptor::registerTraces().isEmpty())
+        sensordLogW() << "replayadaptor loaded but no traces found in trace/replay";
 }
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
-Q_EXPORT_PLUGIN2(alsadaptor, FakeAdaptorPlugin)
+Q_EXPORT_PLUGIN2(replayadaptor, ReplayAdaptorPlugin)
 #endif
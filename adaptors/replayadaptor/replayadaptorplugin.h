@@ -1,12 +1,8 @@
 /**
-   @file fakeadaptorplugin.h
-   @brief Plugin for fake adaptor
+   @file replayadaptorplugin.h
+   @brief Plugin for ReplayAdaptor
 
    <p>
-   Copyright (C) 2009-2010 Nokia Corporation
-
-   @author Timo Rongas <ext-timo.2.rongas@nokia.com>
-
    This file is part of Sensord.
 
    Sensord is free software; you can redistribute it and/or modify
@@ -23,12 +19,18 @@
    </p>
 */
 
-#ifndef FAKEADAPTORPLUGIN_H
-#define FAKEADAPTORPLUGIN_H
+#ifndef REPLAYADAPTORPLUGIN_H
+#define REPLAYADAPTORPLUGIN_H
 
 #include "plugin.h"
 
-class FakeAdaptorPlugin : public Plugin
+/**
+ * Registers a ReplayAdaptor for every trace in the "trace/replay"
+ * directory, under the id of the adaptor the trace was recorded from.
+ * Map the plugin names of those adaptors to this plugin in [plugins]
+ * so that it is loaded instead of them.
+ */
+class ReplayAdaptorPlugin : public Plugin
 {
     Q_OBJECT
 #if QT_VERSION >= QT_VERSION_CHECK(5, 0, 0)
@@ -69,7 +69,7 @@ void TapAdaptor::interpretEvent(int src, struct input_event *ev)
         }
         TapData tapValue;
         tapValue.direction_ = dir;
-        tapValue.timestamp_ = Utils::getTimeStamp(&(ev->time));
+        tapValue.timestamp_ = eventTimestamp(ev);
         tapValue.type_ = TapData::SingleTap;
 
         commitOutput(tapValue);
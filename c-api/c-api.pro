@@ -0,0 +1,17 @@
+TEMPLATE = lib
+TARGET = sensorfw-c
+
+# Plain C client library, only libdbus and libc are linked
+CONFIG -= qt
+CONFIG += link_pkgconfig thread
+PKGCONFIG += dbus-1
+QMAKE_CFLAGS += -std=gnu99
+INCLUDEPATH += ../include
+
+SOURCES += sensorfw-c.c
+HEADERS += sensorfw-c.h
+
+include(../common-install.pri)
+publicheaders.files = $$HEADERS
+target.path = $$SHAREDLIBPATH
+INSTALLS += target
@@ -0,0 +1,957 @@
+/**
+   @file sensorfw-c.c
+   @brief C-API for sensor framework
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "sensorfw-c.h"
+#include "wireprotocol.h"
+
+#include <dbus/dbus.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define SERVICE_NAME "com.nokia.SensorService"
+#define OBJECT_PATH "/SensorManager"
+#define MANAGER_INTERFACE "local.SensorManager"
+#define PROPERTIES_INTERFACE "org.freedesktop.DBus.Properties"
+#define SOCKET_NAME "/var/run/sensord.sock"
+
+/* Frames larger than this mean the stream is out of sync, same limit as
+ * DataConnection uses. */
+#define MAX_FRAME_SIZE (1 << 20)
+
+/* How long sensord may take to accept the data connection or a session. */
+#define CONNECT_TIMEOUT_MS 5000
+
+#define RECEIVE_BUFFER_SIZE 4096
+
+/* Samples queued for a session that is not read. Frames arriving over this
+ * are discarded and counted as dropped, so one idle session cannot make the
+ * process buffer the whole shared stream. */
+#define MAX_QUEUE_SIZE MAX_FRAME_SIZE
+
+struct sensorfw_session;
+
+/* Data connection shared by all sessions of the process, see DataConnection
+ * for the Qt counterpart. A lost connection stays with its sessions until
+ * they are closed, new sessions get a new one. */
+typedef struct sensorfw_connection {
+    int fd;                           /* data socket */
+    int users;                        /* sessions attached */
+    bool lost;                        /* closed by sensord or out of sync */
+    uint16_t sample_version;          /* SENSORFW_WIRE_SAMPLE_US or SENSORFW_WIRE_SAMPLE_NS */
+    bool header_read;                 /* header of the current frame received */
+    sensorfw_wire_frame_t header;     /* header of the current frame */
+    size_t skip;                      /* header extension bytes not yet received */
+    size_t remaining;                 /* sample bytes of the current frame not yet received */
+    struct sensorfw_session* target;  /* receiver of the current frame, NULL discards */
+    size_t rx_start;                  /* first unconsumed byte in rx */
+    size_t rx_end;                    /* end of received bytes in rx */
+    char rx[RECEIVE_BUFFER_SIZE];
+} sensorfw_connection_t;
+
+typedef struct sensorfw_session {
+    struct sensorfw_session* next;
+    int refs;                /* list and callers using it, protected by lock */
+    int id;                  /* session ID given by sensord */
+    char* sensor;            /* sensor name */
+    char* path;              /* D-Bus object of the sensor */
+    sensorfw_connection_t* connection; /* data connection */
+    bool attached;           /* attach acknowledged by sensord */
+    size_t sample_size;      /* bytes per sample */
+    char* queue;             /* samples received for the session */
+    size_t queue_start;      /* first unread byte in queue */
+    size_t queue_end;        /* end of received bytes in queue */
+    size_t queue_size;       /* allocated bytes of queue */
+    uint32_t dropped;        /* samples dropped by sensord or overflow so far */
+    uint32_t overflow;       /* samples discarded because the queue was full */
+    bool running;            /* started by this session */
+    char* description;       /* result of sensorfw_get_description */
+    char* error_string;      /* result of sensorfw_last_error */
+} sensorfw_session_t;
+
+static const struct {
+    const char* sensor;
+    size_t sample_size;
+} sample_sizes[] = {
+    { "accelerometersensor", sizeof(sensorfw_xyz_t) },
+    { "alssensor",           sizeof(sensorfw_unsigned_t) },
+    { "compasssensor",       sizeof(sensorfw_compass_t) },
+    { "gyroscopesensor",     sizeof(sensorfw_xyz_t) },
+    { "humiditysensor",      sizeof(sensorfw_unsigned_t) },
+    { "lidsensor",           sizeof(sensorfw_lid_t) },
+    { "magnetometersensor",  sizeof(sensorfw_magnetic_field_t) },
+    { "orientationsensor",   sizeof(sensorfw_unsigned_t) },
+    { "pressuresensor",      sizeof(sensorfw_unsigned_t) },
+    { "proximitysensor",     sizeof(sensorfw_proximity_t) },
+    { "rotationsensor",      sizeof(sensorfw_xyz_t) },
+    { "stepcountersensor",   sizeof(sensorfw_unsigned_t) },
+    { "tapsensor",           sizeof(sensorfw_tap_t) },
+    { "temperaturesensor",   sizeof(sensorfw_unsigned_t) },
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER; /* protects bus and sessions */
+static DBusConnection* bus;
+static sensorfw_session_t* sessions;
+
+/* Protects connections and session queues. Taken before lock. */
+static pthread_mutex_t rx_lock = PTHREAD_MUTEX_INITIALIZER;
+static sensorfw_connection_t* current_connection;
+static bool nanosecond_timestamps;
+
+static size_t sample_size_of(const char* sensor)
+{
+    size_t i;
+    for (i = 0; i < sizeof(sample_sizes) / sizeof(sample_sizes[0]); ++i) {
+        if (!strcmp(sample_sizes[i].sensor, sensor))
+            return sample_sizes[i].sample_size;
+    }
+    return 0;
+}
+
+/* Returns a reference to the system bus connection, reconnecting if sensord
+ * or the bus went away. */
+static DBusConnection* get_bus(void)
+{
+    DBusConnection* conn;
+
+    pthread_mutex_lock(&lock);
+    if (bus && !dbus_connection_get_is_connected(bus)) {
+        dbus_connection_close(bus);
+        dbus_connection_unref(bus);
+        bus = NULL;
+    }
+    if (!bus) {
+        DBusError err;
+        dbus_error_init(&err);
+        dbus_threads_init_default();
+        /* Private connection, so the exit-on-disconnect setting or a close
+         * here never affects other libdbus users of the process. */
+        bus = dbus_bus_get_private(DBUS_BUS_SYSTEM, &err);
+        if (bus)
+            dbus_connection_set_exit_on_disconnect(bus, FALSE);
+        dbus_error_free(&err);
+    }
+    conn = bus ? dbus_connection_ref(bus) : NULL;
+    pthread_mutex_unlock(&lock);
+    return conn;
+}
+
+/* Calls a method of sensord and waits for the reply. Returns NULL if the
+ * call failed. */
+static DBusMessage* call_method(const char* path, const char* interface, const char* method,
+                                int first_arg_type, ...)
+{
+    DBusConnection* conn;
+    DBusMessage* msg;
+    DBusMessage* reply = NULL;
+    va_list args;
+    dbus_bool_t ok;
+
+    conn = get_bus();
+    if (!conn)
+        return NULL;
+    msg = dbus_message_new_method_call(SERVICE_NAME, path, interface, method);
+    if (msg) {
+        va_start(args, first_arg_type);
+        ok = dbus_message_append_args_valist(msg, first_arg_type, args);
+        va_end(args);
+        if (ok) {
+            DBusError err;
+            dbus_error_init(&err);
+            reply = dbus_connection_send_with_reply_and_block(conn, msg, DBUS_TIMEOUT_USE_DEFAULT, &err);
+            dbus_error_free(&err);
+        }
+        dbus_message_unref(msg);
+    }
+    dbus_connection_unref(conn);
+    return reply;
+}
+
+/* Reads the single return value of a reply and frees the reply. Type
+ * DBUS_TYPE_INVALID only checks that a reply arrived. */
+static bool take_reply(DBusMessage* reply, int type, void* value)
+{
+    bool ok = true;
+
+    if (!reply)
+        return false;
+    if (type != DBUS_TYPE_INVALID) {
+        DBusError err;
+        dbus_error_init(&err);
+        ok = dbus_message_get_args(reply, &err, type, value, DBUS_TYPE_INVALID);
+        dbus_error_free(&err);
+    }
+    dbus_message_unref(reply);
+    return ok;
+}
+
+/* Reads a property of the sensor. Strings are returned as a copy which the
+ * caller frees. */
+static bool get_property(const sensorfw_session_t* session, const char* name, int type, void* value)
+{
+    /* Empty interface makes sensord look the property up from every interface
+     * of the object, so the sensor specific interface name is not needed. */
+    const char* interface = "";
+    DBusMessage* reply;
+    DBusMessageIter iter;
+    DBusMessageIter variant;
+    bool ok;
+
+    reply = call_method(session->path, PROPERTIES_INTERFACE, "Get",
+                        DBUS_TYPE_STRING, &interface,
+                        DBUS_TYPE_STRING, &name,
+                        DBUS_TYPE_INVALID);
+    if (!reply)
+        return false;
+    ok = dbus_message_iter_init(reply, &iter) &&
+         dbus_message_iter_get_arg_type(&iter) == DBUS_TYPE_VARIANT;
+    if (ok) {
+        dbus_message_iter_recurse(&iter, &variant);
+        ok = dbus_message_iter_get_arg_type(&variant) == type;
+    }
+    if (ok) {
+        if (type == DBUS_TYPE_STRING) {
+            const char* str;
+            dbus_message_iter_get_basic(&variant, &str);
+            *(char**)value = strdup(str);
+            ok = *(char**)value != NULL;
+        } else {
+            dbus_message_iter_get_basic(&variant, value);
+        }
+    }
+    dbus_message_unref(reply);
+    return ok;
+}
+
+/* Called with lock held. */
+static sensorfw_session_t* lookup_session(int id)
+{
+    sensorfw_session_t* session;
+
+    for (session = sessions; session && session->id != id; session = session->next)
+        ;
+    return session;
+}
+
+/* Returns a listed session with a reference the caller drops with
+ * put_session, so a concurrent sensorfw_close_session cannot free it. */
+static sensorfw_session_t* get_session(int id)
+{
+    sensorfw_session_t* session;
+
+    pthread_mutex_lock(&lock);
+    session = lookup_session(id);
+    if (session)
+        ++session->refs;
+    pthread_mutex_unlock(&lock);
+    return session;
+}
+
+static void detach_session(sensorfw_session_t* session);
+
+static void free_session(sensorfw_session_t* session)
+{
+    detach_session(session);
+    free(session->queue);
+    free(session->sensor);
+    free(session->path);
+    free(session->description);
+    free(session->error_string);
+    free(session);
+}
+
+/* Drops a reference, the last one frees the session. Must not be called
+ * with rx_lock held, see detach_session. */
+static void put_session(sensorfw_session_t* session)
+{
+    bool last;
+
+    pthread_mutex_lock(&lock);
+    last = !--session->refs;
+    pthread_mutex_unlock(&lock);
+    if (last)
+        free_session(session);
+}
+
+/* Removes a session from the list. The reference of the list passes to
+ * the caller. */
+static sensorfw_session_t* unlink_session(int id)
+{
+    sensorfw_session_t** link;
+    sensorfw_session_t* session = NULL;
+
+    pthread_mutex_lock(&lock);
+    for (link = &sessions; *link; link = &(*link)->next) {
+        if ((*link)->id == id) {
+            session = *link;
+            *link = session->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return session;
+}
+
+static bool release_sensor(const sensorfw_session_t* session)
+{
+    const char* sensor = session->sensor;
+    dbus_int32_t id = session->id;
+    dbus_int64_t pid = getpid();
+    dbus_bool_t released = FALSE;
+
+    return take_reply(call_method(OBJECT_PATH, MANAGER_INTERFACE, "releaseSensor",
+                                  DBUS_TYPE_STRING, &sensor,
+                                  DBUS_TYPE_INT32, &id,
+                                  DBUS_TYPE_INT64, &pid,
+                                  DBUS_TYPE_INVALID),
+                      DBUS_TYPE_BOOLEAN, &released) && released;
+}
+
+/* Opens a data connection speaking version 2, or 3 for nanosecond
+ * timestamps, see DataConnection::open for the Qt counterpart. */
+static sensorfw_connection_t* open_connection(bool nanoseconds)
+{
+    struct sockaddr_un addr;
+    struct pollfd pfd;
+    const char* prefix = getenv("SENSORFW_SOCKET_PATH");
+    sensorfw_wire_hello_t hello = { SENSORFW_WIRE_MAGIC, nanoseconds ? 3 : 2 };
+    char reply[1 + sizeof(hello)];
+    size_t received = 0;
+    sensorfw_connection_t* conn;
+    int len;
+    int fd;
+    int flags;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s%s", prefix ? prefix : "", SOCKET_NAME);
+    if (len < 0 || (size_t)len >= sizeof(addr.sun_path))
+        return NULL;
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return NULL;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        goto fail;
+    if (send(fd, &hello, sizeof(hello), MSG_NOSIGNAL) != sizeof(hello))
+        goto fail;
+
+    /* sensord greets every connection with one byte before the reply. */
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    while (received < sizeof(reply)) {
+        ssize_t bytes;
+        if (poll(&pfd, 1, CONNECT_TIMEOUT_MS) != 1)
+            goto fail;
+        bytes = recv(fd, reply + received, sizeof(reply) - received, 0);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0)
+            goto fail;
+        received += bytes;
+    }
+    memcpy(&hello, reply + 1, sizeof(hello));
+    if (hello.magic != SENSORFW_WIRE_MAGIC || hello.version < (nanoseconds ? 3 : 2))
+        goto fail;
+
+    flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        goto fail;
+    conn = calloc(1, sizeof(*conn));
+    if (!conn)
+        goto fail;
+    conn->fd = fd;
+    conn->sample_version = nanoseconds ? SENSORFW_WIRE_SAMPLE_NS : SENSORFW_WIRE_SAMPLE_US;
+    return conn;
+
+fail:
+    close(fd);
+    return NULL;
+}
+
+/* Called with rx_lock held. */
+static sensorfw_connection_t* acquire_connection(void)
+{
+    uint16_t version = nanosecond_timestamps ? SENSORFW_WIRE_SAMPLE_NS : SENSORFW_WIRE_SAMPLE_US;
+
+    /* A connection of the other timestamp unit stays with its sessions */
+    if (!current_connection || current_connection->lost ||
+        current_connection->sample_version != version) {
+        sensorfw_connection_t* conn = open_connection(version == SENSORFW_WIRE_SAMPLE_NS);
+        if (!conn)
+            return NULL;
+        current_connection = conn;
+    }
+    ++current_connection->users;
+    return current_connection;
+}
+
+/* Called with rx_lock held. */
+static void release_connection(sensorfw_connection_t* conn)
+{
+    if (--conn->users)
+        return;
+    if (current_connection == conn)
+        current_connection = NULL;
+    close(conn->fd);
+    free(conn);
+}
+
+static bool send_request(sensorfw_connection_t* conn, uint32_t op, int id)
+{
+    sensorfw_wire_request_t request = { op, id };
+    ssize_t bytes;
+
+    do
+        bytes = send(conn->fd, &request, sizeof(request), MSG_NOSIGNAL);
+    while (bytes < 0 && errno == EINTR);
+    return bytes == sizeof(request);
+}
+
+/* Appends received sample bytes to the queue of a session. */
+static bool enqueue(sensorfw_session_t* session, const char* data, size_t n)
+{
+    if (session->queue_end + n > session->queue_size) {
+        size_t used = session->queue_end - session->queue_start;
+        if (session->queue_start) {
+            memmove(session->queue, session->queue + session->queue_start, used);
+            session->queue_start = 0;
+            session->queue_end = used;
+        }
+        if (used + n > session->queue_size) {
+            size_t size = session->queue_size ? session->queue_size : RECEIVE_BUFFER_SIZE;
+            char* queue;
+            while (size < used + n)
+                size *= 2;
+            queue = realloc(session->queue, size);
+            if (!queue)
+                return false;
+            session->queue = queue;
+            session->queue_size = size;
+        }
+    }
+    memcpy(session->queue + session->queue_end, data, n);
+    session->queue_end += n;
+    return true;
+}
+
+/* Finds the session the current frame belongs to and accounts for it.
+ * Returns NULL if the samples are to be discarded. Called with rx_lock
+ * held, which keeps the session alive without a reference: it is freed
+ * only after detach_session, and that waits for rx_lock. */
+static sensorfw_session_t* frame_target(sensorfw_connection_t* conn)
+{
+    const sensorfw_wire_frame_t* header = &conn->header;
+    sensorfw_session_t* session;
+    bool accepted;
+
+    pthread_mutex_lock(&lock);
+    session = lookup_session(header->channel);
+    pthread_mutex_unlock(&lock);
+    if (!session || session->connection != conn)
+        return NULL;
+
+    /* First frame of a session acknowledges the attach. */
+    session->attached = true;
+
+    accepted = header->count &&
+               header->sampleSize == session->sample_size &&
+               header->sampleVersion == conn->sample_version;
+    if (accepted && session->queue_end - session->queue_start + conn->remaining > MAX_QUEUE_SIZE) {
+        session->overflow += header->count;
+        accepted = false;
+    }
+    session->dropped = header->dropped + session->overflow;
+    return accepted ? session : NULL;
+}
+
+/* Moves received frames to the queues of their sessions. Partial frames
+ * are delivered as they arrive, sessions only read whole samples. Returns
+ * false if the stream is out of sync. */
+static bool dispatch(sensorfw_connection_t* conn)
+{
+    for (;;) {
+        size_t available = conn->rx_end - conn->rx_start;
+        size_t n;
+
+        if (!conn->header_read) {
+            const sensorfw_wire_frame_t* header = &conn->header;
+            if (available < sizeof(conn->header))
+                return true;
+            memcpy(&conn->header, conn->rx + conn->rx_start, sizeof(conn->header));
+            conn->rx_start += sizeof(conn->header);
+            if (header->headerSize < sizeof(*header) ||
+                header->size < header->headerSize ||
+                header->size > MAX_FRAME_SIZE ||
+                (uint64_t)header->count * header->sampleSize != header->size - header->headerSize)
+                return false;
+            conn->header_read = true;
+            conn->skip = header->headerSize - sizeof(*header);
+            conn->remaining = header->size - header->headerSize;
+            conn->target = frame_target(conn);
+            continue;
+        }
+
+        n = conn->skip ? conn->skip : conn->remaining;
+        if (n > available)
+            n = available;
+        if (conn->skip) {
+            conn->skip -= n;
+        } else if (n) {
+            sensorfw_session_t* target = conn->target;
+            if (target && !enqueue(target, conn->rx + conn->rx_start, n)) {
+                /* Out of memory. Rest of the frame is dropped, the queue
+                 * keeps whole samples only. */
+                target->queue_end -= (target->queue_end - target->queue_start) % target->sample_size;
+                conn->target = NULL;
+            }
+            conn->remaining -= n;
+        }
+        conn->rx_start += n;
+        if (conn->skip || conn->remaining) {
+            if (n == available)
+                return true;
+            continue;
+        }
+        conn->header_read = false;
+    }
+}
+
+/* Receives what sensord has sent without blocking. Returns 1 if bytes
+ * arrived, 0 if none were waiting and -1 if the connection is lost. */
+static int receive(sensorfw_connection_t* conn)
+{
+    ssize_t bytes;
+
+    if (conn->lost)
+        return -1;
+    if (conn->rx_start) {
+        memmove(conn->rx, conn->rx + conn->rx_start, conn->rx_end - conn->rx_start);
+        conn->rx_end -= conn->rx_start;
+        conn->rx_start = 0;
+    }
+    do
+        bytes = recv(conn->fd, conn->rx + conn->rx_end, sizeof(conn->rx) - conn->rx_end, 0);
+    while (bytes < 0 && errno == EINTR);
+    if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        return 0;
+    if (bytes > 0) {
+        conn->rx_end += bytes;
+        if (dispatch(conn))
+            return 1;
+    }
+    conn->lost = true;
+    return -1;
+}
+
+/* Receives frames until sensord has acknowledged the session. */
+static bool attach_session(sensorfw_session_t* session)
+{
+    sensorfw_connection_t* conn;
+    struct pollfd pfd;
+
+    pthread_mutex_lock(&rx_lock);
+    conn = acquire_connection();
+    if (conn) {
+        session->connection = conn;
+        if (send_request(conn, SENSORFW_WIRE_ATTACH, session->id)) {
+            /* Session is configured over D-Bus right after this, so
+             * sensord must know it first. Frames of other sessions
+             * arriving meanwhile are queued for them. */
+            pfd.fd = conn->fd;
+            pfd.events = POLLIN;
+            while (!session->attached && poll(&pfd, 1, CONNECT_TIMEOUT_MS) == 1 && receive(conn) >= 0)
+                ;
+        }
+        if (!session->attached) {
+            release_connection(conn);
+            session->connection = NULL;
+        }
+    }
+    pthread_mutex_unlock(&rx_lock);
+    return session->attached;
+}
+
+static void detach_session(sensorfw_session_t* session)
+{
+    sensorfw_connection_t* conn;
+
+    pthread_mutex_lock(&rx_lock);
+    conn = session->connection;
+    if (conn) {
+        if (conn->target == session)
+            conn->target = NULL;
+        if (!conn->lost)
+            send_request(conn, SENSORFW_WIRE_DETACH, session->id);
+        release_connection(conn);
+        session->connection = NULL;
+    }
+    pthread_mutex_unlock(&rx_lock);
+}
+
+/* Copies whole samples already queued, at most max. */
+static int take_samples(sensorfw_session_t* session, char* dest, int max)
+{
+    size_t count = (session->queue_end - session->queue_start) / session->sample_size;
+
+    if (count > (size_t)max)
+        count = max;
+    if (count) {
+        memcpy(dest, session->queue + session->queue_start, count * session->sample_size);
+        session->queue_start += count * session->sample_size;
+        if (session->queue_start == session->queue_end)
+            session->queue_start = session->queue_end = 0;
+    }
+    return count;
+}
+
+bool sensorfw_init(const char* sensor_name)
+{
+    dbus_bool_t loaded = FALSE;
+
+    if (!sensor_name)
+        return false;
+    return take_reply(call_method(OBJECT_PATH, MANAGER_INTERFACE, "loadPlugin",
+                                  DBUS_TYPE_STRING, &sensor_name,
+                                  DBUS_TYPE_INVALID),
+                      DBUS_TYPE_BOOLEAN, &loaded) && loaded;
+}
+
+void sensorfw_set_nanosecond_timestamps(bool enable)
+{
+    pthread_mutex_lock(&rx_lock);
+    nanosecond_timestamps = enable;
+    pthread_mutex_unlock(&rx_lock);
+}
+
+int sensorfw_open_session(const char* sensor_name)
+{
+    sensorfw_session_t* session;
+    dbus_int64_t pid = getpid();
+    dbus_int32_t id = -1;
+    size_t sample_size;
+
+    if (!sensor_name)
+        return -1;
+    sample_size = sample_size_of(sensor_name);
+    if (!sample_size)
+        return -1;
+
+    session = calloc(1, sizeof(*session));
+    if (!session)
+        return -1;
+    session->refs = 1;
+    session->sample_size = sample_size;
+    session->sensor = strdup(sensor_name);
+    session->path = malloc(strlen(OBJECT_PATH "/") + strlen(sensor_name) + 1);
+    if (!session->sensor || !session->path) {
+        free_session(session);
+        return -1;
+    }
+    sprintf(session->path, "%s/%s", OBJECT_PATH, sensor_name);
+
+    if (!take_reply(call_method(OBJECT_PATH, MANAGER_INTERFACE, "requestSensor",
+                                DBUS_TYPE_STRING, &sensor_name,
+                                DBUS_TYPE_INT64, &pid,
+                                DBUS_TYPE_INVALID),
+                    DBUS_TYPE_INT32, &id) || id < 0) {
+        free_session(session);
+        return -1;
+    }
+    session->id = id;
+
+    /* Listed first, frames are routed to listed sessions only. */
+    pthread_mutex_lock(&lock);
+    session->next = sessions;
+    sessions = session;
+    pthread_mutex_unlock(&lock);
+
+    if (!attach_session(session)) {
+        unlink_session(id);
+        release_sensor(session);
+        put_session(session);
+        return -1;
+    }
+    return id;
+}
+
+bool sensorfw_close_session(int sessionId)
+{
+    sensorfw_session_t* session = unlink_session(sessionId);
+    bool released;
+
+    if (!session)
+        return false;
+
+    /* Calls still using the session keep it until they return, its
+     * samples stop right away. */
+    detach_session(session);
+    released = release_sensor(session);
+    put_session(session);
+    return released;
+}
+
+bool sensorfw_start_sensor(int sessionId)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    dbus_int32_t id = sessionId;
+    bool started;
+
+    if (!session)
+        return false;
+    started = take_reply(call_method(session->path, NULL, "start",
+                                     DBUS_TYPE_INT32, &id,
+                                     DBUS_TYPE_INVALID),
+                         DBUS_TYPE_INVALID, NULL);
+    if (started)
+        session->running = true;
+    put_session(session);
+    return started;
+}
+
+bool sensorfw_stop_sensor(int sessionId)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    dbus_int32_t id = sessionId;
+    bool stopped;
+
+    if (!session)
+        return false;
+    stopped = take_reply(call_method(session->path, NULL, "stop",
+                                     DBUS_TYPE_INT32, &id,
+                                     DBUS_TYPE_INVALID),
+                         DBUS_TYPE_INVALID, NULL);
+    if (stopped)
+        session->running = false;
+    put_session(session);
+    return stopped;
+}
+
+bool sensorfw_running(int sessionId)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    bool running;
+
+    if (!session)
+        return false;
+    running = session->running;
+    put_session(session);
+    return running;
+}
+
+int sensorfw_get_interval(int sessionId)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    dbus_uint32_t interval;
+    bool ok;
+
+    if (!session)
+        return -1;
+    ok = get_property(session, "interval", DBUS_TYPE_UINT32, &interval);
+    put_session(session);
+    return ok ? (int)interval : -1;
+}
+
+bool sensorfw_set_interval(int sessionId, int interval)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    dbus_int32_t id = sessionId;
+    dbus_int32_t value = interval;
+    bool set;
+
+    if (!session)
+        return false;
+    set = take_reply(call_method(session->path, NULL, "setInterval",
+                                 DBUS_TYPE_INT32, &id,
+                                 DBUS_TYPE_INT32, &value,
+                                 DBUS_TYPE_INVALID),
+                     DBUS_TYPE_INVALID, NULL);
+    put_session(session);
+    return set;
+}
+
+bool sensorfw_get_standby_override(int sessionId)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    dbus_bool_t value = FALSE;
+    bool ok;
+
+    if (!session)
+        return false;
+    ok = get_property(session, "standbyOverride", DBUS_TYPE_BOOLEAN, &value);
+    put_session(session);
+    return ok && value;
+}
+
+bool sensorfw_set_standby_override(int sessionId, bool override)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    dbus_int32_t id = sessionId;
+    dbus_bool_t value = override;
+    dbus_bool_t set = FALSE;
+    bool ok;
+
+    if (!session)
+        return false;
+    ok = take_reply(call_method(session->path, NULL, "setStandbyOverride",
+                                DBUS_TYPE_INT32, &id,
+                                DBUS_TYPE_BOOLEAN, &value,
+                                DBUS_TYPE_INVALID),
+                    DBUS_TYPE_BOOLEAN, &set);
+    put_session(session);
+    return ok && set;
+}
+
+bool sensorfw_get_description(int sessionId, char** description)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    char* value;
+    bool ok;
+
+    if (!session)
+        return false;
+    ok = description && get_property(session, "description", DBUS_TYPE_STRING, &value);
+    if (ok) {
+        free(session->description);
+        session->description = value;
+        *description = value;
+    }
+    put_session(session);
+    return ok;
+}
+
+int sensorfw_get_fd(int sessionId)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    int fd = -1;
+
+    if (!session)
+        return -1;
+    pthread_mutex_lock(&rx_lock);
+    if (session->connection)
+        fd = session->connection->fd;
+    pthread_mutex_unlock(&rx_lock);
+    put_session(session);
+    return fd;
+}
+
+size_t sensorfw_get_sample_size(int sessionId)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    size_t sample_size;
+
+    if (!session)
+        return 0;
+    sample_size = session->sample_size;
+    put_session(session);
+    return sample_size;
+}
+
+int sensorfw_read(int sessionId, void* buf, int max)
+{
+    sensorfw_session_t* session;
+    char* dest = buf;
+    int count = 0;
+
+    if (!buf || max < 0)
+        return -1;
+    session = get_session(sessionId);
+    if (!session)
+        return -1;
+
+    pthread_mutex_lock(&rx_lock);
+    while (session->connection) {
+        int received;
+        count += take_samples(session, dest + count * session->sample_size, max - count);
+        if (count == max)
+            break;
+        received = receive(session->connection);
+        if (received > 0)
+            continue;
+        /* Connection lost. Samples read so far are returned first, the
+         * next call reports the loss. */
+        if (received < 0 && !count)
+            count = -1;
+        break;
+    }
+    if (!session->connection)
+        count = -1;
+    pthread_mutex_unlock(&rx_lock);
+    put_session(session);
+    return count;
+}
+
+unsigned long sensorfw_get_dropped(int sessionId)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    unsigned long dropped;
+
+    if (!session)
+        return 0;
+    pthread_mutex_lock(&rx_lock);
+    dropped = session->dropped;
+    pthread_mutex_unlock(&rx_lock);
+    put_session(session);
+    return dropped;
+}
+
+bool sensorfw_prepare_for_calibration(int sessionId)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    bool reset;
+
+    if (!session)
+        return false;
+    reset = take_reply(call_method(session->path, NULL, "reset", DBUS_TYPE_INVALID),
+                       DBUS_TYPE_INVALID, NULL);
+    put_session(session);
+    return reset;
+}
+
+int sensorfw_last_error(int sessionId, char** error_string)
+{
+    sensorfw_session_t* session = get_session(sessionId);
+    dbus_int32_t code;
+    char* value;
+
+    if (!session)
+        return -1;
+    if (!get_property(session, "errorCodeInt", DBUS_TYPE_INT32, &code) ||
+        (error_string && !get_property(session, "errorString", DBUS_TYPE_STRING, &value))) {
+        put_session(session);
+        return -1;
+    }
+    if (error_string) {
+        free(session->error_string);
+        session->error_string = value;
+        *error_string = value;
+    }
+    put_session(session);
+    return code;
+}
@@ -1,13 +1,14 @@
 /**
    @file sensorfw-c.h
-   @brief C-API for sensor framework. <b>NOTE THAT THIS HAS NOT BEEN IMPLEMENTED YET<b>
+   @brief C-API for sensor framework.
+
+   Client library without Qt. Control requests go to sensord over D-Bus
+   with libdbus, samples are read straight from the sensord socket.
 
     @todo
     <ul>
     <li>Querying and setting values for Data range</li>
     <li>Querying possible values for Interval and Data range</li>
-    <li>Control / Listen separation?</li>
-    <li>Generic type for callbacks, or callback must know what to expect?</li>
     </ul>
 
    <p>
@@ -34,6 +35,14 @@
 #ifndef SENSORFW_CAPI
 #define SENSORFW_CAPI
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Structure containing interval information for sensor.
  *
@@ -54,6 +63,77 @@ typedef struct {
     int accuracy; ///< Minimal detected change
 } sensorfw_range_t;
 
+/**
+ * @brief Sample of accelerometersensor, gyroscopesensor and rotationsensor.
+ */
+typedef struct {
+    uint64_t timestamp; ///< Monotonic time (microsec, see sensorfw_set_nanosecond_timestamps)
+    int32_t x; ///< X value
+    int32_t y; ///< Y value
+    int32_t z; ///< Z value
+} sensorfw_xyz_t;
+
+/**
+ * @brief Sample of alssensor, humiditysensor, orientationsensor,
+ * pressuresensor, stepcountersensor and temperaturesensor.
+ */
+typedef struct {
+    uint64_t timestamp; ///< Monotonic time (microsec, see sensorfw_set_nanosecond_timestamps)
+    uint32_t value; ///< Measurement value
+} sensorfw_unsigned_t;
+
+/**
+ * @brief Sample of proximitysensor.
+ */
+typedef struct {
+    uint64_t timestamp; ///< Monotonic time (microsec, see sensorfw_set_nanosecond_timestamps)
+    uint32_t value; ///< Measurement value
+    uint8_t within_proximity; ///< Non-zero if an object is within proximity
+} sensorfw_proximity_t;
+
+/**
+ * @brief Sample of magnetometersensor.
+ */
+typedef struct {
+    uint64_t timestamp; ///< Monotonic time (microsec, see sensorfw_set_nanosecond_timestamps)
+    int32_t x; ///< Calibrated X value
+    int32_t y; ///< Calibrated Y value
+    int32_t z; ///< Calibrated Z value
+    int32_t rx; ///< Raw X value
+    int32_t ry; ///< Raw Y value
+    int32_t rz; ///< Raw Z value
+    int32_t level; ///< Calibration level
+} sensorfw_magnetic_field_t;
+
+/**
+ * @brief Sample of compasssensor.
+ */
+typedef struct {
+    uint64_t timestamp; ///< Monotonic time (microsec, see sensorfw_set_nanosecond_timestamps)
+    int32_t degrees; ///< Angle to north, declination corrected if enabled
+    int32_t raw_degrees; ///< Angle to north without declination correction
+    int32_t corrected_degrees; ///< Declination corrected angle to north
+    int32_t level; ///< Calibration level
+} sensorfw_compass_t;
+
+/**
+ * @brief Sample of tapsensor.
+ */
+typedef struct {
+    uint64_t timestamp; ///< Monotonic time (microsec, see sensorfw_set_nanosecond_timestamps)
+    int32_t direction; ///< Direction of tap
+    int32_t type; ///< Single or double tap
+} sensorfw_tap_t;
+
+/**
+ * @brief Sample of lidsensor.
+ */
+typedef struct {
+    uint64_t timestamp; ///< Monotonic time (microsec, see sensorfw_set_nanosecond_timestamps)
+    int32_t type; ///< Type of lid
+    uint32_t value; ///< Measurement value
+} sensorfw_lid_t;
+
 /**
  * @brief Initialises the sensor for operation.
  *
@@ -65,11 +145,26 @@ typedef struct {
  */
 bool sensorfw_init(const char* sensor_name);
 
+/**
+ * @brief Selects the unit of sample timestamps.
+ *
+ * Sessions opened afterwards get timestamps in nanoseconds instead of
+ * microseconds. Sessions opened before keep theirs; with both kinds open
+ * they use different descriptors, see sensorfw_get_fd. Opening a session
+ * fails if nanoseconds are asked for and sensord does not offer them.
+ * sensord stamps samples in microseconds, so nanosecond times are exact
+ * to the microsecond.
+ *
+ * @param enable \c true for nanoseconds, \c false for microseconds.
+ */
+void sensorfw_set_nanosecond_timestamps(bool enable);
+
 /**
  * @brief Opens a session for a sensor.
  *
  * This call provides the client with a session ID, through which the client can
- * interact with the sensor.
+ * interact with the sensor. The data connection of the session is opened as
+ * well, see sensorfw_get_fd.
  * @param sensor_name Name of the sensor we wish to open.
  * @return session ID for the sensor. \c -1 on failure.
  */
@@ -101,6 +196,9 @@ bool sensorfw_stop_sensor(int sessionId);
 
 /**
  * @brief Tells whether sensor is running or not.
+ *
+ * Sensor is running for the session from a successful sensorfw_start_sensor
+ * until sensorfw_stop_sensor.
  * @param sessionId Session ID to run this request on.
  * @return \c true if running, \c false if not running or invalid session ID.
  */
@@ -114,7 +212,7 @@ bool sensorfw_running(int sessionId);
  * constant, or might depend on user interaction (i.e. no samples if environment
  * is not changing)
  * @param sessionId Session ID to run this request on.
- * @return Milliseconds between samples.
+ * @return Milliseconds between samples. \c -1 on failure.
  */
 int sensorfw_get_interval(int sessionId);
 
@@ -164,15 +262,58 @@ bool sensorfw_set_standby_override(int sessionId, bool override);
 bool sensorfw_get_description(int sessionId, char** description);
 
 /**
- * @brief Registers a callback function to handle sensor output.
+ * @brief Tells the data connection of a session.
  *
- * @todo Description of callback requirements.
+ * The descriptor is non-blocking and becomes readable when samples arrive.
+ * It can be added to poll(), epoll or any main loop; samples are then taken
+ * with sensorfw_read. All sessions of the process share one descriptor, so
+ * when it polls readable call sensorfw_read for every open session. The
+ * descriptor is owned by the library and closed with the last session.
  *
  * @param sessionId Session ID to run this request on.
- * @param cb_func Pointer to function to use as callback.
- * @return \c true on success, \c false on failure or invalid session ID.
+ * @return file descriptor, \c -1 on invalid session ID.
+ */
+int sensorfw_get_fd(int sessionId);
+
+/**
+ * @brief Tells the size of one sample of a session.
+ *
+ * See the sensorfw_*_t structures for the sample layout of each sensor.
+ *
+ * @param sessionId Session ID to run this request on.
+ * @return sample size in bytes, \c 0 on invalid session ID.
+ */
+size_t sensorfw_get_sample_size(int sessionId);
+
+/**
+ * @brief Reads received samples without blocking.
+ *
+ * Samples left over from a frame larger than \c max are returned by the next
+ * call. Samples of other sessions received meanwhile are kept for them. The
+ * descriptor may stop polling readable while samples are still buffered, so
+ * keep reading every session until less than \c max samples are returned.
+ *
+ * @param sessionId Session ID to run this request on.
+ * @param buf Destination for samples, room for \c max samples of
+ *        sensorfw_get_sample_size bytes.
+ * @param max Most samples to read.
+ * @return number of samples read, \c 0 if none were available, \c -1 if
+ *         the connection was lost or the session ID is invalid.
  */
-bool sensorfw_register_callback(int sessionId, void (*cb_func)(void *data));
+int sensorfw_read(int sessionId, void* buf, int max);
+
+/**
+ * @brief Tells how many samples of a session sensord has dropped.
+ *
+ * sensord drops samples when the client does not read them fast enough,
+ * and so does the library when samples of a session that is not read pile
+ * up while other sessions are. The count grows over the life of the session, compare it between reads
+ * to detect gaps in the samples.
+ *
+ * @param sessionId Session ID to run this request on.
+ * @return dropped samples so far, \c 0 on invalid session ID.
+ */
+unsigned long sensorfw_get_dropped(int sessionId);
 
 /**
  * @brief Prepares the sensor for calibration.
@@ -190,10 +331,14 @@ bool sensorfw_prepare_for_calibration(int sessionId);
  * @brief Returns the last error that has occurred for sensor.
  * @param sessionId Session ID to run this request on.
  * @param error_string If given, will be set to verbal description of the error.
- *        Can be referenced until the next error occurs.
+ *        Valid until the next request.
  * @return Numerical code for the error that occurred
  * @todo Provide enums for error numbers.
  */
 int sensorfw_last_error(int sessionId, char** error_string);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // SENSORFW_CAPI
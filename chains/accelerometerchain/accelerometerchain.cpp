@@ -82,6 +82,8 @@ AccelerometerChain::AccelerometerChain(const QString& id) :
     if (!filterBin_->join("acccoordinatealigner", "source", "buffer", "sink"))
     qDebug() << Q_FUNC_INFO << "acccoordinatealigner/buffer join failed";
 
+    setupExecutor(filterBin_);
+
     // Join datasources to the chain
     connectToSource(accelerometerAdaptor_, "accelerometer", accelerometerReader_);
 
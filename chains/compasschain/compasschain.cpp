@@ -148,6 +148,8 @@ CompassChain::CompassChain(const QString& id) :
     if (!filterBin->join("declinationcorrection", "source", "truenorth", "sink"))
         qDebug() << Q_FUNC_INFO << "declinationfilter join failed";
 
+    setupExecutor(filterBin);
+
     if (!hasOrientationAdaptor) {
         if (!connectToSource(accelerometerChain, "accelerometer", accelerometerReader))
             qDebug() << Q_FUNC_INFO << "accelerometer connect failed";
@@ -32,8 +32,15 @@
 CompassFilter::CompassFilter() :
         magDataSink(this, &CompassFilter::magDataAvailable),
         accelSink(this, &CompassFilter::accelDataAvailable),
+        magX(0),
+        magY(0),
+        magZ(0),
+        oldMagX(0),
+        oldMagY(0),
+        oldMagZ(0),
         level(0),
-        oldHeading(0)
+        oldHeading(0),
+        mathMode(FastMath::configuredMode("compass"))
 {
     addSink(&magDataSink, "magsink");
     addSink(&accelSink, "accsink");
@@ -55,14 +62,8 @@ void CompassFilter::magDataAvailable(unsigned, const CalibratedMagneticFieldData
     oldMagZ = magZ;
 }
 
-
-void CompassFilter::accelDataAvailable(unsigned, const AccelerationData *data)
+qreal CompassFilter::heading(qreal magX, qreal magY, qreal magZ, qreal Gx, qreal Gy, qreal Gz)
 {
-    // the x/y are switched as compass expects it in aero coordinates
-    qreal Gx = data->y_ * .001f; //convert to g
-    qreal Gy = data->x_ * .001f;
-    qreal Gz = -data->z_ * .001f;
-
     qreal divisor = qSqrt(Gx * Gx + Gy * Gy + Gz * Gz);
     qreal normalizedGx = Gx / divisor;
     qreal normalizedGy = Gy / divisor;
@@ -105,12 +106,75 @@ void CompassFilter::accelDataAvailable(unsigned, const AccelerationData *data)
     /* calculate yaw = ecompass angle psi (-180deg, 180deg) */
     Psi = (qAtan2(-fBfy, fBfx) * RADIANS_TO_DEGREES); /* Equation 7 */
 
-    int heading = Psi * FILTER_FACTOR + oldHeading * (1.0 - FILTER_FACTOR);
+    return Psi;
+}
+
+void CompassFilter::headingVector(float magX, float magY, float magZ, float Gx, float Gy, float Gz,
+                                  float& north, float& east)
+{
+    // Same rotations as heading(), but sin and cos of the roll and pitch
+    // angles follow from the gravity vector directly, so neither the
+    // angles nor a normalized gravity vector are needed.
+    float roll = sqrtf(Gy * Gy + Gz * Gz);
+    float sinPhi = roll > 0 ? Gy / roll : 0;
+    float cosPhi = roll > 0 ? Gz / roll : 1;
+
+    float fBfy = magY * cosPhi - magZ * sinPhi;
+    float fBz = magY * sinPhi + magZ * cosPhi;
+
+    // De-rotated gravity z is roll, which is never negative
+    float pitch = sqrtf(Gx * Gx + roll * roll);
+    float sinThe = pitch > 0 ? -Gx / pitch : 0;
+    float cosThe = pitch > 0 ? roll / pitch : 1;
+
+    north = magX * cosThe + fBz * sinThe;
+    east = -fBfy;
+}
+
+qreal CompassFilter::fastHeading(qreal magX, qreal magY, qreal magZ, qreal Gx, qreal Gy, qreal Gz)
+{
+    float north;
+    float east;
+    headingVector(magX, magY, magZ, Gx, Gy, Gz, north, east);
+    return FastMath::atan2(east, north) * (float)RADIANS_TO_DEGREES;
+}
+
+void CompassFilter::smoothHeading(unsigned index, quint64 timestamp, qreal degrees)
+{
+    int smoothed = degrees * FILTER_FACTOR + oldHeading * (1.0 - FILTER_FACTOR);
 
-    CompassData compassData; //north angle
-    compassData.timestamp_ = data->timestamp_;
-    compassData.degrees_ = (int)(heading + 360) % 360;
-    compassData.level_ = level;
-    magSource.propagate(1, &compassData);
-    oldHeading = heading;
+    output[index].timestamp_ = timestamp; //north angle
+    output[index].degrees_ = (int)(smoothed + 360) % 360;
+    output[index].level_ = level;
+    oldHeading = smoothed;
+}
+
+void CompassFilter::accelDataAvailable(unsigned n, const AccelerationData *data)
+{
+    while (n) {
+        unsigned count = qMin(n, (unsigned)BLOCK_SIZE);
+
+        // the x/y are switched as compass expects it in aero coordinates
+        if (mathMode == FastMath::Fast) {
+            for (unsigned i = 0; i < count; ++i) {
+                headingVector(magX, magY, magZ,
+                              data[i].y_ * .001f, data[i].x_ * .001f, -data[i].z_ * .001f,
+                              north[i], east[i]);
+            }
+            FastMath::atan2(count, east, north, angles);
+            for (unsigned i = 0; i < count; ++i)
+                smoothHeading(i, data[i].timestamp_, angles[i] * (float)RADIANS_TO_DEGREES);
+        } else {
+            // Double results are smoothed as is, like before blocks
+            for (unsigned i = 0; i < count; ++i) {
+                smoothHeading(i, data[i].timestamp_,
+                              heading(magX, magY, magZ,
+                                      data[i].y_ * .001f, data[i].x_ * .001f, -data[i].z_ * .001f));
+            }
+        }
+
+        magSource.propagate(count, output);
+        data += count;
+        n -= count;
+    }
 }
@@ -25,6 +25,7 @@
 #include "ringbuffer.h"
 #include "orientationdata.h"
 #include "filter.h"
+#include "fastmath.h"
 
 class CompassFilter : public QObject, public FilterBase
 {
@@ -36,6 +37,21 @@ public:
         return new CompassFilter;
     }
 
+    /**
+     * Tilt compensated heading in double precision. Magnetic field and
+     * gravity are in aerospace coordinates.
+     *
+     * @return heading in degrees, (-180, 180].
+     */
+    static qreal heading(qreal magX, qreal magY, qreal magZ, qreal Gx, qreal Gy, qreal Gz);
+
+    /**
+     * heading() computed with FastMath in single precision.
+     *
+     * @return heading in degrees, (-180, 180].
+     */
+    static qreal fastHeading(qreal magX, qreal magY, qreal magZ, qreal Gx, qreal Gy, qreal Gz);
+
 protected:
 
     CompassFilter();
@@ -47,7 +63,25 @@ private:
     Source<CompassData> magSource;
 
     void magDataAvailable(unsigned, const CalibratedMagneticFieldData*);
-    void accelDataAvailable(unsigned, const AccelerationData*);
+    void accelDataAvailable(unsigned n, const AccelerationData* data);
+
+    /**
+     * Horizontal components of the magnetic field after tilt
+     * compensation; their atan2() is the heading.
+     */
+    static void headingVector(float magX, float magY, float magZ, float Gx, float Gy, float Gz,
+                              float& north, float& east);
+
+    /**
+     * Smooth heading into output[index].
+     *
+     * @param index Index in output.
+     * @param timestamp Timestamp of the accelerometer sample.
+     * @param degrees Unsmoothed heading in degrees.
+     */
+    void smoothHeading(unsigned index, quint64 timestamp, qreal degrees);
+
+    enum { BLOCK_SIZE = 64 };
 
     CalibratedMagneticFieldData magData;
 
@@ -60,6 +94,12 @@ private:
 
     int level;
     int oldHeading;
+    FastMath::Mode mathMode;
+
+    float north[BLOCK_SIZE];
+    float east[BLOCK_SIZE];
+    float angles[BLOCK_SIZE];
+    CompassData output[BLOCK_SIZE];
     QList <int> averagingBuffer;
     QList <const CalibratedMagneticFieldData *> magAvgBuffer;
     QList <const AccelerationData *> accelAvgBuffer;
@@ -111,6 +111,8 @@ MagCalibrationChain::MagCalibrationChain(const QString& id) :
             qDebug() << Q_FUNC_INFO << "magcoordinatealigner/calibratedmagnetometerdata join failed";
     }
 
+    setupExecutor(filterBin);
+
     // Join datasources to the chain
     connectToSource(magAdaptor, "calibratedmagneticfield", magReader);
 
@@ -69,6 +69,8 @@ OrientationChain::OrientationChain(const QString& id) :
     if (!filterBin_->join("orientationinterpreter", "orientation", "orientationbuffer", "sink"))
         qDebug() << Q_FUNC_INFO << "orientationinterpreter/orientationbuffer join failed";
 
+    setupExecutor(filterBin_);
+
     // Join datasources to the chain
     connectToSource(accelerometerChain_, "accelerometer", accelerometerReader_);
 
@@ -29,6 +29,23 @@ profile-libc {
   QMAKE_LFLAGS += -lc_p
 }
 
+# Per node timing and sample latency, see latency/* settings
+latencystats {
+  DEFINES += SENSORFW_LATENCY_STATS
+}
+
+# Plain loops instead of SSE2/NEON in filter kernels
+nosimd {
+  DEFINES += SENSORFW_NO_SIMD
+}
+
+# Round multiplies and adds separately, as the SSE2/NEON kernels do.
+# GCC fuses them into FMA on AArch64 by default, which makes plain
+# loops differ from the vector code in the last bit.
+*-g++*|*-clang* {
+  QMAKE_CXXFLAGS += -ffp-contract=off
+}
+
 equals(QT_MAJOR_VERSION, 5):{
     TARGET = $$TARGET-qt5
 }
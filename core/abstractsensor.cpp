@@ -33,12 +33,42 @@
 #include "sockethandler.h"
 #include "idutils.h"
 #include "logging.h"
+#include "config.h"
+#include "bin.h"
+#include "latestsamplecache.h"
+#include <QAtomicInt>
+#include <QTimer>
+
+static QAtomicInt nextFanoutId(1);
 
 AbstractSensorChannel::AbstractSensorChannel(const QString& id) :
     NodeBase(getCleanId(id)),
     errorCode_(SNoError),
-    cnt_(0)
+    cnt_(0),
+    fanoutId_(nextFanoutId.fetchAndAddRelaxed(1)),
+    sampleType_(SENSORFW_WIRE_SAMPLE_UNKNOWN),
+    downsampleFilter_(DownsamplerBase::Box),
+    latestSlot_(SensorManager::instance().latestSamples().allocate()),
+    latestTimer_(new QTimer(this))
+{
+    int latestTimeout = 1000;
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    if (config) {
+        QString name = config->value<QString>("global/downsample_filter", "box");
+        name = config->value<QString>(id() + "/downsample_filter", name);
+        downsampleFilter_ = DownsamplerBase::filterFromName(name, DownsamplerBase::Box);
+
+        latestTimeout = config->value<int>("global/latest_sample_timeout", latestTimeout);
+        latestTimeout = config->value<int>(id() + "/latest_sample_timeout", latestTimeout);
+    }
+    latestTimer_->setSingleShot(true);
+    latestTimer_->setInterval(latestTimeout);
+    connect(latestTimer_, SIGNAL(timeout()), this, SLOT(latestSampleTimedOut()));
+}
+
+AbstractSensorChannel::~AbstractSensorChannel()
 {
+    SensorManager::instance().latestSamples().release(latestSlot_);
 }
 
 void AbstractSensorChannel::setError(SensorError errorCode, const QString& errorString)
@@ -56,8 +86,13 @@ bool AbstractSensorChannel::start(int sessionId)
     if(!activeSessions_.contains(sessionId))
     {
         activeSessions_.insert(sessionId);
+        sessionGeneration_.ref();
+        SensorManager::instance().socketHandler().setSampleType(sessionId, sampleType_);
+        updateFanout();
         requestDefaultInterval(sessionId);
-        return start();
+        bool started = start();
+        SensorManager::instance().updateWakeupGridTimer();
+        return started;
     }
     return false;
 }
@@ -71,8 +106,12 @@ bool AbstractSensorChannel::stop(int sessionId)
 {
     if(activeSessions_.remove(sessionId))
     {
+        sessionGeneration_.ref();
+        updateFanout();
         removeSession(sessionId); //Note: when client restarts the session it is responsible to reconfiguring the sensor.
-        return stop();
+        bool stopped = stop();
+        SensorManager::instance().updateWakeupGridTimer();
+        return stopped;
     }
     return false;
 }
@@ -97,143 +136,99 @@ bool AbstractSensorChannel::writeToSession(int sessionId, const void* source, in
 
 bool AbstractSensorChannel::writeToClients(const void* source, int size)
 {
-    bool ret = true;
-    foreach(int sessionId, activeSessions_) {
-        ret &= writeToSession(sessionId, source, size);
+    updateLatestSample(source, size);
+    if (activeSessions_.isEmpty())
+        return true;
+    if (!(SensorManager::instance().writeFanout(fanoutId_, source, size))) {
+        sensordLogD() << "AbstractSensor failed to write to fan-out " << fanoutId_;
+        return false;
     }
-    return ret;
+    return true;
 }
 
-bool AbstractSensorChannel::downsampleAndPropagate(const TimedXyzData& data, TimedXyzDownsampleBuffer& buffer)
+void AbstractSensorChannel::updateLatestSample(const void* source, int size)
 {
-    bool ret = true;
-    unsigned int currentInterval = getInterval();
-    foreach(int sessionId, activeSessions_)
-    {
-        if(!downsamplingEnabled(sessionId))
-        {
-            ret &= writeToSession(sessionId, (const void *)& data, sizeof(TimedXyzData));
-            continue;
-        }
-        unsigned int sessionInterval = getInterval(sessionId);
-        int bufferSize = (sessionInterval < currentInterval || !currentInterval) ? 1 : sessionInterval / currentInterval;
+    SensorManager::instance().latestSamples().write(latestSlot_, source, size);
+    if (latestRefresh_.load() == 1 && latestRefresh_.testAndSetOrdered(1, 2))
+        QMetaObject::invokeMethod(this, "latestSampleArrived", Qt::QueuedConnection);
+}
 
-        QList<TimedXyzData>& samples(buffer[sessionId]);
-        samples.push_back(data);
+int AbstractSensorChannel::latestSampleSlot() const
+{
+    return latestSlot_;
+}
 
-        for(QList<TimedXyzData>::iterator it = samples.begin(); it != samples.end(); ++it)
-        {
-            if(samples.size() > bufferSize ||
-               data.timestamp_ - it->timestamp_ > 2000000)
-            {
-                it = samples.erase(it);
-                if(it == samples.end())
-                    break;
-            }
-            else
-                break;
-        }
+bool AbstractSensorChannel::refreshLatestSample()
+{
+    if (latestRefresh_.load())
+        return true;
+    if (running())
+        return false;
 
-        if(samples.size() < bufferSize)
-            continue;
+    sensordLogD() << "Refreshing latest sample of" << id();
+    latestRefresh_.storeRelease(1);
+    latestTimer_->start();
+    if (!start()) {
+        finishLatestSampleRefresh();
+        return false;
+    }
+    return true;
+}
 
-        long x = 0;
-        long y = 0;
-        long z = 0;
-        foreach(const TimedXyzData& data, samples)
-        {
-            x += data.x_;
-            y += data.y_;
-            z += data.z_;
-        }
-        TimedXyzData downsampled(data.timestamp_,
-                                 x / samples.count(),
-                                 y / samples.count(),
-                                 z / samples.count());
+void AbstractSensorChannel::latestSampleArrived()
+{
+    if (latestRefresh_.testAndSetOrdered(2, 0))
+        finishLatestSampleRefresh();
+}
 
-        if (writeToSession(sessionId, (const void*)& downsampled, sizeof(TimedXyzData)))
-        {
-            samples.clear();
-        }
-        else
-        {
-            ret = false;
-        }
+void AbstractSensorChannel::latestSampleTimedOut()
+{
+    if (latestRefresh_.fetchAndStoreOrdered(0)) {
+        sensordLogD() << "No sample from" << id() << "for latest sample refresh";
+        finishLatestSampleRefresh();
     }
+}
 
-    return ret;
+void AbstractSensorChannel::finishLatestSampleRefresh()
+{
+    latestRefresh_.storeRelease(0);
+    latestTimer_->stop();
+    stop();
+    emit latestSampleRefreshed();
+}
+
+void AbstractSensorChannel::setSampleType(int type)
+{
+    sampleType_ = type;
 }
 
-bool AbstractSensorChannel::downsampleAndPropagate(const CalibratedMagneticFieldData& data, MagneticFieldDownsampleBuffer& buffer)
+void AbstractSensorChannel::updateFanout()
 {
-    bool ret = true;
+    SensorManager::instance().socketHandler().setFanout(fanoutId_, activeSessions_.toList());
+}
+
+QMap<unsigned, QList<int> > AbstractSensorChannel::downsampleFactors() const
+{
+    QMap<unsigned, QList<int> > factors;
     unsigned int currentInterval = getInterval();
     foreach(int sessionId, activeSessions_)
     {
-        if(!downsamplingEnabled(sessionId))
+        unsigned int factor = 1;
+        if(downsamplingEnabled(sessionId))
         {
-            ret &= writeToSession(sessionId, (const void *)& data, sizeof(CalibratedMagneticFieldData));
-            continue;
+            unsigned int sessionInterval = getInterval(sessionId);
+            if(currentInterval && sessionInterval > currentInterval)
+                factor = sessionInterval / currentInterval;
         }
-        unsigned int sessionInterval = getInterval(sessionId);
-        int bufferSize = (sessionInterval < currentInterval || !currentInterval) ? 1 : sessionInterval / currentInterval;
-
-        QList<CalibratedMagneticFieldData>& samples(buffer[sessionId]);
-        samples.push_back(data);
-
-        for(QList<CalibratedMagneticFieldData>::iterator it = samples.begin(); it != samples.end(); ++it)
-        {
-            if(samples.size() > bufferSize ||
-               data.timestamp_ - it->timestamp_ > 2000000)
-            {
-                it = samples.erase(it);
-                if(it == samples.end())
-                    break;
-            }
-            else
-                break;
-        }
-
-        if(samples.size() < bufferSize)
-            continue;
-
-        long x = 0;
-        long y = 0;
-        long z = 0;
-        long rx = 0;
-        long ry = 0;
-        long rz = 0;
-        foreach(const CalibratedMagneticFieldData& data, samples)
-        {
-            x += data.x_;
-            y += data.y_;
-            z += data.z_;
-            rx += data.rx_;
-            ry += data.ry_;
-            rz += data.rz_;
-        }
-        CalibratedMagneticFieldData downsampled(data.timestamp_,
-                                                x / samples.count(),
-                                                y / samples.count(),
-                                                z / samples.count(),
-                                                rx / samples.count(),
-                                                ry / samples.count(),
-                                                rz / samples.count(),
-                                                data.level_);
-
-        if (writeToSession(sessionId, (const void*)& downsampled, sizeof(CalibratedMagneticFieldData)))
-        {
-            samples.clear();
-        }
-        else
-        {
-            ret = false;
-        }
-
+        factors[factor].append(sessionId);
     }
-    return ret;
+    return factors;
 }
 
+quint64 AbstractSensorChannel::downsampleGeneration() const
+{
+    return ((quint64)(quint32)sessionGeneration_.load() << 32) | (quint32)intervalGeneration();
+}
 
 void AbstractSensorChannel::setDownsamplingEnabled(int sessionId, bool value)
 {
@@ -241,6 +236,7 @@ void AbstractSensorChannel::setDownsamplingEnabled(int sessionId, bool value)
     {
         sensordLogT() << "Downsampling state for session " << sessionId << ": " << value;
         downsampling_[sessionId] = value;
+        sessionGeneration_.ref();
     }
 }
 
@@ -260,6 +256,7 @@ bool AbstractSensorChannel::downsamplingSupported() const
 void AbstractSensorChannel::removeSession(int sessionId)
 {
     downsampling_.take(sessionId);
+    sessionGeneration_.ref();
     NodeBase::removeSession(sessionId);
 }
 
@@ -299,3 +296,35 @@ RingBufferBase* AbstractSensorChannel::findBuffer(const QString&) const
     sensordLogW() << "Tried to locate buffer from SensorChannel!";
     return NULL;
 }
+
+void AbstractSensorChannel::setupExecutor(Bin* bin)
+{
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    if (!config)
+        return;
+
+    QString name = config->value<QString>(id() + "/executor", "");
+    if (name.isEmpty())
+        return;
+
+    Executor* executor = SensorManager::instance().requestExecutor(name);
+    bin->setExecutor(executor, config->value<unsigned>(id() + "/executor_queue_size", 64));
+    executorBins_.append(bin);
+    sensordLogD() << id() << "runs on executor" << name;
+}
+
+quint64 AbstractSensorChannel::cpuTime() const
+{
+    quint64 time = 0;
+    foreach (const Bin* bin, executorBins_) {
+        time += bin->cpuTime();
+    }
+    return time;
+}
+
+QString AbstractSensorChannel::executorName() const
+{
+    if (executorBins_.isEmpty())
+        return QString();
+    return executorBins_.first()->executor()->name();
+}
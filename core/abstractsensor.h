@@ -42,6 +42,11 @@
 #include "datarange.h"
 #include "genericdata.h"
 #include "orientationdata.h"
+#include "downsampler.h"
+#include "wireprotocol.h"
+
+class Bin;
+class QTimer;
 
 /**
  * Base class for sensor type specific nodes. This is used as base class
@@ -61,7 +66,7 @@ public:
     /**
      * Destructor.
      */
-    virtual ~AbstractSensorChannel() {}
+    virtual ~AbstractSensorChannel();
 
     /**
      * Last occured error.
@@ -117,6 +122,21 @@ public:
 
     virtual void removeSession(int sessionId);
 
+    /**
+     * Thread CPU time spent by executors running bins of this channel.
+     *
+     * @return CPU time in nanoseconds.
+     */
+    quint64 cpuTime() const;
+
+    /**
+     * Name of the executor running bins of this channel.
+     *
+     * @return executor name or empty string if bins are run by the
+     *         threads writing their buffers.
+     */
+    QString executorName() const;
+
     /**
      * Start data flow. Base class implementation is responsible for
      * reference counting. Which each subclass is responsible of calling.
@@ -158,6 +178,24 @@ public:
      */
     bool stop(int sessionId);
 
+    /**
+     * Slot of the channel in the latest sample cache, see
+     * SensorManager::latestSamples().
+     *
+     * @return slot index or -1 if the channel has none.
+     */
+    int latestSampleSlot() const;
+
+    /**
+     * Refresh cached latest sample of a stopped channel. The channel is
+     * started until it outputs a sample or "<id>/latest_sample_timeout"
+     * milliseconds pass, then latestSampleRefreshed() is emitted.
+     *
+     * @return true if refresh was started or is in progress. False if the
+     *         channel is running, in which case the cache is current.
+     */
+    bool refreshLatestSample();
+
 Q_SIGNALS:
     /**
      * Signal is emitted for occured errors.
@@ -166,12 +204,18 @@ Q_SIGNALS:
      */
     void errorSignal(int error);
 
+    /**
+     * Signal is emitted when refresh started with refreshLatestSample()
+     * finishes, whether or not a sample arrived.
+     */
+    void latestSampleRefreshed();
+
 protected:
-    /** Sample buffer type for TimedXyzData downsampling. */
-    typedef QMap<int, QList<TimedXyzData> > TimedXyzDownsampleBuffer;
+    /** Downsampling state type for TimedXyzData. */
+    typedef Downsampler<TimedXyzData> TimedXyzDownsampleBuffer;
 
-    /** Sample buffer type for CalibratedMagneticFieldData downsampling. */
-    typedef QMap<int, QList<CalibratedMagneticFieldData> > MagneticFieldDownsampleBuffer;
+    /** Downsampling state type for CalibratedMagneticFieldData. */
+    typedef Downsampler<CalibratedMagneticFieldData> MagneticFieldDownsampleBuffer;
 
     /**
      * Constructor.
@@ -194,31 +238,38 @@ protected:
     void clearError();
 
     /**
-     * Write output data to all connected sessions.
+     * Set sample type reported to clients in frame headers.
      *
-     * @param source Object to write.
-     * @param size Size of the object.
-     * @return was data succesfully written.
+     * @param type sensorfw_wire_sample_type of the written samples.
      */
-    bool writeToClients(const void* source, int size);
+    void setSampleType(int type);
 
     /**
-     * Downsample and propagate data to all connected sessions.
+     * Write output data to all connected sessions. The sample is queued
+     * once for the whole fan-out of the channel and shared by sessions
+     * with identical stream parameters. The sample is also stored as
+     * the latest sample of the channel.
      *
-     * @param data Object to handle.
-     * @param buffer Data buffer.
-     * @return was data succesfully handled.
+     * @param source Object to write.
+     * @param size Size of the object.
+     * @return was data succesfully written.
      */
-    bool downsampleAndPropagate(const TimedXyzData& data, TimedXyzDownsampleBuffer& buffer);
+    bool writeToClients(const void* source, int size);
 
     /**
-     * Downsample and propagate data to all connected sessions.
+     * Downsample and propagate data to all connected sessions. Sessions
+     * with downsampling enabled receive one sample per their interval,
+     * reduced with the filter configured with "<id>/downsample_filter"
+     * or "global/downsample_filter". Sessions sharing an interval share
+     * the reduction work. The input sample is stored as the latest
+     * sample of the channel.
      *
      * @param data Object to handle.
-     * @param buffer Data buffer.
+     * @param buffer Downsampling state of the channel.
      * @return was data succesfully handled.
      */
-    bool downsampleAndPropagate(const CalibratedMagneticFieldData& data, MagneticFieldDownsampleBuffer& buffer);
+    template <class TYPE>
+    bool downsampleAndPropagate(const TYPE& data, Downsampler<TYPE>& buffer);
 
     /**
      * Signal property change.
@@ -229,7 +280,41 @@ protected:
 
     virtual RingBufferBase* findBuffer(const QString& name) const;
 
+    /**
+     * Run bin on the executor configured with "<id>/executor". Bins of
+     * channels configured with the same executor name share its thread.
+     * Without configuration the bin is run by the thread writing its
+     * buffers.
+     *
+     * @param bin bin to configure.
+     */
+    void setupExecutor(Bin* bin);
+
+private Q_SLOTS:
+    /**
+     * Finish latest sample refresh after a sample arrived.
+     */
+    void latestSampleArrived();
+
+    /**
+     * Finish latest sample refresh which did not get a sample in time.
+     */
+    void latestSampleTimedOut();
+
 private:
+    /**
+     * Store output sample to the latest sample cache.
+     *
+     * @param source sample.
+     * @param size size of sample.
+     */
+    void updateLatestSample(const void* source, int size);
+
+    /**
+     * Stop channel started for latest sample refresh.
+     */
+    void finishLatestSampleRefresh();
+
     /**
      * Write to given session.
      *
@@ -240,13 +325,68 @@ private:
      */
     bool writeToSession(int sessionId, const void* source, int size);
 
+    /**
+     * Tell SocketHandler which sessions belong to the fan-out of the
+     * channel.
+     */
+    void updateFanout();
+
+    /**
+     * Group active sessions by the decimation factor they need at the
+     * current channel interval. Factor 1 means no downsampling.
+     *
+     * @return sessions for each factor.
+     */
+    QMap<unsigned, QList<int> > downsampleFactors() const;
+
+    /**
+     * Counter which changes whenever downsampleFactors() may change for
+     * other reasons than the channel interval.
+     */
+    quint64 downsampleGeneration() const;
+
     SensorError         errorCode_;       /**< previous occured error code */
     QString             errorString_;     /**< previous occured error description */
     int                 cnt_;             /**< usage reference count */
     QSet<int>           activeSessions_;  /**< active sessions */
     QMap<int, bool>     downsampling_;    /**< downsample state for sessions */
+    QList<Bin*>         executorBins_;    /**< bins run by executor */
+    int                 fanoutId_;        /**< fan-out of active sessions */
+    int                 sampleType_;      /**< sensorfw_wire_sample_type of output */
+    QAtomicInt          sessionGeneration_; /**< bumped on session set and downsampling changes */
+    DownsamplerBase::Filter downsampleFilter_; /**< configured downsampling filter */
+    int                 latestSlot_;      /**< slot in latest sample cache */
+    QAtomicInt          latestRefresh_;   /**< 0 idle, 1 refresh running, 2 sample arrived */
+    QTimer*             latestTimer_;     /**< timeout of latest sample refresh */
 };
 
+template <class TYPE>
+bool AbstractSensorChannel::downsampleAndPropagate(const TYPE& data, Downsampler<TYPE>& buffer)
+{
+    updateLatestSample(&data, sizeof(TYPE));
+
+    unsigned int currentInterval = getInterval();
+    quint64 generation = downsampleGeneration();
+    if (!buffer.isCurrent(generation, currentInterval))
+    {
+        buffer.setFilter(downsampleFilter_);
+        buffer.setGroups(generation, currentInterval, downsampleFactors());
+    }
+
+    bool ret = true;
+    for (int i = 0; i < buffer.groupCount(); ++i)
+    {
+        const TYPE* output = buffer.push(i, data);
+        if (!output)
+            continue;
+        foreach (int sessionId, buffer.sessions(i))
+        {
+            ret &= writeToSession(sessionId, (const void*)output, sizeof(TYPE));
+        }
+    }
+    return ret;
+}
+
 /**
  * Factory type for constructing sensor channel.
  */
@@ -30,6 +30,8 @@
 #include "sfwerror.h"
 #include <sensormanager.h>
 #include <sockethandler.h>
+#include "latestsamplecache.h"
+#include "datatypes/utils.h"
 
 AbstractSensorChannelAdaptor::AbstractSensorChannelAdaptor(QObject *parent) :
     QDBusAbstractAdaptor(parent)
@@ -208,3 +210,34 @@ void AbstractSensorChannelAdaptor::setDownsampling(int sessionId, bool value)
 {
     node()->setDownsamplingEnabled(sessionId, value);
 }
+
+int AbstractSensorChannelAdaptor::latestSampleSlot() const
+{
+    return node()->latestSampleSlot();
+}
+
+QByteArray AbstractSensorChannelAdaptor::latestSample(quint64 maxAge)
+{
+    quint64 updated = 0;
+    QByteArray sample(SensorManager::instance().latestSamples().read(node()->latestSampleSlot(), &updated));
+    bool stale = sample.isEmpty() || (maxAge && Utils::getTimeStamp() - updated > maxAge);
+    if (!stale || !calledFromDBus())
+        return sample;
+
+    connect(node(), SIGNAL(latestSampleRefreshed()), this, SLOT(replyLatestSample()), Qt::UniqueConnection);
+    if (!node()->refreshLatestSample())
+        return sample;
+
+    setDelayedReply(true);
+    latestSampleRequests_.append(message());
+    return QByteArray();
+}
+
+void AbstractSensorChannelAdaptor::replyLatestSample()
+{
+    quint64 updated = 0;
+    QByteArray sample(SensorManager::instance().latestSamples().read(node()->latestSampleSlot(), &updated));
+    foreach (const QDBusMessage& request, latestSampleRequests_)
+        QDBusConnection::systemBus().send(request.createReply(QVariant::fromValue(sample)));
+    latestSampleRequests_.clear();
+}
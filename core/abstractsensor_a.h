@@ -40,7 +40,7 @@
  * has associated AbstractSensorChannel to which this object delegates
  * calls.
  */
-class AbstractSensorChannelAdaptor : public QDBusAbstractAdaptor
+class AbstractSensorChannelAdaptor : public QDBusAbstractAdaptor, protected QDBusContext
 {
     Q_OBJECT
     Q_DISABLE_COPY(AbstractSensorChannelAdaptor)
@@ -85,6 +85,14 @@ private:
      */
     AbstractSensorChannel* node() const;
 
+    QList<QDBusMessage> latestSampleRequests_; /**< delayed latestSample() calls */
+
+private Q_SLOTS:
+    /**
+     * Reply to delayed latestSample() calls.
+     */
+    void replyLatestSample();
+
 public Q_SLOTS: // METHODS
 
     /** AbstractSensorChannel::isValid() */
@@ -174,6 +182,20 @@ public Q_SLOTS: // METHODS
     /** AbstractSensorChannel::hwBuffering() */
     bool hwBuffering() const;
 
+    /** AbstractSensorChannel::latestSampleSlot() */
+    int latestSampleSlot() const;
+
+    /**
+     * Latest sample output by the channel. If the sample is older than
+     * maxAge and the channel is stopped, the reply is delayed until the
+     * channel has been started for a fresh sample, see
+     * AbstractSensorChannel::refreshLatestSample().
+     *
+     * @param maxAge Accepted age in microseconds, 0 accepts any age.
+     * @return sample, empty if the channel has not output any.
+     */
+    QByteArray latestSample(quint64 maxAge);
+
 Q_SIGNALS:
     /** AbstractSensorChannel::propertyChanged(name) */
     void propertyChanged(const QString& name);
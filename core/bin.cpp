@@ -35,12 +35,18 @@
 #include "ringbuffer.h"
 #include "logging.h"
 
-Bin::Bin()
+Bin::Bin() :
+    executor_(0),
+    queueSize_(0),
+    process_(this, &Bin::pushStagedData),
+    task_(&process_)
 {
 }
 
 Bin::~Bin()
 {
+    if (executor_)
+        executor_->cancel(&task_);
 }
 
 void Bin::start()
@@ -49,6 +55,45 @@ void Bin::start()
 
 void Bin::stop()
 {
+    if (executor_)
+        executor_->cancel(&task_);
+}
+
+void Bin::setExecutor(Executor* executor, unsigned queueSize)
+{
+    if (executor_)
+        executor_->cancel(&task_);
+
+    executor_ = executor;
+    queueSize_ = queueSize;
+
+    foreach (Pusher* pusher, pushers_) {
+        applyExecutor(pusher);
+    }
+}
+
+Executor* Bin::executor() const
+{
+    return executor_;
+}
+
+quint64 Bin::cpuTime() const
+{
+    return task_.cpuTime();
+}
+
+void Bin::pushStagedData()
+{
+    foreach (Pusher* pusher, pushers_) {
+        pusher->pushStagedData();
+    }
+}
+
+void Bin::applyExecutor(Pusher* pusher)
+{
+    if (!pusher->setExecutor(executor_, &task_, queueSize_)) {
+        sensordLogW() << "Pusher can not be run on executor" << executor_->name() << ", running it directly";
+    }
 }
 
 void Bin::add(Pusher* pusher, const QString& name)
@@ -57,6 +102,8 @@ void Bin::add(Pusher* pusher, const QString& name)
     Q_ASSERT(!filters_.contains(name));
 
     pushers_.insert(name, pusher);
+    if (executor_)
+        applyExecutor(pusher);
 }
 
 void Bin::add(Consumer* consumer, const QString& name)
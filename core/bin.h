@@ -31,6 +31,7 @@
 #define BIN_H
 
 #include "callback.h"
+#include "executor.h"
 #include <QHash>
 
 class SourceBase;
@@ -48,8 +49,8 @@ class RingBuffer;
  * and consumer. When data is written to the buffers bin will invoke
  * data consumers. Default bin will directly invoke consumers using
  * the current thread without context switches.
- * It is possible to subclass bin for threaded usage where bin instance
- * is run by dedicated thread.
+ * Bin can be set to run on an Executor, in which case pushers only stage
+ * incoming data and the consumers are invoked by the executor thread.
  */
 class Bin
 {
@@ -77,6 +78,29 @@ public:
      */
     virtual void stop();
 
+    /**
+     * Run consumers of this bin on given executor. Must be called before
+     * data starts flowing.
+     *
+     * @param executor Executor or NULL to run on the writing thread.
+     * @param queueSize How many objects each pusher can stage.
+     */
+    void setExecutor(Executor* executor, unsigned queueSize = 64);
+
+    /**
+     * Executor running this bin.
+     *
+     * @return executor or NULL.
+     */
+    Executor* executor() const;
+
+    /**
+     * Thread CPU time the executor has spent on this bin.
+     *
+     * @return CPU time in nanoseconds.
+     */
+    quint64 cpuTime() const;
+
     /**
      * Add new data pusher. Pusher callback is set to call the bin.
      *
@@ -165,9 +189,25 @@ protected:
     Consumer*   consumer(const QString& name) const;
 
 private:
+    /**
+     * Push staged data of all pushers. Run by executor.
+     */
+    void pushStagedData();
+
+    /**
+     * Set executor of single pusher.
+     *
+     * @param pusher pusher.
+     */
+    void applyExecutor(Pusher* pusher);
+
     QHash<QString, Pusher*>     pushers_;   /**< Pushers   */
     QHash<QString, Consumer*>   consumers_; /**< Consumers */
     QHash<QString, FilterBase*> filters_;   /**< Filters   */
+    Executor*                   executor_;  /**< Executor or NULL */
+    unsigned                    queueSize_; /**< staging queue size */
+    const Callback<Bin>         process_;   /**< executor callback */
+    Executor::Task              task_;      /**< executor task */
 };
 
 #endif
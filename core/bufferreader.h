@@ -31,6 +31,7 @@
 #include "pusher.h"
 #include "source.h"
 #include "ringbuffer.h"
+#include <QAtomicInteger>
 
 /**
  * Data producer subclass which reads data from RingBuffer and propagates
@@ -50,7 +51,14 @@ public:
      */
     BufferReader(unsigned chunkSize) :
         chunkSize_(chunkSize),
-        chunk_(new TYPE[chunkSize])
+        stage_(this, &BufferReader::stageNewData),
+        executor_(0),
+        task_(0),
+        staging_(0),
+        stagingMask_(0),
+        stagingHead_(0),
+        stagingTail_(0),
+        stagingDrops_(0)
     {
         this->addSource(&source_, "source");
     }
@@ -60,7 +68,7 @@ public:
      */
     virtual ~BufferReader()
     {
-        delete[] chunk_;
+        setExecutor(0, 0, 0);
     }
 
     /**
@@ -68,16 +76,106 @@ public:
      */
     void pushNewData()
     {
-        unsigned n;
-        while ((n = RingBufferReader<TYPE>::read(chunkSize_, chunk_))) {
-            source_.propagate(n, chunk_);
+        RingBufferSpan<const TYPE> span;
+        while ((span = this->readContiguous(chunkSize_)).size) {
+            source_.propagate(span.size, span.data);
+            this->consume(span.size);
         }
     }
 
+    /**
+     * Read data into a bounded staging queue on the writer thread and
+     * propagate it from the executor thread. Must be set before the
+     * buffer starts receiving data.
+     *
+     * @param executor Executor or NULL to propagate directly again.
+     * @param task Task to post when data has been staged.
+     * @param queueSize Capacity of staging queue.
+     * @return true.
+     */
+    bool setExecutor(Executor* executor, Executor::Task* task, unsigned queueSize)
+    {
+        if (executor_) {
+            this->setReadyCallback(&this->signalNewEvent_);
+            executor_->cancel(task_);
+            delete[] staging_;
+            staging_ = 0;
+        }
+
+        executor_ = executor;
+        task_ = task;
+
+        if (executor_) {
+            unsigned size = 1;
+            while (size < queueSize || size < chunkSize_)
+                size <<= 1;
+            staging_ = new TYPE[size];
+            stagingMask_ = size - 1;
+            stagingHead_.store(0);
+            stagingTail_.store(0);
+            this->setReadyCallback(&stage_);
+        }
+        return true;
+    }
+
+    /**
+     * Propagate data from the staging queue. Run by executor.
+     */
+    void pushStagedData()
+    {
+        unsigned tail = stagingTail_.load();
+        unsigned head;
+        while ((head = stagingHead_.loadAcquire()) != tail) {
+            unsigned index = tail & stagingMask_;
+            unsigned n = qMin(qMin(head - tail, stagingMask_ + 1 - index), chunkSize_);
+            source_.propagate(n, &staging_[index]);
+            tail += n;
+            stagingTail_.storeRelease(tail);
+        }
+    }
+
+    /**
+     * Number of objects dropped because the staging queue was full.
+     */
+    unsigned stagingDrops() const { return stagingDrops_.load(); }
+
 private:
+    /**
+     * Move new data from the buffer into the staging queue and post
+     * the executor task. Run by the buffer writer.
+     */
+    void stageNewData()
+    {
+        unsigned head = stagingHead_.load();
+        unsigned tail = stagingTail_.loadAcquire();
+        unsigned free = stagingMask_ + 1 - (head - tail);
+        RingBufferSpan<const TYPE> span;
+        while ((span = this->readContiguous(chunkSize_)).size) {
+            unsigned n = qMin(span.size, free);
+            for (unsigned i = 0; i < n; ++i)
+                staging_[(head + i) & stagingMask_] = span.data[i];
+            head += n;
+            free -= n;
+            if (n < span.size)
+                stagingDrops_.fetchAndAddRelaxed(span.size - n);
+            this->consume(span.size);
+        }
+        stagingHead_.storeRelease(head);
+
+        executor_->post(task_);
+    }
+
     Source<TYPE> source_;    /**< Source */
-    unsigned     chunkSize_; /**< How many objects can be buffered */
-    TYPE*        chunk_;     /**< Data storage */
+    unsigned     chunkSize_; /**< How many objects are propagated at once */
+
+    const Callback<BufferReader> stage_;    /**< ready callback when executor is used */
+    Executor*                    executor_; /**< executor running the bin */
+    Executor::Task*              task_;     /**< task of the bin */
+    TYPE*                        staging_;  /**< staging queue */
+    unsigned                     stagingMask_; /**< staging queue capacity - 1 */
+    QAtomicInteger<unsigned>     stagingHead_; /**< written by buffer writer */
+    QAtomicInteger<unsigned>     stagingTail_; /**< written by executor */
+    QAtomicInteger<unsigned>     stagingDrops_; /**< objects dropped */
 };
 
 #endif
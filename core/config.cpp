@@ -104,6 +104,17 @@ QStringList SensorFrameworkConfig::groups() const
     return groups;
 }
 
+QStringList SensorFrameworkConfig::keys(const QString &group) const
+{
+    const QString prefix(group + "/");
+    QStringList keys;
+    foreach (const QString &key, m_settings.allKeys()) {
+        if (key.startsWith(prefix) && key.indexOf('/', prefix.size()) < 0)
+            keys.append(key.mid(prefix.size()));
+    }
+    return keys;
+}
+
 SensorFrameworkConfig *SensorFrameworkConfig::configuration() {
     if (!static_configuration) {
         sensordLogW() << "Configuration has not been loaded";
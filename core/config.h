@@ -62,6 +62,14 @@ public:
      */
     QStringList groups() const;
 
+    /**
+     * List of keys directly inside given group, i.e. without subgroups.
+     *
+     * @param group Group path, for example "chain/node".
+     * @return keys relative to the group.
+     */
+    QStringList keys(const QString &group) const;
+
     /**
      * Find value for given key. Given default value is returned if key
      * does not exists.
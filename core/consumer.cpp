@@ -27,10 +27,12 @@
 
 #include "consumer.h"
 #include "logging.h"
+#include "sink.h"
 
 void Consumer::addSink(SinkBase* sink, const QString& name)
 {
     sinks_.insert(name, sink);
+    SENSORFW_LATENCY_NAME(sink->latencyProbe(), LatencyStats::className(typeid(*this)) + "." + name);
 }
 
 SinkBase* Consumer::sink(const QString& name) const
@@ -32,19 +32,31 @@ SOURCES += sensormanager.cpp \
     source.cpp \
     consumer.cpp \
     bin.cpp \
+    executor.cpp \
     filter.cpp \
     deviceadaptor.cpp \
+    timestampmapper.cpp \
+    tracefile.cpp \
+    tracerecorder.cpp \
     loader.cpp \
     plugin.cpp \
     abstractsensor_a.cpp \
     abstractsensor.cpp \
     parameterparser.cpp \
     abstractchain.cpp \
+    pipelinechain.cpp \
     sysfsadaptor.cpp \
+    wakeupgrid.cpp \
     sockethandler.cpp \
     inputdevadaptor.cpp \
     config.cpp \
-    nodebase.cpp
+    nodebase.cpp \
+    samplequeue.cpp \
+    latencystats.cpp \
+    xyzblock.cpp \
+    downsampler.cpp \
+    fastmath.cpp \
+    latestsamplecache.cpp
 
 HEADERS += sensormanager.h \
     sensormanager_a.h \
@@ -57,9 +69,13 @@ HEADERS += sensormanager.h \
     consumer.h \
     sink.h \
     bin.h \
+    executor.h \
     filter.h \
     deviceadaptor.h \
     deviceadaptorringbuffer.h \
+    timestampmapper.h \
+    tracefile.h \
+    tracerecorder.h \
     bufferreader.h \
     loader.h \
     plugin.h \
@@ -68,11 +84,20 @@ HEADERS += sensormanager.h \
     logging.h \
     parameterparser.h \
     abstractchain.h \
+    pipelinechain.h \
     sysfsadaptor.h \
+    wakeupgrid.h \
     sockethandler.h \
     inputdevadaptor.h \
     config.h \
-    nodebase.h
+    nodebase.h \
+    samplequeue.h \
+    latencystats.h \
+    xyzblock.h \
+    slidingwindow.h \
+    downsampler.h \
+    fastmath.h \
+    latestsamplecache.h
 
 mce {
     SOURCES += mcewatcher.cpp
@@ -44,11 +44,10 @@ public:
     /**
      * Constructor.
      *
-     * @param chunkSize how many objects will be internally buffered.
+     * @param chunkSize how many objects are emitted at once.
      */
     DataEmitter(unsigned chunkSize) :
-        chunkSize_(chunkSize),
-        chunk_(new TYPE[chunkSize])
+        chunkSize_(chunkSize)
     {
     }
 
@@ -57,7 +56,6 @@ public:
      */
     virtual ~DataEmitter()
     {
-        delete[] chunk_;
     }
 
     /**
@@ -65,11 +63,12 @@ public:
      */
     void pushNewData()
     {
-        unsigned n;
-        while ((n = RingBufferReader<TYPE>::read(chunkSize_, chunk_))) {
-            for (unsigned i = 0; i < n; ++i) {
-                emitData(chunk_[i]);
+        RingBufferSpan<const TYPE> span;
+        while ((span = this->readContiguous(chunkSize_)).size) {
+            for (unsigned i = 0; i < span.size; ++i) {
+                emitData(span.data[i]);
             }
+            this->consume(span.size);
         }
     }
 
@@ -80,8 +79,7 @@ protected:
     virtual void emitData(const TYPE& value) = 0;
 
 private:
-    unsigned     chunkSize_; /**< How many objects can be buffered */
-    TYPE*        chunk_;     /**< Buffer */
+    unsigned     chunkSize_; /**< How many objects are emitted at once */
 };
 
 #endif
@@ -29,6 +29,7 @@
 
 #include "deviceadaptor.h"
 #include "sensormanager.h"
+#include "ringbuffer.h"
 
 AdaptedSensorEntry::AdaptedSensorEntry(const QString& name, const QString& description, RingBufferBase* buffer) :
     name_(name),
@@ -100,6 +101,8 @@ DeviceAdaptor::~DeviceAdaptor()
 
 void DeviceAdaptor::setAdaptedSensor(const QString& name, const QString& description, RingBufferBase* buffer)
 {
+    if (buffer)
+        SENSORFW_LATENCY_NAME(buffer->latencyProbe(), id() + "/" + name);
     setAdaptedSensor(name, new AdaptedSensorEntry(name, description, buffer));
 }
 
@@ -36,6 +36,7 @@
 #include <QPair>
 #include "logging.h"
 #include "nodebase.h"
+#include "timestampmapper.h"
 
 class RingBufferBase;
 
@@ -200,11 +201,20 @@ public:
 
     const QString& name() { return sensor_.first; }
 
+    /**
+     * Mapping of sample times of this adaptor to CLOCK_MONOTONIC.
+     *
+     * @return timestamp mapper.
+     */
+    const TimestampMapper& timestampMapper() const { return timestampMapper_; }
+
 protected:
     void setAdaptedSensor(const QString& name, const QString& description, RingBufferBase* buffer);
 
     const QPair<QString, AdaptedSensorEntry*>& sensor() const { return sensor_; }
 
+    TimestampMapper timestampMapper_; /**< sample time mapping, used from the reader thread */
+
 private:
     void setAdaptedSensor(const QString& name, AdaptedSensorEntry* newAdaptedSensor);
 
@@ -47,6 +47,7 @@ public:
     {}
 
     using RingBuffer<TYPE>::nextSlot;
+    using RingBuffer<TYPE>::writeContiguous;
     using RingBuffer<TYPE>::commit;
     using RingBuffer<TYPE>::wakeUpReaders;
 };
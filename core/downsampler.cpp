@@ -0,0 +1,68 @@
+/**
+   @file downsampler.cpp
+   @brief Per session downsampling of sensor channel output
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "downsampler.h"
+#include <math.h>
+
+DownsamplerBase::Filter DownsamplerBase::filterFromName(const QString& name, Filter fallback)
+{
+    QString lower(name.trimmed().toLower());
+    if (lower == "box")
+        return Box;
+    if (lower == "decimate")
+        return Decimate;
+    if (lower == "polyphase")
+        return Polyphase;
+    return fallback;
+}
+
+const char* DownsamplerBase::filterName(Filter filter)
+{
+    switch (filter) {
+    case Decimate:
+        return "decimate";
+    case Polyphase:
+        return "polyphase";
+    case Box:
+    default:
+        return "box";
+    }
+}
+
+QVector<double> DownsamplerBase::lowPass(unsigned factor)
+{
+    const int taps = qMax(factor, 2u) * TAPS_PER_PHASE;
+    const double cutoff = 0.5 / qMax(factor, 2u);
+    const double center = (taps - 1) / 2.0;
+
+    QVector<double> result(taps);
+    double total = 0;
+    for (int i = 0; i < taps; ++i) {
+        double t = i - center;
+        double sinc = (t == 0) ? 2 * cutoff : sin(2 * M_PI * cutoff * t) / (M_PI * t);
+        double window = 0.54 - 0.46 * cos(2 * M_PI * i / (taps - 1));
+        result[i] = sinc * window;
+        total += result[i];
+    }
+    for (int i = 0; i < taps; ++i)
+        result[i] /= total;
+    return result;
+}
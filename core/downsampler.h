@@ -0,0 +1,425 @@
+/**
+   @file downsampler.h
+   @brief Per session downsampling of sensor channel output
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef DOWNSAMPLER_H
+#define DOWNSAMPLER_H
+
+#include <QtGlobal>
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QVector>
+#include "genericdata.h"
+#include "orientationdata.h"
+
+/**
+ * Describes the values of a sample type which are downsampled. Other
+ * members of the output sample, like the timestamp, are taken from the
+ * newest input sample.
+ *
+ * Specializations provide:
+ * - enum { AXES = n }
+ * - static void values(const TYPE& sample, int* values)
+ * - static void setValues(TYPE& sample, const int* values)
+ */
+template <class TYPE>
+struct DownsampleTraits;
+
+template <>
+struct DownsampleTraits<TimedXyzData>
+{
+    enum { AXES = 3 };
+
+    static void values(const TimedXyzData& sample, int* values)
+    {
+        values[0] = sample.x_;
+        values[1] = sample.y_;
+        values[2] = sample.z_;
+    }
+
+    static void setValues(TimedXyzData& sample, const int* values)
+    {
+        sample.x_ = values[0];
+        sample.y_ = values[1];
+        sample.z_ = values[2];
+    }
+};
+
+template <>
+struct DownsampleTraits<CalibratedMagneticFieldData>
+{
+    enum { AXES = 6 };
+
+    static void values(const CalibratedMagneticFieldData& sample, int* values)
+    {
+        values[0] = sample.x_;
+        values[1] = sample.y_;
+        values[2] = sample.z_;
+        values[3] = sample.rx_;
+        values[4] = sample.ry_;
+        values[5] = sample.rz_;
+    }
+
+    static void setValues(CalibratedMagneticFieldData& sample, const int* values)
+    {
+        sample.x_ = values[0];
+        sample.y_ = values[1];
+        sample.z_ = values[2];
+        sample.rx_ = values[3];
+        sample.ry_ = values[4];
+        sample.rz_ = values[5];
+    }
+};
+
+/**
+ * Type independent parts of Downsampler.
+ */
+class DownsamplerBase
+{
+public:
+    /**
+     * How samples are reduced.
+     */
+    enum Filter
+    {
+        Box = 0,      /**< average of the samples since previous output */
+        Decimate,     /**< every n:th sample as is */
+        Polyphase     /**< windowed sinc low-pass evaluated at output instants only */
+    };
+
+    /**
+     * Taps per output phase of the polyphase low-pass.
+     */
+    enum { TAPS_PER_PHASE = 8 };
+
+    /**
+     * Parse filter name.
+     *
+     * @param name "box", "decimate" or "polyphase".
+     * @param fallback Returned for unknown names.
+     * @return filter.
+     */
+    static Filter filterFromName(const QString& name, Filter fallback);
+
+    /**
+     * Name of filter.
+     */
+    static const char* filterName(Filter filter);
+
+    /**
+     * Design low-pass FIR for decimation. Cutoff is at the output
+     * Nyquist frequency, taps are Hamming windowed and sum to one.
+     *
+     * @param factor Decimation factor, at least 2.
+     * @return factor * TAPS_PER_PHASE taps, newest sample first.
+     */
+    static QVector<double> lowPass(unsigned factor);
+};
+
+/**
+ * Reduces the rate of a channel output for sessions which requested a
+ * longer interval than the channel runs at. Sessions with the same
+ * decimation factor form a group and share one accumulator, so the cost
+ * per input sample depends on the number of distinct factors, not on the
+ * number of sessions, and nothing is allocated per sample.
+ *
+ * Groups are recomputed by the owner only when session intervals or the
+ * channel interval change; see AbstractSensorChannel.
+ *
+ * @tparam TYPE Sample type with a DownsampleTraits specialization.
+ */
+template <class TYPE>
+class Downsampler : public DownsamplerBase
+{
+public:
+    typedef DownsampleTraits<TYPE> Traits;
+    enum { AXES = Traits::AXES };
+
+    /**
+     * Constructor.
+     *
+     * @param filter Reduction method.
+     * @param maxAge Accumulated samples older than this relative to the
+     *               newest sample are discarded, in microseconds.
+     */
+    explicit Downsampler(Filter filter = Box, quint64 maxAge = 2000000) :
+        filter_(filter),
+        maxAge_(maxAge),
+        generation_(0),
+        interval_(0),
+        valid_(false)
+    {
+    }
+
+    /**
+     * Change reduction method. Accumulated state is discarded.
+     */
+    void setFilter(Filter filter)
+    {
+        if (filter == filter_)
+            return;
+        filter_ = filter;
+        for (int i = 0; i < groups_.size(); ++i)
+            initGroup(groups_[i]);
+    }
+
+    /**
+     * Reduction method.
+     */
+    Filter filter() const { return filter_; }
+
+    /**
+     * Are groups computed for the given state.
+     *
+     * @param generation Owner defined session state counter.
+     * @param interval Channel interval.
+     */
+    bool isCurrent(quint64 generation, unsigned interval) const
+    {
+        return valid_ && generation == generation_ && interval == interval_;
+    }
+
+    /**
+     * Replace groups. Accumulators of factors which still exist are
+     * kept, so sessions do not see a gap when others come and go.
+     *
+     * @param generation Owner defined session state counter.
+     * @param interval Channel interval.
+     * @param factors Sessions for each decimation factor. Factors 0 and
+     *                1 pass samples through.
+     */
+    void setGroups(quint64 generation, unsigned interval, const QMap<unsigned, QList<int> >& factors)
+    {
+        QVector<Group> groups;
+        groups.reserve(factors.size());
+        for (QMap<unsigned, QList<int> >::const_iterator it = factors.constBegin(); it != factors.constEnd(); ++it) {
+            if (it.value().isEmpty())
+                continue;
+            unsigned factor = qMax(it.key(), 1u);
+            if (!groups.isEmpty() && groups.last().factor == factor) {
+                groups.last().sessions += it.value();
+                continue;
+            }
+            int old = findGroup(factor);
+            if (old >= 0) {
+                groups.append(groups_[old]);
+            } else {
+                Group group;
+                group.factor = factor;
+                initGroup(group);
+                groups.append(group);
+            }
+            groups.last().sessions = it.value();
+        }
+        groups_ = groups;
+        generation_ = generation;
+        interval_ = interval;
+        valid_ = true;
+    }
+
+    /**
+     * Forget session. Groups are recomputed on next use.
+     *
+     * @param sessionId Session ID.
+     */
+    void remove(int sessionId)
+    {
+        for (int i = 0; i < groups_.size(); ++i)
+            groups_[i].sessions.removeAll(sessionId);
+        valid_ = false;
+    }
+
+    /**
+     * Number of groups.
+     */
+    int groupCount() const { return groups_.size(); }
+
+    /**
+     * Sessions of a group.
+     *
+     * @param group Group index.
+     */
+    const QList<int>& sessions(int group) const { return groups_[group].sessions; }
+
+    /**
+     * Decimation factor of a group.
+     *
+     * @param group Group index.
+     */
+    unsigned factor(int group) const { return groups_[group].factor; }
+
+    /**
+     * Feed sample to a group.
+     *
+     * @param group Group index.
+     * @param sample Input sample.
+     * @return output sample, or 0 if the group produces nothing for this
+     *         input. Valid until the next call for the same group.
+     */
+    const TYPE* push(int group, const TYPE& sample)
+    {
+        Group& g = groups_[group];
+        if (g.factor <= 1)
+            return &sample;
+
+        int values[AXES];
+        Traits::values(sample, values);
+
+        switch (filter_) {
+        case Decimate:
+            if (++g.count < g.factor)
+                return 0;
+            g.count = 0;
+            return &sample;
+
+        case Polyphase:
+            return pushPolyphase(g, sample, values);
+
+        case Box:
+        default:
+            return pushBox(g, sample, values);
+        }
+    }
+
+private:
+    /**
+     * Accumulator of one decimation factor.
+     */
+    struct Group
+    {
+        unsigned        factor;          /**< decimation factor */
+        QList<int>      sessions;        /**< sessions reading the output */
+        unsigned        count;           /**< inputs since previous output */
+        quint64         first;           /**< timestamp of oldest accumulated input */
+        quint64         last;            /**< timestamp of newest input */
+        bool            primed;          /**< is history filled */
+        qint64          sums[AXES];      /**< box sums */
+        QVector<double> taps;            /**< low-pass taps, newest first */
+        QVector<int>    history;         /**< ring of taps.size() inputs, AXES each */
+        int             head;            /**< next history slot */
+        TYPE            output;          /**< last output sample */
+    };
+
+    int findGroup(unsigned factor) const
+    {
+        for (int i = 0; i < groups_.size(); ++i) {
+            if (groups_[i].factor == factor)
+                return i;
+        }
+        return -1;
+    }
+
+    void initGroup(Group& g) const
+    {
+        g.count = 0;
+        g.first = 0;
+        g.last = 0;
+        g.primed = false;
+        for (int axis = 0; axis < AXES; ++axis)
+            g.sums[axis] = 0;
+        g.head = 0;
+        if (filter_ == Polyphase && g.factor > 1) {
+            if ((unsigned)g.taps.size() != g.factor * TAPS_PER_PHASE)
+                g.taps = lowPass(g.factor);
+            g.history.fill(0, g.taps.size() * AXES);
+        } else {
+            g.taps.clear();
+            g.history.clear();
+        }
+    }
+
+    const TYPE* pushBox(Group& g, const TYPE& sample, const int* values)
+    {
+        if (g.count && sample.timestamp_ - g.first > maxAge_)
+            g.count = 0;
+        if (g.count == 0) {
+            g.first = sample.timestamp_;
+            for (int axis = 0; axis < AXES; ++axis)
+                g.sums[axis] = 0;
+        }
+        for (int axis = 0; axis < AXES; ++axis)
+            g.sums[axis] += values[axis];
+        if (++g.count < g.factor)
+            return 0;
+
+        int averages[AXES];
+        for (int axis = 0; axis < AXES; ++axis)
+            averages[axis] = g.sums[axis] / (qint64)g.count;
+        g.count = 0;
+        g.output = sample;
+        Traits::setValues(g.output, averages);
+        return &g.output;
+    }
+
+    const TYPE* pushPolyphase(Group& g, const TYPE& sample, const int* values)
+    {
+        const int taps = g.taps.size();
+
+        // Start over after a gap by filling the history with the sample,
+        // which avoids the transient of a zeroed filter
+        if (!g.primed || sample.timestamp_ - g.last > maxAge_) {
+            for (int i = 0; i < taps; ++i) {
+                for (int axis = 0; axis < AXES; ++axis)
+                    g.history[i * AXES + axis] = values[axis];
+            }
+            g.count = 0;
+            g.primed = true;
+        }
+        g.last = sample.timestamp_;
+
+        int* slot = g.history.data() + g.head * AXES;
+        for (int axis = 0; axis < AXES; ++axis)
+            slot[axis] = values[axis];
+        g.head = (g.head + 1) % taps;
+
+        if (++g.count < g.factor)
+            return 0;
+        g.count = 0;
+
+        // Only output instants are evaluated: each output costs taps
+        // multiplies and inputs between outputs cost a store
+        double acc[AXES] = { 0 };
+        const int* history = g.history.constData();
+        const double* coefficient = g.taps.constData();
+        int index = g.head;
+        for (int i = 0; i < taps; ++i) {
+            index = (index == 0 ? taps : index) - 1;
+            for (int axis = 0; axis < AXES; ++axis)
+                acc[axis] += coefficient[i] * history[index * AXES + axis];
+        }
+
+        int filtered[AXES];
+        for (int axis = 0; axis < AXES; ++axis)
+            filtered[axis] = qRound(acc[axis]);
+        g.output = sample;
+        Traits::setValues(g.output, filtered);
+        return &g.output;
+    }
+
+    Filter          filter_;         /**< reduction method */
+    quint64         maxAge_;         /**< max age of accumulated samples */
+    QVector<Group>  groups_;         /**< groups ordered by factor */
+    quint64         generation_;     /**< owner state groups were computed for */
+    unsigned        interval_;       /**< channel interval groups were computed for */
+    bool            valid_;          /**< are groups computed */
+};
+
+#endif // DOWNSAMPLER_H
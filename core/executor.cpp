@@ -0,0 +1,124 @@
+/**
+   @file executor.cpp
+   @brief Worker thread for running bins
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "executor.h"
+#include "logging.h"
+#include <QMutexLocker>
+#include <time.h>
+
+static quint64 threadCpuTime()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0)
+        return 0;
+    return (quint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+Executor::Executor(const QString& name, int queueSize) :
+    name_(name),
+    queueSize_(queueSize),
+    current_(0),
+    running_(true),
+    cpuTime_(0),
+    overflows_(0)
+{
+    queue_.reserve(queueSize);
+    start();
+}
+
+Executor::~Executor()
+{
+    stopExecutor();
+    wait();
+}
+
+bool Executor::post(Task* task)
+{
+    if (!task->queued_.testAndSetOrdered(0, 1))
+        return true;
+
+    QMutexLocker locker(&mutex_);
+    if (queue_.size() >= queueSize_) {
+        task->queued_.store(0);
+        overflows_.fetchAndAddRelaxed(1);
+        return false;
+    }
+    queue_.append(task);
+    wakeup_.wakeOne();
+    return true;
+}
+
+void Executor::cancel(Task* task)
+{
+    QMutexLocker locker(&mutex_);
+    if (queue_.removeAll(task))
+        task->queued_.store(0);
+    while (current_ == task)
+        idle_.wait(&mutex_);
+}
+
+bool Executor::waitIdle()
+{
+    QMutexLocker locker(&mutex_);
+    bool waited = false;
+    while (running_ && (current_ || !queue_.isEmpty())) {
+        idle_.wait(&mutex_);
+        waited = true;
+    }
+    return waited;
+}
+
+void Executor::stopExecutor()
+{
+    QMutexLocker locker(&mutex_);
+    running_ = false;
+    wakeup_.wakeOne();
+}
+
+void Executor::run()
+{
+    sensordLogD() << "Executor" << name_ << "started";
+
+    QMutexLocker locker(&mutex_);
+    forever {
+        while (running_ && queue_.isEmpty())
+            wakeup_.wait(&mutex_);
+        if (queue_.isEmpty())
+            break;
+
+        current_ = queue_.takeFirst();
+        // Data arriving while the task runs queues it again.
+        current_->queued_.store(0);
+        locker.unlock();
+
+        quint64 begin = threadCpuTime();
+        (*current_->callback_)();
+        quint64 spent = threadCpuTime() - begin;
+        current_->cpuTime_.fetchAndAddRelaxed(spent);
+        cpuTime_.fetchAndAddRelaxed(spent);
+
+        locker.relock();
+        current_ = 0;
+        idle_.wakeAll();
+    }
+
+    sensordLogD() << "Executor" << name_ << "stopped";
+}
@@ -0,0 +1,150 @@
+/**
+   @file executor.h
+   @brief Worker thread for running bins
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include "callback.h"
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInteger>
+#include <QAtomicInt>
+#include <QString>
+#include <QVector>
+
+/**
+ * Worker thread which runs posted tasks in order. Used by Bin to move
+ * filter processing away from adaptor threads. Several bins may share
+ * one executor.
+ */
+class Executor : public QThread
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(Executor)
+
+public:
+    /**
+     * Unit of work. Task is queued at most once at a time; posting an
+     * already queued task is a no-op.
+     */
+    class Task
+    {
+    public:
+        /**
+         * Constructor.
+         *
+         * @param callback Callback to run on the executor.
+         */
+        Task(const CallbackBase* callback) : callback_(callback), queued_(0), cpuTime_(0) {}
+
+        /**
+         * Thread CPU time spent running this task.
+         *
+         * @return CPU time in nanoseconds.
+         */
+        quint64 cpuTime() const { return cpuTime_.load(); }
+
+    private:
+        friend class Executor;
+
+        const CallbackBase*     callback_; /**< work */
+        QAtomicInt              queued_;   /**< is task queued */
+        QAtomicInteger<quint64> cpuTime_;  /**< accumulated CPU time */
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param name Executor name.
+     * @param queueSize Max number of queued tasks.
+     */
+    Executor(const QString& name, int queueSize = 64);
+
+    /**
+     * Destructor. Stops the thread.
+     */
+    virtual ~Executor();
+
+    /**
+     * Queue task. Can be called from any thread.
+     *
+     * @param task Task to run.
+     * @return false if queue was full.
+     */
+    bool post(Task* task);
+
+    /**
+     * Remove task from queue and wait until it is not running.
+     *
+     * @param task Task to cancel.
+     */
+    void cancel(Task* task);
+
+    /**
+     * Wait until no task is queued or running.
+     *
+     * @return false if the executor was idle already.
+     */
+    bool waitIdle();
+
+    /**
+     * Stop thread after queued tasks have been run.
+     */
+    void stopExecutor();
+
+    /**
+     * Executor name.
+     */
+    const QString& name() const { return name_; }
+
+    /**
+     * Thread CPU time spent running tasks.
+     *
+     * @return CPU time in nanoseconds.
+     */
+    quint64 cpuTime() const { return cpuTime_.load(); }
+
+    /**
+     * Number of posts rejected because queue was full.
+     */
+    unsigned overflows() const { return overflows_.load(); }
+
+protected:
+    /**
+     * Thread entry-function.
+     */
+    void run();
+
+private:
+    QString                 name_;      /**< name */
+    QMutex                  mutex_;     /**< guards queue */
+    QWaitCondition          wakeup_;    /**< signalled on post and stop */
+    QWaitCondition          idle_;      /**< signalled when task finishes */
+    QVector<Task*>          queue_;     /**< queued tasks */
+    int                     queueSize_; /**< max queued tasks */
+    Task*                   current_;   /**< running task */
+    bool                    running_;   /**< should thread be running */
+    QAtomicInteger<quint64> cpuTime_;   /**< accumulated CPU time */
+    QAtomicInteger<unsigned> overflows_; /**< rejected posts */
+};
+
+#endif // EXECUTOR_H
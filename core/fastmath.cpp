@@ -0,0 +1,64 @@
+/**
+   @file fastmath.cpp
+   @brief Single precision approximations of trigonometric functions
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "fastmath.h"
+#include "config.h"
+#include <math.h>
+
+FastMath::Mode FastMath::modeFromName(const QString& name, Mode fallback)
+{
+    QString lower(name.trimmed().toLower());
+    if (lower == "fast")
+        return Fast;
+    if (lower == "precise")
+        return Precise;
+    return fallback;
+}
+
+FastMath::Mode FastMath::configuredMode(const QString& group)
+{
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    if (!config)
+        return Precise;
+    return modeFromName(config->value<QString>(group + "/math_mode", "precise"), Precise);
+}
+
+void FastMath::atan2(unsigned n, const float* y, const float* x, float* result)
+{
+    for (unsigned i = 0; i < n; ++i)
+        result[i] = atan2(y[i], x[i]);
+}
+
+double FastMath::inclination(int a, int b, int c, Mode mode)
+{
+    if (mode == Precise)
+        return ::atan((double)a / sqrt(b * b + c * c));
+    return atan2((float)a, sqrtf((float)b * b + (float)c * c));
+}
+
+void FastMath::inclination(unsigned n, const int* a, const int* b, const int* c, float* result)
+{
+    for (unsigned i = 0; i < n; ++i) {
+        const float fb = b[i];
+        const float fc = c[i];
+        result[i] = atan2((float)a[i], sqrtf(fb * fb + fc * fc));
+    }
+}
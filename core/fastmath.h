@@ -0,0 +1,127 @@
+/**
+   @file fastmath.h
+   @brief Single precision approximations of trigonometric functions
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef FASTMATH_H
+#define FASTMATH_H
+
+#include <QtGlobal>
+#include <QString>
+
+/**
+ * Trigonometry for the angle computations of orientation and compass
+ * filters. Fast mode uses float arithmetic and a polynomial arctangent
+ * with an absolute error of about 1e-5 radians, far below the one
+ * degree resolution of the outputs. Precise mode is the double precision
+ * libm code the filters used before and computes the same angles.
+ *
+ * Filters read their mode from "<group>/math_mode" with value "fast" or
+ * "precise"; see configuredMode().
+ */
+class FastMath
+{
+public:
+    /**
+     * Arithmetic used by filters.
+     */
+    enum Mode
+    {
+        Precise = 0,    /**< double precision libm */
+        Fast            /**< float polynomial approximations */
+    };
+
+    /**
+     * Parse mode name.
+     *
+     * @param name "fast" or "precise".
+     * @param fallback Returned for unknown names.
+     * @return mode.
+     */
+    static Mode modeFromName(const QString& name, Mode fallback);
+
+    /**
+     * Mode configured with "<group>/math_mode", Precise by default.
+     *
+     * @param group Configuration group, e.g. "compass".
+     * @return mode.
+     */
+    static Mode configuredMode(const QString& group);
+
+    /**
+     * Arctangent of a value in [-1, 1].
+     */
+    static inline float atanUnit(float t)
+    {
+        // Abramowitz & Stegun 4.4.49, |error| <= 1e-5
+        const float t2 = t * t;
+        return t * (0.9998660f + t2 * (-0.3302995f + t2 * (0.1801410f + t2 * (-0.0851330f + t2 * 0.0208351f))));
+    }
+
+    /**
+     * Angle of vector (x, y) in radians, (-pi, pi]. Returns 0 for the
+     * zero vector like atan2().
+     */
+    static inline float atan2(float y, float x)
+    {
+        const float ax = x < 0 ? -x : x;
+        const float ay = y < 0 ? -y : y;
+        const float hi = ax > ay ? ax : ay;
+        const float lo = ax > ay ? ay : ax;
+        float angle = atanUnit(hi > 0 ? lo / hi : 0);
+        angle = ay > ax ? 1.57079633f - angle : angle;
+        angle = x < 0 ? 3.14159265f - angle : angle;
+        return y < 0 ? -angle : angle;
+    }
+
+    /**
+     * atan2() for arrays. The loop has no branches, so the compiler can
+     * vectorize it where the target allows.
+     *
+     * @param n Number of values.
+     * @param y Y values.
+     * @param x X values.
+     * @param result Angles in radians. May be either input array.
+     */
+    static void atan2(unsigned n, const float* y, const float* x, float* result);
+
+    /**
+     * Angle between vector (a, b, c) and the plane perpendicular to the
+     * a axis, atan(a / sqrt(b^2 + c^2)), in radians.
+     *
+     * @param a Value along the measured axis.
+     * @param b Value along a perpendicular axis.
+     * @param c Value along the other perpendicular axis.
+     * @param mode Arithmetic to use.
+     */
+    static double inclination(int a, int b, int c, Mode mode);
+
+    /**
+     * inclination() in fast mode for arrays.
+     *
+     * @param n Number of vectors.
+     * @param a Values along the measured axis.
+     * @param b Values along a perpendicular axis.
+     * @param c Values along the other perpendicular axis.
+     * @param result Angles in radians.
+     */
+    static void inclination(unsigned n, const int* a, const int* b, const int* c, float* result);
+};
+
+#endif // FASTMATH_H
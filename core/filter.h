@@ -48,6 +48,11 @@ protected:
  * Extendable filter class. Filters data from given source "source"
  * to sink "sink".
  *
+ * The sink callback gets every sample a buffer reader took from its ring
+ * in one call and must process all \c n of them, propagating the results
+ * in as few blocks as possible. Filters working on TimedXyzData can use
+ * XyzBlock and XyzKernels for vectorized processing.
+ *
  * @tparam INPUT_TYPE input data type.
  * @tparam DERIVED subclass type.
  * @tparam OUTPUT_TYPE output data type.
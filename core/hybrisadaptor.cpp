@@ -20,6 +20,9 @@
 
 #include "hybrisadaptor.h"
 #include "deviceadaptor.h"
+#include "sensormanager.h"
+#include "wakeupgrid.h"
+#include "datatypes/utils.h"
 
 #include <QDebug>
 #include <QCoreApplication>
@@ -199,6 +202,8 @@ HybrisSensorState::HybrisSensorState()
     , m_maxDelay(0)
     , m_delay(-1)
     , m_active(-1)
+    , m_batchLatency(0)
+    , m_fifoMaxEventCount(0)
 {
     memset(&m_fallbackEvent, 0, sizeof m_fallbackEvent);
 }
@@ -219,15 +224,24 @@ HybrisManager::HybrisManager(QObject *parent)
     , m_registeredAdaptors()
     , m_halModule(NULL)
     , m_halDevice(NULL)
+#ifdef SENSORS_DEVICE_API_VERSION_1_0
+    , m_halDevice1(NULL)
+#endif
     , m_halSensorCount(0)
     , m_halSensorArray(NULL)
     , m_halSensorState(NULL)
     , m_halIndexOfType()
     , m_halIndexOfHandle()
     , m_halEventReaderTid(0)
+    , m_dispatchTable(0)
+    , m_retiredDispatchTables()
+    , m_wakeupGrid(SensorManager::instance().wakeupGrid())
 {
     int err;
 
+    connect(&SensorManager::instance(), SIGNAL(wakeupGridChanged(unsigned int)),
+            this, SLOT(setWakeupGrid(unsigned int)));
+
     /* Open android sensor plugin */
     err = hw_get_module(SENSORS_HARDWARE_MODULE_ID,
                         (hw_module_t const**)&m_halModule);
@@ -245,6 +259,12 @@ HybrisManager::HybrisManager(QObject *parent)
         return;
     }
 
+#ifdef SENSORS_DEVICE_API_VERSION_1_0
+    /* batch() and flush() are available only via version 1 device */
+    if (m_halDevice->common.version >= SENSORS_DEVICE_API_VERSION_1_0)
+        m_halDevice1 = reinterpret_cast<struct sensors_poll_device_1 *>(m_halDevice);
+#endif
+
     /* Get static sensor information */
     m_halSensorCount = m_halModule->get_sensors_list(m_halModule, &m_halSensorArray);
 
@@ -284,6 +304,10 @@ HybrisManager::HybrisManager(QObject *parent)
 #ifdef SENSORS_DEVICE_API_VERSION_1_3
             if (m_halDevice->common.version >= SENSORS_DEVICE_API_VERSION_1_3)
                 maxDelay = (m_halSensorArray[i].maxDelay + 999) / 1000;
+#endif
+#ifdef SENSORS_DEVICE_API_VERSION_1_1
+            if (m_halDevice->common.version >= SENSORS_DEVICE_API_VERSION_1_1)
+                m_halSensorState[i].m_fifoMaxEventCount = m_halSensorArray[i].fifoMaxEventCount;
 #endif
             /* If HAL does not define maximum delay, we need to invent
              * something that a) allows sensorfwd logic to see a range
@@ -411,6 +435,8 @@ HybrisManager::~HybrisManager()
             _exit(EXIT_FAILURE);
         }
     }
+    delete m_dispatchTable.load();
+    qDeleteAll(m_retiredDispatchTables);
     delete[] m_halSensorState;
 }
 
@@ -475,18 +501,84 @@ void HybrisManager::stopReader(HybrisAdaptor *adaptor)
 
 void HybrisManager::processSample(const sensors_event_t& data)
 {
-    foreach (HybrisAdaptor *adaptor, m_registeredAdaptors.values(data.type)) {
+    QMutexLocker locker(&m_dispatchMutex);
+    queueSample(m_halIndexOfHandle.value(data.sensor, -1), data);
+    commitSamples();
+}
+
+/* Called from the main thread. The event reader thread spends its time
+ * blocked in the hal poll() and can not be woken up to do this, so the
+ * fallback is dispatched here under the lock the reader holds while it
+ * stages and commits events. The same lock keeps the reader from
+ * clearing the fallback event while it is being applied. */
+void HybrisManager::applyFallback(HybrisAdaptor *adaptor)
+{
+    int index = m_halIndexOfHandle.value(adaptor->m_sensorHandle, -1);
+    if (index == -1)
+        return;
+
+    QMutexLocker locker(&m_dispatchMutex);
+    sensors_event_t *fallback = &m_halSensorState[index].m_fallbackEvent;
+    if (fallback->sensor == adaptor->m_sensorHandle && fallback->type == adaptor->m_sensorType) {
+        sensordLogT("HYBRIS FALLBACK type:%s sensor:%d",
+                    sensorTypeName(fallback->type),
+                    fallback->sensor);
+        adaptor->processSample(*fallback);
+        adaptor->commitSamples();
+        fallback->sensor = fallback->type = 0;
+    }
+}
+
+void HybrisManager::queueSample(int index, const sensors_event_t& data)
+{
+    const DispatchTable *table = m_dispatchTable.loadAcquire();
+    if (!table || index < 0 || index >= m_halSensorCount) {
+        sensordLogT("HYBRIS EVE no adaptors for sensor %d", data.sensor);
+        return;
+    }
+    for (int i = table->m_first.at(index); i < table->m_first.at(index + 1); ++i) {
+        HybrisAdaptor *adaptor = table->m_adaptors.at(i);
         if (adaptor->isRunning()) {
             adaptor->processSample(data);
+            adaptor->m_samplesPending = true;
+        }
+    }
+}
+
+void HybrisManager::commitSamples()
+{
+    const DispatchTable *table = m_dispatchTable.loadAcquire();
+    if (!table)
+        return;
+    for (int i = 0; i < table->m_adaptors.size(); ++i) {
+        HybrisAdaptor *adaptor = table->m_adaptors.at(i);
+        if (adaptor->m_samplesPending) {
+            adaptor->m_samplesPending = false;
+            adaptor->commitSamples();
         }
     }
 }
 
 void HybrisManager::registerAdaptor(HybrisAdaptor *adaptor)
 {
-    if (!m_registeredAdaptors.values().contains(adaptor) && adaptor->isValid()) {
-        m_registeredAdaptors.insertMulti(adaptor->m_sensorType, adaptor);
+    if (m_registeredAdaptors.values().contains(adaptor) || !adaptor->isValid())
+        return;
+    m_registeredAdaptors.insertMulti(adaptor->m_sensorType, adaptor);
+
+    /* Events are dispatched by sensor type, so every hal sensor of
+     * the adaptor type feeds it */
+    DispatchTable *table = new DispatchTable;
+    table->m_first.reserve(m_halSensorCount + 1);
+    for (int index = 0; index < m_halSensorCount; ++index) {
+        table->m_first.append(table->m_adaptors.size());
+        table->m_adaptors += m_registeredAdaptors.values(m_halSensorArray[index].type).toVector();
     }
+    table->m_first.append(table->m_adaptors.size());
+
+    /* The reader thread may still be walking the previous table */
+    DispatchTable *previous = m_dispatchTable.fetchAndStoreOrdered(table);
+    if (previous)
+        m_retiredDispatchTables.append(previous);
 }
 
 float HybrisManager::halGetMaxRange(int handle) const
@@ -585,24 +677,167 @@ bool HybrisManager::halSetDelay(int handle, int delay_ms)
             sensordLogT("HYBRIS CTL setDelay(%d=%s, %d) -> no-change",
                         sensor->handle, sensorTypeName(sensor->type), delay_ms);
         } else {
-            int64_t delay_ns = delay_ms * 1000LL * 1000LL;
-            int error = m_halDevice->setDelay(m_halDevice, sensor->handle, delay_ns);
-            if (error) {
-                sensordLogW("HYBRIS CTL setDelay(%d=%s, %d) -> %d=%s",
-                            sensor->handle, sensorTypeName(sensor->type), delay_ms,
-                            error, strerror(error));
-            } else {
-                sensordLogD("HYBRIS CTL setDelay(%d=%s, %d) -> success",
-                            sensor->handle, sensorTypeName(sensor->type), delay_ms);
-                state->m_delay = delay_ms;
-                success = true;
-            }
+            success = halApplyDelay(index, delay_ms, state->m_batchLatency);
         }
     }
 
     return success;
 }
 
+bool HybrisManager::halApplyDelay(int index, int delay_ms, int latency_ms)
+{
+    const struct sensor_t *sensor = &m_halSensorArray[index];
+    HybrisSensorState     *state  = &m_halSensorState[index];
+    int error;
+
+    /* On a wakeup grid the hal gets snapped values; the state keeps the
+     * requested ones so they come back when the grid is lifted. Latency
+     * is rounded down, so the fifo still holds a whole batch. */
+    int hal_delay_ms = delay_ms;
+    int hal_latency_ms = latency_ms;
+    if (m_wakeupGrid) {
+        if (delay_ms > 0) {
+            hal_delay_ms = WakeupGrid::snapPeriod(delay_ms, m_wakeupGrid);
+            if (state->m_maxDelay > 0 && hal_delay_ms > state->m_maxDelay)
+                hal_delay_ms = delay_ms;
+        }
+        if (latency_ms >= (int)m_wakeupGrid)
+            hal_latency_ms = latency_ms / m_wakeupGrid * m_wakeupGrid;
+    }
+    int64_t delay_ns = hal_delay_ms * 1000LL * 1000LL;
+
+#ifdef SENSORS_DEVICE_API_VERSION_1_0
+    /* Plain setDelay() unless batching is being turned on or off */
+    if (m_halDevice1 && (latency_ms > 0 || state->m_batchLatency > 0)) {
+        int64_t latency_ns = hal_latency_ms * 1000LL * 1000LL;
+        error = m_halDevice1->batch(m_halDevice1, sensor->handle, 0, delay_ns, latency_ns);
+        if (error) {
+            sensordLogW("HYBRIS CTL batch(%d=%s, %d, %d) -> %d=%s",
+                        sensor->handle, sensorTypeName(sensor->type), delay_ms, latency_ms,
+                        error, strerror(-error));
+            return false;
+        }
+        sensordLogD("HYBRIS CTL batch(%d=%s, %d, %d) -> success",
+                    sensor->handle, sensorTypeName(sensor->type), delay_ms, latency_ms);
+        state->m_delay = delay_ms;
+        state->m_batchLatency = latency_ms;
+        return true;
+    }
+#endif
+
+    error = m_halDevice->setDelay(m_halDevice, sensor->handle, delay_ns);
+    if (error) {
+        sensordLogW("HYBRIS CTL setDelay(%d=%s, %d) -> %d=%s",
+                    sensor->handle, sensorTypeName(sensor->type), delay_ms,
+                    error, strerror(error));
+        return false;
+    }
+    sensordLogD("HYBRIS CTL setDelay(%d=%s, %d) -> success",
+                sensor->handle, sensorTypeName(sensor->type), delay_ms);
+    state->m_delay = delay_ms;
+    state->m_batchLatency = 0;
+    return true;
+}
+
+int HybrisManager::halGetFifoMaxEventCount(int handle) const
+{
+    int count = 0;
+    int index = halIndexForHandle(handle);
+
+    if (index != -1)
+        count = m_halSensorState[index].m_fifoMaxEventCount;
+
+    return count;
+}
+
+bool HybrisManager::halCanBatch(int handle) const
+{
+#ifdef SENSORS_DEVICE_API_VERSION_1_0
+    return m_halDevice1 && halGetFifoMaxEventCount(handle) > 0;
+#else
+    Q_UNUSED(handle);
+    return false;
+#endif
+}
+
+int HybrisManager::halGetBatchLatency(int handle) const
+{
+    int latency = 0;
+    int index = halIndexForHandle(handle);
+
+    if (index != -1)
+        latency = m_halSensorState[index].m_batchLatency;
+
+    return latency;
+}
+
+void HybrisManager::setWakeupGrid(unsigned int grid)
+{
+    if (grid == m_wakeupGrid)
+        return;
+    m_wakeupGrid = grid;
+
+    /* Inactive sensors get their delay applied again on activation */
+    for (int index = 0; index < m_halSensorCount; ++index) {
+        HybrisSensorState *state = &m_halSensorState[index];
+        if (state->m_active > 0 && state->m_delay >= 0)
+            halApplyDelay(index, state->m_delay, state->m_batchLatency);
+    }
+}
+
+bool HybrisManager::halSetBatch(int handle, int delay_ms, int latency_ms)
+{
+    int index = halIndexForHandle(handle);
+
+    if (index == -1)
+        return false;
+
+    const struct sensor_t *sensor = &m_halSensorArray[index];
+    HybrisSensorState     *state  = &m_halSensorState[index];
+
+    if (latency_ms > 0 && !halCanBatch(handle)) {
+        sensordLogW("HYBRIS CTL batch(%d=%s) -> not supported",
+                    sensor->handle, sensorTypeName(sensor->type));
+        return false;
+    }
+
+    if (state->m_delay == delay_ms && state->m_batchLatency == latency_ms) {
+        sensordLogT("HYBRIS CTL batch(%d=%s, %d, %d) -> no-change",
+                    sensor->handle, sensorTypeName(sensor->type), delay_ms, latency_ms);
+        return true;
+    }
+
+    return halApplyDelay(index, delay_ms, latency_ms);
+}
+
+bool HybrisManager::halFlush(int handle)
+{
+    bool success = false;
+    int index = halIndexForHandle(handle);
+
+#ifdef SENSORS_DEVICE_API_VERSION_1_1
+    if (index != -1 && m_halDevice1 &&
+        m_halDevice->common.version >= SENSORS_DEVICE_API_VERSION_1_1 &&
+        m_halSensorState[index].m_active > 0) {
+        const struct sensor_t *sensor = &m_halSensorArray[index];
+        int error = m_halDevice1->flush(m_halDevice1, sensor->handle);
+        if (error) {
+            sensordLogW("HYBRIS CTL flush(%d=%s) -> %d=%s",
+                        sensor->handle, sensorTypeName(sensor->type),
+                        error, strerror(-error));
+        } else {
+            sensordLogD("HYBRIS CTL flush(%d=%s) -> success",
+                        sensor->handle, sensorTypeName(sensor->type));
+            success = true;
+        }
+    }
+#else
+    Q_UNUSED(index);
+#endif
+
+    return success;
+}
+
 bool HybrisManager::halGetActive(int handle) const
 {
     bool active = false;
@@ -659,7 +894,8 @@ bool HybrisManager::halSetActive(int handle, bool active)
 void *HybrisManager::halEventReaderThread(void *aptr)
 {
     HybrisManager *manager = static_cast<HybrisManager *>(aptr);
-    static const size_t numEvents = 16;
+    /* Deep enough to drain a hardware fifo in a few polls */
+    static const size_t numEvents = POLL_BATCH_SIZE;
     sensors_event_t buffer[numEvents];
     /* Async cancellation, but disabled */
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, 0);
@@ -683,18 +919,30 @@ void *HybrisManager::halEventReaderThread(void *aptr)
             do { } while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
             continue;
         }
-        /* Process received events */
+        /* Stage received events, readers are woken up once per poll */
         bool blockSuspend = false;
         bool errorInInput = false;
+        manager->m_dispatchMutex.lock();
         for (int i = 0; i < numberOfEvents; i++) {
             const sensors_event_t& data = buffer[i];
 
             sensordLogT("HYBRIS EVE %s", sensorTypeName(data.type));
 
+#ifdef SENSORS_DEVICE_API_VERSION_1_1
+            /* Completion of flush() carries no sensor data */
+            if (data.type == SENSOR_TYPE_META_DATA) {
+                sensordLogT("HYBRIS EVE flush complete for %d", data.meta_data.sensor);
+                continue;
+            }
+#endif
+
             /* Got data -> Clear the no longer needed fallback event */
-            sensors_event_t *fallback = manager->halEventForHandle(data.sensor);
-            if (fallback && fallback->type == data.type && fallback->sensor == data.sensor) {
-                fallback->type = fallback->sensor = 0;
+            int index = manager->m_halIndexOfHandle.value(data.sensor, -1);
+            if (index != -1) {
+                sensors_event_t *fallback = &manager->m_halSensorState[index].m_fallbackEvent;
+                if (fallback->type == data.type && fallback->sensor == data.sensor) {
+                    fallback->type = fallback->sensor = 0;
+                }
             }
 
             if (data.version != sizeof(sensors_event_t)) {
@@ -704,9 +952,10 @@ void *HybrisManager::halEventReaderThread(void *aptr)
             if (data.type == SENSOR_TYPE_PROXIMITY) {
                 blockSuspend = true;
             }
-            // FIXME: is this thread safe?
-            manager->processSample(data);
+            manager->queueSample(index, data);
         }
+        manager->commitSamples();
+        manager->m_dispatchMutex.unlock();
         /* Suspend proof sensor reporting that could occur in display off */
         if (blockSuspend) {
             ObtainTemporaryWakeLock();
@@ -729,6 +978,7 @@ HybrisAdaptor::HybrisAdaptor(const QString& id, int type)
     , m_inStandbyMode(false)
     , m_isRunning(false)
     , m_shouldBeRunning(false)
+    , m_samplesPending(false)
     , m_sensorHandle(-1)
     , m_sensorType(type)
 {
@@ -739,6 +989,10 @@ HybrisAdaptor::HybrisAdaptor(const QString& id, int type)
         return;
     }
 
+    /* Android hals stamp events with elapsedRealtimeNanos(), older
+     * ones with CLOCK_MONOTONIC; learn the offset unless configured */
+    timestampMapper_.configure(id, TimestampMapper::Estimated, false);
+
     hybrisManager()->registerAdaptor(this);
 }
 
@@ -752,6 +1006,14 @@ void HybrisAdaptor::init()
     introduceAvailableInterval(DataRange(minInterval(), maxInterval(), 0));
 }
 
+quint64 HybrisAdaptor::eventTimestamp(const sensors_event_t& data)
+{
+    quint64 now = Utils::getTimeStampNs();
+    if (data.timestamp <= 0)
+        return now / 1000;
+    return timestampMapper_.mapToMicroseconds(data.timestamp, now);
+}
+
 void HybrisAdaptor::sendInitialData()
 {
     // virtual dummy
@@ -820,20 +1082,17 @@ bool HybrisAdaptor::setInterval(const unsigned int value, const int sessionId)
 {
     Q_UNUSED(sessionId);
 
-    bool ok = hybrisManager()->halSetDelay(m_sensorHandle, value);
+    bool ok;
+    if (m_bufferSize > 1 || m_bufferInterval > 0)
+        ok = hybrisManager()->halSetBatch(m_sensorHandle, value, batchLatency(value));
+    else
+        ok = hybrisManager()->halSetDelay(m_sensorHandle, value);
 
     if (!ok) {
         sensordLogW() << Q_FUNC_INFO << "setInterval not ok";
     } else {
         /* If we have not yet received sensor data, apply fallback value */
-        sensors_event_t *fallback = hybrisManager()->halEventForHandle(m_sensorHandle);
-        if (fallback && fallback->sensor == m_sensorHandle && fallback->type == m_sensorType) {
-            sensordLogT("HYBRIS FALLBACK type:%s sensor:%d",
-                        sensorTypeName(fallback->type),
-                        fallback->sensor);
-            processSample(*fallback);
-            fallback->sensor = fallback->type = 0;
-        }
+        hybrisManager()->applyFallback(this);
 
         sendInitialData();
     }
@@ -841,6 +1100,66 @@ bool HybrisAdaptor::setInterval(const unsigned int value, const int sessionId)
     return ok;
 }
 
+/* ------------------------------------------------------------------------- *
+ * hardware fifo batching
+ * ------------------------------------------------------------------------- */
+
+IntegerRangeList HybrisAdaptor::getAvailableBufferSizes(bool& hwSupported) const
+{
+    if (!hybrisManager()->halCanBatch(m_sensorHandle))
+        return DeviceAdaptor::getAvailableBufferSizes(hwSupported);
+
+    IntegerRangeList list;
+    list.push_back(IntegerRange(1, hybrisManager()->halGetFifoMaxEventCount(m_sensorHandle)));
+    hwSupported = true;
+    return list;
+}
+
+IntegerRangeList HybrisAdaptor::getAvailableBufferIntervals(bool& hwSupported) const
+{
+    if (!hybrisManager()->halCanBatch(m_sensorHandle))
+        return DeviceAdaptor::getAvailableBufferIntervals(hwSupported);
+
+    IntegerRangeList list;
+    list.push_back(IntegerRange(0, 60000));
+    hwSupported = true;
+    return list;
+}
+
+int HybrisAdaptor::batchLatency(unsigned int delay_ms) const
+{
+    // Explicit interval wins, otherwise report when buffer fills up
+    if (m_bufferInterval > 0)
+        return m_bufferInterval;
+    if (m_bufferSize > 1)
+        return m_bufferSize * delay_ms;
+    return 0;
+}
+
+bool HybrisAdaptor::setBufferSize(unsigned int value)
+{
+    if (!hybrisManager()->halCanBatch(m_sensorHandle))
+        return false;
+
+    m_bufferSize = value;
+    int delay = hybrisManager()->halGetDelay(m_sensorHandle);
+    if (delay < 0)
+        delay = defaultInterval();
+    return hybrisManager()->halSetBatch(m_sensorHandle, delay, batchLatency(delay));
+}
+
+bool HybrisAdaptor::setBufferInterval(unsigned int value)
+{
+    if (!hybrisManager()->halCanBatch(m_sensorHandle))
+        return false;
+
+    m_bufferInterval = value;
+    int delay = hybrisManager()->halGetDelay(m_sensorHandle);
+    if (delay < 0)
+        delay = defaultInterval();
+    return hybrisManager()->halSetBatch(m_sensorHandle, delay, batchLatency(delay));
+}
+
 unsigned int HybrisAdaptor::evaluateIntervalRequests(int& sessionId) const
 {
     if (m_intervalMap.size() == 0)
@@ -913,14 +1232,7 @@ void HybrisAdaptor::evaluateSensor()
             }
 
             /* If we have not yet received sensor data, apply fallback value */
-            sensors_event_t *fallback = hybrisManager()->halEventForHandle(m_sensorHandle);
-            if (fallback && fallback->sensor == m_sensorHandle && fallback->type == m_sensorType) {
-                sensordLogT("HYBRIS FALLBACK type:%s sensor:%d",
-                            sensorTypeName(fallback->type),
-                            fallback->sensor);
-                processSample(*fallback);
-                fallback->sensor = fallback->type = 0;
-            }
+            hybrisManager()->applyFallback(this);
         } else {
             if (entry->removeReference() == 0) {
                 entry->setIsRunning(false);
@@ -969,6 +1281,10 @@ bool HybrisAdaptor::resume()
         m_inStandbyMode = false;
         sensordLogT("%s m_inStandbyMode = %d", sensorTypeName(m_sensorType), m_inStandbyMode);
         evaluateSensor();
+
+        /* Deliver samples batched while display was off right away */
+        if (m_isRunning && hybrisManager()->halGetBatchLatency(m_sensorHandle) > 0)
+            hybrisManager()->halFlush(m_sensorHandle);
     }
     return true;
 }
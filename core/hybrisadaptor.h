@@ -25,6 +25,9 @@
 #include <QThread>
 #include <QTimer>
 #include <QFile>
+#include <QVector>
+#include <QAtomicPointer>
+#include <QMutex>
 
 #include <pthread.h>
 
@@ -43,6 +46,8 @@ struct HybrisSensorState
     int  m_maxDelay;
     int  m_delay;
     int  m_active;
+    int  m_batchLatency;
+    int  m_fifoMaxEventCount;
     sensors_event_t m_fallbackEvent;
 };
 
@@ -50,6 +55,9 @@ class HybrisManager : public QObject
 {
     Q_OBJECT
 public:
+    /* Events read from the hal with one poll() */
+    enum { POLL_BATCH_SIZE = 64 };
+
     static HybrisManager *instance();
 
     explicit HybrisManager(QObject *parent = 0);
@@ -71,6 +79,11 @@ public:
     bool             halSetDelay      (int handle, int delay_ms);
     bool             halGetActive     (int handle) const;
     bool             halSetActive     (int handle, bool active);
+    int              halGetFifoMaxEventCount(int handle) const;
+    bool             halCanBatch      (int handle) const;
+    int              halGetBatchLatency(int handle) const;
+    bool             halSetBatch      (int handle, int delay_ms, int latency_ms);
+    bool             halFlush         (int handle);
 
     /* - - - - - - - - - - - - - - - - - - - *
      * HybrisManager <--> sensorfwd
@@ -80,23 +93,46 @@ public:
     void stopReader      (HybrisAdaptor *adaptor);
     void registerAdaptor (HybrisAdaptor * adaptor);
     void processSample   (const sensors_event_t& data);
+    void applyFallback   (HybrisAdaptor *adaptor);
 
 private:
+    /* Adaptors receiving events of each hal sensor. Built whole in
+     * registerAdaptor() and published to the event reader thread,
+     * which then looks adaptors up without locking or allocating. */
+    struct DispatchTable
+    {
+        QVector<int>             m_first;    // [m_halSensorCount + 1], index -> offset
+        QVector<HybrisAdaptor *> m_adaptors; // grouped by hal index
+    };
+
     // fields
     bool                          m_initialized;
     QMap <int, HybrisAdaptor *>   m_registeredAdaptors; // type -> obj
     struct sensors_module_t      *m_halModule;
     struct sensors_poll_device_t *m_halDevice;
+#ifdef SENSORS_DEVICE_API_VERSION_1_0
+    struct sensors_poll_device_1 *m_halDevice1;       // NULL if hal lacks batch()
+#endif
     int                           m_halSensorCount;
     const struct sensor_t        *m_halSensorArray;   // [m_halSensorCount]
     HybrisSensorState            *m_halSensorState;   // [m_halSensorCount]
     QMap <int, int>               m_halIndexOfType;   // type   -> index
     QMap <int, int>               m_halIndexOfHandle; // handle -> index
     pthread_t                     m_halEventReaderTid;
+    QAtomicPointer<DispatchTable> m_dispatchTable;
+    QList<DispatchTable *>        m_retiredDispatchTables; // freed with manager
+    unsigned int                  m_wakeupGrid;       // ms, 0 for none
+    QMutex                        m_dispatchMutex;    // event reader vs main thread dispatch
 
     friend class HybrisAdaptorReader;
 
+private Q_SLOTS:
+    void         setWakeupGrid(unsigned int grid);
+
 private:
+    bool         halApplyDelay(int index, int delay_ms, int latency_ms);
+    void         queueSample(int index, const sensors_event_t& data);
+    void         commitSamples();
     static void *halEventReaderThread(void *aptr);
 };
 
@@ -121,10 +157,22 @@ public:
 
     virtual void sendInitialData();
 
+    virtual IntegerRangeList getAvailableBufferSizes(bool& hwSupported) const;
+    virtual IntegerRangeList getAvailableBufferIntervals(bool& hwSupported) const;
+
     friend class HybrisManager;
 
 protected:
+    /* Store one event in the output buffer without waking up readers.
+     * Events of one poll() are staged and then committed together. */
     virtual void processSample(const sensors_event_t& data) = 0;
+    /* Wake up readers once for all events staged since last commit */
+    virtual void commitSamples() = 0;
+
+    /* Sample time of a hal event as TimedData timestamp, mapped from
+     * the hal clock to CLOCK_MONOTONIC. Events without a time, like
+     * the fallback ones, are stamped with the current time. */
+    quint64      eventTimestamp(const sensors_event_t& data);
 
     qreal        minRange() const;
     qreal        maxRange() const;
@@ -138,10 +186,16 @@ protected:
     virtual unsigned int evaluateIntervalRequests(int& sessionId) const;
     static bool writeToFile(const QByteArray& path, const QByteArray& content);
 
+    virtual bool setBufferSize(unsigned int value);
+    virtual bool setBufferInterval(unsigned int value);
+
 private:
+    int           batchLatency(unsigned int delay_ms) const;
+
     bool          m_inStandbyMode;
     volatile bool m_isRunning;
     bool          m_shouldBeRunning;
+    bool          m_samplesPending; // staged during current poll
 
     int           m_sensorHandle;
     int           m_sensorType;
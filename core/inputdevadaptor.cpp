@@ -31,12 +31,14 @@
 
 #include "inputdevadaptor.h"
 #include "config.h"
+#include "datatypes/utils.h"
 
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 
 #include <QFile>
@@ -50,6 +52,7 @@ InputDevAdaptor::InputDevAdaptor(const QString& id, int maxDeviceCount) :
     cachedInterval_(0)
 {
     memset(evlist_, 0x0, sizeof(input_event)*64);
+    timestampMapper_.configure(id, TimestampMapper::Monotonic, false);
 }
 
 InputDevAdaptor::~InputDevAdaptor()
@@ -122,6 +125,26 @@ int InputDevAdaptor::getEvents(int fd)
     return bytes/sizeof(struct input_event);
 }
 
+void InputDevAdaptor::configureDescriptor(int pathId, int fd)
+{
+    Q_UNUSED(pathId);
+#ifdef EVIOCSCLOCKID
+    int clock = CLOCK_MONOTONIC;
+    if (ioctl(fd, EVIOCSCLOCKID, &clock) == 0)
+        return;
+    sensordLogD() << "Event times of" << id() << "stay in CLOCK_REALTIME: " << strerror(errno);
+#else
+    Q_UNUSED(fd);
+#endif
+    if (timestampMapper_.clock() == TimestampMapper::Monotonic)
+        timestampMapper_.setClock(TimestampMapper::Realtime);
+}
+
+quint64 InputDevAdaptor::eventTimestamp(const struct input_event *ev)
+{
+    return timestampMapper_.mapToMicroseconds(Utils::getTimeStampNs(&(ev->time)), Utils::getTimeStampNs());
+}
+
 void InputDevAdaptor::processSample(int pathId, int fd)
 {
     int numEvents = getEvents(fd);
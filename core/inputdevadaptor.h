@@ -106,6 +106,21 @@ protected:
 
     void processSample(int pathId, int fd);
 
+    /**
+     * Ask for event times from CLOCK_MONOTONIC instead of the default
+     * CLOCK_REALTIME. If the kernel can not do that, event times are
+     * mapped from realtime.
+     */
+    void configureDescriptor(int pathId, int fd);
+
+    /**
+     * Time of an event as TimedData timestamp.
+     *
+     * @param ev Event.
+     * @return CLOCK_MONOTONIC microseconds.
+     */
+    quint64 eventTimestamp(const struct input_event *ev);
+
     virtual unsigned int interval() const;
 
     virtual bool setInterval(const unsigned int value, const int sessionId);
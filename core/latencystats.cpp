@@ -0,0 +1,268 @@
+/**
+   @file latencystats.cpp
+   @brief Processing time and latency counters for the data flow
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "latencystats.h"
+#include <QMutex>
+#include <QMutexLocker>
+#include <QList>
+#include <QMap>
+#include <cxxabi.h>
+#include <stdlib.h>
+#include <time.h>
+
+QAtomicInt LatencyStats::enabled_(0);
+QAtomicInteger<quint64> LatencyStats::budget_(5000);
+
+/* Function local so that probes with static storage can register. */
+static QMutex& registryMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+static QList<LatencyProbe*>& registry()
+{
+    static QList<LatencyProbe*> probes;
+    return probes;
+}
+
+LatencyProbe::LatencyProbe(const QString& name) :
+    name_(name)
+{
+    reset();
+    LatencyStats::add(this);
+}
+
+LatencyProbe::~LatencyProbe()
+{
+    LatencyStats::remove(this);
+}
+
+QString LatencyProbe::name() const
+{
+    QMutexLocker locker(&registryMutex());
+    return name_;
+}
+
+void LatencyProbe::setName(const QString& name)
+{
+    QMutexLocker locker(&registryMutex());
+    name_ = name;
+}
+
+int LatencyProbe::bucket(quint64 us)
+{
+    int i = 0;
+    while (i < BUCKETS - 1 && us >= (1ULL << i))
+        ++i;
+    return i;
+}
+
+void LatencyProbe::raise(QAtomicInteger<quint64>& max, quint64 value)
+{
+    quint64 old = max.load();
+    while (value > old && !max.testAndSetRelaxed(old, value))
+        old = max.load();
+}
+
+void LatencyProbe::addTime(quint64 ns, int samples)
+{
+    calls_.fetchAndAddRelaxed(1);
+    samples_.fetchAndAddRelaxed(samples);
+    totalTime_.fetchAndAddRelaxed(ns);
+    raise(maxTime_, ns);
+    timeHist_[bucket(ns / 1000)].fetchAndAddRelaxed(1);
+}
+
+void LatencyProbe::addAge(quint64 timestamp)
+{
+    quint64 now = LatencyStats::clock() / 1000;
+    quint64 age = now > timestamp ? now - timestamp : 0;
+
+    ages_.fetchAndAddRelaxed(1);
+    totalAge_.fetchAndAddRelaxed(age);
+    raise(maxAge_, age);
+    ageHist_[bucket(age)].fetchAndAddRelaxed(1);
+    if (age > LatencyStats::budget())
+        overBudget_.fetchAndAddRelaxed(1);
+}
+
+void LatencyProbe::reset()
+{
+    calls_.store(0);
+    samples_.store(0);
+    totalTime_.store(0);
+    maxTime_.store(0);
+    ages_.store(0);
+    totalAge_.store(0);
+    maxAge_.store(0);
+    overBudget_.store(0);
+    for (int i = 0; i < BUCKETS; ++i) {
+        timeHist_[i].store(0);
+        ageHist_[i].store(0);
+    }
+}
+
+bool LatencyStats::isAvailable()
+{
+#ifdef SENSORFW_LATENCY_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LatencyStats::setEnabled(bool enabled)
+{
+    if (!isAvailable())
+        return false;
+    if (enabled && !isEnabled())
+        reset();
+    enabled_.store(enabled ? 1 : 0);
+    return true;
+}
+
+void LatencyStats::setBudget(quint64 us)
+{
+    budget_.store(us);
+}
+
+quint64 LatencyStats::clock()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (quint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+QString LatencyStats::className(const std::type_info& type)
+{
+    int status = 0;
+    char* name = abi::__cxa_demangle(type.name(), 0, 0, &status);
+    if (status != 0 || !name)
+        return QString(type.name());
+    QString result(name);
+    free(name);
+    return result;
+}
+
+void LatencyStats::add(LatencyProbe* probe)
+{
+    QMutexLocker locker(&registryMutex());
+    registry().append(probe);
+}
+
+void LatencyStats::remove(LatencyProbe* probe)
+{
+    QMutexLocker locker(&registryMutex());
+    registry().removeOne(probe);
+}
+
+void LatencyStats::reset()
+{
+    QMutexLocker locker(&registryMutex());
+    foreach (LatencyProbe* probe, registry())
+        probe->reset();
+}
+
+namespace {
+
+/**
+ * Counters of equally named probes.
+ */
+struct Totals
+{
+    Totals() : calls(0), samples(0), totalTime(0), maxTime(0),
+               ages(0), totalAge(0), maxAge(0), overBudget(0)
+    {
+        for (int i = 0; i < LatencyProbe::BUCKETS; ++i)
+            timeHist[i] = ageHist[i] = 0;
+    }
+
+    quint64 calls;
+    quint64 samples;
+    quint64 totalTime;
+    quint64 maxTime;
+    quint64 timeHist[LatencyProbe::BUCKETS];
+    quint64 ages;
+    quint64 totalAge;
+    quint64 maxAge;
+    quint64 overBudget;
+    quint64 ageHist[LatencyProbe::BUCKETS];
+};
+
+/* Upper bound of the bucket holding given fraction of the values. */
+QString percentile(const quint64* hist, quint64 count, int permille)
+{
+    quint64 limit = (count * permille + 999) / 1000;
+    quint64 seen = 0;
+    for (int i = 0; i < LatencyProbe::BUCKETS - 1; ++i) {
+        seen += hist[i];
+        if (seen >= limit)
+            return QString("<%1").arg(1ULL << i);
+    }
+    return QString(">=%1").arg(1ULL << (LatencyProbe::BUCKETS - 2));
+}
+
+}
+
+void LatencyStats::report(QStringList& output)
+{
+    QMap<QString, Totals> totals;
+    {
+        QMutexLocker locker(&registryMutex());
+        foreach (const LatencyProbe* probe, registry()) {
+            if (!probe->calls_.load() && !probe->ages_.load())
+                continue;
+            Totals& t = totals[probe->name_.isEmpty() ? QString("unnamed") : probe->name_];
+            t.calls += probe->calls_.load();
+            t.samples += probe->samples_.load();
+            t.totalTime += probe->totalTime_.load();
+            t.maxTime = qMax(t.maxTime, probe->maxTime_.load());
+            t.ages += probe->ages_.load();
+            t.totalAge += probe->totalAge_.load();
+            t.maxAge = qMax(t.maxAge, probe->maxAge_.load());
+            t.overBudget += probe->overBudget_.load();
+            for (int i = 0; i < LatencyProbe::BUCKETS; ++i) {
+                t.timeHist[i] += probe->timeHist_[i].load();
+                t.ageHist[i] += probe->ageHist_[i].load();
+            }
+        }
+    }
+
+    for (QMap<QString, Totals>::const_iterator it = totals.constBegin(); it != totals.constEnd(); ++it) {
+        const Totals& t = it.value();
+        QString str = QString("    %1:").arg(it.key());
+        if (t.calls)
+            str.append(QString(" %1 call(s), %2 sample(s), avg %3 us, p50 %4 us, p99 %5 us, max %6 us")
+                       .arg(t.calls).arg(t.samples).arg(t.totalTime / t.calls / 1000)
+                       .arg(percentile(t.timeHist, t.calls, 500))
+                       .arg(percentile(t.timeHist, t.calls, 990))
+                       .arg(t.maxTime / 1000));
+        if (t.ages)
+            str.append(QString("%1 age avg %2 us, p50 %3 us, p99 %4 us, max %5 us, %6 over %7 us budget")
+                       .arg(t.calls ? ";" : "")
+                       .arg(t.totalAge / t.ages)
+                       .arg(percentile(t.ageHist, t.ages, 500))
+                       .arg(percentile(t.ageHist, t.ages, 990))
+                       .arg(t.maxAge).arg(t.overBudget).arg(budget()));
+        output.append(str);
+    }
+}
@@ -0,0 +1,239 @@
+/**
+   @file latencystats.h
+   @brief Processing time and latency counters for the data flow
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include <QAtomicInteger>
+#include <QAtomicInt>
+#include <QString>
+#include <QStringList>
+#include <typeinfo>
+
+/**
+ * Counters of one instrumentation point: number of calls, histogram of
+ * time spent in the call and histogram of sample age (now - timestamp_)
+ * when the point sees samples. Times of nested points are inclusive,
+ * e.g. time of a source includes all filters downstream of it.
+ *
+ * Probes register themselves to LatencyStats. Probes with the same name
+ * are summed in reports.
+ */
+class LatencyProbe
+{
+public:
+    /**
+     * Histogram buckets. Bucket i counts values below 2^i microseconds,
+     * last bucket counts the rest.
+     */
+    enum { BUCKETS = 16 };
+
+    /**
+     * Constructor.
+     *
+     * @param name Name shown in reports.
+     */
+    explicit LatencyProbe(const QString& name = QString());
+
+    /**
+     * Destructor.
+     */
+    ~LatencyProbe();
+
+    /**
+     * Probe name.
+     */
+    QString name() const;
+
+    /**
+     * Rename probe.
+     *
+     * @param name Name shown in reports.
+     */
+    void setName(const QString& name);
+
+    /**
+     * Account one call.
+     *
+     * @param ns Time spent in nanoseconds.
+     * @param samples Number of samples handled.
+     */
+    void addTime(quint64 ns, int samples);
+
+    /**
+     * Account age of a sample.
+     *
+     * @param timestamp Sample timestamp, monotonic microseconds.
+     */
+    void addAge(quint64 timestamp);
+
+    /**
+     * Clear counters.
+     */
+    void reset();
+
+private:
+    Q_DISABLE_COPY(LatencyProbe)
+    friend class LatencyStats;
+
+    static int bucket(quint64 us);
+    static void raise(QAtomicInteger<quint64>& max, quint64 value);
+
+    QString                 name_;               /**< name, guarded by registry */
+    QAtomicInteger<quint64> calls_;              /**< instrumented calls */
+    QAtomicInteger<quint64> samples_;            /**< samples in those calls */
+    QAtomicInteger<quint64> totalTime_;          /**< ns spent */
+    QAtomicInteger<quint64> maxTime_;            /**< longest call, ns */
+    QAtomicInteger<quint32> timeHist_[BUCKETS];  /**< call time histogram */
+    QAtomicInteger<quint64> ages_;               /**< samples with age */
+    QAtomicInteger<quint64> totalAge_;           /**< us of age */
+    QAtomicInteger<quint64> maxAge_;             /**< oldest sample, us */
+    QAtomicInteger<quint64> overBudget_;         /**< samples older than budget */
+    QAtomicInteger<quint32> ageHist_[BUCKETS];   /**< sample age histogram */
+};
+
+/**
+ * Registry and runtime switch of latency probes.
+ *
+ * The hooks in the data flow are compiled in only when sensord is built
+ * with CONFIG+=latencystats (SENSORFW_LATENCY_STATS). Even then they only
+ * read one flag per call until measuring is enabled with the
+ * latency/enabled setting or over D-Bus.
+ */
+class LatencyStats
+{
+public:
+    /**
+     * Are the hooks compiled in.
+     */
+    static bool isAvailable();
+
+    /**
+     * Is measuring on.
+     */
+    static bool isEnabled() { return enabled_.load(); }
+
+    /**
+     * Turn measuring on or off. Counters are cleared when turned on.
+     *
+     * @param enabled Measure or not.
+     * @return false if the hooks are not compiled in.
+     */
+    static bool setEnabled(bool enabled);
+
+    /**
+     * Set latency budget. Samples older than this when they reach a
+     * probe are counted as over budget.
+     *
+     * @param us Budget in microseconds.
+     */
+    static void setBudget(quint64 us);
+
+    /**
+     * Latency budget in microseconds.
+     */
+    static quint64 budget() { return budget_.load(); }
+
+    /**
+     * Monotonic clock used for call times.
+     *
+     * @return nanoseconds.
+     */
+    static quint64 clock();
+
+    /**
+     * Human readable class name.
+     *
+     * @param type Type info.
+     * @return demangled name.
+     */
+    static QString className(const std::type_info& type);
+
+    /**
+     * Append one line per probe name to output.
+     *
+     * @param output Report destination.
+     */
+    static void report(QStringList& output);
+
+    /**
+     * Clear counters of all probes.
+     */
+    static void reset();
+
+private:
+    friend class LatencyProbe;
+
+    static void add(LatencyProbe* probe);
+    static void remove(LatencyProbe* probe);
+
+    static QAtomicInt              enabled_; /**< runtime switch */
+    static QAtomicInteger<quint64> budget_;  /**< latency budget, us */
+};
+
+/**
+ * Accounts time spent in a scope to a probe.
+ */
+class LatencyScope
+{
+public:
+    /**
+     * Constructor. Starts timing when measuring is on.
+     *
+     * @param probe Probe to account to.
+     * @param samples Number of samples handled in the scope.
+     */
+    LatencyScope(LatencyProbe& probe, int samples) :
+        probe_(LatencyStats::isEnabled() ? &probe : 0),
+        samples_(samples),
+        begin_(probe_ ? LatencyStats::clock() : 0)
+    {
+    }
+
+    /**
+     * Destructor. Accounts the time.
+     */
+    ~LatencyScope()
+    {
+        if (probe_)
+            probe_->addTime(LatencyStats::clock() - begin_, samples_);
+    }
+
+private:
+    Q_DISABLE_COPY(LatencyScope)
+
+    LatencyProbe* probe_;   /**< probe or 0 when not measuring */
+    int           samples_; /**< samples handled */
+    quint64       begin_;   /**< start time, ns */
+};
+
+#ifdef SENSORFW_LATENCY_STATS
+#define SENSORFW_LATENCY_SCOPE(probe, samples) LatencyScope latencyScope_(probe, samples)
+#define SENSORFW_LATENCY_AGE(probe, timestamp) \
+    do { if (LatencyStats::isEnabled()) (probe).addAge(timestamp); } while (0)
+#define SENSORFW_LATENCY_NAME(probe, name) (probe).setName(name)
+#else
+#define SENSORFW_LATENCY_SCOPE(probe, samples) do {} while (0)
+#define SENSORFW_LATENCY_AGE(probe, timestamp) do {} while (0)
+#define SENSORFW_LATENCY_NAME(probe, name) do {} while (0)
+#endif
+
+#endif // LATENCYSTATS_H
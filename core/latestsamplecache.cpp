@@ -0,0 +1,136 @@
+/**
+   @file latestsamplecache.cpp
+   @brief Latest sample of every sensor channel
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "latestsamplecache.h"
+#include "latestsampletable.h"
+#include "sockethandler.h"
+#include "logging.h"
+#include "datatypes/utils.h"
+#include <QMutexLocker>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+LatestSampleCache::LatestSampleCache(unsigned slotCount) :
+    mapping_(0),
+    mappingSize_(LatestSampleTable::mappingSize(slotCount)),
+    fd_(-1),
+    readOnlyFd_(-1),
+    table_(0),
+    used_(slotCount, false)
+{
+    fd_ = SocketHandler::createSharedMemory("sensorfw-latest", mappingSize_);
+    if (fd_ >= 0) {
+        mapping_ = mmap(0, mappingSize_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapping_ == MAP_FAILED) {
+            sensordLogW() << "Failed to map latest sample table: " << strerror(errno);
+            mapping_ = 0;
+        } else {
+            // Descriptor opened for reading only can not be mapped writable,
+            // so clients can not corrupt samples read by others
+            char path[32];
+            snprintf(path, sizeof(path), "/proc/self/fd/%d", fd_);
+            readOnlyFd_ = open(path, O_RDONLY | O_CLOEXEC);
+            if (readOnlyFd_ < 0)
+                sensordLogW() << "Latest sample table is not shared: " << strerror(errno);
+        }
+    }
+    if (!mapping_) {
+        mapping_ = calloc(1, mappingSize_);
+        if (fd_ >= 0) {
+            close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    table_ = new LatestSampleTable(mapping_);
+    table_->initialize(slotCount);
+}
+
+LatestSampleCache::~LatestSampleCache()
+{
+    delete table_;
+    if (fd_ >= 0) {
+        munmap(mapping_, mappingSize_);
+        close(fd_);
+    } else {
+        free(mapping_);
+    }
+    if (readOnlyFd_ >= 0)
+        close(readOnlyFd_);
+}
+
+int LatestSampleCache::allocate()
+{
+    QMutexLocker locker(&mutex_);
+    int slot = used_.indexOf(false);
+    if (slot < 0) {
+        sensordLogW() << "All" << used_.size() << "latest sample slots are in use";
+        return -1;
+    }
+    used_[slot] = true;
+    return slot;
+}
+
+void LatestSampleCache::release(int slot)
+{
+    QMutexLocker locker(&mutex_);
+    if (slot < 0 || slot >= used_.size())
+        return;
+    table_->write(slot, 0, 0, Utils::getTimeStamp());
+    used_[slot] = false;
+}
+
+void LatestSampleCache::write(int slot, const void* source, int size)
+{
+    if (slot < 0 || size > LatestSampleTable::SLOT_DATA_SIZE)
+        return;
+    table_->write(slot, source, size, Utils::getTimeStamp());
+}
+
+QByteArray LatestSampleCache::read(int slot, quint64* updated) const
+{
+    char data[LatestSampleTable::SLOT_DATA_SIZE];
+    int size = slot < 0 ? -1 : table_->read(slot, data, sizeof(data), updated);
+    if (size <= 0)
+        return QByteArray();
+    return QByteArray(data, size);
+}
+
+int LatestSampleCache::readOnlyFd() const
+{
+    return readOnlyFd_;
+}
+
+int LatestSampleCache::usedSlots() const
+{
+    QMutexLocker locker(&mutex_);
+    return used_.count(true);
+}
+
+int LatestSampleCache::slotCount() const
+{
+    return used_.size();
+}
@@ -0,0 +1,120 @@
+/**
+   @file latestsamplecache.h
+   @brief Latest sample of every sensor channel
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef LATESTSAMPLECACHE_H
+#define LATESTSAMPLECACHE_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QMutex>
+#include <QVector>
+
+class LatestSampleTable;
+
+/**
+ * Owner of the LatestSampleTable of sensord. Every sensor channel gets
+ * a slot where it stores each sample it outputs, whether or not anyone
+ * reads the stream. Clients read the table over D-Bus or map it
+ * read-only through readOnlyFd().
+ *
+ * The table lives in a memfd if the kernel supports it and in private
+ * memory otherwise.
+ */
+class LatestSampleCache
+{
+    Q_DISABLE_COPY(LatestSampleCache)
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param slotCount Number of slots, i.e. most channels with a cache.
+     */
+    explicit LatestSampleCache(unsigned slotCount);
+
+    /**
+     * Destructor.
+     */
+    ~LatestSampleCache();
+
+    /**
+     * Reserve a slot.
+     *
+     * @return slot index, or -1 if all slots are in use.
+     */
+    int allocate();
+
+    /**
+     * Free a slot. Its sample is cleared.
+     *
+     * @param slot Slot index.
+     */
+    void release(int slot);
+
+    /**
+     * Store sample. Safe to call from any thread.
+     *
+     * @param slot Slot index. Negative values are ignored.
+     * @param source Sample.
+     * @param size Sample size. Larger samples than the slot holds are
+     *             ignored.
+     */
+    void write(int slot, const void* source, int size);
+
+    /**
+     * Read sample.
+     *
+     * @param slot Slot index.
+     * @param updated Set to the time the sample was stored, monotonic
+     *                microseconds.
+     * @return sample, or empty array if there is none.
+     */
+    QByteArray read(int slot, quint64* updated) const;
+
+    /**
+     * Read-only descriptor of the shared table.
+     *
+     * @return file descriptor owned by the cache, or -1 if the table is
+     *         not shared.
+     */
+    int readOnlyFd() const;
+
+    /**
+     * Number of slots in use.
+     */
+    int usedSlots() const;
+
+    /**
+     * Number of slots.
+     */
+    int slotCount() const;
+
+private:
+    void*               mapping_;      /**< table memory */
+    size_t              mappingSize_;  /**< size of table memory */
+    int                 fd_;           /**< memfd or -1 */
+    int                 readOnlyFd_;   /**< read-only descriptor of memfd or -1 */
+    LatestSampleTable*  table_;        /**< table */
+    QVector<bool>       used_;         /**< allocated slots */
+    mutable QMutex      mutex_;        /**< protects used_ */
+};
+
+#endif // LATESTSAMPLECACHE_H
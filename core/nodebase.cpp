@@ -37,6 +37,10 @@ NodeBase::NodeBase(const QString& id, QObject* parent) :
     m_intervalSource(NULL),
     m_hasDefault(false),
     m_defaultInterval(0),
+    m_intervalApplied(false),
+    m_appliedInterval(0),
+    m_appliedSessionId(-1),
+    m_appliedResult(0),
     DEFAULT_DATA_RANGE_REQUEST(-1),
     id_(id),
     isValid_(false)
@@ -314,6 +318,15 @@ unsigned int NodeBase::getInterval(int sessionId) const
     return it.value();
 }
 
+int NodeBase::intervalGeneration() const
+{
+    if (!hasLocalInterval())
+    {
+        return m_intervalSource->intervalGeneration();
+    }
+    return m_intervalGeneration.load();
+}
+
 bool NodeBase::setIntervalRequest(const int sessionId, const unsigned int value)
 {
     // Has single defined source, pass the request that way
@@ -329,27 +342,75 @@ bool NodeBase::setIntervalRequest(const int sessionId, const unsigned int value)
         return false;
     }
 
-    // Store the request for the session
-    m_intervalMap[sessionId] = value;
+    // Store the request for the session and re-evaluate
+    insertIntervalRequest(sessionId, value);
+    return applyIntervalRequests();
+}
 
-    // Store the current interval
-    unsigned int previousInterval = interval();
+void NodeBase::insertIntervalRequest(int sessionId, unsigned int value)
+{
+    QMap<int, unsigned int>::iterator it(m_intervalMap.find(sessionId));
+    if (it != m_intervalMap.end())
+    {
+        if (it.value() == value)
+            return;
+        m_intervalOrder.remove(qMakePair(it.value(), sessionId));
+        it.value() = value;
+    }
+    else
+    {
+        m_intervalMap.insert(sessionId, value);
+    }
+    m_intervalOrder.insert(qMakePair(value, sessionId), true);
+    m_intervalGeneration.ref();
+}
+
+bool NodeBase::takeIntervalRequest(int sessionId)
+{
+    QMap<int, unsigned int>::iterator it(m_intervalMap.find(sessionId));
+    if (it == m_intervalMap.end())
+        return false;
+    m_intervalOrder.remove(qMakePair(it.value(), sessionId));
+    m_intervalMap.erase(it);
+    m_intervalGeneration.ref();
+    return true;
+}
 
-    // Re-evaluate
+bool NodeBase::applyIntervalRequests()
+{
     int winningSessionId;
     unsigned int winningRequest = evaluateIntervalRequests(winningSessionId);
 
-    if (winningSessionId >= 0) {
-        sensordLogD() << "Setting new interval for node: " << id() << ". Evaluation won by session '" << winningSessionId << "' with request: " << winningRequest;
-        setInterval(winningRequest, winningSessionId);
+    // No requests left keeps the current interval
+    if (winningSessionId < 0)
+        return true;
+
+    // Upstream nodes and hardware only hear about actual changes. A
+    // setInterval() call from elsewhere shows up as a changed interval().
+    if (m_intervalApplied && winningRequest == m_appliedInterval &&
+        winningSessionId == m_appliedSessionId && interval() == m_appliedResult)
+        return true;
+
+    unsigned int previousInterval = interval();
+
+    sensordLogD() << "Setting new interval for node: " << id() << ". Evaluation won by session '" << winningSessionId << "' with request: " << winningRequest;
+    if (!setInterval(winningRequest, winningSessionId))
+    {
+        // Not cached, so the next request writes the winner again
+        sensordLogW() << "Failed to set interval" << winningRequest << "for node: " << id();
+        m_intervalApplied = false;
+        return false;
     }
+    m_intervalApplied = true;
+    m_appliedInterval = winningRequest;
+    m_appliedSessionId = winningSessionId;
+    m_appliedResult = interval();
 
     // Signal listeners about change
     if (previousInterval != interval())
     {
         emit propertyChanged("interval");
     }
-
     return true;
 }
 
@@ -433,21 +494,10 @@ unsigned int NodeBase::evaluateIntervalRequests(int& sessionId) const
         return defaultInterval();
     }
 
-    // Get the winning request
-    QMap<int, unsigned int>::const_iterator it = m_intervalMap.constBegin();
-    unsigned int highestValue = it.value();
-    int winningSessionId = it.key();
-
-    for (++it; it != m_intervalMap.constEnd(); ++it)
-    {
-        if (it.value() < highestValue) {
-            highestValue = it.value();
-            winningSessionId = it.key();
-        }
-    }
-
-    sessionId = winningSessionId;
-    return highestValue;
+    // Smallest request, ties resolved by session ID
+    const QPair<unsigned int, int>& winner = m_intervalOrder.constBegin().key();
+    sessionId = winner.second;
+    return winner.first;
 }
 
 unsigned int NodeBase::defaultInterval() const
@@ -483,33 +533,15 @@ bool NodeBase::requestDefaultInterval(const int sessionId)
 
 void NodeBase::removeIntervalRequest(const int sessionId)
 {
-    unsigned int previousInterval = interval();
-
     foreach (NodeBase *source, m_sourceList)
     {
         source->removeIntervalRequest(sessionId);
     }
 
-    if (hasLocalInterval())
+    // Re-evaluate local setting if the session had a request here
+    if (hasLocalInterval() && takeIntervalRequest(sessionId))
     {
-        // Remove from local list
-        if (m_intervalMap.keys().contains(sessionId))
-        {
-            m_intervalMap.remove(sessionId);
-        }
-
-        // Re-evaluate local setting
-        int winningSessionId;
-        unsigned int winningRequest = evaluateIntervalRequests(winningSessionId);
-        if (winningSessionId >= 0) {
-            setInterval(winningRequest, winningSessionId);
-        }
-
-        // Signal listeners if changed.
-        if (previousInterval != interval())
-        {
-            emit propertyChanged("interval");
-        }
+        applyIntervalRequests();
     }
 }
 
@@ -738,14 +770,34 @@ bool NodeBase::setInterval(unsigned int value, int sessionId)
 
 bool NodeBase::setBufferSize(unsigned int value)
 {
-    Q_UNUSED(value);
+    // Pass request to the source doing hardware buffering
+    foreach (NodeBase* source, m_sourceList)
+    {
+        bool hwSupported = false;
+        source->getAvailableBufferSizes(hwSupported);
+        if (hwSupported && source->setBufferSize(value))
+        {
+            m_bufferSize = value;
+            return true;
+        }
+    }
     sensordLogD() << __func__ << "not implemented in some node using it.";
     return false;
 }
 
 bool NodeBase::setBufferInterval(unsigned int value)
 {
-    Q_UNUSED(value);
+    // Pass request to the source doing hardware buffering
+    foreach (NodeBase* source, m_sourceList)
+    {
+        bool hwSupported = false;
+        source->getAvailableBufferIntervals(hwSupported);
+        if (hwSupported && source->setBufferInterval(value))
+        {
+            m_bufferInterval = value;
+            return true;
+        }
+    }
     sensordLogD() << __func__ << "not implemented in some node using it.";
     return false;
 }
@@ -30,6 +30,9 @@
 #include <QObject>
 #include <QString>
 #include <QList>
+#include <QMap>
+#include <QPair>
+#include <QAtomicInt>
 #include "datarange.h"
 #include "logging.h"
 
@@ -176,11 +179,12 @@ public Q_SLOTS:
 
     /**
      * Set interval request for the node. Acceptable values are listed by
-     * #getAvailableIntervals().
+     * #getAvailableIntervals(). The winning request is applied right
+     * away, but only if the winner changed.
      *
      * @param sessionId Session ID.
      * @param value interval value is milliseconds.
-     * @return was request succesful.
+     * @return was request valid and the winner applied.
      */
     bool setIntervalRequest(int sessionId, unsigned int value);
 
@@ -221,6 +225,14 @@ public Q_SLOTS:
      */
     unsigned int getInterval(int sessionId) const;
 
+    /**
+     * Counter which changes whenever a session interval request is set
+     * or removed. Lets users of getInterval(int) cache the results.
+     *
+     * @return interval request generation.
+     */
+    int intervalGeneration() const;
+
     /**
      * Returns list of available buffer sizes. The list is ordered by
      * efficiency of the size.
@@ -243,14 +255,14 @@ public Q_SLOTS:
      *
      * @return current buffersize.
      */
-    virtual unsigned int bufferSize() const { return 0; }
+    virtual unsigned int bufferSize() const { return m_bufferSize; }
 
     /**
      * Get current buffer interval of the node.
      *
      * @return current buffer interval in milliseconds.
      */
-    virtual unsigned int bufferInterval() const { return 0; }
+    virtual unsigned int bufferInterval() const { return m_bufferInterval; }
 
     /**
      * Set buffersize for given session.
@@ -446,8 +458,9 @@ protected:
      * setDefaultInterval()) is returned.
      *
      * This implementation considers smallest non-negative interval request
-     * as the winner. Reimplement for nodes that need to use different
-     * approach.
+     * as the winner, ties going to the smallest session ID. Requests are
+     * kept ordered, so this takes constant time. Reimplement for nodes
+     * that need to use different approach.
      *
      * <b>Note that this approach has been considered 'proper' by design.
      * Consider carefully what the consequences may be for other parts of
@@ -494,7 +507,8 @@ protected:
 
     /**
      * Set buffer size. Nodes subclasses supporting buffering needs to
-     * reimplement this.
+     * reimplement this. By default the request is passed to the source
+     * which reports hardware buffering.
      *
      * @param value buffer size.
      * @return was buffer size set succesfully.
@@ -503,7 +517,8 @@ protected:
 
     /**
      * Set buffer interval. Nodes subclasses supporting buffering needs to
-     * reimplement this.
+     * reimplement this. By default the request is passed to the source
+     * which reports hardware buffering.
      *
      * @param value buffer interval.
      * @return was buffer interval set succesfully.
@@ -516,6 +531,30 @@ protected:
     unsigned int            m_bufferInterval; /** buffer interval */
 
 private:
+    /**
+     * Apply the winning interval request unless it is the one applied
+     * last and the interval has not been changed since.
+     *
+     * @return was the winner applied, or already in effect.
+     */
+    bool applyIntervalRequests();
+
+    /**
+     * Store or replace the interval request of a session.
+     *
+     * @param sessionId Session ID.
+     * @param value Requested interval.
+     */
+    void insertIntervalRequest(int sessionId, unsigned int value);
+
+    /**
+     * Drop the interval request of a session.
+     *
+     * @param sessionId Session ID.
+     * @return did the session have a request.
+     */
+    bool takeIntervalRequest(int sessionId);
+
     /**
      * Returns whether the class defines its own output data range, or
      * whether it uses the values from previous layer.
@@ -562,6 +601,13 @@ private:
 
     QList<NodeBase*>        m_sourceList; /**< source nodes */
 
+    QAtomicInt              m_intervalGeneration; /**< bumped on interval request changes */
+    QMap<QPair<unsigned int, int>, bool> m_intervalOrder; /**< interval requests ordered by value and session */
+    bool                    m_intervalApplied; /**< has a winner been applied */
+    unsigned int            m_appliedInterval; /**< last applied winning interval */
+    int                     m_appliedSessionId; /**< session of last applied winner */
+    unsigned int            m_appliedResult;  /**< interval() after the last applied winner */
+
     //Oldest session wins for these:
     QMap<int, unsigned int> m_bufferSizeMap; /**< buffersize requests for sessions. */
     QMap<int, unsigned int> m_bufferIntervalMap; /**< buffer interval requests for sessions. */
@@ -68,3 +68,17 @@ void ParameterParser::applyPropertyMap(QObject* object, const QMap<QString, QStr
         object->setProperty(it.key().toLatin1().data(), QVariant(it.value()));
     }
 }
+
+bool ParameterParser::parseMatrix(const QString& str, double matrix[3][3])
+{
+    QStringList cells = str.split(PROP_STRING_SEPARATOR);
+    if (cells.size() != 9) {
+        sensordLogW() << "Invalid cell count from matrix. Expected 9, got" << cells.size();
+        return false;
+    }
+
+    for (int i = 0; i < 9; ++i)
+        matrix[i / 3][i % 3] = cells.at(i).trimmed().toDouble();
+
+    return true;
+}
@@ -52,6 +52,15 @@ public:
      */
     static void applyPropertyMap(QObject* object, const QMap<QString, QString> & propertyMap);
 
+    /**
+     * Parse 3x3 matrix from nine comma separated cells in row order.
+     *
+     * @param str input string to parse.
+     * @param matrix matrix to fill. Left untouched if parsing fails.
+     * @return was the cell count correct.
+     */
+    static bool parseMatrix(const QString& str, double matrix[3][3]);
+
 private:
     static const char TYPE_SEPARATOR            = ';'; /**< type separator. */
     static const char PROP_STRING_SEPARATOR     = ','; /**< property separator */
@@ -0,0 +1,546 @@
+/**
+   @file pipelinechain.cpp
+   @brief Chain built from a pipeline description in configuration
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "pipelinechain.h"
+#include "sensormanager.h"
+#include "deviceadaptor.h"
+#include "bin.h"
+#include "bufferreader.h"
+#include "filter.h"
+#include "config.h"
+#include "logging.h"
+#include "datatypes/orientationdata.h"
+#include "datatypes/posedata.h"
+#include "datatypes/liddata.h"
+#include "datatypes/tapdata.h"
+#include <QObject>
+#include <QHash>
+#include <QSet>
+
+/* ------------------------------------------------------------------------- *
+ * PipelineDescription
+ * ------------------------------------------------------------------------- */
+
+bool PipelineDescription::isDescribed(const QString& id)
+{
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    return config && config->exists(id + "/links");
+}
+
+bool PipelineDescription::load(const QString& id)
+{
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    if (!config)
+        return fail("configuration is not loaded");
+
+    plugins_ = config->value<QStringList>(id + "/plugins");
+    for (int i = 0; i < plugins_.size(); ++i)
+        plugins_[i] = plugins_.at(i).trimmed();
+    plugins_.removeAll(QString());
+    description_ = config->value<QString>(id + "/description", "");
+
+    return parse(config->value<QStringList>(id + "/inputs"),
+                 config->value<QStringList>(id + "/filters"),
+                 config->value<QStringList>(id + "/links"),
+                 config->value<QStringList>(id + "/outputs"));
+}
+
+bool PipelineDescription::parse(const QStringList& inputs,
+                                const QStringList& filters,
+                                const QStringList& links,
+                                const QStringList& outputs)
+{
+    inputs_.clear();
+    filters_.clear();
+    links_.clear();
+    outputs_.clear();
+    errorString_.clear();
+
+    QSet<QString> names;
+    foreach (const QString& item, inputs) {
+        QString str = item.trimmed();
+        int colon = str.indexOf(':');
+        int slash = str.indexOf('/');
+        if (colon <= 0 || slash <= colon + 1 || slash == str.size() - 1)
+            return fail(QString("input '%1' is not name:provider/buffer").arg(str));
+        InputNode node;
+        node.name = str.left(colon);
+        node.provider = str.mid(colon + 1, slash - colon - 1);
+        node.buffer = str.mid(slash + 1);
+        if (names.contains(node.name))
+            return fail(QString("node '%1' is defined twice").arg(node.name));
+        names.insert(node.name);
+        inputs_.append(node);
+    }
+
+    foreach (const QString& item, filters) {
+        QString str = item.trimmed();
+        int colon = str.indexOf(':');
+        if (colon <= 0 || colon == str.size() - 1)
+            return fail(QString("filter '%1' is not name:type").arg(str));
+        FilterNode node;
+        node.name = str.left(colon);
+        node.type = str.mid(colon + 1);
+        if (names.contains(node.name))
+            return fail(QString("node '%1' is defined twice").arg(node.name));
+        names.insert(node.name);
+        filters_.append(node);
+    }
+
+    foreach (const QString& item, links) {
+        QString str = item.trimmed();
+        int arrow = str.indexOf('>');
+        Link link;
+        if (arrow <= 0 ||
+            !parsePort(str.left(arrow), "source", link.from) ||
+            !parsePort(str.mid(arrow + 1), "sink", link.to))
+            return fail(QString("link '%1' is not node[.source]>filter[.sink]").arg(str));
+        if (!isInput(link.from.node) && !isFilter(link.from.node))
+            return fail(QString("link '%1' starts from unknown node").arg(str));
+        if (!isFilter(link.to.node))
+            return fail(QString("link '%1' does not end at a filter").arg(str));
+        links_.append(link);
+    }
+
+    QSet<QString> outputNames;
+    foreach (const QString& item, outputs) {
+        QString str = item.trimmed();
+        int colon = str.indexOf(':');
+        OutputNode node;
+        if (colon <= 0 || !parsePort(str.mid(colon + 1), "source", node.from))
+            return fail(QString("output '%1' is not buffer:node[.source]").arg(str));
+        node.name = str.left(colon);
+        if (!isInput(node.from.node) && !isFilter(node.from.node))
+            return fail(QString("output '%1' reads unknown node").arg(str));
+        if (outputNames.contains(node.name))
+            return fail(QString("output '%1' is defined twice").arg(node.name));
+        outputNames.insert(node.name);
+        outputs_.append(node);
+    }
+
+    if (inputs_.isEmpty())
+        return fail("pipeline has no inputs");
+    if (outputs_.isEmpty())
+        return fail("pipeline has no outputs");
+
+    foreach (const FilterNode& filter, filters_) {
+        bool fed = false;
+        foreach (const Link& link, links_) {
+            fed = fed || link.to.node == filter.name;
+        }
+        if (!fed)
+            return fail(QString("filter '%1' has no incoming link").arg(filter.name));
+    }
+
+    if (!isAcyclic())
+        return fail("links form a cycle");
+
+    return true;
+}
+
+int PipelineDescription::fanOut(const Port& port) const
+{
+    int count = 0;
+    foreach (const Link& link, links_) {
+        if (link.from.node == port.node && link.from.port == port.port)
+            ++count;
+    }
+    foreach (const OutputNode& output, outputs_) {
+        if (output.from.node == port.node && output.from.port == port.port)
+            ++count;
+    }
+    return count;
+}
+
+int PipelineDescription::directLinks() const
+{
+    int count = 0;
+    foreach (const Link& link, links_) {
+        if (fanOut(link.from) == 1)
+            ++count;
+    }
+    return count;
+}
+
+bool PipelineDescription::fail(const QString& error)
+{
+    errorString_ = error;
+    return false;
+}
+
+bool PipelineDescription::parsePort(const QString& str, const QString& defaultPort, Port& port) const
+{
+    QString s = str.trimmed();
+    int dot = s.indexOf('.');
+    if (dot < 0) {
+        port.node = s;
+        port.port = defaultPort;
+    } else {
+        port.node = s.left(dot);
+        port.port = s.mid(dot + 1);
+    }
+    return !port.node.isEmpty() && !port.port.isEmpty();
+}
+
+bool PipelineDescription::isInput(const QString& name) const
+{
+    foreach (const InputNode& node, inputs_) {
+        if (node.name == name)
+            return true;
+    }
+    return false;
+}
+
+bool PipelineDescription::isFilter(const QString& name) const
+{
+    foreach (const FilterNode& node, filters_) {
+        if (node.name == name)
+            return true;
+    }
+    return false;
+}
+
+bool PipelineDescription::isAcyclic() const
+{
+    // Kahn: repeatedly drop filters whose producers are all dropped
+    QHash<QString, int> pending;
+    foreach (const FilterNode& node, filters_) {
+        pending.insert(node.name, 0);
+    }
+    foreach (const Link& link, links_) {
+        if (pending.contains(link.from.node))
+            ++pending[link.to.node];
+    }
+
+    QStringList ready;
+    foreach (const FilterNode& node, filters_) {
+        if (pending.value(node.name) == 0)
+            ready.append(node.name);
+    }
+
+    int visited = 0;
+    while (!ready.isEmpty()) {
+        QString name = ready.takeFirst();
+        ++visited;
+        foreach (const Link& link, links_) {
+            if (link.from.node == name && --pending[link.to.node] == 0)
+                ready.append(link.to.node);
+        }
+    }
+    return visited == filters_.size();
+}
+
+/* ------------------------------------------------------------------------- *
+ * Sample types
+ * ------------------------------------------------------------------------- */
+
+/**
+ * Buffers and readers are templates, so the pipeline finds the sample
+ * type of a provider buffer or a filter source by trying the types
+ * flowing through sensord.
+ */
+template <class TYPE>
+struct PipelineType
+{
+    static RingBufferReaderBase* reader(RingBufferBase* buffer, unsigned* capacity)
+    {
+        RingBuffer<TYPE>* typed = dynamic_cast<RingBuffer<TYPE>*>(buffer);
+        if (!typed)
+            return 0;
+        *capacity = typed->capacity();
+        return new BufferReader<TYPE>(typed->capacity());
+    }
+
+    static RingBufferBase* buffer(SourceBase* source, unsigned size)
+    {
+        return dynamic_cast<Source<TYPE>*>(source) ? new RingBuffer<TYPE>(size) : 0;
+    }
+};
+
+static const struct
+{
+    RingBufferReaderBase* (*reader)(RingBufferBase* buffer, unsigned* capacity);
+    RingBufferBase*       (*buffer)(SourceBase* source, unsigned size);
+} pipelineTypes[] = {
+    { PipelineType<TimedXyzData>::reader,                PipelineType<TimedXyzData>::buffer },
+    { PipelineType<CalibratedMagneticFieldData>::reader, PipelineType<CalibratedMagneticFieldData>::buffer },
+    { PipelineType<CompassData>::reader,                 PipelineType<CompassData>::buffer },
+    { PipelineType<TimedUnsigned>::reader,               PipelineType<TimedUnsigned>::buffer },
+    { PipelineType<ProximityData>::reader,               PipelineType<ProximityData>::buffer },
+    { PipelineType<PoseData>::reader,                    PipelineType<PoseData>::buffer },
+    { PipelineType<LidData>::reader,                     PipelineType<LidData>::buffer },
+    { PipelineType<TapData>::reader,                     PipelineType<TapData>::buffer },
+};
+
+static RingBufferReaderBase* createReader(RingBufferBase* buffer, unsigned* capacity)
+{
+    for (size_t i = 0; i < sizeof(pipelineTypes) / sizeof(pipelineTypes[0]); ++i) {
+        if (RingBufferReaderBase* reader = pipelineTypes[i].reader(buffer, capacity))
+            return reader;
+    }
+    return 0;
+}
+
+static RingBufferBase* createBuffer(SourceBase* source, unsigned size)
+{
+    for (size_t i = 0; i < sizeof(pipelineTypes) / sizeof(pipelineTypes[0]); ++i) {
+        if (RingBufferBase* buffer = pipelineTypes[i].buffer(source, size))
+            return buffer;
+    }
+    return 0;
+}
+
+/* ------------------------------------------------------------------------- *
+ * PipelineChain
+ * ------------------------------------------------------------------------- */
+
+PipelineChain::PipelineChain(const QString& id) :
+    AbstractChain(id),
+    bin_(new Bin),
+    batchSize_(1)
+{
+    PipelineDescription description;
+    if (!description.load(id)) {
+        sensordLogW() << "Pipeline" << id << "is invalid:" << description.errorString();
+        setValid(false);
+        return;
+    }
+
+    SensorManager& sm = SensorManager::instance();
+    foreach (const QString& plugin, description.plugins()) {
+        if (!sm.loadPlugin(plugin)) {
+            sensordLogW() << "Pipeline" << id << "can not load plugin" << plugin;
+            setValid(false);
+            return;
+        }
+    }
+
+    if (!build(description)) {
+        setValid(false);
+        return;
+    }
+
+    setDescription(description.description().isEmpty() ? QString("Configured pipeline")
+                                                        : description.description());
+    setRangeSource(inputNode(inputs_.first()));
+    setIntervalSource(inputNode(inputs_.first()));
+    foreach (const Input& input, inputs_) {
+        addStandbyOverrideSource(inputNode(input));
+    }
+
+    sensordLogD() << "Pipeline" << id << "built with" << filters_.size() << "filters,"
+                  << description.directLinks() << "of" << description.links().size()
+                  << "links direct," << outputs_.size() << "output buffers";
+}
+
+PipelineChain::~PipelineChain()
+{
+    SensorManager& sm = SensorManager::instance();
+    foreach (const Input& input, inputs_) {
+        if (input.reader)
+            disconnectFromSource(inputNode(input), input.buffer, input.reader);
+        if (input.adaptor)
+            sm.releaseDeviceAdaptor(input.provider);
+        else
+            sm.releaseChain(input.provider);
+        // Reader base destructor is protected, Pusher's is not
+        delete static_cast<Pusher*>(input.reader);
+    }
+    qDeleteAll(filters_);
+    qDeleteAll(outputs_);
+    delete bin_;
+}
+
+bool PipelineChain::build(const PipelineDescription& description)
+{
+    foreach (const PipelineDescription::InputNode& node, description.inputs()) {
+        if (!addInput(node))
+            return false;
+    }
+
+    foreach (const PipelineDescription::FilterNode& node, description.filters()) {
+        if (!addFilter(node))
+            return false;
+    }
+
+    foreach (const PipelineDescription::Link& link, description.links()) {
+        if (!bin_->join(link.from.node, link.from.port, link.to.node, link.to.port)) {
+            sensordLogW() << "Pipeline" << id() << "can not link"
+                          << link.from.node << "/" << link.from.port << "to"
+                          << link.to.node << "/" << link.to.port;
+            return false;
+        }
+    }
+
+    foreach (const PipelineDescription::OutputNode& node, description.outputs()) {
+        if (!addOutput(node))
+            return false;
+    }
+
+    setupExecutor(bin_);
+
+    for (int i = 0; i < inputs_.size(); ++i) {
+        const Input& input = inputs_.at(i);
+        if (!connectToSource(inputNode(input), input.buffer, input.reader)) {
+            sensordLogW() << "Pipeline" << id() << "can not read" << input.provider << "/" << input.buffer;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PipelineChain::addInput(const PipelineDescription::InputNode& node)
+{
+    SensorManager& sm = SensorManager::instance();
+    Input input;
+    input.provider = node.provider;
+    input.buffer = node.buffer;
+    input.adaptor = 0;
+    input.chain = 0;
+    input.reader = 0;
+
+    RingBufferBase* buffer = 0;
+    if (sm.getAdaptorTypes().contains(node.provider)) {
+        input.adaptor = sm.requestDeviceAdaptor(node.provider);
+        if (input.adaptor)
+            buffer = input.adaptor->findBuffer(node.buffer);
+    } else if (node.provider != id()) {
+        input.chain = sm.requestChain(node.provider);
+        if (input.chain)
+            buffer = input.chain->findBuffer(node.buffer);
+    }
+    if (!input.adaptor && !input.chain) {
+        sensordLogW() << "Pipeline" << id() << "has no provider" << node.provider;
+        return false;
+    }
+    // Keep the provider referenced so the destructor releases it
+    inputs_.append(input);
+
+    if (!buffer) {
+        sensordLogW() << "Pipeline" << id() << ":" << node.provider << "has no buffer" << node.buffer;
+        return false;
+    }
+    unsigned capacity = 1;
+    if (!(input.reader = createReader(buffer, &capacity))) {
+        sensordLogW() << "Pipeline" << id() << "does not know the sample type of"
+                      << node.provider << "/" << node.buffer;
+        return false;
+    }
+    inputs_.last().reader = input.reader;
+    batchSize_ = qMax(batchSize_, capacity);
+
+    bin_->add(input.reader, node.name);
+    producers_.insert(node.name, input.reader);
+    return true;
+}
+
+bool PipelineChain::addFilter(const PipelineDescription::FilterNode& node)
+{
+    FilterBase* filter = SensorManager::instance().instantiateFilter(node.type);
+    if (!filter) {
+        sensordLogW() << "Pipeline" << id() << "has unknown filter type" << node.type;
+        return false;
+    }
+    filters_.append(filter);
+    bin_->add(filter, node.name);
+    producers_.insert(node.name, filter);
+
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    const QString group = id() + "/" + node.name;
+    foreach (const QString& key, config->keys(group)) {
+        QVariant value = config->value(group + "/" + key);
+        // Unquoted lists in the configuration arrive split at commas
+        if (value.type() == QVariant::StringList)
+            value = value.toStringList().join(",");
+        QObject* object = dynamic_cast<QObject*>(filter);
+        if (!object || !object->setProperty(key.toLatin1().constData(), value)) {
+            sensordLogW() << "Pipeline" << id() << "can not set" << key << "of filter" << node.name;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PipelineChain::addOutput(const PipelineDescription::OutputNode& node)
+{
+    Producer* producer = producers_.value(node.from.node);
+    SourceBase* source = producer ? producer->source(node.from.port) : 0;
+    if (!source) {
+        sensordLogW() << "Pipeline" << id() << "has no source" << node.from.node << "/" << node.from.port;
+        return false;
+    }
+
+    // Sized for a whole input batch so readers of the output are not lapped
+    RingBufferBase* buffer = createBuffer(source, batchSize_);
+    if (!buffer) {
+        sensordLogW() << "Pipeline" << id() << "does not know the sample type of"
+                      << node.from.node << "/" << node.from.port;
+        return false;
+    }
+    outputs_.append(buffer);
+
+    // Bin names are shared by all nodes, outputs get their own prefix
+    const QString name = "@" + node.name;
+    bin_->add(buffer, name);
+    if (!bin_->join(node.from.node, node.from.port, name, "sink")) {
+        sensordLogW() << "Pipeline" << id() << "can not output" << node.from.node << "/" << node.from.port;
+        return false;
+    }
+    nameOutputBuffer(node.name, buffer);
+    return true;
+}
+
+NodeBase* PipelineChain::inputNode(const Input& input) const
+{
+    if (input.adaptor)
+        return input.adaptor;
+    return input.chain;
+}
+
+bool PipelineChain::start()
+{
+    if (AbstractSensorChannel::start()) {
+        sensordLogD() << "Starting pipeline" << id();
+        bin_->start();
+        foreach (const Input& input, inputs_) {
+            if (input.adaptor)
+                input.adaptor->startSensor();
+            else
+                input.chain->start();
+        }
+    }
+    return true;
+}
+
+bool PipelineChain::stop()
+{
+    if (AbstractSensorChannel::stop()) {
+        sensordLogD() << "Stopping pipeline" << id();
+        foreach (const Input& input, inputs_) {
+            if (input.adaptor)
+                input.adaptor->stopSensor();
+            else
+                input.chain->stop();
+        }
+        bin_->stop();
+    }
+    return true;
+}
@@ -0,0 +1,241 @@
+/**
+   @file pipelinechain.h
+   @brief Chain built from a pipeline description in configuration
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef PIPELINECHAIN_H
+#define PIPELINECHAIN_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include "abstractchain.h"
+
+class Bin;
+class DeviceAdaptor;
+class FilterBase;
+class Producer;
+class RingBufferReaderBase;
+
+/**
+ * Processing graph of a chain as written in the configuration group
+ * named after the chain:
+ *
+ * @code
+ * [accelerometerchain]
+ * plugins = accelerometeradaptor, coordinatealignfilter
+ * inputs  = acc:accelerometeradaptor/accelerometer
+ * filters = align:coordinatealignfilter
+ * links   = acc>align
+ * outputs = accelerometer:align
+ * align/transMatrix = "-1,0,0,0,1,0,0,0,1"
+ * @endcode
+ *
+ * Inputs read a named buffer of an adaptor or another chain, filters
+ * are instantiated by type, links connect \c node[.source] to
+ * \c filter[.sink] and outputs publish \c node[.source] as a named
+ * buffer of the chain. Ports default to "source" and "sink". Keys
+ * \c <filter>/<property> set Qt properties of the filter.
+ */
+class PipelineDescription
+{
+public:
+    /**
+     * Data source or sink of a node.
+     */
+    struct Port
+    {
+        QString node; /**< node name */
+        QString port; /**< source or sink name */
+    };
+
+    /**
+     * Buffer of an adaptor or chain read by the pipeline.
+     */
+    struct InputNode
+    {
+        QString name;     /**< node name */
+        QString provider; /**< adaptor or chain id */
+        QString buffer;   /**< buffer of the provider */
+    };
+
+    /**
+     * Filter instance.
+     */
+    struct FilterNode
+    {
+        QString name; /**< node name */
+        QString type; /**< registered filter name */
+    };
+
+    /**
+     * Connection from a producer to a filter.
+     */
+    struct Link
+    {
+        Port from; /**< producer source */
+        Port to;   /**< filter sink */
+    };
+
+    /**
+     * Named buffer published by the chain.
+     */
+    struct OutputNode
+    {
+        QString name; /**< buffer name */
+        Port    from; /**< producer source */
+    };
+
+    /**
+     * Is there a pipeline for given chain in the configuration.
+     *
+     * @param id chain id.
+     */
+    static bool isDescribed(const QString& id);
+
+    /**
+     * Read description of a chain from the configuration.
+     *
+     * @param id chain id.
+     * @return is the description valid.
+     */
+    bool load(const QString& id);
+
+    /**
+     * Parse and validate description.
+     *
+     * @param inputs list of name:provider/buffer.
+     * @param filters list of name:type.
+     * @param links list of node[.source]>filter[.sink].
+     * @param outputs list of buffer:node[.source].
+     * @return is the description valid.
+     */
+    bool parse(const QStringList& inputs,
+               const QStringList& filters,
+               const QStringList& links,
+               const QStringList& outputs);
+
+    /**
+     * Why the description is not valid.
+     */
+    const QString& errorString() const { return errorString_; }
+
+    const QList<InputNode>&  inputs()  const { return inputs_; }
+    const QList<FilterNode>& filters() const { return filters_; }
+    const QList<Link>&       links()   const { return links_; }
+    const QList<OutputNode>& outputs() const { return outputs_; }
+    const QStringList&       plugins() const { return plugins_; }
+    const QString&           description() const { return description_; }
+
+    /**
+     * Number of links and outputs fed by a producer source.
+     *
+     * @param port producer source.
+     */
+    int fanOut(const Port& port) const;
+
+    /**
+     * Number of links which are the only consumer of their source and
+     * thus end up as a direct call from producer to filter.
+     */
+    int directLinks() const;
+
+private:
+    bool fail(const QString& error);
+    bool parsePort(const QString& str, const QString& defaultPort, Port& port) const;
+    bool isInput(const QString& name) const;
+    bool isFilter(const QString& name) const;
+    bool isAcyclic() const;
+
+    QList<InputNode>  inputs_;      /**< inputs */
+    QList<FilterNode> filters_;     /**< filters */
+    QList<Link>       links_;       /**< links */
+    QList<OutputNode> outputs_;     /**< outputs */
+    QStringList       plugins_;     /**< plugins to load before building */
+    QString           description_; /**< channel description */
+    QString           errorString_; /**< parse error */
+};
+
+/**
+ * Chain built at runtime from a PipelineDescription.
+ *
+ * Filters are joined directly to each other inside one Bin, so a link
+ * costs a function call and a source with one consumer calls it without
+ * walking its sink set. Ring buffers exist only where data crosses from
+ * a provider to the pipeline and where outputs are shared with other
+ * nodes. Input readers take everything their buffer holds in one chunk.
+ *
+ * Range and interval follow the first input, standby overrides are
+ * passed to all of them. The chain can run on an executor like any
+ * other chain.
+ */
+class PipelineChain : public AbstractChain
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(PipelineChain)
+
+public:
+    /**
+     * Factory method for PipelineChain.
+     *
+     * @param id chain id, also the configuration group of the pipeline.
+     * @return new chain.
+     */
+    static AbstractChain* factoryMethod(const QString& id)
+    {
+        return new PipelineChain(id);
+    }
+
+public Q_SLOTS:
+    bool start();
+    bool stop();
+
+protected:
+    PipelineChain(const QString& id);
+    ~PipelineChain();
+
+private:
+    /**
+     * Provider buffer read by the pipeline.
+     */
+    struct Input
+    {
+        QString               provider; /**< adaptor or chain id */
+        QString               buffer;   /**< buffer name */
+        DeviceAdaptor*        adaptor;  /**< provider if it is an adaptor */
+        AbstractChain*        chain;    /**< provider if it is a chain */
+        RingBufferReaderBase* reader;   /**< reader joined to the buffer */
+    };
+
+    bool build(const PipelineDescription& description);
+    bool addInput(const PipelineDescription::InputNode& node);
+    bool addFilter(const PipelineDescription::FilterNode& node);
+    bool addOutput(const PipelineDescription::OutputNode& node);
+    NodeBase* inputNode(const Input& input) const;
+
+    Bin*                       bin_;       /**< filters of the pipeline */
+    QList<Input>               inputs_;    /**< inputs */
+    QList<FilterBase*>         filters_;   /**< filters */
+    QList<RingBufferBase*>     outputs_;   /**< output buffers */
+    QHash<QString, Producer*>  producers_; /**< inputs and filters by node name */
+    unsigned                   batchSize_; /**< largest input buffer */
+};
+
+#endif // PIPELINECHAIN_H
@@ -25,6 +25,7 @@
  */
 
 #include "producer.h"
+#include "source.h"
 
 Producer::~Producer()
 {
@@ -33,6 +34,7 @@ Producer::~Producer()
 void Producer::addSource(SourceBase* source, const QString& name)
 {
     sources_.insert(name, source);
+    SENSORFW_LATENCY_NAME(source->latencyProbe(), LatencyStats::className(typeid(*this)) + "." + name);
 }
 
 SourceBase* Producer::source(const QString& name)
@@ -50,3 +50,14 @@ void Pusher::signalNewEvent()
 {
     pushNewData();
 }
+
+bool Pusher::setExecutor(Executor* executor, Executor::Task* task, unsigned queueSize)
+{
+    Q_UNUSED(task);
+    Q_UNUSED(queueSize);
+    return executor == 0;
+}
+
+void Pusher::pushStagedData()
+{
+}
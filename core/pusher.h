@@ -29,6 +29,7 @@
 
 #include "producer.h"
 #include "callback.h"
+#include "executor.h"
 
 /**
  * Base-class for pusher type of data producers.
@@ -58,6 +59,23 @@ public:
      */
     virtual void pushNewData() = 0;
 
+    /**
+     * Defer pushing of data to an executor. When data becomes available
+     * the pusher stores it and posts the task; the task then calls
+     * pushStagedData() on the executor thread.
+     *
+     * @param executor Executor or NULL to push directly again.
+     * @param task Task to post when data has been staged.
+     * @param queueSize How many objects can be stored for the executor.
+     * @return false if the pusher can not defer pushing.
+     */
+    virtual bool setExecutor(Executor* executor, Executor::Task* task, unsigned queueSize);
+
+    /**
+     * Push data stored for the executor.
+     */
+    virtual void pushStagedData();
+
 protected:
     /**
      * Call event handler.
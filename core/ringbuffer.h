@@ -33,11 +33,29 @@
 #include "sink.h"
 #include "pusher.h"
 #include "logging.h"
-#include <QSet>
+#include <QVector>
+#include <QAtomicInteger>
+#include <atomic>
+#include <algorithm>
 
 template <class TYPE>
 class RingBuffer;
 
+/**
+ * Contiguous run of objects inside a ring buffer.
+ *
+ * @tparam TYPE object type, const for read spans.
+ */
+template <class TYPE>
+struct RingBufferSpan
+{
+    RingBufferSpan() : data(0), size(0) {}
+    RingBufferSpan(TYPE* d, unsigned s) : data(d), size(s) {}
+
+    TYPE*    data; /**< first object */
+    unsigned size; /**< number of objects */
+};
+
 /**
  * Base-class for ring buffer reader subclasses.
  */
@@ -62,13 +80,23 @@ public:
     /**
      * Constructor.
      */
-    RingBufferReader() : readCount_(0) {}
+    RingBufferReader() : readCount_(0), lapped_(0), lost_(0), buffer_(0) {}
 
     /**
      * Destructor
      */
     virtual ~RingBufferReader() {}
 
+    /**
+     * How many times the writer has overrun this reader.
+     */
+    unsigned lapped() const { return lapped_; }
+
+    /**
+     * Number of objects overwritten before this reader got to them.
+     */
+    unsigned lost() const { return lost_; }
+
 protected:
     /**
      * Read data from buffer.
@@ -82,10 +110,36 @@ protected:
         return buffer_->read(n, values, *this);
     }
 
+    /**
+     * Get unread data in place. Data stays valid until consumed as long
+     * as the writer does not lap the reader; this holds when reading on
+     * the writer thread from the wakeup callback.
+     *
+     * @param n maximum number of objects.
+     * @return span of unread objects, empty if there are none.
+     */
+    RingBufferSpan<const TYPE> readContiguous(unsigned n)
+    {
+        return buffer_->readContiguous(n, *this);
+    }
+
+    /**
+     * Mark objects returned by readContiguous() as read.
+     *
+     * @param n number of objects.
+     * @return false if the writer overwrote some of them meanwhile.
+     */
+    bool consume(unsigned n)
+    {
+        return buffer_->consume(n, *this);
+    }
+
 private:
     friend class RingBuffer<TYPE>;
 
     unsigned                readCount_; /**< how many objects have been read */
+    unsigned                lapped_;    /**< times overrun by writer */
+    unsigned                lost_;      /**< objects lost to overruns */
     const RingBuffer<TYPE>* buffer_; /**< buffer associated with this reader */
 };
 
@@ -116,6 +170,17 @@ public:
      */
     bool unjoin(RingBufferReaderBase* reader);
 
+#ifdef SENSORFW_LATENCY_STATS
+    /**
+     * Probe timing reader wakeups, i.e. pushing committed objects
+     * through everything connected to the buffer.
+     */
+    LatencyProbe& latencyProbe() { return latencyProbe_; }
+
+protected:
+    LatencyProbe latencyProbe_; /**< wakeUpReaders() timing */
+#endif
+
 private:
     /**
      * Connect reader to this buffer.
@@ -135,7 +200,15 @@ private:
 };
 
 /**
- * Ring buffer implementation.
+ * Ring buffer implementation for one writer and any number of readers.
+ *
+ * Capacity is a power of two so slots are found by masking the running
+ * counters. The writer never waits: it publishes objects by advancing
+ * writeCount_ with release semantics, and a reader which falls more than
+ * a full buffer behind skips the overwritten objects and counts itself as
+ * lapped. Before touching a slot the writer announces it in
+ * writeReserve_, which lets readers on other threads detect objects
+ * overwritten while they were copying them.
  *
  * @tparam TYPE data type in buffer.
  */
@@ -146,14 +219,20 @@ public:
     /**
      * Constructor.
      *
-     * @param size how many elements can be buffered.
+     * @param size how many elements can be buffered. Rounded up to a
+     *             power of two.
      */
     RingBuffer(unsigned size) :
         sink_(this, &RingBuffer::write),
-        bufferSize_(size),
-        writeCount_()
+        mask_(roundUpCapacity(size) - 1),
+        writeCount_(0),
+        writeReserve_(0),
+        lappedReaders_(0)
+#ifdef SENSORFW_LATENCY_STATS
+        , wokenCount_(0)
+#endif
     {
-        buffer_ = new TYPE[size];
+        buffer_ = new TYPE[mask_ + 1];
         addSink(&sink_, "sink");
     }
 
@@ -165,6 +244,16 @@ public:
         delete [] buffer_;
     }
 
+    /**
+     * Number of objects the buffer holds.
+     */
+    unsigned capacity() const { return mask_ + 1; }
+
+    /**
+     * How many times readers of this buffer have been overrun.
+     */
+    unsigned lappedReaders() const { return lappedReaders_.load(); }
+
     /**
      * Read data from buffer.
      *
@@ -177,15 +266,61 @@ public:
                   TYPE*                   values,
                   RingBufferReader<TYPE>& reader) const
     {
-        unsigned itemsRead = 0;
-        while (itemsRead < n && reader.readCount_ != (unsigned)writeCount_) {
-
-            *values++ = buffer_[reader.readCount_++ % bufferSize_];
-
-            ++itemsRead;
+        forever {
+            unsigned available = catchUp(reader);
+            unsigned count = qMin(n, available);
+            if (!count)
+                return 0;
+
+            unsigned index = reader.readCount_ & mask_;
+            unsigned first = qMin(count, mask_ + 1 - index);
+            std::copy(buffer_ + index, buffer_ + index + first, values);
+            std::copy(buffer_, buffer_ + count - first, values + first);
+
+            unsigned overwritten = overwrittenSince(reader.readCount_, count);
+            if (overwritten < count) {
+                if (overwritten) {
+                    std::copy(values + overwritten, values + count, values);
+                    countLap(reader, overwritten);
+                }
+                reader.readCount_ += count;
+                return count - overwritten;
+            }
+            countLap(reader, count);
+            reader.readCount_ += count;
         }
+    }
+
+    /**
+     * Get unread objects in place.
+     *
+     * @param n maximum number of objects.
+     * @param reader buffer reader.
+     * @return span up to the end of the buffer memory.
+     */
+    RingBufferSpan<const TYPE> readContiguous(unsigned                n,
+                                              RingBufferReader<TYPE>& reader) const
+    {
+        unsigned available = catchUp(reader);
+        unsigned index = reader.readCount_ & mask_;
+        return RingBufferSpan<const TYPE>(buffer_ + index,
+                                          qMin(qMin(n, available), mask_ + 1 - index));
+    }
 
-        return itemsRead;
+    /**
+     * Advance reader past objects obtained with readContiguous().
+     *
+     * @param n number of objects.
+     * @param reader buffer reader.
+     * @return false if some of the objects were overwritten meanwhile.
+     */
+    bool consume(unsigned n, RingBufferReader<TYPE>& reader) const
+    {
+        unsigned overwritten = overwrittenSince(reader.readCount_, n);
+        if (overwritten)
+            countLap(reader, overwritten);
+        reader.readCount_ += n;
+        return overwritten == 0;
     }
 
 protected:
@@ -196,15 +331,36 @@ protected:
      */
     TYPE* nextSlot()
     {
-        return &buffer_[writeCount_ % bufferSize_];
+        unsigned count = writeCount_.load();
+        reserve(count + 1);
+        return &buffer_[count & mask_];
     }
 
     /**
-     * Called for each object written into buffer.
+     * Get free slots to fill in place. Slots must be published with
+     * commit().
+     *
+     * @param n maximum number of slots.
+     * @return span up to the end of the buffer memory.
      */
-    void commit()
+    RingBufferSpan<TYPE> writeContiguous(unsigned n)
     {
-        ++writeCount_;
+        unsigned count = writeCount_.load();
+        unsigned index = count & mask_;
+        unsigned size = qMin(n, mask_ + 1 - index);
+        reserve(count + size);
+        return RingBufferSpan<TYPE>(buffer_ + index, size);
+    }
+
+    /**
+     * Publish objects written into slots from nextSlot() or
+     * writeContiguous().
+     *
+     * @param n number of objects.
+     */
+    void commit(unsigned n = 1)
+    {
+        writeCount_.storeRelease(writeCount_.load() + n);
     }
 
     /**
@@ -212,9 +368,13 @@ protected:
      */
     void wakeUpReaders()
     {
-        RingBufferReader<TYPE>* reader;
-        foreach (reader, readers_) {
-            reader->wakeup();
+#ifdef SENSORFW_LATENCY_STATS
+        unsigned written = writeCount_.load();
+        SENSORFW_LATENCY_SCOPE(latencyProbe_, written - wokenCount_);
+        wokenCount_ = written;
+#endif
+        for (int i = 0; i < readers_.size(); ++i) {
+            readers_.at(i)->wakeup();
         }
     }
 
@@ -228,9 +388,11 @@ protected:
     {
         // buffer incoming data
         while (n) {
-            *nextSlot() = *values++;
-            commit();
-            --n;
+            RingBufferSpan<TYPE> span = writeContiguous(n);
+            std::copy(values, values + span.size, span.data);
+            commit(span.size);
+            values += span.size;
+            n -= span.size;
         }
         wakeUpReaders();
     }
@@ -250,10 +412,11 @@ protected:
             return false;
         }
 
-        r->readCount_ = writeCount_;
+        r->readCount_ = writeCount_.loadAcquire();
         r->buffer_    = this;
 
-        readers_.insert(r);
+        if (!readers_.contains(r))
+            readers_.append(r);
         return true;
     }
 
@@ -270,17 +433,80 @@ protected:
             return false;
         }
 
-        readers_.remove(r);
+        readers_.removeAll(r);
         return true;
     }
 
 private:
+    /**
+     * Smallest power of two not less than size.
+     */
+    static unsigned roundUpCapacity(unsigned size)
+    {
+        unsigned capacity = 1;
+        while (capacity < size)
+            capacity <<= 1;
+        return capacity;
+    }
 
-    Sink<RingBuffer, TYPE>        sink_;       /**< data sink */
-    const unsigned                bufferSize_; /**< buffer size */
-    TYPE*                         buffer_;     /**< buffer */
-    unsigned int                  writeCount_; /**< how many objects have been written */
-    QSet<RingBufferReader<TYPE>*> readers_;    /**< connected readers */
+    /**
+     * Announce that slots up to given count are about to be written.
+     */
+    void reserve(unsigned count)
+    {
+        writeReserve_.store(count);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    /**
+     * Skip objects the writer has already overwritten.
+     *
+     * @return number of published objects left for the reader.
+     */
+    unsigned catchUp(RingBufferReader<TYPE>& reader) const
+    {
+        unsigned available = writeCount_.loadAcquire() - reader.readCount_;
+        if (available > mask_ + 1) {
+            countLap(reader, available - (mask_ + 1));
+            reader.readCount_ += available - (mask_ + 1);
+            available = mask_ + 1;
+        }
+        return available;
+    }
+
+    /**
+     * Check how many of the n objects starting from count may have been
+     * overwritten after the reader looked at them.
+     */
+    unsigned overwrittenSince(unsigned count, unsigned n) const
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        int overwritten = (int)(writeReserve_.load() - (mask_ + 1) - count);
+        if (overwritten <= 0)
+            return 0;
+        return qMin((unsigned)overwritten, n);
+    }
+
+    /**
+     * Record objects lost by the reader.
+     */
+    void countLap(RingBufferReader<TYPE>& reader, unsigned lost) const
+    {
+        ++reader.lapped_;
+        reader.lost_ += lost;
+        lappedReaders_.fetchAndAddRelaxed(1);
+    }
+
+    Sink<RingBuffer, TYPE>           sink_;          /**< data sink */
+    const unsigned                   mask_;          /**< capacity - 1 */
+    TYPE*                            buffer_;        /**< buffer */
+    QAtomicInteger<unsigned>         writeCount_;    /**< how many objects have been published */
+    QAtomicInteger<unsigned>         writeReserve_;  /**< how many slots the writer has claimed */
+    mutable QAtomicInteger<unsigned> lappedReaders_; /**< reader overruns */
+    QVector<RingBufferReader<TYPE>*> readers_;       /**< connected readers */
+#ifdef SENSORFW_LATENCY_STATS
+    unsigned                         wokenCount_;    /**< writeCount_ at last wakeup */
+#endif
 };
 
 #endif
@@ -0,0 +1,187 @@
+/**
+   @file samplequeue.cpp
+   @brief Lock-free sample handoff from adaptor threads to main thread
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "samplequeue.h"
+#include "logging.h"
+#include <QMutexLocker>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+SampleQueue::SampleQueue(unsigned capacity) :
+    mask_(1)
+{
+    while (mask_ < capacity)
+        mask_ <<= 1;
+    slots_ = new Slot[mask_];
+    --mask_;
+}
+
+SampleQueue::~SampleQueue()
+{
+    delete[] slots_;
+}
+
+bool SampleQueue::push(int id, const void* source, int size)
+{
+    unsigned head = head_.load();
+    unsigned used = head - tail_.loadAcquire();
+
+    if (used > mask_ || size < 0 || size > SLOT_PAYLOAD_SIZE) {
+        drops_.store(drops_.load() + 1);
+        return false;
+    }
+
+    Slot& slot = slots_[head & mask_];
+    slot.id = id;
+    slot.size = size;
+    memcpy(slot.payload, source, size);
+    head_.storeRelease(head + 1);
+
+    if (used + 1 > highWatermark_.load())
+        highWatermark_.store(used + 1);
+    return true;
+}
+
+const SampleQueue::Slot* SampleQueue::front() const
+{
+    unsigned tail = tail_.load();
+    if (tail == head_.loadAcquire())
+        return NULL;
+    return &slots_[tail & mask_];
+}
+
+void SampleQueue::pop()
+{
+    tail_.storeRelease(tail_.load() + 1);
+}
+
+unsigned SampleQueue::depth() const
+{
+    return head_.loadAcquire() - tail_.loadAcquire();
+}
+
+unsigned SampleQueue::highWatermark() const
+{
+    return highWatermark_.load();
+}
+
+unsigned SampleQueue::drops() const
+{
+    return drops_.load();
+}
+
+SampleQueueSet::SampleQueueSet(unsigned capacity) :
+    capacity_(capacity),
+    eventFd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (eventFd_ == -1)
+        sensordLogC() << "Failed to create eventfd: " << strerror(errno);
+    memset(queues_, 0, sizeof(queues_));
+}
+
+SampleQueueSet::~SampleQueueSet()
+{
+    int count = count_.loadAcquire();
+    for (int i = 0; i < count; ++i)
+        delete queues_[i];
+    if (eventFd_ != -1)
+        close(eventFd_);
+}
+
+bool SampleQueueSet::push(int id, const void* source, int size)
+{
+    // Nothing would wake up the consumer to drain the sample.
+    if (!isValid())
+        return false;
+
+    Handle* handle = handle_.localData();
+    if (!handle) {
+        SampleQueue* queue = acquire();
+        if (!queue)
+            return false;
+        handle = new Handle(this, queue);
+        handle_.setLocalData(handle);
+    }
+
+    SampleQueue* queue = handle->queue_;
+    if (!queue->push(id, source, size))
+        return false;
+
+    if (!deferred_.loadAcquire() || queue->depth() * 2 >= queue->capacity())
+        notify();
+    return true;
+}
+
+void SampleQueueSet::clearNotification()
+{
+    eventfd_t value;
+    eventfd_read(eventFd_, &value);
+    wakeupPending_.fetchAndStoreOrdered(0);
+}
+
+void SampleQueueSet::notify()
+{
+    if (wakeupPending_.testAndSetOrdered(0, 1))
+        eventfd_write(eventFd_, 1);
+}
+
+void SampleQueueSet::setDeferred(bool deferred)
+{
+    deferred_.storeRelease(deferred ? 1 : 0);
+}
+
+int SampleQueueSet::count() const
+{
+    return count_.loadAcquire();
+}
+
+SampleQueue* SampleQueueSet::queue(int index) const
+{
+    return queues_[index];
+}
+
+SampleQueue* SampleQueueSet::acquire()
+{
+    QMutexLocker locker(&mutex_);
+
+    if (!freeQueues_.isEmpty())
+        return freeQueues_.takeLast();
+
+    int count = count_.load();
+    if (count == MAX_QUEUES) {
+        sensordLogC() << "Too many threads writing samples, max" << MAX_QUEUES;
+        return NULL;
+    }
+
+    SampleQueue* queue = new SampleQueue(capacity_);
+    queues_[count] = queue;
+    count_.storeRelease(count + 1);
+    sensordLogD() << "Allocated sample queue" << count << "with" << queue->capacity() << "slots";
+    return queue;
+}
+
+void SampleQueueSet::release(SampleQueue* queue)
+{
+    QMutexLocker locker(&mutex_);
+    freeQueues_.append(queue);
+}
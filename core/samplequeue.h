@@ -0,0 +1,235 @@
+/**
+   @file samplequeue.h
+   @brief Lock-free sample handoff from adaptor threads to main thread
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SAMPLEQUEUE_H
+#define SAMPLEQUEUE_H
+
+#include <QAtomicInteger>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QList>
+#include <QThreadStorage>
+
+/**
+ * Single producer, single consumer queue of fixed size sample slots.
+ * Slots are preallocated so pushing and popping never touch the heap.
+ * Producer side is owned by one thread at a time, consumer side by the
+ * main thread.
+ */
+class SampleQueue
+{
+public:
+    /**
+     * Largest sample which fits into a slot.
+     */
+    enum { SLOT_PAYLOAD_SIZE = 64 };
+
+    /**
+     * Sample slot.
+     */
+    struct Slot
+    {
+        int  id;                        /**< Session ID, or negated fan-out ID */
+        int  size;                      /**< Payload size in bytes */
+        char payload[SLOT_PAYLOAD_SIZE]; /**< Sample data */
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param capacity Number of slots. Rounded up to a power of two.
+     */
+    explicit SampleQueue(unsigned capacity);
+
+    /**
+     * Destructor.
+     */
+    ~SampleQueue();
+
+    /**
+     * Copy sample into the queue. Producer side only.
+     *
+     * @param id Session ID.
+     * @param source Sample data.
+     * @param size Sample size in bytes.
+     * @return false if the queue was full or sample too large. Sample is
+     *         then counted as dropped.
+     */
+    bool push(int id, const void* source, int size);
+
+    /**
+     * Oldest queued slot. Consumer side only.
+     *
+     * @return slot or NULL if queue is empty.
+     */
+    const Slot* front() const;
+
+    /**
+     * Release the slot returned by front(). Consumer side only.
+     */
+    void pop();
+
+    /**
+     * Number of samples currently queued.
+     */
+    unsigned depth() const;
+
+    /**
+     * Number of slots.
+     */
+    unsigned capacity() const { return mask_ + 1; }
+
+    /**
+     * Highest depth seen by producer.
+     */
+    unsigned highWatermark() const;
+
+    /**
+     * Number of samples dropped because queue was full.
+     */
+    unsigned drops() const;
+
+private:
+    Q_DISABLE_COPY(SampleQueue)
+
+    Slot*                   slots_;         /**< slot storage */
+    unsigned                mask_;          /**< capacity - 1 */
+
+    QAtomicInteger<unsigned> head_;         /**< next slot to write, producer owned */
+    QAtomicInteger<unsigned> highWatermark_; /**< producer owned */
+    QAtomicInteger<unsigned> drops_;        /**< producer owned */
+    char                    pad_[64];       /**< keep cursors on separate cache lines */
+    QAtomicInteger<unsigned> tail_;         /**< next slot to read, consumer owned */
+};
+
+/**
+ * Set of sample queues, one per producing thread, sharing a single
+ * eventfd for waking up the consumer. A thread gets its queue on the
+ * first push; the queue is returned for reuse when the thread exits.
+ */
+class SampleQueueSet
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param capacity Slot count for each queue.
+     */
+    explicit SampleQueueSet(unsigned capacity);
+
+    /**
+     * Destructor. Producer threads must have been stopped.
+     */
+    ~SampleQueueSet();
+
+    /**
+     * Is the wakeup descriptor available.
+     */
+    bool isValid() const { return eventFd_ != -1; }
+
+    /**
+     * Descriptor which becomes readable when samples are queued.
+     */
+    int notifyFd() const { return eventFd_; }
+
+    /**
+     * Queue sample from calling thread and wake up the consumer.
+     *
+     * @param id Session ID.
+     * @param source Sample data.
+     * @param size Sample size in bytes.
+     * @return was the sample queued. Always false when the set is not
+     *         valid.
+     */
+    bool push(int id, const void* source, int size);
+
+    /**
+     * Acknowledge wakeup. Consumer must call this before draining queues
+     * so that samples pushed during draining produce a new wakeup.
+     */
+    void clearNotification();
+
+    /**
+     * Request new wakeup, e.g. when the consumer left samples behind.
+     */
+    void notify();
+
+    /**
+     * Stop waking up the consumer for every push. The consumer then
+     * drains the queues on its own schedule; a queue filling past half
+     * of its capacity still wakes it up.
+     *
+     * @param deferred should wakeups be deferred.
+     */
+    void setDeferred(bool deferred);
+
+    /**
+     * Number of allocated queues. Never decreases.
+     */
+    int count() const;
+
+    /**
+     * Get queue.
+     *
+     * @param index Queue index, less than count().
+     */
+    SampleQueue* queue(int index) const;
+
+private:
+    Q_DISABLE_COPY(SampleQueueSet)
+
+    /**
+     * Per thread reference to the queue owned by the thread.
+     */
+    class Handle
+    {
+    public:
+        Handle(SampleQueueSet* set, SampleQueue* queue) : set_(set), queue_(queue) {}
+        ~Handle() { set_->release(queue_); }
+
+        SampleQueueSet* set_;   /**< owning set */
+        SampleQueue*    queue_; /**< queue reserved for thread */
+    };
+
+    /**
+     * Reserve queue for calling thread.
+     */
+    SampleQueue* acquire();
+
+    /**
+     * Return queue of an exiting thread.
+     */
+    void release(SampleQueue* queue);
+
+    enum { MAX_QUEUES = 32 };
+
+    unsigned                    capacity_;           /**< slots per queue */
+    int                         eventFd_;            /**< wakeup descriptor */
+    QAtomicInt                  wakeupPending_;      /**< eventfd already signalled */
+    QAtomicInt                  deferred_;           /**< consumer drains on its own schedule */
+    SampleQueue*                queues_[MAX_QUEUES]; /**< allocated queues */
+    QAtomicInt                  count_;              /**< number of allocated queues */
+    QList<SampleQueue*>         freeQueues_;         /**< queues of exited threads */
+    QMutex                      mutex_;              /**< guards allocation */
+    QThreadStorage<Handle*>     handle_;             /**< queue of current thread */
+};
+
+#endif // SAMPLEQUEUE_H
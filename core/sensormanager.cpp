@@ -40,20 +40,27 @@
 #include "lsclient.h"
 #endif // SENSORFW_LUNA_SERVICE_CLIENT
 #include <QSocketNotifier>
+#include <QThread>
 #include <errno.h>
 #include "sockethandler.h"
+#include "samplequeue.h"
+#include "latestsamplecache.h"
+#include "config.h"
+#include "latencystats.h"
+#include "sysfsadaptor.h"
+#include "wakeupgrid.h"
+#include "pipelinechain.h"
+#include "tracerecorder.h"
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 #include <QSettings>
+#include <QDir>
 
-
-typedef struct {
-        int id;
-        int size;
-        void* buffer;
-} PipeData;
+/** Maximum number of samples written from one queue per wakeup. */
+static const int SAMPLE_BATCH_SIZE = 64;
 
 SensorManager* SensorManager::instance_ = NULL;
 int SensorManager::sessionIdCount_ = 0;
@@ -81,6 +88,7 @@ ChainInstanceEntry::~ChainInstanceEntry()
 
 DeviceAdaptorInstanceEntry::DeviceAdaptorInstanceEntry(const QString& type, const QString& id) :
     adaptor_(0),
+    recorder_(0),
     cnt_(0),
     type_(type)
 {
@@ -108,7 +116,14 @@ SensorManager& SensorManager::instance()
 
 SensorManager::SensorManager()
     : errorCode_(SmNoError),
-    pipeNotifier_(0),
+    sampleQueues_(0),
+    sampleNotifier_(0),
+    latestSamples_(0),
+    blankedWakeupGrid_(0),
+    wakeupGrid_(0),
+    wakeupGridFd_(-1),
+    wakeupGridNotifier_(0),
+    wakeupGridArmed_(false),
     deviation(0)
 {
     QString pluginPath;
@@ -126,12 +141,50 @@ SensorManager::SensorManager()
 
     Q_ASSERT(socketHandler_->listen(SOCKET_NAME));
 
-    if (pipe(pipefds_) == -1) {
-        sensordLogC() << "Failed to create pipe: " << strerror(errno);
-        pipefds_[0] = pipefds_[1] = 0;
-    } else {
-        pipeNotifier_ = new QSocketNotifier(pipefds_[0], QSocketNotifier::Read);
-        connect(pipeNotifier_, SIGNAL(activated(int)), this, SLOT(sensorDataHandler(int)));
+    unsigned queueSize = 256;
+    if (SensorFrameworkConfig::configuration())
+        queueSize = SensorFrameworkConfig::configuration()->value<unsigned>("global/sample_queue_size", queueSize);
+    sampleQueues_ = new SampleQueueSet(queueSize);
+    if (sampleQueues_->isValid()) {
+        sampleNotifier_ = new QSocketNotifier(sampleQueues_->notifyFd(), QSocketNotifier::Read);
+        connect(sampleNotifier_, SIGNAL(activated(int)), this, SLOT(sensorDataHandler(int)));
+    }
+
+    unsigned latestSlots = 64;
+    if (SensorFrameworkConfig::configuration())
+        latestSlots = SensorFrameworkConfig::configuration()->value<unsigned>("global/latest_sample_slots", latestSlots);
+    latestSamples_ = new LatestSampleCache(latestSlots);
+
+    if (SensorFrameworkConfig::configuration())
+        blankedWakeupGrid_ = SensorFrameworkConfig::configuration()->value<unsigned>("global/blanked_wakeup_grid", blankedWakeupGrid_);
+    if (blankedWakeupGrid_) {
+        wakeupGridFd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (wakeupGridFd_ == -1) {
+            sensordLogW() << "Wakeup grid disabled, timerfd_create(): " << strerror(errno);
+            blankedWakeupGrid_ = 0;
+        } else {
+            wakeupGridNotifier_ = new QSocketNotifier(wakeupGridFd_, QSocketNotifier::Read);
+            wakeupGridNotifier_->setEnabled(false);
+            connect(wakeupGridNotifier_, SIGNAL(activated(int)), this, SLOT(wakeupGridTick(int)));
+        }
+    }
+
+    // Chains described in configuration take precedence over the chains
+    // plugins register later under the same name
+    if (SensorFrameworkConfig::configuration()) {
+        foreach (const QString& group, SensorFrameworkConfig::configuration()->groups()) {
+            if (PipelineDescription::isDescribed(group)) {
+                sensordLogD() << "Chain" << group << "is a configured pipeline";
+                registerChain<PipelineChain>(group);
+            }
+        }
+    }
+
+    if (SensorFrameworkConfig::configuration()) {
+        LatencyStats::setBudget(SensorFrameworkConfig::configuration()->value<unsigned>("latency/budget_us", LatencyStats::budget()));
+        if (SensorFrameworkConfig::configuration()->value<bool>("latency/enabled", false) &&
+            !LatencyStats::setEnabled(true))
+            sensordLogW() << "latency/enabled set but latency measurement is not compiled in";
     }
 
     if (chmod(SOCKET_NAME, S_IRWXU|S_IRWXG|S_IRWXO) != 0) {
@@ -202,6 +255,12 @@ SensorManager::~SensorManager()
     // delete adaptors
     for(QMap<QString, DeviceAdaptorInstanceEntry>::iterator it = deviceAdaptorInstanceMap_.begin(); it != deviceAdaptorInstanceMap_.end(); ++it)
     {
+        if(it.value().recorder_)
+        {
+            it.value().adaptor_->getAdaptedSensor()->buffer()->unjoin(it.value().recorder_);
+            delete static_cast<Pusher*>(it.value().recorder_);
+            it.value().recorder_ = 0;
+        }
         if(it.value().adaptor_)
         {
             delete it.value().adaptor_;
@@ -209,10 +268,20 @@ SensorManager::~SensorManager()
         }
     }
 
+    // stop executors once nothing can post to them
+    {
+        QMutexLocker locker(&executorMutex_);
+        qDeleteAll(executorMap_);
+        executorMap_.clear();
+    }
+
     delete socketHandler_;
-    delete pipeNotifier_;
-    if (pipefds_[0]) close(pipefds_[0]);
-    if (pipefds_[1]) close(pipefds_[1]);
+    delete sampleNotifier_;
+    delete sampleQueues_;
+    delete wakeupGridNotifier_;
+    if (wakeupGridFd_ != -1)
+        close(wakeupGridFd_);
+    delete latestSamples_;
 
 #ifdef SENSORFW_MCE_WATCHER
     delete mceWatcher_;
@@ -556,6 +625,7 @@ DeviceAdaptor* SensorManager::requestDeviceAdaptor(const QString& id)
                 {
                     entryIt.value().adaptor_ = da;
                     entryIt.value().cnt_++;
+                    startTraceRecording(entryIt.value(), id);
                     sensordLogD() << "Instantiated adaptor '" << id << "'. Valid =" << da->isValid();
                 }
                 else
@@ -579,6 +649,34 @@ DeviceAdaptor* SensorManager::requestDeviceAdaptor(const QString& id)
     return da;
 }
 
+void SensorManager::startTraceRecording(DeviceAdaptorInstanceEntry& entry, const QString& id)
+{
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    QString dir(config->value<QString>("trace/record"));
+    if (dir.isEmpty())
+        return;
+
+    QStringList adaptors(config->value<QStringList>("trace/record_adaptors"));
+    if (!adaptors.isEmpty() && !adaptors.contains(id))
+        return;
+
+    // Recording over a trace being replayed would truncate it under the reader
+    QString replay(config->value<QString>("trace/replay"));
+    if (!replay.isEmpty() && QDir(dir) == QDir(replay)) {
+        sensordLogW() << "Not recording" << id << "into the replay directory" << dir;
+        return;
+    }
+
+    AdaptedSensorEntry* sensor = entry.adaptor_->getAdaptedSensor();
+    if (!sensor || !sensor->buffer())
+        return;
+
+    QDir().mkpath(dir);
+    entry.recorder_ = TraceType::record(sensor->buffer(), QString("%1/%2.trace").arg(dir).arg(id),
+                                        id, sensor->name(),
+                                        config->value<quint64>("trace/record_limit", 0));
+}
+
 void SensorManager::releaseDeviceAdaptor(const QString& id)
 {
     sensordLogD() << "Releasing adaptor:" << id;
@@ -639,22 +737,35 @@ FilterBase* SensorManager::instantiateFilter(const QString& id)
     return it.value()();
 }
 
+#ifdef SENSORFW_LATENCY_STATS
+static LatencyProbe writeProbe("SensorManager::write");
+#endif
+
 bool SensorManager::write(int id, const void* source, int size)
 {
-    void* buffer = malloc(size);
-    if(!buffer) {
-        sensordLogC() << "Malloc failed!";
+    // Every sample type starts with the TimedData timestamp
+    SENSORFW_LATENCY_SCOPE(writeProbe, 1);
+    SENSORFW_LATENCY_AGE(writeProbe, *static_cast<const quint64*>(source));
+
+    if (!sampleQueues_->isValid())
+        return deliver(id, source, size);
+    if (!sampleQueues_->push(id, source, size)) {
+        sensordLogW() << "Failed to queue sample for session" << id;
         return false;
     }
-    PipeData pipeData;
-    pipeData.id = id;
-    pipeData.size = size;
-    pipeData.buffer = buffer;
-
-    memcpy(buffer, source, size);
+    return true;
+}
 
-    if (::write(pipefds_[1], &pipeData, sizeof(pipeData)) < (int)sizeof(pipeData)) {
-        sensordLogW() << "Failed to write all data to pipe.";
+bool SensorManager::writeFanout(int fanoutId, const void* source, int size)
+{
+    SENSORFW_LATENCY_SCOPE(writeProbe, 1);
+    SENSORFW_LATENCY_AGE(writeProbe, *static_cast<const quint64*>(source));
+
+    // Session IDs are never negative, so fan-outs share the slot field.
+    if (!sampleQueues_->isValid())
+        return deliver(-fanoutId, source, size);
+    if (!sampleQueues_->push(-fanoutId, source, size)) {
+        sensordLogW() << "Failed to queue sample for fan-out" << fanoutId;
         return false;
     }
     return true;
@@ -662,14 +773,112 @@ bool SensorManager::write(int id, const void* source, int size)
 
 void SensorManager::sensorDataHandler(int)
 {
-    PipeData pipeData;
-    ssize_t bytesRead = read(pipefds_[0], &pipeData, sizeof(pipeData));
+    sampleQueues_->clearNotification();
+
+    bool pending = false;
+    for (int i = 0; i < sampleQueues_->count(); ++i) {
+        SampleQueue* queue = sampleQueues_->queue(i);
+        const SampleQueue::Slot* slot;
+        for (int n = 0; n < SAMPLE_BATCH_SIZE && (slot = queue->front()); ++n) {
+            bool ok = (slot->id < 0) ?
+                socketHandler_->writeFanout(-slot->id, slot->payload, slot->size) :
+                socketHandler_->write(slot->id, slot->payload, slot->size);
+            if (!ok) {
+                sensordLogW() << "Failed to write data to socket.";
+            }
+            queue->pop();
+        }
+        if (queue->front())
+            pending = true;
+    }
+    socketHandler_->flush();
 
-    if (!bytesRead || !socketHandler_->write(pipeData.id, pipeData.buffer, pipeData.size)) {
+    // Come back for the rest after other events have been served.
+    if (pending)
+        sampleQueues_->notify();
+}
+
+bool SensorManager::deliver(int id, const void* source, int size)
+{
+    if (QThread::currentThread() != thread()) {
+        QByteArray sample(static_cast<const char*>(source), size);
+        return QMetaObject::invokeMethod(this, "deliverSample", Qt::QueuedConnection,
+                                         Q_ARG(int, id), Q_ARG(QByteArray, sample));
+    }
+
+    bool ok = (id < 0) ?
+        socketHandler_->writeFanout(-id, source, size) :
+        socketHandler_->write(id, source, size);
+    socketHandler_->flush();
+    return ok;
+}
+
+void SensorManager::deliverSample(int id, const QByteArray& sample)
+{
+    if (!deliver(id, sample.constData(), sample.size())) {
         sensordLogW() << "Failed to write data to socket.";
     }
+}
+
+void SensorManager::wakeupGridTick(int)
+{
+    quint64 expirations;
+    if (read(wakeupGridFd_, &expirations, sizeof(expirations)) != sizeof(expirations))
+        return;
+
+    sensorDataHandler(0);
+    if (!socketHandler_->gridTick())
+        updateWakeupGridTimer();
+}
+
+void SensorManager::updateWakeupGridTimer()
+{
+    bool armed = false;
+    if (wakeupGrid_) {
+        foreach (const SensorInstanceEntry& entry, sensorInstanceMap_) {
+            if (entry.sensor_ && entry.sensor_->running()) {
+                armed = true;
+                break;
+            }
+        }
+        for (int i = 0; !armed && i < sampleQueues_->count(); ++i)
+            armed = sampleQueues_->queue(i)->front() != 0;
+        armed = armed || socketHandler_->hasGridWrites();
+    }
+
+    // An idle device is not woken up while the display is blanked
+    if (armed == wakeupGridArmed_)
+        return;
+    wakeupGridArmed_ = armed;
+    WakeupGrid::armTimer(wakeupGridFd_, armed ? wakeupGrid_ : 0);
+    wakeupGridNotifier_->setEnabled(armed);
+}
+
+void SensorManager::setWakeupGrid(unsigned int grid)
+{
+    if (grid == wakeupGrid_)
+        return;
+    sensordLogD() << "Wakeup grid changed to" << grid << "ms";
+    wakeupGrid_ = grid;
+
+    // Polled adaptors expire on the grid, samples wait in the queues and
+    // buffered writes are held until the next grid tick.
+    SysfsAdaptorReactor::setWakeupGrid(grid);
+    sampleQueues_->setDeferred(grid != 0);
+    socketHandler_->setGridDelivery(grid != 0);
+    if (wakeupGridArmed_) {
+        // Rearm with the new step
+        wakeupGridArmed_ = false;
+        WakeupGrid::armTimer(wakeupGridFd_, 0);
+        wakeupGridNotifier_->setEnabled(false);
+    }
+    updateWakeupGridTimer();
 
-    free(pipeData.buffer);
+    // Deliver samples held back in the queues
+    if (!grid)
+        sampleQueues_->notify();
+
+    emit wakeupGridChanged(grid);
 }
 
 void SensorManager::lostClient(int sessionId)
@@ -708,6 +917,8 @@ void SensorManager::displayStateChanged(bool displayState)
 
     }
 
+    setWakeupGrid(displayState ? 0 : blankedWakeupGrid_);
+
     foreach (const DeviceAdaptorInstanceEntry& adaptor, deviceAdaptorInstanceMap_) {
         if (adaptor.adaptor_) {
             if (displayState) {
@@ -734,12 +945,19 @@ void SensorManager::printStatus(QStringList& output) const
 {
     output.append("  Adaptors:");
     for (QMap<QString, DeviceAdaptorInstanceEntry>::const_iterator it = deviceAdaptorInstanceMap_.constBegin(); it != deviceAdaptorInstanceMap_.constEnd(); ++it) {
-        output.append(QString("    %1 [%2 listener(s)] %3").arg(it.value().type_).arg(it.value().cnt_).arg(it.value().adaptor_->deviceStandbyOverride() ? "Standby Overriden" : "No standby override"));
+        QString str = QString("    %1 [%2 listener(s)] %3").arg(it.value().type_).arg(it.value().cnt_).arg(it.value().adaptor_->deviceStandbyOverride() ? "Standby Overriden" : "No standby override");
+        const TimestampMapper& timestamps = it.value().adaptor_->timestampMapper();
+        if (timestamps.samples())
+            str.append(QString(". Timestamp jitter %1 us, period %2 us, offset %3 us, %4 resync(s)").arg(timestamps.jitter() / 1000).arg(timestamps.period() / 1000).arg(timestamps.offset() / 1000).arg(timestamps.resyncs()));
+        output.append(str);
     }
 
     output.append("  Chains:\n");
     for (QMap<QString, ChainInstanceEntry>::const_iterator it = chainInstanceMap_.constBegin(); it != chainInstanceMap_.constEnd(); ++it) {
-        output.append(QString("    %1 [%2 listener(s)]. %3").arg(it.value().type_).arg(it.value().cnt_).arg((it.value().chain_ && it.value().chain_->running()) ? "Running" : "Stopped"));
+        QString str = QString("    %1 [%2 listener(s)]. %3").arg(it.value().type_).arg(it.value().cnt_).arg((it.value().chain_ && it.value().chain_->running()) ? "Running" : "Stopped");
+        if (it.value().chain_ && !it.value().chain_->executorName().isEmpty())
+            str.append(QString(". Executor %1, %2 ms CPU").arg(it.value().chain_->executorName()).arg(it.value().chain_->cpuTime() / 1000000));
+        output.append(str);
     }
 
     output.append("  Logical sensors:");
@@ -754,6 +972,49 @@ void SensorManager::printStatus(QStringList& output) const
         str.append(QString(". %1").arg((it.value().sensor_ && it.value().sensor_->running()) ? "Running" : "Stopped"));
         output.append(str);
     }
+
+    if (!executorMap_.isEmpty()) {
+        output.append("  Executors:");
+        foreach (const Executor* executor, executorMap_) {
+            output.append(QString("    %1: %2 ms CPU, %3 overflow(s)").arg(executor->name()).arg(executor->cpuTime() / 1000000).arg(executor->overflows()));
+        }
+    }
+
+    socketHandler_->printStatus(output);
+
+    output.append(QString("  Latest sample cache: %1/%2 slot(s) in use, %3").arg(latestSamples_->usedSlots()).arg(latestSamples_->slotCount()).arg(latestSamples_->readOnlyFd() >= 0 ? "shared" : "not shared"));
+
+    if (wakeupGrid_)
+        output.append(QString("  Wakeup grid: %1 ms").arg(wakeupGrid_));
+
+    output.append("  Sample queues:");
+    for (int i = 0; i < sampleQueues_->count(); ++i) {
+        const SampleQueue* queue = sampleQueues_->queue(i);
+        output.append(QString("    #%1 depth %2/%3, high watermark %4, %5 dropped").arg(i).arg(queue->depth()).arg(queue->capacity()).arg(queue->highWatermark()).arg(queue->drops()));
+    }
+
+    if (LatencyStats::isEnabled()) {
+        output.append("  Latency:");
+        LatencyStats::report(output);
+    }
+}
+
+QStringList SensorManager::latencyStatistics() const
+{
+    QStringList output;
+    if (!LatencyStats::isAvailable())
+        output.append("Latency measurement not compiled in");
+    else if (!LatencyStats::isEnabled())
+        output.append("Latency measurement disabled");
+    else
+        LatencyStats::report(output);
+    return output;
+}
+
+bool SensorManager::setLatencyMeasurement(bool enabled)
+{
+    sensordLogD() << "Latency measurement" << (enabled ? "enabled" : "disabled");
+    return LatencyStats::setEnabled(enabled);
 }
 
 QString SensorManager::socketToPid(int id) const
@@ -785,6 +1046,30 @@ QString SensorManager::socketToPid(const QSet<int>& ids) const
     return str;
 }
 
+Executor* SensorManager::requestExecutor(const QString& name)
+{
+    QMutexLocker locker(&executorMutex_);
+    Executor* executor = executorMap_.value(name);
+    if (!executor) {
+        executor = new Executor(name);
+        executorMap_.insert(name, executor);
+    }
+    return executor;
+}
+
+void SensorManager::waitForExecutors()
+{
+    // Bins on one executor may feed bins on another, so repeat until a
+    // pass finds all of them idle
+    QMutexLocker locker(&executorMutex_);
+    bool waited = true;
+    while (waited) {
+        waited = false;
+        foreach (Executor* executor, executorMap_)
+            waited = executor->waitIdle() || waited;
+    }
+}
+
 int SensorManager::createNewSessionId()
 {
     return ++sessionIdCount_;
@@ -827,6 +1112,11 @@ SocketHandler& SensorManager::socketHandler() const
     return *socketHandler_;
 }
 
+LatestSampleCache& SensorManager::latestSamples() const
+{
+    return *latestSamples_;
+}
+
 QList<QString> SensorManager::getAdaptorTypes() const
 {
     return deviceAdaptorInstanceMap_.keys();
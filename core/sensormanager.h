@@ -34,6 +34,7 @@
 #include "abstractchain.h"
 #include "deviceadaptor.h"
 #include "filter.h"
+#include "executor.h"
 #include "sfwerror.h"
 #include "idutils.h"
 #include "parameterparser.h"
@@ -51,6 +52,8 @@ class MceWatcher;
 
 class QSocketNotifier;
 class SocketHandler;
+class SampleQueueSet;
+class LatestSampleCache;
 
 /**
  * Sensor instance entry. Contains list of connected sessions.
@@ -119,6 +122,7 @@ public:
 
     QMap<QString, QString>  propertyMap_; /**< Property map */
     DeviceAdaptor*          adaptor_;     /**< Adaptor pointer */
+    RingBufferReaderBase*   recorder_;    /**< Trace recorder of adaptor output */
     int                     cnt_;         /**< Reference count */
     QString                 type_;        /**< Type */
 };
@@ -143,6 +147,22 @@ public:
      */
     void printStatus(QStringList& output) const;
 
+    /**
+     * Get per node call counts, processing times and sample latencies.
+     *
+     * @return one line per instrumented node.
+     */
+    QStringList latencyStatistics() const;
+
+    /**
+     * Turn latency measurement on or off. Counters are cleared when
+     * turned on.
+     *
+     * @param enabled measure or not.
+     * @return false if measurement is not compiled in.
+     */
+    bool setLatencyMeasurement(bool enabled);
+
     /**
      * Get last occured error code.
      *
@@ -210,6 +230,35 @@ public:
      */
     void releaseChain(const QString& id);
 
+    /**
+     * Get executor with given name. Executor is created on first request
+     * and lives until sensord exits.
+     *
+     * @param name executor name.
+     * @return executor.
+     */
+    Executor* requestExecutor(const QString& name);
+
+    /**
+     * Wait until all executors have run out of work. Can be called from
+     * any thread.
+     */
+    void waitForExecutors();
+
+    /**
+     * Current wakeup grid, see setWakeupGrid().
+     *
+     * @return grid step in milliseconds, 0 when there is no grid.
+     */
+    unsigned int wakeupGrid() const { return wakeupGrid_; }
+
+    /**
+     * Arm the wakeup grid timer while there is a grid and sessions are
+     * running or samples and writes wait for a tick, disarm it otherwise.
+     * Called when sessions start and stop.
+     */
+    void updateWakeupGridTimer();
+
     /**
      * Register given adaptor type.
      *
@@ -260,7 +309,8 @@ public:
 #endif
 
     /**
-     * Write sensor data for given session.
+     * Write sensor data for given session. Data is queued and written
+     * to the socket from the main thread.
      *
      * @param id Session ID.
      * @param source Source from where to write.
@@ -268,6 +318,17 @@ public:
      */
     bool write(int id, const void* source, int size);
 
+    /**
+     * Write sensor data once for all sessions of a fan-out. The sample
+     * is queued once and the main thread hands the encoded frame to
+     * every session, see SocketHandler::setFanout().
+     *
+     * @param fanoutId Fan-out ID, greater than zero.
+     * @param source Source from where to write.
+     * @param size How many bytes to write.
+     */
+    bool writeFanout(int fanoutId, const void* source, int size);
+
     /**
      * Load plugin.
      *
@@ -328,6 +389,13 @@ public:
      */
     SocketHandler& socketHandler() const;
 
+    /**
+     * Get latest sample cache shared by all sensor channels.
+     *
+     * @return latest sample cache.
+     */
+    LatestSampleCache& latestSamples() const;
+
     /**
      * Get list configured of adaptor types.
      */
@@ -382,11 +450,26 @@ private Q_SLOTS:
     void devicePSMStateChanged(bool deviceMode);
 
     /**
-     * Callback for arrived sensor data in internal pipe which SensorManager
-     * needs to propagate to the SocketHandler.
+     * Callback for arrived sensor data in internal sample queues which
+     * SensorManager needs to propagate to the SocketHandler.
      */
     void sensorDataHandler(int);
 
+    /**
+     * Write a sample handed over from another thread without the sample
+     * queues, see deliver().
+     *
+     * @param id Session ID, or negated fan-out ID.
+     * @param sample Sample data.
+     */
+    void deliverSample(int id, const QByteArray& sample);
+
+    /**
+     * Callback for wakeup grid timer. Delivers queued samples and due
+     * buffered writes while the display is blanked.
+     */
+    void wakeupGridTick(int);
+
 Q_SIGNALS:
     /**
      * Signal for occured errors.
@@ -410,6 +493,14 @@ Q_SIGNALS:
      */
     void displayOn();
 
+    /**
+     * Signal that the wakeup grid has changed. Adaptors programming
+     * periods into hardware snap them to the grid.
+     *
+     * @param grid Grid step in milliseconds, 0 when there is no grid.
+     */
+    void wakeupGridChanged(unsigned int grid);
+
 private:
     /**
      * Constructor.
@@ -421,6 +512,36 @@ private:
      */
     virtual ~SensorManager();
 
+    /**
+     * Snap sensor polling and sample delivery to a common timer grid.
+     * Used while the display is blanked; see WakeupGrid.
+     *
+     * @param grid Grid step in milliseconds, 0 to deliver immediately.
+     */
+    void setWakeupGrid(unsigned int grid);
+
+    /**
+     * Write a sample to the socket without the sample queues, used when
+     * their wakeup descriptor could not be created. Samples from other
+     * threads are passed to the main thread through the event loop.
+     *
+     * @param id Session ID, or negated fan-out ID.
+     * @param source Sample data.
+     * @param size Sample size in bytes.
+     * @return was the sample written or passed on.
+     */
+    bool deliver(int id, const void* source, int size);
+
+    /**
+     * Start recording the output of a new adaptor if "trace/record"
+     * names a directory and "trace/record_adaptors" is empty or lists
+     * the adaptor.
+     *
+     * @param entry Adaptor instance.
+     * @param id Adaptor ID.
+     */
+    void startTraceRecording(DeviceAdaptorInstanceEntry& entry, const QString& id);
+
     /**
      * Set error state.
      *
@@ -482,6 +603,9 @@ private:
 
     QMap<QString, FilterFactoryMethod>             filterFactoryMap_; /**< factories for filter types */
 
+    QMap<QString, Executor*>                       executorMap_; /**< executors by name */
+    QMutex                                         executorMutex_; /**< guards executorMap_ against other threads */
+
     SocketHandler*                                 socketHandler_; /**< socket handler */
     MceWatcher*                                    mceWatcher_; /**< MCE watcher */
 #ifdef SENSORFW_LUNA_SERVICE_CLIENT
@@ -489,8 +613,14 @@ private:
 #endif
     SensorManagerError                             errorCode_; /** global error code */
     QString                                        errorString_; /** global error description */
-    int                                            pipefds_[2]; /** pipe for sensor samples */
-    QSocketNotifier*                               pipeNotifier_; /** notifier for pipe stream */
+    SampleQueueSet*                                sampleQueues_; /** queues for sensor samples */
+    QSocketNotifier*                               sampleNotifier_; /** notifier for sample queues */
+    LatestSampleCache*                             latestSamples_; /** latest sample of each channel */
+    unsigned int                                   blankedWakeupGrid_; /** grid step while display is blanked, 0 to disable */
+    unsigned int                                   wakeupGrid_; /** current grid step */
+    int                                            wakeupGridFd_; /** timerfd of the grid */
+    QSocketNotifier*                               wakeupGridNotifier_; /** notifier for grid timer */
+    bool                                           wakeupGridArmed_; /** is the grid timer running */
 
     static SensorManager*                          instance_; /** singleton */
     static int                                     sessionIdCount_; /** session ID counter */
@@ -525,7 +655,10 @@ template<class CHAIN_TYPE>
 void SensorManager::registerChain(const QString& chainName)
 {
     if (chainInstanceMap_.contains(chainName)) {
-        sensordLogW() << QString("<%1> Chain is already present!").arg(chainName);
+        if (chainInstanceMap_.constFind(chainName).value().type_ == "PipelineChain")
+            sensordLogD() << QString("<%1> Chain is replaced by configured pipeline").arg(chainName);
+        else
+            sensordLogW() << QString("<%1> Chain is already present!").arg(chainName);
         return;
     }
 
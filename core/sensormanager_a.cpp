@@ -28,6 +28,7 @@
  */
 
 #include "sensormanager_a.h"
+#include "latestsamplecache.h"
 #include "logging.h"
 
 /*
@@ -92,6 +93,21 @@ double SensorManagerAdaptor::magneticDeviation()
     return sensorManager()->magneticDeviation();
 }
 
+QStringList SensorManagerAdaptor::latencyStatistics() const
+{
+    return sensorManager()->latencyStatistics();
+}
+
+bool SensorManagerAdaptor::setLatencyMeasurement(bool enabled)
+{
+    return sensorManager()->setLatencyMeasurement(enabled);
+}
+
+QDBusUnixFileDescriptor SensorManagerAdaptor::latestSampleMemory() const
+{
+    return QDBusUnixFileDescriptor(sensorManager()->latestSamples().readOnlyFd());
+}
+
 SensorManager* SensorManagerAdaptor::sensorManager() const
 {
     return dynamic_cast<SensorManager*>(parent());
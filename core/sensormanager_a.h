@@ -130,6 +130,30 @@ public Q_SLOTS:
     double magneticDeviation();
     void setMagneticDeviation(double level);
 
+    /**
+     * Get per node call counts, processing times and sample latencies.
+     *
+     * @return one line per instrumented node.
+     */
+    QStringList latencyStatistics() const;
+
+    /**
+     * Turn latency measurement on or off.
+     *
+     * @param enabled measure or not.
+     * @return false if sensord was built without latency measurement.
+     */
+    bool setLatencyMeasurement(bool enabled);
+
+    /**
+     * Get read-only descriptor of the latest sample table, see
+     * LatestSampleTable.
+     *
+     * @return descriptor. Invalid descriptor can not be sent, so the
+     *         call fails if the table is not shared.
+     */
+    QDBusUnixFileDescriptor latestSampleMemory() const;
+
 Q_SIGNALS:
     /**
      * Signal which is emitted for occured errors.
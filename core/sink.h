@@ -28,16 +28,30 @@
 #ifndef SINK_H
 #define SINK_H
 
+#include "latencystats.h"
+
 /**
  * Data sink base class.
  */
 class SinkBase
 {
+#ifdef SENSORFW_LATENCY_STATS
+public:
+    /**
+     * Probe timing collect() calls.
+     */
+    LatencyProbe& latencyProbe() { return latencyProbe_; }
+#endif
+
 protected:
     /**
      * Destructor.
      */
     virtual ~SinkBase() {}
+
+#ifdef SENSORFW_LATENCY_STATS
+    LatencyProbe latencyProbe_; /**< collect() timing */
+#endif
 };
 
 /**
@@ -87,6 +101,7 @@ public:
 private:
     void collect(int n, const TYPE* values)
     {
+        SENSORFW_LATENCY_SCOPE(this->latencyProbe_, n);
         (instance_->*member_)(n, values);
     }
 
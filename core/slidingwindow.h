@@ -0,0 +1,301 @@
+/**
+   @file slidingwindow.h
+   @brief Running statistics over a window of recent samples
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SLIDINGWINDOW_H
+#define SLIDINGWINDOW_H
+
+#include <QtGlobal>
+#include <QVector>
+
+/**
+ * Window over the most recent samples of a stream with one or more
+ * axes. The window is limited by sample count and optionally by age in
+ * microseconds. Sum, mean, variance, minimum and maximum of every axis
+ * are kept up to date as samples enter and leave, so pushing a sample
+ * and reading any statistic costs the same regardless of window size.
+ * Minimum and maximum use monotonic deques.
+ *
+ * Storage is allocated only when the capacity changes.
+ *
+ * @tparam T Sample value type.
+ * @tparam AXES Number of values in a sample.
+ * @tparam SUM Type for sums of values.
+ */
+template <class T, int AXES = 1, class SUM = qint64>
+class SlidingWindow
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param capacity Maximum number of samples in the window.
+     * @param maxAge Maximum age of samples relative to the newest one in
+     *               microseconds, 0 for no limit.
+     */
+    explicit SlidingWindow(unsigned capacity = 1, quint64 maxAge = 0) :
+        capacity_(0),
+        mask_(0),
+        maxAge_(maxAge),
+        first_(0),
+        next_(0)
+    {
+        setCapacity(capacity);
+    }
+
+    /**
+     * Change capacity. The newest samples which fit are kept.
+     *
+     * @param capacity Maximum number of samples, at least 1.
+     */
+    void setCapacity(unsigned capacity)
+    {
+        if (capacity < 1)
+            capacity = 1;
+        if (capacity == capacity_)
+            return;
+
+        unsigned keep = qMin(count(), capacity);
+        QVector<quint64> timestamps(keep);
+        QVector<T> values(keep * AXES);
+        for (unsigned i = 0; i < keep; ++i) {
+            quint32 seq = next_ - keep + i;
+            timestamps[i] = timestamps_[seq & mask_];
+            for (int axis = 0; axis < AXES; ++axis)
+                values[i * AXES + axis] = values_[(seq & mask_) * AXES + axis];
+        }
+
+        unsigned size = 1;
+        while (size < capacity)
+            size <<= 1;
+        capacity_ = capacity;
+        mask_ = size - 1;
+        timestamps_.resize(size);
+        values_.resize(size * AXES);
+        minQueue_.resize(size * AXES);
+        maxQueue_.resize(size * AXES);
+
+        clear();
+        for (unsigned i = 0; i < keep; ++i)
+            push(timestamps[i], values.constData() + i * AXES);
+    }
+
+    /**
+     * Maximum number of samples in the window.
+     */
+    unsigned capacity() const { return capacity_; }
+
+    /**
+     * Set maximum age of samples. Takes effect on the next push().
+     *
+     * @param maxAge Age in microseconds relative to the newest sample,
+     *               0 for no limit.
+     */
+    void setMaxAge(quint64 maxAge) { maxAge_ = maxAge; }
+
+    /**
+     * Maximum age of samples in microseconds, 0 if unlimited.
+     */
+    quint64 maxAge() const { return maxAge_; }
+
+    /**
+     * Add sample. The oldest sample leaves if the window is full, and
+     * samples older than the maximum age leave. The new sample always
+     * stays.
+     *
+     * @param timestamp Sample time in microseconds.
+     * @param values AXES values.
+     */
+    void push(quint64 timestamp, const T* values)
+    {
+        if (count() == capacity_)
+            popOldest();
+
+        quint32 seq = next_++;
+        unsigned slot = seq & mask_;
+        timestamps_[slot] = timestamp;
+        for (int axis = 0; axis < AXES; ++axis) {
+            const T value = values[axis];
+            values_[slot * AXES + axis] = value;
+            sum_[axis] += value;
+            squares_[axis] += (double)value * value;
+
+            // Drop candidates which can no longer be the extreme
+            quint32* minQueue = minQueue_.data() + axis * (mask_ + 1);
+            while (minTail_[axis] != minHead_[axis] && value <= valueAt(minQueue[(minTail_[axis] - 1) & mask_], axis))
+                --minTail_[axis];
+            minQueue[minTail_[axis]++ & mask_] = seq;
+
+            quint32* maxQueue = maxQueue_.data() + axis * (mask_ + 1);
+            while (maxTail_[axis] != maxHead_[axis] && value >= valueAt(maxQueue[(maxTail_[axis] - 1) & mask_], axis))
+                --maxTail_[axis];
+            maxQueue[maxTail_[axis]++ & mask_] = seq;
+        }
+
+        if (maxAge_) {
+            while (count() > 1 && timestamp - timestamps_[first_ & mask_] > maxAge_)
+                popOldest();
+        }
+    }
+
+    /**
+     * Add single axis sample.
+     *
+     * @param timestamp Sample time in microseconds.
+     * @param value Sample value.
+     */
+    void push(quint64 timestamp, T value)
+    {
+        Q_STATIC_ASSERT(AXES == 1);
+        push(timestamp, &value);
+    }
+
+    /**
+     * Remove all samples.
+     */
+    void clear()
+    {
+        first_ = next_;
+        for (int axis = 0; axis < AXES; ++axis) {
+            sum_[axis] = 0;
+            squares_[axis] = 0;
+            minHead_[axis] = minTail_[axis] = 0;
+            maxHead_[axis] = maxTail_[axis] = 0;
+        }
+    }
+
+    /**
+     * Number of samples in the window.
+     */
+    unsigned count() const { return next_ - first_; }
+
+    /**
+     * Is the window empty.
+     */
+    bool isEmpty() const { return next_ == first_; }
+
+    /**
+     * Does the window hold capacity() samples.
+     */
+    bool isFull() const { return count() == capacity_; }
+
+    /**
+     * Timestamp of the oldest sample. Window must not be empty.
+     */
+    quint64 oldestTimestamp() const { return timestamps_[first_ & mask_]; }
+
+    /**
+     * Timestamp of the newest sample. Window must not be empty.
+     */
+    quint64 newestTimestamp() const { return timestamps_[(next_ - 1) & mask_]; }
+
+    /**
+     * Sum of values.
+     *
+     * @param axis Axis index.
+     */
+    SUM sum(int axis = 0) const { return sum_[axis]; }
+
+    /**
+     * Mean of values. Window must not be empty.
+     *
+     * @param axis Axis index.
+     */
+    double mean(int axis = 0) const { return (double)sum_[axis] / count(); }
+
+    /**
+     * Sample variance of values, 0 for less than two samples.
+     *
+     * @param axis Axis index.
+     */
+    double variance(int axis = 0) const
+    {
+        double n = count();
+        if (n < 2)
+            return 0;
+        double sum = sum_[axis];
+        return (n * squares_[axis] - sum * sum) / (n * (n - 1));
+    }
+
+    /**
+     * Smallest value. Window must not be empty.
+     *
+     * @param axis Axis index.
+     */
+    T min(int axis = 0) const
+    {
+        return valueAt(minQueue_[axis * (mask_ + 1) + (minHead_[axis] & mask_)], axis);
+    }
+
+    /**
+     * Largest value. Window must not be empty.
+     *
+     * @param axis Axis index.
+     */
+    T max(int axis = 0) const
+    {
+        return valueAt(maxQueue_[axis * (mask_ + 1) + (maxHead_[axis] & mask_)], axis);
+    }
+
+private:
+    /**
+     * Value of a sample in the window.
+     */
+    T valueAt(quint32 seq, int axis) const
+    {
+        return values_[(seq & mask_) * AXES + axis];
+    }
+
+    /**
+     * Remove the oldest sample.
+     */
+    void popOldest()
+    {
+        quint32 seq = first_++;
+        unsigned slot = seq & mask_;
+        for (int axis = 0; axis < AXES; ++axis) {
+            const T value = values_[slot * AXES + axis];
+            sum_[axis] -= value;
+            squares_[axis] -= (double)value * value;
+            if (minHead_[axis] != minTail_[axis] && minQueue_[axis * (mask_ + 1) + (minHead_[axis] & mask_)] == seq)
+                ++minHead_[axis];
+            if (maxHead_[axis] != maxTail_[axis] && maxQueue_[axis * (mask_ + 1) + (maxHead_[axis] & mask_)] == seq)
+                ++maxHead_[axis];
+        }
+    }
+
+    unsigned          capacity_;         /**< maximum sample count */
+    unsigned          mask_;             /**< storage size - 1 */
+    quint64           maxAge_;           /**< maximum age, 0 if unlimited */
+    quint32           first_;            /**< sequence number of oldest sample */
+    quint32           next_;             /**< sequence number of next sample */
+    QVector<quint64>  timestamps_;       /**< sample timestamps */
+    QVector<T>        values_;           /**< sample values, AXES per sample */
+    QVector<quint32>  minQueue_;         /**< candidates for minimum per axis */
+    QVector<quint32>  maxQueue_;         /**< candidates for maximum per axis */
+    unsigned          minHead_[AXES];    /**< front of minimum queue */
+    unsigned          minTail_[AXES];    /**< back of minimum queue */
+    unsigned          maxHead_[AXES];    /**< front of maximum queue */
+    unsigned          maxTail_[AXES];    /**< back of maximum queue */
+    SUM               sum_[AXES];        /**< sums of values */
+    double            squares_[AXES];    /**< sums of squared values */
+};
+
+#endif // SLIDINGWINDOW_H
@@ -28,38 +28,311 @@
 
 #include <QLocalSocket>
 #include <QLocalServer>
+#include <QSocketNotifier>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
 #include "logging.h"
+#include "config.h"
 #include "sockethandler.h"
+#include "sharedsamplering.h"
+#include "wireprotocol.h"
+#include "datatypes/utils.h"
 #include <unistd.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <errno.h>
+#include <string.h>
 
-SessionData::SessionData(QLocalSocket* socket, QObject* parent) : QObject(parent),
-                                                                  socket(socket),
-                                                                  interval(-1),
-                                                                  buffer(0),
-                                                                  size(0),
-                                                                  count(0),
-                                                                  bufferSize(1),
-                                                                  bufferInterval(0),
-                                                                  downsampling(false)
+/**
+ * Most frames written with a single sendmsg().
+ */
+static const int MAX_FLUSH_FRAMES = 64;
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC       0x0001U
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+
+int SocketHandler::createSharedMemory(const char* name, size_t size)
+{
+#ifdef SYS_memfd_create
+    int fd = syscall(SYS_memfd_create, name, MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (fd < 0) {
+        sensordLogW() << "[SocketHandler]: memfd_create failed: " << strerror(errno);
+        return -1;
+    }
+    if (ftruncate(fd, size) < 0) {
+        sensordLogW() << "[SocketHandler]: failed to size shared memory: " << strerror(errno);
+        close(fd);
+        return -1;
+    }
+#ifdef F_ADD_SEALS
+    // Client must not be able to truncate the file under our mapping.
+    fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL);
+#endif
+    return fd;
+#else
+    Q_UNUSED(name);
+    Q_UNUSED(size);
+    sensordLogW() << "[SocketHandler]: memfd_create not supported";
+    return -1;
+#endif
+}
+
+/**
+ * Reply to shared memory request of the client. Single status byte is
+ * sent, accompanied with the memory file descriptor if there is one.
+ *
+ * @param socketFd Client socket.
+ * @param fd Memory file descriptor or -1 if request was refused.
+ * @return was reply sent.
+ */
+static bool sendSharedMemory(int socketFd, int fd)
+{
+    char status = (fd >= 0);
+    struct iovec iov;
+    iov.iov_base = &status;
+    iov.iov_len = 1;
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    if (fd >= 0) {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    return sendmsg(socketFd, &msg, MSG_NOSIGNAL) == 1;
+}
+
+ClientConnection::ClientConnection(QLocalSocket* socket, int version, QObject* parent) : QObject(parent),
+                                                                                          socket(socket),
+                                                                                          protocol(version),
+                                                                                          outboxOffset(0),
+                                                                                          outboxBytes(0),
+                                                                                          outboxLimit(65536),
+                                                                                          writeNotifier(0),
+                                                                                          blockedWrites(0)
+{
+    if (SensorFrameworkConfig::configuration())
+        outboxLimit = SensorFrameworkConfig::configuration()->value<int>("global/socket_backlog_size", outboxLimit);
+}
+
+ClientConnection::~ClientConnection()
+{
+    foreach(SessionData* session, attached)
+        session->clearConnection();
+    delete writeNotifier;
+    delete socket;
+}
+
+int ClientConnection::version() const
+{
+    return protocol;
+}
+
+int ClientConnection::sampleVersion() const
+{
+    return protocol >= 3 ? SENSORFW_WIRE_SAMPLE_NS : SENSORFW_WIRE_SAMPLE_US;
+}
+
+void ClientConnection::socketWritable()
+{
+    writeNotifier->setEnabled(false);
+    flush();
+}
+
+bool ClientConnection::queue(const QByteArray& data)
+{
+    if(outboxBytes + data.size() > outboxLimit)
+        return false;
+    outbox.append(data);
+    outboxBytes += data.size();
+    return true;
+}
+
+bool ClientConnection::queue(const QByteArray& header, const QByteArray& payload)
+{
+    if(outboxBytes + header.size() + payload.size() > outboxLimit)
+        return false;
+    outbox.append(header);
+    if(!payload.isEmpty())
+        outbox.append(payload);
+    outboxBytes += header.size() + payload.size();
+    return true;
+}
+
+bool ClientConnection::flush()
+{
+    if(!socket || !hasPendingData() || (writeNotifier && writeNotifier->isEnabled()))
+        return true;
+
+    while(hasPendingData())
+    {
+        struct iovec iov[MAX_FLUSH_FRAMES];
+        int frames = qMin(outbox.size(), MAX_FLUSH_FRAMES);
+        size_t requested = 0;
+        for(int i = 0; i < frames; ++i)
+        {
+            int offset = i ? 0 : outboxOffset;
+            iov[i].iov_base = (void*)(outbox.at(i).constData() + offset);
+            iov[i].iov_len = outbox.at(i).size() - offset;
+            requested += iov[i].iov_len;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = frames;
+
+        ssize_t written = sendmsg(socket->socketDescriptor(), &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(written < 0)
+        {
+            if(errno == EAGAIN || errno == EWOULDBLOCK)
+                written = 0;
+            else
+            {
+                sensordLogW() << "[SocketHandler]: failed to write payload to the socket: " << strerror(errno);
+                outbox.clear();
+                outboxOffset = 0;
+                outboxBytes = 0;
+                return false;
+            }
+        }
+
+        // Release written frames so that their writers can reuse them.
+        outboxBytes -= written;
+        int consumed = outboxOffset + written;
+        while(!outbox.isEmpty() && consumed >= outbox.first().size())
+        {
+            consumed -= outbox.first().size();
+            outbox.removeFirst();
+        }
+        outboxOffset = consumed;
+
+        if((size_t)written < requested)
+            break;
+    }
+
+    if(!hasPendingData())
+        return true;
+
+    // Socket is full. Keep the rest and continue once client has read.
+    ++blockedWrites;
+    if(!writeNotifier)
+    {
+        writeNotifier = new QSocketNotifier(socket->socketDescriptor(), QSocketNotifier::Write, this);
+        connect(writeNotifier, SIGNAL(activated(int)), this, SLOT(socketWritable()));
+    }
+    writeNotifier->setEnabled(true);
+    return true;
+}
+
+bool ClientConnection::hasPendingData() const
+{
+    return outboxBytes > 0;
+}
+
+int ClientConnection::getBacklog() const
+{
+    return outboxBytes;
+}
+
+unsigned long ClientConnection::getBlockedWrites() const
+{
+    return blockedWrites;
+}
+
+QLocalSocket* ClientConnection::getSocket() const
+{
+    return socket;
+}
+
+QLocalSocket* ClientConnection::stealSocket()
+{
+    QLocalSocket* tmpsocket = socket;
+    socket = 0;
+    return tmpsocket;
+}
+
+void ClientConnection::attach(SessionData* session)
+{
+    if(!attached.contains(session))
+        attached.append(session);
+}
+
+void ClientConnection::detach(SessionData* session)
+{
+    attached.removeAll(session);
+    session->clearConnection();
+}
+
+const QList<SessionData*>& ClientConnection::sessions() const
+{
+    return attached;
+}
+
+SessionData::SessionData(ClientConnection* connection, int id, QObject* parent) : QObject(parent),
+                                                                                  connection(connection),
+                                                                                  id(id),
+                                                                                  interval(-1),
+                                                                                  buffer(0),
+                                                                                  size(0),
+                                                                                  count(0),
+                                                                                  bufferSize(1),
+                                                                                  bufferInterval(0),
+                                                                                  gridDelivery(false),
+                                                                                  dueAt(0),
+                                                                                  downsampling(false),
+                                                                                  headerIndex(0),
+                                                                                  sequence(0),
+                                                                                  sampleType(SENSORFW_WIRE_SAMPLE_UNKNOWN),
+                                                                                  droppedSamples(0),
+                                                                                  ring(0),
+                                                                                  ringMapping(0),
+                                                                                  ringMappingSize(0)
 {
     lastWrite.tv_sec = 0;
     lastWrite.tv_usec = 0;
     timer.setSingleShot(true);
     connect(&timer, SIGNAL(timeout()), this, SLOT(timerTimeout()));
+
+    if(connection)
+        connection->attach(this);
 }
 
 SessionData::~SessionData()
 {
     timer.stop();
-    delete socket;
+    if(connection)
+        connection->detach(this);
     delete[] buffer;
+    delete ring;
+    if (ringMapping)
+        munmap(ringMapping, ringMappingSize);
 }
 
 void SessionData::timerTimeout()
 {
     delayedWrite();
+    flush();
+    foreach(SessionData* follower, followers)
+        follower->flush();
 }
 
 long SessionData::sinceLastWrite() const
@@ -71,62 +344,250 @@ long SessionData::sinceLastWrite() const
     return (now.tv_sec - lastWrite.tv_sec) * 1000 + ((now.tv_usec - lastWrite.tv_usec) / 1000);
 }
 
-bool SessionData::write(void* source, int size, unsigned int count)
+bool SessionData::write(const void* source, int size, unsigned int count)
 {
-    if(socket && count)
+    if(!count)
+        return false;
+
+    // Sample storage is reused once every session has written it out, so
+    // steady streams do not allocate.
+    int frameSize = size * count;
+    if(!frame.isDetached())
     {
-        memcpy(source, &count, sizeof(unsigned int));
-        int written = socket->write((const char*)source, size * count + sizeof(unsigned int));
-        if(written < 0)
+        frame = QByteArray();
+        frame.reserve(qMax(frameSize, 256));
+    }
+    frame.resize(frameSize);
+    memcpy(frame.data(), source, frameSize);
+
+    foreach(SessionData* follower, followers)
+        follower->queueFrame(frame, size, count);
+    return queueFrame(frame, size, count);
+}
+
+QByteArray& SessionData::nextHeader(int size)
+{
+    // Connection writes headers out in the order they were queued, so
+    // the next one in turn is the oldest. If even that is still queued,
+    // a new one is added in its place.
+    if(headers.isEmpty() || !headers.at(headerIndex).isDetached())
+        headers.insert(headerIndex, QByteArray());
+    QByteArray& header = headers[headerIndex];
+    headerIndex = (headerIndex + 1) % headers.size();
+    header.resize(size);
+    return header;
+}
+
+const QByteArray& SessionData::nanosecondFrame(const QByteArray& payload, int size, unsigned int count)
+{
+    if(!nsFrame.isDetached())
+        nsFrame = QByteArray();
+    nsFrame.resize(payload.size());
+    memcpy(nsFrame.data(), payload.constData(), payload.size());
+    char* sample = nsFrame.data();
+    for(unsigned int i = 0; i < count; ++i, sample += size)
+    {
+        // Every sample type starts with TimedData::timestamp_
+        quint64 timestamp;
+        memcpy(&timestamp, sample, sizeof(timestamp));
+        timestamp *= 1000;
+        memcpy(sample, &timestamp, sizeof(timestamp));
+    }
+    return nsFrame;
+}
+
+bool SessionData::queueFrame(const QByteArray& payload, int size, unsigned int count)
+{
+    if(!connection)
+        return false;
+    if(ring)
+    {
+        const char* samples = payload.constData();
+        bool wakeup = false;
+        for(unsigned int i = 0; i < count; ++i)
         {
-            sensordLogW() << "[SocketHandler]: failed to write payload to the socket: " << socket->errorString();
-            return false;
+            if(size > SharedSampleRing::SLOT_DATA_SIZE)
+            {
+                ++droppedSamples;
+                continue;
+            }
+            if(ring->write(samples + i * size, size))
+                wakeup = true;
+        }
+        // Any byte will do, client only waits for the socket to become readable.
+        if(wakeup && !connection->hasPendingData())
+        {
+            static const QByteArray wakeupByte(1, '\0');
+            connection->queue(wakeupByte);
         }
         return true;
     }
-    return false;
+
+    bool queued;
+    if(connection->version() >= 2)
+    {
+        int sampleVersion = connection->sampleVersion();
+        const QByteArray* samples = &payload;
+        if(sampleVersion == SENSORFW_WIRE_SAMPLE_NS && count)
+        {
+            if(sampleType == SENSORFW_WIRE_SAMPLE_UNKNOWN || size < (int)sizeof(quint64))
+                sampleVersion = SENSORFW_WIRE_SAMPLE_US;
+            else
+                samples = &nanosecondFrame(payload, size, count);
+        }
+
+        sensorfw_wire_frame_t header;
+        memset(&header, 0, sizeof(header));
+        header.size = sizeof(header) + payload.size();
+        header.headerSize = sizeof(header);
+        header.sampleType = sampleType;
+        header.channel = id;
+        header.sequence = sequence;
+        header.count = count;
+        header.dropped = droppedSamples;
+        header.sampleSize = size;
+        header.sampleVersion = sampleVersion;
+        QByteArray& encoded = nextHeader(sizeof(header));
+        memcpy(encoded.data(), &header, sizeof(header));
+        queued = connection->queue(encoded, *samples);
+    }
+    else
+    {
+        QByteArray& encoded = nextHeader(sizeof(unsigned int));
+        memcpy(encoded.data(), &count, sizeof(unsigned int));
+        queued = connection->queue(encoded, payload);
+    }
+
+    if(!queued)
+    {
+        droppedSamples += count;
+        return false;
+    }
+    ++sequence;
+    return true;
+}
+
+void SessionData::acknowledge()
+{
+    if(connection && connection->version() >= 2)
+        queueFrame(QByteArray(), size, 0);
+}
+
+bool SessionData::flush()
+{
+    return connection ? connection->flush() : true;
+}
+
+bool SessionData::hasPendingData() const
+{
+    return connection && connection->hasPendingData();
+}
+
+int SessionData::getBacklog() const
+{
+    return connection ? connection->getBacklog() : 0;
+}
+
+unsigned long SessionData::getDroppedSamples() const
+{
+    return droppedSamples;
+}
+
+unsigned long SessionData::getBlockedWrites() const
+{
+    return connection ? connection->getBlockedWrites() : 0;
+}
+
+ClientConnection* SessionData::getConnection() const
+{
+    return connection;
+}
+
+void SessionData::clearConnection()
+{
+    connection = 0;
+}
+
+void SessionData::setSampleType(int type)
+{
+    sampleType = type;
+}
+
+int SessionData::enableSharedMemory(unsigned int slotCount)
+{
+    if(ring || !connection || connection->version() >= 2)
+        return -1;
+
+    unsigned int slots = 2;
+    while(slots < slotCount)
+        slots <<= 1;
+    size_t mappingSize = SharedSampleRing::mappingSize(slots);
+
+    int fd = SocketHandler::createSharedMemory("sensorfw-session", mappingSize);
+    if(fd < 0)
+        return -1;
+
+    void* mapping = mmap(0, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mapping == MAP_FAILED)
+    {
+        sensordLogW() << "[SocketHandler]: failed to map shared memory: " << strerror(errno);
+        close(fd);
+        return -1;
+    }
+
+    ringMapping = mapping;
+    ringMappingSize = mappingSize;
+    ring = new SharedSampleRing(mapping);
+    ring->initialize(slots);
+    sensordLogD() << "[SocketHandler]: using shared memory ring with" << slots << "slots";
+    return fd;
+}
+
+const SharedSampleRing* SessionData::getSharedMemory() const
+{
+    return ring;
 }
 
 bool SessionData::write(const void* source, int size)
 {
     long since = sinceLastWrite();
-    int allocSize = bufferSize * size + sizeof(unsigned int);
-    if(!buffer)
-        buffer = new char[allocSize];
-    else if(size != this->size)
+    if(size != this->size)
     {
-        socket->waitForBytesWritten();
+        if(count)
+            delayedWrite();
         delete[] buffer;
-        buffer = new char[allocSize];
+        buffer = 0;
     }
+    if(!buffer)
+        buffer = new char[bufferSize * size];
     this->size = size;
     if(bufferSize <= 1)
     {
-        memcpy(buffer + sizeof(unsigned int), source, size);
         if(!downsampling || (downsampling && since >= interval))
         {
             gettimeofday(&lastWrite, 0);
-            return write(buffer, size, 1);
+            return write(source, size, 1);
         }
+        memcpy(buffer, source, size);
     }
     else
     {
-        memcpy(buffer + sizeof(unsigned int) + size * count, source, size);
+        memcpy(buffer + size * count, source, size);
         ++count;
         if(bufferSize == count)
         {
             return delayedWrite();
         }
     }
-    if(!timer.isActive())
+    if(!timeoutScheduled())
     {
         if(bufferSize > 1 && bufferInterval)
         {
-            timer.start(bufferInterval);
+            scheduleTimeout(bufferInterval);
         }
         else if(!bufferSize && (interval - since) > 0)
         {
-            timer.start(interval - since);
+            scheduleTimeout(interval - since);
         }
     }
     return true;
@@ -134,26 +595,13 @@ bool SessionData::write(const void* source, int size)
 
 bool SessionData::delayedWrite()
 {
-    if(timer.isActive())
-        timer.stop();
+    cancelTimeout();
     gettimeofday(&lastWrite, 0);
     bool ret = write(buffer, size, count);
     count = 0;
     return ret;
 }
 
-QLocalSocket* SessionData::stealSocket()
-{
-    QLocalSocket* tmpsocket = socket;
-    socket = 0;
-    return tmpsocket;
-}
-
-QLocalSocket* SessionData::getSocket() const
-{
-    return socket;
-}
-
 void SessionData::setInterval(int interval)
 {
     this->interval = interval;
@@ -178,9 +626,9 @@ void SessionData::setBufferSize(unsigned int size)
 {
     if(size != bufferSize)
     {
-        if(timer.isActive())
-            timer.stop();
-        socket->waitForBytesWritten();
+        if(count)
+            delayedWrite();
+        cancelTimeout();
         delete[] buffer;
         buffer = 0;
         count = 0;
@@ -201,8 +649,7 @@ void SessionData::setDownsampling(bool value)
     if(value != downsampling)
     {
         downsampling = value;
-        if(timer.isActive())
-            timer.stop();
+        cancelTimeout();
     }
 }
 
@@ -211,8 +658,70 @@ bool SessionData::getDownsampling() const
     return downsampling;
 }
 
-SocketHandler::SocketHandler(QObject* parent) : QObject(parent), m_server(NULL)
+bool SessionData::hasSameParameters(const SessionData& other) const
+{
+    return interval == other.interval &&
+           bufferSize == other.bufferSize &&
+           bufferInterval == other.bufferInterval &&
+           downsampling == other.downsampling;
+}
+
+void SessionData::setFollowers(const QList<SessionData*>& sessions)
+{
+    if(count && !followers.isEmpty())
+        delayedWrite();
+    followers = sessions;
+}
+
+void SessionData::scheduleTimeout(int msec)
+{
+    if(gridDelivery)
+        dueAt = Utils::getTimeStamp() + msec * 1000ULL;
+    else
+        timer.start(msec);
+}
+
+void SessionData::cancelTimeout()
+{
+    dueAt = 0;
+    if(timer.isActive())
+        timer.stop();
+}
+
+bool SessionData::timeoutScheduled() const
 {
+    return dueAt || timer.isActive();
+}
+
+void SessionData::setGridDelivery(bool enabled)
+{
+    if(enabled == gridDelivery)
+        return;
+    gridDelivery = enabled;
+    if(enabled && timer.isActive())
+    {
+        dueAt = Utils::getTimeStamp() + timer.remainingTime() * 1000ULL;
+        timer.stop();
+    }
+    else if(!enabled && dueAt)
+    {
+        quint64 now = Utils::getTimeStamp();
+        timer.start(dueAt > now ? (dueAt - now + 999) / 1000 : 0);
+        dueAt = 0;
+    }
+}
+
+void SessionData::gridTick(quint64 now)
+{
+    if(dueAt && dueAt <= now)
+        timerTimeout();
+}
+
+SocketHandler::SocketHandler(QObject* parent) : QObject(parent), m_server(NULL), m_sharedMemorySlots(256), m_fanoutsDirty(false), m_gridDelivery(false)
+{
+    if (SensorFrameworkConfig::configuration())
+        m_sharedMemorySlots = SensorFrameworkConfig::configuration()->value<unsigned int>("global/shared_memory_slots", m_sharedMemorySlots);
+
     m_server = new QLocalServer(this);
     connect(m_server, SIGNAL(newConnection()), this, SLOT(newConnection()));
 }
@@ -252,9 +761,127 @@ bool SocketHandler::write(int id, const void* source, int size)
         sensordLogD() << "[SocketHandler]: Trying to write to nonexistent session (normal, no panic).";
         return false;
     }
+    SENSORFW_LATENCY_SCOPE((*it)->latencyProbe, 1);
+    SENSORFW_LATENCY_AGE((*it)->latencyProbe, *static_cast<const quint64*>(source));
     return (*it)->write(source, size);
 }
 
+bool SocketHandler::writeFanout(int fanoutId, const void* source, int size)
+{
+    if (m_fanoutsDirty)
+        regroupFanouts();
+
+    QMap<int, SessionFanout>::const_iterator it = m_fanouts.constFind(fanoutId);
+    if (it == m_fanouts.constEnd())
+    {
+        sensordLogD() << "[SocketHandler]: Trying to write to nonexistent fan-out (normal, no panic).";
+        return false;
+    }
+
+    // Latency of a group is accounted to its leader.
+    bool ret = true;
+    foreach (const QList<SessionData*>& group, it->groups)
+    {
+        SessionData* leader = group.first();
+        SENSORFW_LATENCY_SCOPE(leader->latencyProbe, group.size());
+        SENSORFW_LATENCY_AGE(leader->latencyProbe, *static_cast<const quint64*>(source));
+        ret &= leader->write(source, size);
+    }
+    return ret;
+}
+
+void SocketHandler::setFanout(int fanoutId, const QList<int>& sessions)
+{
+    if (sessions.isEmpty())
+        m_fanouts.remove(fanoutId);
+    else
+        m_fanouts[fanoutId].sessions = sessions;
+    m_fanoutsDirty = true;
+}
+
+void SocketHandler::dissolveFanouts()
+{
+    foreach (SessionData* session, m_idMap)
+        session->setFollowers(QList<SessionData*>());
+    m_fanoutsDirty = true;
+}
+
+void SocketHandler::regroupFanouts()
+{
+    dissolveFanouts();
+    for (QMap<int, SessionFanout>::iterator it = m_fanouts.begin(); it != m_fanouts.end(); ++it)
+    {
+        it->groups.clear();
+        foreach (int sessionId, it->sessions)
+        {
+            SessionData* session = m_idMap.value(sessionId);
+            if (!session)
+                continue;
+            int i = 0;
+            while (i < it->groups.size() && !it->groups[i].first()->hasSameParameters(*session))
+                ++i;
+            if (i == it->groups.size())
+                it->groups.append(QList<SessionData*>());
+            it->groups[i].append(session);
+        }
+        foreach (const QList<SessionData*>& group, it->groups)
+            group.first()->setFollowers(group.mid(1));
+    }
+    m_fanoutsDirty = false;
+}
+
+void SocketHandler::flush()
+{
+    foreach (ClientConnection* connection, m_connections)
+    {
+        if (connection->hasPendingData())
+            connection->flush();
+    }
+}
+
+void SocketHandler::setGridDelivery(bool enabled)
+{
+    m_gridDelivery = enabled;
+    foreach (SessionData* session, m_idMap)
+        session->setGridDelivery(enabled);
+}
+
+bool SocketHandler::gridTick()
+{
+    quint64 now = Utils::getTimeStamp();
+    foreach (SessionData* session, m_idMap)
+        session->gridTick(now);
+    return hasGridWrites();
+}
+
+bool SocketHandler::hasGridWrites() const
+{
+    foreach (const SessionData* session, m_idMap) {
+        if (session->gridWritePending())
+            return true;
+    }
+    return false;
+}
+
+void SocketHandler::printStatus(QStringList& output) const
+{
+    output.append("  Sessions:");
+    for (QMap<int, SessionData*>::const_iterator it = m_idMap.constBegin(); it != m_idMap.constEnd(); ++it) {
+        QString str = QString("    %1: backlog %2 bytes, %3 sample(s) dropped, %4 blocked write(s)").arg(it.key()).arg(it.value()->getBacklog()).arg(it.value()->getDroppedSamples()).arg(it.value()->getBlockedWrites());
+        const SharedSampleRing* ring = it.value()->getSharedMemory();
+        if (ring)
+            str.append(QString(", shared memory %1/%2, %3 sample(s) lost by client").arg(ring->depth()).arg(ring->slotCount()).arg(ring->dropped()));
+        output.append(str);
+    }
+    for (QMap<int, SessionFanout>::const_iterator it = m_fanouts.constBegin(); it != m_fanouts.constEnd(); ++it) {
+        output.append(QString("    fan-out %1: %2 session(s) in %3 group(s)").arg(it.key()).arg(it->sessions.size()).arg(it->groups.size()));
+    }
+    foreach (ClientConnection* connection, m_connections) {
+        if (connection->version() >= 2 && connection->getSocket())
+            output.append(QString("    connection %1: protocol %2, %3 session(s)").arg(connection->getSocket()->socketDescriptor()).arg(connection->version()).arg(connection->sessions().size()));
+    }
+}
+
 bool SocketHandler::removeSession(int sessionId)
 {
     if (!(m_idMap.keys().contains(sessionId))) {
@@ -262,18 +889,54 @@ bool SocketHandler::removeSession(int sessionId)
         return false;
     }
 
-    QLocalSocket* socket = (*m_idMap.find(sessionId))->stealSocket();
+    dissolveFanouts();
+    SessionData* session = m_idMap.take(sessionId);
+    ClientConnection* connection = session->getConnection();
+    delete session;
+
+    // Version 1 connection belongs to its session, a shared one is kept
+    // as long as the client has it open.
+    if (connection && (connection->version() < 2 ||
+                       (connection->sessions().isEmpty() &&
+                        (!connection->getSocket() || connection->getSocket()->state() != QLocalSocket::ConnectedState))))
+        closeConnection(connection);
+
+    return true;
+}
+
+SessionData* SocketHandler::addSession(ClientConnection* connection, int sessionId)
+{
+    SessionData* session = new SessionData(connection, sessionId, this);
+    session->setGridDelivery(m_gridDelivery);
+    SENSORFW_LATENCY_NAME(session->latencyProbe, QString("session %1").arg(sessionId));
+    m_idMap.insert(sessionId, session);
+    m_fanoutsDirty = true;
+    return session;
+}
+
+ClientConnection* SocketHandler::findConnection(QLocalSocket* socket) const
+{
+    foreach (ClientConnection* connection, m_connections) {
+        if (connection->getSocket() == socket)
+            return connection;
+    }
+    return 0;
+}
+
+void SocketHandler::closeConnection(ClientConnection* connection)
+{
+    m_connections.removeAll(connection);
+    QLocalSocket* socket = connection->stealSocket();
 
     if (socket) {
         disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
+        disconnect(socket, SIGNAL(readyRead()), this, SLOT(requestReadable()));
         disconnect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
         disconnect(socket, SIGNAL(error(QLocalSocket::LocalSocketError)), this, SLOT(socketError(QLocalSocket::LocalSocketError)));
         socket->deleteLater();
     }
 
-    delete m_idMap.take(sessionId);
-
-    return true;
+    delete connection;
 }
 
 void SocketHandler::newConnection()
@@ -295,39 +958,122 @@ void SocketHandler::newConnection()
 
 void SocketHandler::socketReadable()
 {
-    int sessionId = -1;
+    quint32 first = 0;
     QLocalSocket* socket = (QLocalSocket*)sender();
-    ((QLocalSocket*)sender())->read((char*)&sessionId, sizeof(int));
+    socket->read((char*)&first, sizeof(first));
 
     disconnect(socket, SIGNAL(readyRead()), this, SLOT(socketReadable()));
 
+    if (first == SENSORFW_WIRE_MAGIC) {
+        sensorfw_wire_hello_t hello;
+        hello.magic = SENSORFW_WIRE_MAGIC;
+        hello.version = 0;
+        if (socket->read((char*)&hello.version, sizeof(hello.version)) != sizeof(hello.version) ||
+            hello.version < 2) {
+            sensordLogC() << "[SocketHandler]: Failed to read protocol version from client. Closing socket.";
+            socket->abort();
+            return;
+        }
+        hello.version = qMin(hello.version, (quint32)SENSORFW_WIRE_VERSION);
+
+        ClientConnection* connection = new ClientConnection(socket, hello.version, this);
+        m_connections.append(connection);
+        connection->queue(QByteArray((const char*)&hello, sizeof(hello)));
+        connection->flush();
+
+        connect(socket, SIGNAL(readyRead()), this, SLOT(requestReadable()));
+        if (socket->bytesAvailable())
+            readRequests(connection);
+        return;
+    }
+
+    int sessionId = (int)first;
     if (sessionId >= 0) {
-        if(!m_idMap.contains(sessionId))
-            m_idMap.insert(sessionId, new SessionData((QLocalSocket*)sender(), this));
+        if(!m_idMap.contains(sessionId)) {
+            ClientConnection* connection = new ClientConnection(socket, 1, this);
+            m_connections.append(connection);
+            SessionData* session = addSession(connection, sessionId);
+
+            quint32 request = 0;
+            if (socket->bytesAvailable() >= (qint64)sizeof(request) &&
+                socket->read((char*)&request, sizeof(request)) == sizeof(request) &&
+                request == SHARED_MEMORY_REQUEST) {
+                int fd = m_sharedMemorySlots ? session->enableSharedMemory(m_sharedMemorySlots) : -1;
+                if (!sendSharedMemory(socket->socketDescriptor(), fd))
+                    sensordLogW() << "[SocketHandler]: failed to reply to shared memory request: " << strerror(errno);
+                if (fd >= 0)
+                    close(fd);
+            }
+        }
     } else {
         sensordLogC() << "[SocketHandler]: Failed to read valid session ID from client. Closing socket.";
         socket->abort();
     }
 }
 
+void SocketHandler::requestReadable()
+{
+    ClientConnection* connection = findConnection((QLocalSocket*)sender());
+    if (connection)
+        readRequests(connection);
+}
+
+void SocketHandler::readRequests(ClientConnection* connection)
+{
+    QLocalSocket* socket = connection->getSocket();
+    sensorfw_wire_request_t request;
+    while (socket->bytesAvailable() >= (qint64)sizeof(request) &&
+           socket->read((char*)&request, sizeof(request)) == sizeof(request)) {
+        if (request.op == SENSORFW_WIRE_ATTACH) {
+            if (request.channel < 0 || m_idMap.contains(request.channel)) {
+                sensordLogW() << "[SocketHandler]: Refusing to attach session" << request.channel;
+                continue;
+            }
+            addSession(connection, request.channel)->acknowledge();
+        } else if (request.op == SENSORFW_WIRE_DETACH) {
+            SessionData* session = m_idMap.value(request.channel);
+            if (session && session->getConnection() == connection)
+                connection->detach(session);
+        } else {
+            sensordLogC() << "[SocketHandler]: Unknown request" << request.op << "from client. Closing socket.";
+            socket->abort();
+            return;
+        }
+    }
+    connection->flush();
+}
+
 void SocketHandler::socketDisconnected()
 {
     QLocalSocket* socket = (QLocalSocket*)sender();
 
-    int sessionId = -1;
+    ClientConnection* connection = findConnection(socket);
+    QList<int> lost;
     for(QMap<int, SessionData*>::const_iterator it = m_idMap.constBegin(); it != m_idMap.constEnd(); ++it)
     {
-        if(it.value()->getSocket() == socket)
-            sessionId = it.key();
+        if(connection && it.value()->getConnection() == connection)
+            lost.append(it.key());
     }
 
-    if (sessionId == -1) {
+    if (lost.isEmpty()) {
+        if (connection && connection->version() >= 2) {
+            sensordLogD() << "[SocketHandler]: Client closed connection without sessions.";
+            closeConnection(connection);
+            return;
+        }
         sensordLogW() << "[SocketHandler]: Noticed lost session, but can't find it.";
         return;
     }
 
-    sensordLogW() << "[SocketHandler]: Noticed lost session: " << sessionId;
-    emit lostSession(sessionId);
+    foreach (int sessionId, lost) {
+        sensordLogW() << "[SocketHandler]: Noticed lost session: " << sessionId;
+        emit lostSession(sessionId);
+    }
+
+    // Handlers normally remove the sessions, which closes the connection.
+    connection = findConnection(socket);
+    if (connection && connection->sessions().isEmpty())
+        closeConnection(connection);
 }
 
 void SocketHandler::socketError(QLocalSocket::LocalSocketError socketError)
@@ -339,8 +1085,8 @@ void SocketHandler::socketError(QLocalSocket::LocalSocketError socketError)
 int SocketHandler::getSocketFd(int sessionId) const
 {
     QMap<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
-    if (it != m_idMap.end() && (*it)->getSocket())
-        return (*it)->getSocket()->socketDescriptor();
+    if (it != m_idMap.end() && (*it)->getConnection() && (*it)->getConnection()->getSocket())
+        return (*it)->getConnection()->getSocket()->socketDescriptor();
     return 0;
 }
 
@@ -349,6 +1095,7 @@ void SocketHandler::setInterval(int sessionId, int value)
     QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         (*it)->setInterval(value);
+    m_fanoutsDirty = true;
 }
 
 void SocketHandler::clearInterval(int sessionId)
@@ -356,6 +1103,7 @@ void SocketHandler::clearInterval(int sessionId)
     QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         (*it)->setInterval(-1);
+    m_fanoutsDirty = true;
 }
 
 int SocketHandler::interval(int sessionId) const
@@ -371,6 +1119,7 @@ void SocketHandler::setBufferSize(int sessionId, unsigned int value)
     QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         (*it)->setBufferSize(value);
+    m_fanoutsDirty = true;
 }
 
 void SocketHandler::clearBufferSize(int sessionId)
@@ -391,6 +1140,7 @@ void SocketHandler::setBufferInterval(int sessionId, unsigned int value)
     QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
         (*it)->setBufferInterval(value);
+    m_fanoutsDirty = true;
 }
 
 void SocketHandler::clearBufferInterval(int sessionId)
@@ -410,7 +1160,7 @@ bool SocketHandler::downsampling(int sessionId) const
 {
     QMap<int, SessionData*>::const_iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
-        return (*it)->getBufferSize();
+        return (*it)->getDownsampling();
     return 0;
 }
 
@@ -418,5 +1168,13 @@ void SocketHandler::setDownsampling(int sessionId, bool value)
 {
     QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
     if (it != m_idMap.end())
-        (*it)->setBufferInterval(value);
+        (*it)->setDownsampling(value);
+    m_fanoutsDirty = true;
+}
+
+void SocketHandler::setSampleType(int sessionId, int type)
+{
+    QMap<int, SessionData*>::iterator it = m_idMap.find(sessionId);
+    if (it != m_idMap.end())
+        (*it)->setSampleType(type);
 }
@@ -34,9 +34,159 @@
 #include <QList>
 #include <QMutex>
 #include <QLocalSocket>
+#include <QByteArray>
+#include <QStringList>
 #include <sys/time.h>
+#include "latencystats.h"
 
 class QLocalServer;
+class QSocketNotifier;
+class SharedSampleRing;
+class SessionData;
+
+/**
+ * Data socket of a client with the queue of data not yet written to it.
+ * A version 1 connection belongs to a single session. A version 2
+ * connection is shared by the sessions the client has attached to it and
+ * every frame carries a header telling its session, see wireprotocol.h.
+ */
+class ClientConnection : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(ClientConnection)
+
+public:
+    /**
+     * Constructor.
+     *
+     * @param socket Established socket connection. ClientConnection will
+     *               take the ownership of it.
+     * @param version Protocol version spoken on the socket.
+     * @param parent Parent object.
+     */
+    ClientConnection(QLocalSocket* socket, int version, QObject* parent = 0);
+
+    /**
+     * Destructor.
+     */
+    virtual ~ClientConnection();
+
+    /**
+     * Get protocol version of the connection.
+     *
+     * @return protocol version.
+     */
+    int version() const;
+
+    /**
+     * Get sample layout version of the connection's frames.
+     *
+     * @return SENSORFW_WIRE_SAMPLE_US or SENSORFW_WIRE_SAMPLE_NS.
+     */
+    int sampleVersion() const;
+
+    /**
+     * Queue data for writing. The data is shared, not copied.
+     *
+     * @param data Data to write.
+     * @return false if the queue is full.
+     */
+    bool queue(const QByteArray& data);
+
+    /**
+     * Queue frame header and samples for writing. Either both or neither
+     * are queued.
+     *
+     * @param header Frame header.
+     * @param payload Samples.
+     * @return false if the queue is full.
+     */
+    bool queue(const QByteArray& header, const QByteArray& payload);
+
+    /**
+     * Write queued data to the socket with a single non-blocking call.
+     * If the socket is full the rest is kept and written when the socket
+     * becomes writable again.
+     *
+     * @return false if the socket failed.
+     */
+    bool flush();
+
+    /**
+     * Is there data waiting to be written to the socket.
+     *
+     * @return is there queued data.
+     */
+    bool hasPendingData() const;
+
+    /**
+     * Get amount of data waiting to be written to the socket.
+     *
+     * @return queued bytes.
+     */
+    int getBacklog() const;
+
+    /**
+     * Get number of writes which found the socket full.
+     *
+     * @return blocked writes.
+     */
+    unsigned long getBlockedWrites() const;
+
+    /**
+     * Get used local socket pointer.
+     *
+     * @return local socket or NULL if stolen.
+     */
+    QLocalSocket* getSocket() const;
+
+    /**
+     * Get used local socket pointer and steal ownership of it
+     * from ClientConnection.
+     *
+     * @return local socket or NULL if stolen.
+     */
+    QLocalSocket* stealSocket();
+
+    /**
+     * Route frames of a session to this connection.
+     *
+     * @param session Session.
+     */
+    void attach(SessionData* session);
+
+    /**
+     * Stop routing frames of a session to this connection.
+     *
+     * @param session Session.
+     */
+    void detach(SessionData* session);
+
+    /**
+     * Get sessions attached to the connection.
+     *
+     * @return sessions.
+     */
+    const QList<SessionData*>& sessions() const;
+
+private:
+    QLocalSocket* socket;        /**< socket pointer. */
+    int protocol;                /**< protocol version */
+    QList<QByteArray> outbox;    /**< data waiting to be written */
+    int outboxOffset;            /**< bytes of first entry already written */
+    int outboxBytes;             /**< bytes waiting to be written */
+    int outboxLimit;             /**< max bytes of outbox */
+    QSocketNotifier* writeNotifier; /**< notifier for full socket */
+    unsigned long blockedWrites; /**< writes which hit EAGAIN */
+    QList<SessionData*> attached; /**< sessions of the connection */
+
+private slots:
+
+    /**
+     * Callback for full socket becoming writable.
+     */
+    void socketWritable();
+};
 
 /**
  * Class contains data for single sensor session related data socket
@@ -51,40 +201,105 @@ public:
     /**
      * Constructor.
      *
-     * @param socket Established socket connection. SessionData will take
-     *               the ownership of it.
+     * @param connection Connection receiving the frames of the session.
+     * @param id Session ID.
      * @param parent Parent object.
      */
-    SessionData(QLocalSocket* socket, QObject* parent = 0);
+    SessionData(ClientConnection* connection, int id, QObject* parent = 0);
 
     /**
-     * Destructor.
+     * Destructor. Detaches the session from its connection.
      */
     virtual ~SessionData();
 
     /**
-     * Write data to socket. The data might be queued before written.
+     * Write data to socket. The data is queued and written by the next
+     * flush().
      *
      * @param source Source from where to write.
      * @param size How many bytes to write from source.
-     * @return was data succesfully written.
+     * @return was data succesfully queued.
      */
     bool write(const void* source, int size);
 
     /**
-     * Get used local socket pointer.
+     * Write queued data of the connection to the socket. See
+     * ClientConnection::flush().
      *
-     * @return local socket or NULL if connection is closed or stolen.
+     * @return false if the socket failed.
      */
-    QLocalSocket* getSocket() const;
+    bool flush();
 
     /**
-     * Get used local socket pointer and steal ownership of it
-     * from SessionData.
+     * Is there data waiting to be written to the socket.
      *
-     * @return local socket or NULL if connection is closed or stolen.
+     * @return is there queued data.
      */
-    QLocalSocket* stealSocket();
+    bool hasPendingData() const;
+
+    /**
+     * Get amount of data waiting to be written to the socket.
+     *
+     * @return queued bytes.
+     */
+    int getBacklog() const;
+
+    /**
+     * Get number of samples dropped because the client did not keep up.
+     *
+     * @return dropped samples.
+     */
+    unsigned long getDroppedSamples() const;
+
+    /**
+     * Get number of writes which found the socket full.
+     *
+     * @return blocked writes.
+     */
+    unsigned long getBlockedWrites() const;
+
+    /**
+     * Move sample data of the session into a shared memory ring. The
+     * socket is then only used to wake up the client. Only possible on
+     * version 1 connections.
+     *
+     * @param slotCount Number of samples the ring can hold.
+     * @return memory file descriptor to pass to the client, or -1 on
+     *         failure. Caller must close it.
+     */
+    int enableSharedMemory(unsigned int slotCount);
+
+    /**
+     * Get shared memory ring of the session.
+     *
+     * @return ring or NULL if socket transport is used.
+     */
+    const SharedSampleRing* getSharedMemory() const;
+
+    /**
+     * Get connection of the session.
+     *
+     * @return connection or NULL if the session has been detached.
+     */
+    ClientConnection* getConnection() const;
+
+    /**
+     * Forget the connection after it has detached the session.
+     */
+    void clearConnection();
+
+    /**
+     * Set sample type reported in frame headers.
+     *
+     * @param type sensorfw_wire_sample_type.
+     */
+    void setSampleType(int type);
+
+    /**
+     * Queue empty frame telling a version 2 client that the session has
+     * been attached.
+     */
+    void acknowledge();
 
     /**
      * Set used interval for the data stream. If data is received at higher
@@ -146,6 +361,50 @@ public:
      */
     bool getDownsampling() const;
 
+    /**
+     * Does the other session buffer and drop samples exactly like this
+     * one, so that both can share written frames.
+     *
+     * @param other Session to compare with.
+     * @return are the stream parameters identical.
+     */
+    bool hasSameParameters(const SessionData& other) const;
+
+    /**
+     * Set sessions which receive every frame this session writes instead
+     * of buffering samples themselves. Samples still buffered for the
+     * previous followers are written to them first.
+     *
+     * @param sessions Sessions with identical stream parameters.
+     */
+    void setFollowers(const QList<SessionData*>& sessions);
+
+    /**
+     * Switch delayed writes between the session's own timer and the
+     * wakeup grid. On the grid a due write waits for the next gridTick().
+     *
+     * @param enabled should delayed writes wait for grid ticks.
+     */
+    void setGridDelivery(bool enabled);
+
+    /**
+     * Perform delayed write if it is due.
+     *
+     * @param now Current monotonic time (microsec).
+     */
+    void gridTick(quint64 now);
+
+    /**
+     * Is delayed write waiting for a grid tick.
+     *
+     * @return is write waiting.
+     */
+    bool gridWritePending() const { return dueAt != 0; }
+
+#ifdef SENSORFW_LATENCY_STATS
+    LatencyProbe latencyProbe;   /**< end-to-end latency of the session */
+#endif
+
 private:
     /**
      * How many milliseconds since last time data was written to socket.
@@ -156,13 +415,62 @@ private:
     long sinceLastWrite() const;
 
     /**
-     * Write data directly to the socket.
+     * Append frame of data elements to the queue of outgoing data.
      *
      * @param source Source from where to write.
-     * @param size How many bytes to write.
+     * @param size Size of single data element.
      * @param count How many data elements are written.
      */
-    bool write(void* source, int size, unsigned int count);
+    bool write(const void* source, int size, unsigned int count);
+
+    /**
+     * Schedule delayed write.
+     *
+     * @param msec Delay in milliseconds.
+     */
+    void scheduleTimeout(int msec);
+
+    /**
+     * Cancel scheduled delayed write.
+     */
+    void cancelTimeout();
+
+    /**
+     * Is delayed write scheduled.
+     */
+    bool timeoutScheduled() const;
+
+    /**
+     * Queue frame for writing behind a header of the connection's
+     * protocol. The samples are shared, not copied, unless the session
+     * uses shared memory.
+     *
+     * @param payload Samples.
+     * @param size Size of single data element.
+     * @param count How many data elements the frame holds.
+     * @return was frame queued.
+     */
+    bool queueFrame(const QByteArray& payload, int size, unsigned int count);
+
+    /**
+     * Get header storage for the next frame. Headers are reused once the
+     * connection has written them out.
+     *
+     * @param size Header size.
+     * @return header.
+     */
+    QByteArray& nextHeader(int size);
+
+    /**
+     * Copy samples with their timestamps converted to nanoseconds. The
+     * copy is reused once the connection has written it out.
+     *
+     * @param payload Samples.
+     * @param size Size of single data element.
+     * @param count How many data elements the frame holds.
+     * @return converted samples.
+     */
+    const QByteArray& nanosecondFrame(const QByteArray& payload, int size, unsigned int count);
 
     /**
      * Delayed write invocation.
@@ -171,16 +479,30 @@ private:
      */
     bool delayedWrite();
 
-    QLocalSocket* socket;        /**< socket pointer. */
+    ClientConnection* connection; /**< connection of the session. */
+    int id;                      /**< session ID */
     int interval;                /**< interval in milliseconds. */
     char* buffer;                /**< pointer to buffer allocation. */
     int size;                    /**< allocated buffer size. */
     unsigned int count;          /**< how many elements are in the buffer */
     struct timeval lastWrite;    /**< when data was written last time */
     QTimer timer;                /**< timer for delayed write */
+    bool gridDelivery;           /**< delayed write waits for grid ticks */
+    quint64 dueAt;               /**< monotonic time of delayed write on grid, 0 if none */
     unsigned int bufferSize;     /**< buffer size */
     unsigned int bufferInterval; /**< buffer interval in milliseconds */
     bool downsampling;           /**< sample dropping */
+    QByteArray frame;            /**< samples of last frame, reused once released */
+    QByteArray nsFrame;          /**< nanosecond copy of last frame, reused once released */
+    QList<QByteArray> headers;   /**< frame headers, reused once released */
+    int headerIndex;             /**< oldest header */
+    quint32 sequence;            /**< frames queued */
+    int sampleType;              /**< sensorfw_wire_sample_type */
+    QList<SessionData*> followers; /**< sessions sharing frames of this one */
+    unsigned long droppedSamples; /**< samples dropped due to full outbox */
+    SharedSampleRing* ring;      /**< shared memory transport */
+    void* ringMapping;           /**< mapping of the ring */
+    size_t ringMappingSize;      /**< size of ring mapping */
 
 private slots:
 
@@ -220,7 +542,17 @@ public:
     bool listen(const QString& serverName);
 
     /**
-     * Write data to given session.
+     * Create anonymous shared memory file. Size of the file is sealed
+     * where supported, so readers can not truncate it under mappings.
+     *
+     * @param name Name of the file for debugging.
+     * @param size File size.
+     * @return file descriptor or -1.
+     */
+    static int createSharedMemory(const char* name, size_t size);
+
+    /**
+     * Write data to given session. Data is queued until flush().
      *
      * @param id Session ID.
      * @param source Location from where to write.
@@ -229,10 +561,64 @@ public:
     bool write(int id, const void* source, int size);
 
     /**
-     * Close related socket connection for session.
+     * Write data to all sessions of a fan-out. Sessions with identical
+     * stream parameters are grouped, the sample is buffered and encoded
+     * once per group and the frame is shared by all of its sessions.
+     *
+     * @param fanoutId Fan-out ID.
+     * @param source Location from where to write.
+     * @param size How many bytes to write.
+     */
+    bool writeFanout(int fanoutId, const void* source, int size);
+
+    /**
+     * Set sessions of a fan-out.
+     *
+     * @param fanoutId Fan-out ID.
+     * @param sessions Session IDs. Empty list removes the fan-out.
+     */
+    void setFanout(int fanoutId, const QList<int>& sessions);
+
+    /**
+     * Write queued data of all sessions to their sockets.
+     */
+    void flush();
+
+    /**
+     * Defer delayed writes of all sessions to grid ticks instead of
+     * their own timers.
+     *
+     * @param enabled should delayed writes wait for gridTick().
+     */
+    void setGridDelivery(bool enabled);
+
+    /**
+     * Perform due delayed writes of all sessions and flush.
+     *
+     * @return do delayed writes still wait for later ticks.
+     */
+    bool gridTick();
+
+    /**
+     * Are delayed writes waiting for grid ticks.
+     *
+     * @return is any delayed write waiting.
+     */
+    bool hasGridWrites() const;
+
+    /**
+     * Append session status into given StringList.
+     *
+     * @param output StringList to append status.
+     */
+    void printStatus(QStringList& output) const;
+
+    /**
+     * Remove session. Its socket connection is closed unless the client
+     * shares it with other sessions.
      *
      * @param sessionId Session ID.
-     * @return was socket connection closed succesfully.
+     * @return was session removed succesfully.
      */
     bool removeSession(int sessionId);
 
@@ -337,6 +723,14 @@ public:
      */
     void setDownsampling(int sessionId, bool value);
 
+    /**
+     * Set sample type reported in frame headers of given session.
+     *
+     * @param sessionId Session ID.
+     * @param type sensorfw_wire_sample_type.
+     */
+    void setSampleType(int sessionId, int type);
+
 Q_SIGNALS:
     /**
      * Signal is emitted for lost sessions which can happen for example
@@ -357,6 +751,11 @@ private slots:
      */
     void socketReadable();
 
+    /**
+     * Callback for requests on a version 2 connection.
+     */
+    void requestReadable();
+
     /**
      * Callback for disconnected client.
      */
@@ -370,9 +769,67 @@ private slots:
     void socketError(QLocalSocket::LocalSocketError socketError);
 
 private:
+    /**
+     * Sessions of a fan-out, grouped by stream parameters.
+     */
+    struct SessionFanout
+    {
+        QList<int> sessions;                   /**< member session IDs */
+        QList<QList<SessionData*> > groups;     /**< groups, leader first */
+    };
+
+    /**
+     * Detach followers from all sessions. Must be done before deleting
+     * a session.
+     */
+    void dissolveFanouts();
+
+    /**
+     * Regroup sessions of all fan-outs after membership or stream
+     * parameters have changed.
+     */
+    void regroupFanouts();
+
+    /**
+     * Create session writing to given connection.
+     *
+     * @param connection Connection of the session.
+     * @param sessionId Session ID.
+     * @return session.
+     */
+    SessionData* addSession(ClientConnection* connection, int sessionId);
+
+    /**
+     * Serve attach and detach requests waiting on a version 2
+     * connection.
+     *
+     * @param connection Connection.
+     */
+    void readRequests(ClientConnection* connection);
+
+    /**
+     * Find connection of a socket.
+     *
+     * @param socket Socket.
+     * @return connection or NULL.
+     */
+    ClientConnection* findConnection(QLocalSocket* socket) const;
+
+    /**
+     * Close connection and delete it. Its sessions must have been
+     * detached.
+     *
+     * @param connection Connection.
+     */
+    void closeConnection(ClientConnection* connection);
 
     QLocalServer*            m_server; /**< listening server socket. */
     QMap<int, SessionData*>  m_idMap;  /**< map of client sessions. */
+    QList<ClientConnection*> m_connections; /**< client connections */
+    unsigned int             m_sharedMemorySlots; /**< ring size for shared memory sessions, 0 to disable */
+    QMap<int, SessionFanout> m_fanouts; /**< fan-outs by ID */
+    bool                     m_fanoutsDirty; /**< fan-outs need regrouping */
+    bool                     m_gridDelivery; /**< delayed writes wait for grid ticks */
 };
 
 #endif // SOCKETHANDLER_H
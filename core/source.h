@@ -58,12 +58,23 @@ public:
      */
     bool unjoin(SinkBase* sink);
 
+#ifdef SENSORFW_LATENCY_STATS
+    /**
+     * Probe timing propagate() calls.
+     */
+    LatencyProbe& latencyProbe() { return latencyProbe_; }
+#endif
+
 protected:
     /**
      * Destructor.
      */
     virtual ~SourceBase() {}
 
+#ifdef SENSORFW_LATENCY_STATS
+    LatencyProbe latencyProbe_; /**< propagate() timing */
+#endif
+
 private:
     /**
      * Connect and check that sink is compatible with source.
@@ -92,17 +103,32 @@ class Source : public SourceBase
 {
 public:
     /**
-     * Propagate data to connected sinks.
+     * Constructor.
+     */
+    Source() :
+        only_(0)
+    {
+    }
+
+    /**
+     * Propagate data to connected sinks. A source with a single sink
+     * calls it directly without walking the sink set.
      *
      * @param n how many elements to stream.
      * @param values source from where to stream data.
      */
     void propagate(int n, const TYPE* values)
     {
+        SENSORFW_LATENCY_SCOPE(this->latencyProbe_, n);
+        if (only_) {
+            only_->collect(n, values);
+            return;
+        }
         foreach (SinkTyped<TYPE>* sink, sinks_) {
             sink->collect(n, values);
         }
     }
+
 private:
     bool joinTypeChecked(SinkBase* sink)
     {
@@ -110,6 +136,7 @@ private:
         if(type)
         {
             sinks_.insert(type);
+            updateOnly();
             return true;
         }
         sensordLogC() << "Failed to join type '" << typeid(type).name() << " to source!";
@@ -122,13 +149,20 @@ private:
         if(type)
         {
             sinks_.remove(type);
+            updateOnly();
             return true;
         }
         sensordLogC() << "Failed to unjoin type '" << typeid(type).name() << " from source!";
         return false;
     }
 
+    void updateOnly()
+    {
+        only_ = sinks_.size() == 1 ? *sinks_.constBegin() : 0;
+    }
+
     QSet<SinkTyped<TYPE>*> sinks_; /**< connected sinks. */
+    SinkTyped<TYPE>*       only_;  /**< the sink if there is exactly one */
 };
 
 #endif
@@ -32,10 +32,14 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 #include <QFile>
 #include "logging.h"
 #include "config.h"
+#include "datatypes/utils.h"
+#include "wakeupgrid.h"
 
 SysfsAdaptor::SysfsAdaptor(const QString& id,
                            PollMode mode,
@@ -43,9 +47,7 @@ SysfsAdaptor::SysfsAdaptor(const QString& id,
                            const QString& path,
                            const int pathId) :
     DeviceAdaptor(id),
-    reader_(this),
     mode_(mode),
-    epollDescriptor_(-1),
     interval_(0),
     inStandbyMode_(false),
     running_(false),
@@ -55,9 +57,6 @@ SysfsAdaptor::SysfsAdaptor(const QString& id,
     if (!path.isEmpty()) {
         addPath(path, pathId);
     }
-
-    pipeDescriptors_[0] = -1;
-    pipeDescriptors_[1] = -1;
 }
 
 SysfsAdaptor::~SysfsAdaptor()
@@ -226,70 +225,22 @@ bool SysfsAdaptor::openFds()
             return false;
         }
         sysfsDescriptors_.append(fd);
-    }
-
-    // Set up epoll for select mode
-    if (mode_ == SelectMode) {
-
-        if (pipe(pipeDescriptors_) == -1 ) {
-            sensordLogW() << "pipe(): " << strerror(errno);
-            return false;
-        }
-
-        if (fcntl(pipeDescriptors_[0], F_SETFD, FD_CLOEXEC) == -1) {
-            sensordLogW() << "fcntl(): " << strerror(errno);
-            return false;
-        }
-
-        // Set up epoll fd
-        if ((epollDescriptor_ = epoll_create(sysfsDescriptors_.size() + 1)) == -1) {
-            sensordLogW() << "epoll_create(): " << strerror(errno);
-            return false;
-        }
-
-        struct epoll_event ev;
-        memset(&ev, 0, sizeof(epoll_event));
-        ev.events  = EPOLLIN;
-
-        // Set up epolling for the list
-        for (int i = 0; i < sysfsDescriptors_.size(); ++i) {
-            ev.data.fd = sysfsDescriptors_.at(i);
-            if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, sysfsDescriptors_.at(i), &ev) == -1) {
-                sensordLogW() << "epoll_ctl(): " << strerror(errno);
-                return false;
-            }
-        }
-
-        // Add control pipe to poll list
-        ev.data.fd = pipeDescriptors_[0];
-        if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, pipeDescriptors_[0], &ev) == -1) {
-            sensordLogW() << "epoll_ctl(): " << strerror(errno);
-            return false;
-        }
+        configureDescriptor(pathIds_.at(i), fd);
     }
 
     return true;
 }
 
+void SysfsAdaptor::configureDescriptor(int pathId, int fd)
+{
+    Q_UNUSED(pathId);
+    Q_UNUSED(fd);
+}
+
 void SysfsAdaptor::closeAllFds()
 {
     QMutexLocker locker(&mutex_);
 
-    /* Epoll */
-    if (epollDescriptor_ != -1) {
-        close(epollDescriptor_);
-        epollDescriptor_ = -1;
-    }
-
-    /* Pipe */
-    for (int i = 0; i < 2; ++i) {
-        if (pipeDescriptors_[i] != -1) {
-            close(pipeDescriptors_[i]);
-            pipeDescriptors_[i] = -1;
-        }
-    }
-
-    /* SysFS */
     while (!sysfsDescriptors_.empty()) {
         if (sysfsDescriptors_.last() != -1) {
             close(sysfsDescriptors_.last());
@@ -300,27 +251,17 @@ void SysfsAdaptor::closeAllFds()
 
 void SysfsAdaptor::stopReaderThread()
 {
-    if (mode_ == SelectMode) {
-        quint64 dummy = 1;
-        ssize_t bytesWritten = write(pipeDescriptors_[1], &dummy, 8);
-        if (!bytesWritten)
-            qWarning() << "Could not write pipe descriptors";
-    }
-    else
-        reader_.stopReader();
-    reader_.wait();
+    SysfsAdaptorReactor::instance().remove(this);
 }
 
 bool SysfsAdaptor::startReaderThread()
 {
-    if (!openFds()) {
+    if (!openFds() || !SysfsAdaptorReactor::instance().add(this)) {
 
         closeAllFds();
         return false;
     }
 
-    reader_.startReader();
-
     return true;
 }
 
@@ -390,6 +331,8 @@ bool SysfsAdaptor::setInterval(const unsigned int value, const int sessionId)
     if(!checkIntervalUsage())
         return false;
     interval_ = value;
+    if (mode_ == IntervalMode)
+        SysfsAdaptorReactor::instance().reschedule(this);
     return true;
 }
 
@@ -398,82 +341,300 @@ SysfsAdaptor::PollMode SysfsAdaptor::mode() const
     return mode_;
 }
 
-SysfsAdaptorReader::SysfsAdaptorReader(SysfsAdaptor *parent) : running_(false), parent_(parent)
-{
+namespace {
+    const quint64 WAKEUP_KEY = 0;            /**< epoll key of the eventfd */
+    const int MAX_EVENTS = 16;               /**< events handled per wakeup */
+    const unsigned int INPUT_ERROR_PAUSE = 50;   /**< ms to ignore fd after error */
+    const unsigned int SEEK_ERROR_PAUSE = 1000;  /**< ms to ignore fd after failed lseek() */
 }
 
-void SysfsAdaptorReader::stopReader()
+QAtomicInt SysfsAdaptorReactor::wakeupGrid_(0);
+bool SysfsAdaptorReactor::created_ = false;
+
+SysfsAdaptorReactor& SysfsAdaptorReactor::instance()
 {
-    running_ = false;
+    static SysfsAdaptorReactor the_reactor;
+
+    return the_reactor;
 }
 
-void SysfsAdaptorReader::startReader()
+SysfsAdaptorReactor::SysfsAdaptorReactor() :
+    epollDescriptor_(-1),
+    eventDescriptor_(-1),
+    nextKey_(WAKEUP_KEY + 1),
+    quit_(0)
 {
-    running_ = true;
+    created_ = true;
+
+    if ((epollDescriptor_ = epoll_create1(EPOLL_CLOEXEC)) == -1) {
+        sensordLogW() << "epoll_create1(): " << strerror(errno);
+        return;
+    }
+    if ((eventDescriptor_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) == -1) {
+        sensordLogW() << "eventfd(): " << strerror(errno);
+        return;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(epoll_event));
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKEUP_KEY;
+    if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, eventDescriptor_, &ev) == -1) {
+        sensordLogW() << "epoll_ctl(): " << strerror(errno);
+        return;
+    }
+
     start();
 }
 
-void SysfsAdaptorReader::run()
+SysfsAdaptorReactor::~SysfsAdaptorReactor()
+{
+    if (isRunning()) {
+        quit_.storeRelease(1);
+        quint64 one = 1;
+        if (write(eventDescriptor_, &one, sizeof(one)) != sizeof(one))
+            sensordLogW() << "Failed to stop sysfs reactor: " << strerror(errno);
+        wait();
+    }
+
+    foreach (const Watch& watch, watches_) {
+        if (watch.index < 0)
+            close(watch.fd);
+    }
+    if (eventDescriptor_ != -1)
+        close(eventDescriptor_);
+    if (epollDescriptor_ != -1)
+        close(epollDescriptor_);
+}
+
+bool SysfsAdaptorReactor::add(SysfsAdaptor* adaptor)
+{
+    if (!isRunning()) {
+        sensordLogW() << "Sysfs reactor not running, can not monitor " << adaptor->id();
+        return false;
+    }
+
+    QMutexLocker locker(&mutex_);
+
+    QList<Watch> added;
+    if (adaptor->mode_ == SysfsAdaptor::SelectMode) {
+        for (int i = 0; i < adaptor->sysfsDescriptors_.size(); ++i) {
+            Watch watch = { adaptor, adaptor->sysfsDescriptors_.at(i), i, 0 };
+            added.append(watch);
+        }
+    } else {
+        int timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (timerFd == -1) {
+            sensordLogW() << "timerfd_create(): " << strerror(errno);
+            return false;
+        }
+        if (!armTimer(timerFd, adaptor->interval())) {
+            close(timerFd);
+            return false;
+        }
+        Watch watch = { adaptor, timerFd, -1, 0 };
+        added.append(watch);
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(epoll_event));
+    ev.events = EPOLLIN;
+    QList<quint64> keys;
+    foreach (const Watch& watch, added) {
+        ev.data.u64 = nextKey_++;
+        if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, watch.fd, &ev) == -1) {
+            sensordLogW() << "epoll_ctl(): " << strerror(errno);
+            foreach (quint64 key, keys)
+                epoll_ctl(epollDescriptor_, EPOLL_CTL_DEL, watches_.take(key).fd, 0);
+            if (adaptor->mode_ == SysfsAdaptor::IntervalMode)
+                close(added.first().fd);
+            return false;
+        }
+        keys.append(ev.data.u64);
+        watches_.insert(ev.data.u64, watch);
+    }
+
+    return true;
+}
+
+void SysfsAdaptorReactor::remove(SysfsAdaptor* adaptor)
+{
+    QList<int> timers;
+    {
+        QMutexLocker locker(&mutex_);
+        QHash<quint64, Watch>::iterator it = watches_.begin();
+        while (it != watches_.end()) {
+            if (it->adaptor != adaptor) {
+                ++it;
+                continue;
+            }
+            if (!it->mutedUntil)
+                epoll_ctl(epollDescriptor_, EPOLL_CTL_DEL, it->fd, 0);
+            if (it->index < 0)
+                timers.append(it->fd);
+            it = watches_.erase(it);
+        }
+    }
+
+    // Events already taken from epoll are looked up from watches_ before
+    // use, so once the current batch is done the adaptor is not touched.
+    if (QThread::currentThread() != this) {
+        dispatchMutex_.lock();
+        dispatchMutex_.unlock();
+    }
+
+    foreach (int timerFd, timers)
+        close(timerFd);
+}
+
+void SysfsAdaptorReactor::reschedule(SysfsAdaptor* adaptor)
 {
-    while (running_) {
+    QMutexLocker locker(&mutex_);
+    foreach (const Watch& watch, watches_) {
+        if (watch.adaptor == adaptor && watch.index < 0)
+            armTimer(watch.fd, adaptor->interval());
+    }
+}
 
-        if (parent_->mode_ == SysfsAdaptor::SelectMode) {
+bool SysfsAdaptorReactor::armTimer(int timerFd, unsigned int interval)
+{
+    // Zero interval used to mean back to back reads, poll every
+    // millisecond instead.
+    return WakeupGrid::armTimer(timerFd, WakeupGrid::snapPeriod(qMax(interval, 1u), wakeupGrid_.load()));
+}
+
+void SysfsAdaptorReactor::setWakeupGrid(unsigned int grid)
+{
+    if ((unsigned int)wakeupGrid_.fetchAndStoreOrdered(grid) == grid || !created_)
+        return;
 
-            struct epoll_event events[parent_->sysfsDescriptors_.size() + 1];
-            memset(events, 0x0, sizeof(events));
+    SysfsAdaptorReactor& reactor = instance();
+    QMutexLocker locker(&reactor.mutex_);
+    foreach (const Watch& watch, reactor.watches_) {
+        if (watch.index < 0)
+            reactor.armTimer(watch.fd, watch.adaptor->interval());
+    }
+}
+
+void SysfsAdaptorReactor::run()
+{
+    struct epoll_event events[MAX_EVENTS];
+    int timeout = -1;
 
-            int descriptors = epoll_wait(parent_->epollDescriptor_, events, parent_->sysfsDescriptors_.size() + 1, -1);
+    while (!quit_.loadAcquire()) {
+        int descriptors = epoll_wait(epollDescriptor_, events, MAX_EVENTS, timeout);
 
-            if (descriptors == -1) {
+        if (descriptors == -1) {
+            if (errno != EINTR) {
                 sensordLogD() << "epoll_wait(): " << strerror(errno);
                 QThread::msleep(1000);
-            } else {
-                bool errorInInput = false;
-                for (int i = 0; i < descriptors; ++i) {
-                    if (events[i].events & (EPOLLHUP | EPOLLERR)) {
-                        //Note: we ignore error so the sensordiverter.sh works. This should be handled better when testcases are improved.
-                        sensordLogD() << "epoll_wait(): error in input fd";
-                        errorInInput = true;
-                    }
-                    int index = parent_->sysfsDescriptors_.lastIndexOf(events[i].data.fd);
-                    if (index != -1) {
-                        parent_->processSample(parent_->pathIds_.at(index), events[i].data.fd);
-
-                        if (parent_->doSeek_)
-                        {
-                            if (lseek(events[i].data.fd, 0, SEEK_SET) == -1)
-                            {
-                                sensordLogW() << "Failed to lseek fd: " << strerror(errno);
-                                QThread::msleep(1000);
-                            }
-                        }
-                    } else if (events[i].data.fd == parent_->pipeDescriptors_[0]) {
-                        running_ = false;
-                    }
-                }
-                if (errorInInput)
-                    QThread::msleep(50);
             }
-        } else { //IntervalMode
-
-            // Read through all fds.
-            for (int i = 0; i < parent_->sysfsDescriptors_.size(); ++i) {
-                parent_->processSample(parent_->pathIds_.at(i), parent_->sysfsDescriptors_.at(i));
-
-                if (parent_->doSeek_)
-                {
-                    if (lseek(parent_->sysfsDescriptors_.at(i), 0, SEEK_SET) == -1)
-                    {
-                        sensordLogW() << "Failed to lseek fd: " << strerror(errno);
-                        QThread::msleep(1000);
-                    }
-                }
+            timeout = unmuteExpired();
+            continue;
+        }
+
+        QMutexLocker dispatching(&dispatchMutex_);
+        for (int i = 0; i < descriptors; ++i) {
+            quint64 key = events[i].data.u64;
+            if (key == WAKEUP_KEY) {
+                quint64 value;
+                if (read(eventDescriptor_, &value, sizeof(value)) != sizeof(value))
+                    sensordLogD() << "read(): " << strerror(errno);
+                continue;
             }
 
-            // Sleep for interval
-            QThread::msleep(parent_->interval());
+            Watch watch;
+            {
+                QMutexLocker locker(&mutex_);
+                QHash<quint64, Watch>::const_iterator it = watches_.constFind(key);
+                if (it == watches_.constEnd() || it->mutedUntil)
+                    continue;
+                watch = *it;
+            }
+            dispatch(key, watch, events[i].events);
+        }
+        timeout = unmuteExpired();
+    }
+}
+
+void SysfsAdaptorReactor::dispatch(quint64 key, const Watch& watch, quint32 events)
+{
+    SysfsAdaptor* adaptor = watch.adaptor;
+
+    if (watch.index < 0) {
+        // Overruns are not caught up, one read per wakeup
+        quint64 expirations;
+        if (read(watch.fd, &expirations, sizeof(expirations)) != sizeof(expirations))
+            return;
+        for (int i = 0; i < adaptor->sysfsDescriptors_.size(); ++i) {
+            if (!readSample(adaptor, i)) {
+                mute(key, SEEK_ERROR_PAUSE);
+                return;
+            }
+        }
+        return;
+    }
+
+    bool errorInInput = false;
+    if (events & (EPOLLHUP | EPOLLERR)) {
+        //Note: we ignore error so the sensordiverter.sh works. This should be handled better when testcases are improved.
+        sensordLogD() << "epoll_wait(): error in input fd";
+        errorInInput = true;
+    }
+    if (!readSample(adaptor, watch.index))
+        mute(key, SEEK_ERROR_PAUSE);
+    else if (errorInInput)
+        mute(key, INPUT_ERROR_PAUSE);
+}
+
+bool SysfsAdaptorReactor::readSample(SysfsAdaptor* adaptor, int index)
+{
+    int fd = adaptor->sysfsDescriptors_.at(index);
+    adaptor->processSample(adaptor->pathIds_.at(index), fd);
+
+    if (adaptor->doSeek_ && lseek(fd, 0, SEEK_SET) == -1) {
+        sensordLogW() << "Failed to lseek fd: " << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+void SysfsAdaptorReactor::mute(quint64 key, unsigned int duration)
+{
+    // Errors are reported by epoll even without EPOLLIN, so the fd is
+    // taken out of the set instead of sleeping and stalling other adaptors.
+    QMutexLocker locker(&mutex_);
+    QHash<quint64, Watch>::iterator it = watches_.find(key);
+    if (it == watches_.end() || it->mutedUntil)
+        return;
+    if (epoll_ctl(epollDescriptor_, EPOLL_CTL_DEL, it->fd, 0) == -1) {
+        sensordLogW() << "epoll_ctl(): " << strerror(errno);
+        return;
+    }
+    it->mutedUntil = Utils::getTimeStamp() + duration * 1000ULL;
+}
+
+int SysfsAdaptorReactor::unmuteExpired()
+{
+    QMutexLocker locker(&mutex_);
+    quint64 now = Utils::getTimeStamp();
+    quint64 nearest = 0;
+    for (QHash<quint64, Watch>::iterator it = watches_.begin(); it != watches_.end(); ++it) {
+        if (!it->mutedUntil)
+            continue;
+        if (it->mutedUntil <= now) {
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(epoll_event));
+            ev.events = EPOLLIN;
+            ev.data.u64 = it.key();
+            if (epoll_ctl(epollDescriptor_, EPOLL_CTL_ADD, it->fd, &ev) == -1)
+                sensordLogW() << "epoll_ctl(): " << strerror(errno);
+            it->mutedUntil = 0;
+        } else if (!nearest || it->mutedUntil < nearest) {
+            nearest = it->mutedUntil;
         }
     }
+    return nearest ? (nearest - now + 999) / 1000 : -1;
 }
 
 void SysfsAdaptor::init()
@@ -36,45 +36,108 @@
 #include <QThread>
 #include <QMutex>
 #include <QFile>
+#include <QHash>
+#include <QAtomicInt>
 
 class SysfsAdaptor;
 
 /**
- * Threading functionality for SysfsAdaptor. Helper class that removes
- * ambiguous inheritance from QObject. Should not be invoked directly
- * by anything except #SysfsAdaptor.
+ * Shared I/O thread of all SysfsAdaptor instances. One epoll set holds
+ * the file descriptors of adaptors in SelectMode and a timerfd for each
+ * adaptor in IntervalMode. Should not be invoked directly by anything
+ * except #SysfsAdaptor.
+ *
+ * Timers expire at multiples of their interval on the monotonic clock
+ * instead of sleeping after each read, so periods do not drift and
+ * adaptors with intervals that divide each other wake up together.
  */
-class SysfsAdaptorReader : public QThread
+class SysfsAdaptorReactor : public QThread
 {
     Q_OBJECT
-    Q_DISABLE_COPY(SysfsAdaptorReader)
+    Q_DISABLE_COPY(SysfsAdaptorReactor)
 
 public:
     /**
-     * Constructor.
+     * Get the reactor. Thread is started on first use.
      *
-     * @param parent Parent object.
+     * @return reactor.
      */
-    SysfsAdaptorReader(SysfsAdaptor *parent);
+    static SysfsAdaptorReactor& instance();
 
     /**
-     * Reader thread entry-function.
+     * Destructor. Stops the thread.
      */
-    void run();
+    ~SysfsAdaptorReactor();
+
+    /**
+     * Start monitoring the open file descriptors of an adaptor.
+     *
+     * @param adaptor Adaptor with opened descriptors.
+     * @return was monitoring set up.
+     */
+    bool add(SysfsAdaptor* adaptor);
 
     /**
-     * Initiate reader stopping.
+     * Stop monitoring an adaptor. When called outside the reactor
+     * thread, returns only after any running read of the adaptor has
+     * finished, so its descriptors can be closed.
+     *
+     * @param adaptor Adaptor to remove.
      */
-    void stopReader();
+    void remove(SysfsAdaptor* adaptor);
 
     /**
-     * Initiate reader starting.
+     * Re-arm the timer of an adaptor in IntervalMode with its current
+     * interval. Does nothing for adaptors not being monitored.
+     *
+     * @param adaptor Adaptor whose interval changed.
      */
-    void startReader();
+    void reschedule(SysfsAdaptor* adaptor);
+
+    /**
+     * Snap the periods of all IntervalMode adaptors to a grid, see
+     * WakeupGrid::snapPeriod(). Does not start the reactor.
+     *
+     * @param grid Grid step in milliseconds, 0 to use exact periods.
+     */
+    static void setWakeupGrid(unsigned int grid);
+
+protected:
+    /**
+     * Reactor thread entry-function.
+     */
+    void run();
 
 private:
-    bool          running_; /**< should thread be running or not */
-    SysfsAdaptor *parent_;  /**< parent object. */
+    SysfsAdaptorReactor();
+
+    /**
+     * Monitored descriptor.
+     */
+    struct Watch
+    {
+        SysfsAdaptor* adaptor;    /**< owner */
+        int           fd;         /**< sysfs descriptor or timerfd */
+        int           index;      /**< index of sysfs descriptor, -1 for timer */
+        quint64       mutedUntil; /**< monotonic time (microsec) until which the watch is paused, 0 if active */
+    };
+
+    bool armTimer(int timerFd, unsigned int interval);
+    void dispatch(quint64 key, const Watch& watch, quint32 events);
+    bool readSample(SysfsAdaptor* adaptor, int index);
+    void mute(quint64 key, unsigned int duration);
+    int unmuteExpired();
+
+    int                     epollDescriptor_; /**< epoll set of all watches */
+    int                     eventDescriptor_; /**< eventfd waking the thread for quitting */
+    QHash<quint64, Watch>   watches_;         /**< watches by epoll key */
+    quint64                 nextKey_;         /**< key of the next watch */
+    QAtomicInt              quit_;            /**< should thread exit */
+    QMutex                  mutex_;           /**< protects watches_ */
+    QMutex                  dispatchMutex_;   /**< held while samples are read */
+
+    static QAtomicInt       wakeupGrid_;      /**< grid step in ms, 0 for none */
+    static bool             created_;         /**< has the reactor been created */
 };
 
 /**
@@ -82,7 +145,7 @@ private:
  *
  * Two different polling modes are supported:
  * <ul>
- *   <li><tt>SysfsAdaptor::IntervalMode</tt> - Read constantly by given frequency (ms delay between reads).</li>
+ *   <li><tt>SysfsAdaptor::IntervalMode</tt> - Read constantly by given frequency (ms between reads).</li>
  *   <li><tt>SysfsAdaptor::SelectMode</tt>   - Wait for interrupt from driver before reading.</li>
  * </ul>
  *
@@ -163,6 +226,16 @@ protected:
      */
     virtual void processSample(int pathId, int fd) = 0;
 
+    /**
+     * Called for each file descriptor right after it has been opened,
+     * before anything is read from it. Default implementation does
+     * nothing.
+     *
+     * @param pathId Path ID of the opened file.
+     * @param fd     Open file descriptor. Must not be closed.
+     */
+    virtual void configureDescriptor(int pathId, int fd);
+
     /**
      * Utility function for writing to files. Can be used to control
      * sensor driver parameters (setting to powersave mode etc.)
@@ -192,13 +265,13 @@ protected:
 
     /**
      * Sets the interval for the adaptor. This function is valid for
-     * adaptors using PollMode. It just sets the number of milliseconds
-     * that the adaptor will sleep between reads.
+     * adaptors using PollMode. It sets the number of milliseconds
+     * between reads and re-arms the read timer if the adaptor is running.
      *
      * For adaptors using SelectMode, reimplementation is a must as this
      * implementatino will have no effect on the behavior.
      *
-     * @param value Interval to sleep (ms) between reads
+     * @param value Interval (ms) between reads
      * @param sessionId Id of the session where the requested originated.
      *        This should be passed with any requests made from this function
      *        to allow for proper state maintenance.
@@ -229,14 +302,14 @@ private:
     void closeAllFds();
 
     /**
-     * Stop reader thread.
+     * Stop monitoring in the reactor.
      */
     void stopReaderThread();
 
     /**
-     * Start reader thread.
+     * Open descriptors and start monitoring them in the reactor.
      *
-     * @return was thread started succesfully.
+     * @return was monitoring started succesfully.
      */
     bool startReaderThread();
 
@@ -245,10 +318,7 @@ private:
      */
     bool checkIntervalUsage() const;
 
-    SysfsAdaptorReader  reader_; /**< reader thread instance */
     PollMode            mode_;   /**< used poll mode */
-    int                 epollDescriptor_;    /**< open epoll descriptors */
-    int                 pipeDescriptors_[2]; /**< open pipe descriptors */
     QStringList         paths_;   /**< added paths. */
     QList<int>          pathIds_; /**< added path IDs. */
     unsigned int interval_; /**< used interval */
@@ -259,7 +329,7 @@ private:
     QList<int> sysfsDescriptors_; /**< List of open file descriptors. */
     QMutex mutex_;          /** mutex protecting starting and stopping. */
 
-    friend class SysfsAdaptorReader;
+    friend class SysfsAdaptorReactor;
 };
 
 #endif
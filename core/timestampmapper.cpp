@@ -0,0 +1,206 @@
+/**
+   @file timestampmapper.cpp
+   @brief Mapping of sample times to the sensord clock
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "timestampmapper.h"
+#include "config.h"
+#include "datatypes/utils.h"
+#include <limits>
+
+TimestampMapper::TimestampMapper(Clock clock, bool smoothing) :
+    clock_(clock),
+    smoothing_(smoothing),
+    offsetValid_(false),
+    offset_(0),
+    offsetTime_(0),
+    windowMin_(0),
+    last_(0),
+    lastRaw_(0),
+    period_(0),
+    jitter_(0),
+    outliers_(0),
+    resyncs_(0),
+    samples_(0)
+{
+}
+
+void TimestampMapper::configure(const QString& group, Clock defaultClock, bool defaultSmoothing)
+{
+    Clock clock = defaultClock;
+    smoothing_ = defaultSmoothing;
+    SensorFrameworkConfig* config = SensorFrameworkConfig::configuration();
+    if (config) {
+        clock = clockFromName(config->value<QString>(group + "/timestamp_clock"), defaultClock);
+        smoothing_ = config->value<bool>(group + "/timestamp_smoothing", defaultSmoothing);
+    }
+    setClock(clock);
+    last_ = 0;
+    lastRaw_ = 0;
+    period_ = 0;
+    jitter_ = 0;
+    outliers_ = 0;
+}
+
+void TimestampMapper::setClock(Clock clock)
+{
+    clock_ = clock;
+    offsetValid_ = false;
+    offset_ = 0;
+}
+
+TimestampMapper::Clock TimestampMapper::clockFromName(const QString& name, Clock fallback)
+{
+    QString lower(name.trimmed().toLower());
+    if (lower == "monotonic")
+        return Monotonic;
+    if (lower == "boottime")
+        return Boottime;
+    if (lower == "realtime")
+        return Realtime;
+    if (lower == "estimated")
+        return Estimated;
+    return fallback;
+}
+
+qint64 TimestampMapper::kernelOffset(Clock clock)
+{
+    clockid_t id;
+    switch (clock) {
+#ifdef CLOCK_BOOTTIME
+    case Boottime:
+        id = CLOCK_BOOTTIME;
+        break;
+#endif
+    case Realtime:
+        id = CLOCK_REALTIME;
+        break;
+    default:
+        return 0;
+    }
+
+    // Bracket the read so that the error is half of the bracket
+    quint64 before = Utils::getTimeStampNs();
+    quint64 other = Utils::getTimeStampNs(id);
+    quint64 after = Utils::getTimeStampNs();
+    return (qint64)(before + (after - before) / 2) - (qint64)other;
+}
+
+quint64 TimestampMapper::map(quint64 eventTime, quint64 arrival)
+{
+    ++samples_;
+
+    qint64 offset = 0;
+    switch (clock_) {
+    case Monotonic:
+        break;
+    case Estimated:
+        offset = estimateOffset(eventTime, arrival);
+        break;
+    default:
+        if (!offsetValid_ || arrival - offsetTime_ >= OFFSET_REFRESH_NS) {
+            offset_ = kernelOffset(clock_);
+            offsetTime_ = arrival;
+            offsetValid_ = true;
+        }
+        offset = offset_;
+        break;
+    }
+
+    qint64 mapped = (qint64)eventTime + offset;
+    quint64 time = mapped > 0 ? (quint64)mapped : 0;
+    if (time > arrival)
+        time = arrival;
+    return track(time, arrival);
+}
+
+quint64 TimestampMapper::mapArrival(quint64 arrival)
+{
+    ++samples_;
+    return track(arrival, arrival);
+}
+
+qint64 TimestampMapper::estimateOffset(quint64 eventTime, quint64 arrival)
+{
+    if (!offsetValid_) {
+        offset_ = (qint64)arrival - (qint64)eventTime;
+        offsetTime_ = arrival;
+        offsetValid_ = true;
+        windowMin_ = 0;
+        return offset_;
+    }
+
+    qint64 delay = (qint64)arrival - ((qint64)eventTime + offset_);
+    if (delay < 0) {
+        offset_ += delay;
+        delay = 0;
+    }
+    if (delay < windowMin_)
+        windowMin_ = delay;
+
+    if (arrival - offsetTime_ >= DRIFT_WINDOW_NS) {
+        offset_ += windowMin_ / 2;
+        windowMin_ = std::numeric_limits<qint64>::max();
+        offsetTime_ = arrival;
+    }
+    return offset_;
+}
+
+quint64 TimestampMapper::track(quint64 time, quint64 arrival)
+{
+    quint64 out = time;
+
+    if (lastRaw_ && !period_) {
+        if (time > lastRaw_)
+            period_ = time - lastRaw_;
+    } else if (lastRaw_) {
+        qint64 delta = (qint64)time - (qint64)lastRaw_;
+        quint64 expected = (smoothing_ ? last_ : lastRaw_) + period_;
+        qint64 error = (qint64)time - (qint64)expected;
+        qint64 bound = period_ / 2;
+        if (error > bound || error < -bound) {
+            // Gap, burst or new rate. Follow the raw time and take the
+            // new period once it repeats.
+            ++resyncs_;
+            if (++outliers_ >= 2 && delta > 0) {
+                period_ = delta;
+                outliers_ = 0;
+            }
+        } else {
+            outliers_ = 0;
+            qint64 deviation = error < 0 ? -error : error;
+            jitter_ = (quint64)((qint64)jitter_ + (deviation - (qint64)jitter_) / 16);
+            // Mean of the intervals is unbiased whatever the jitter is
+            period_ = (quint64)((qint64)period_ + (delta - (qint64)period_) / 64);
+            // Read times are late, never early: an early sample moves
+            // the phase at once, a late one only slightly.
+            if (smoothing_ && error > 0)
+                out = expected + error / 8;
+        }
+    }
+
+    if (out > arrival)
+        out = arrival;
+    if (last_ && out <= last_)
+        out = last_ + 1;
+
+    lastRaw_ = time;
+    last_ = out;
+    return out;
+}
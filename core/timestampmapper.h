@@ -0,0 +1,211 @@
+/**
+   @file timestampmapper.h
+   @brief Mapping of sample times to the sensord clock
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef TIMESTAMPMAPPER_H
+#define TIMESTAMPMAPPER_H
+
+#include <QtGlobal>
+#include <QString>
+
+/**
+ * Maps the time of a sample, as stamped by the device, the kernel or the
+ * android hal, to CLOCK_MONOTONIC which all sensord timestamps use.
+ *
+ * The offset between the clocks is read from the kernel for the known
+ * clock domains and refreshed once a second, so suspend and realtime
+ * steps are followed. For @c Estimated it is learned from the samples:
+ * a sample can not arrive before it was taken, so the offset is the
+ * lower envelope of arrival time minus event time. Evidence of a smaller
+ * delay is applied at once, the envelope creeps up by half of the
+ * smallest delay seen in each window to follow drift.
+ *
+ * Mapped times are also tracked against the sample period, estimated
+ * as the mean interval. The mean deviation from the expected time is
+ * reported as jitter. With smoothing enabled the output advances by the
+ * period instead of following the raw stamps: it moves at once to a
+ * sample earlier than expected and only by an eighth towards a later
+ * one, as read times are delayed but never early. Gaps and rate changes
+ * resynchronize to the raw stamps. Output is strictly increasing and
+ * never later than arrival.
+ *
+ * Times are nanoseconds. Samples carry microseconds, see
+ * mapToMicroseconds(); clients asking for nanoseconds get them scaled
+ * on the data socket, see SENSORFW_WIRE_SAMPLE_NS. A mapper is used
+ * from one thread only.
+ */
+class TimestampMapper
+{
+public:
+    /**
+     * Clock domain of event times.
+     */
+    enum Clock {
+        Monotonic = 0, /**< CLOCK_MONOTONIC, no mapping needed */
+        Boottime,      /**< CLOCK_BOOTTIME, includes suspend */
+        Realtime,      /**< CLOCK_REALTIME, steps with wall clock */
+        Estimated      /**< unknown clock, offset learned from arrival times */
+    };
+
+    enum {
+        OFFSET_REFRESH_NS = 1000000000, /**< kernel offset refresh period */
+        DRIFT_WINDOW_NS = 2000000000    /**< estimated offset slew window */
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param clock Clock domain of event times.
+     * @param smoothing Correct jitter of mapped times.
+     */
+    TimestampMapper(Clock clock = Monotonic, bool smoothing = false);
+
+    /**
+     * Read "<group>/timestamp_clock" (monotonic, boottime, realtime or
+     * estimated) and "<group>/timestamp_smoothing". Forgets estimates.
+     *
+     * @param group Configuration group, usually the adaptor id.
+     * @param defaultClock Clock if not configured.
+     * @param defaultSmoothing Smoothing if not configured.
+     */
+    void configure(const QString& group, Clock defaultClock, bool defaultSmoothing);
+
+    /**
+     * Set clock domain of event times. Forgets the offset estimate.
+     *
+     * @param clock Clock domain.
+     */
+    void setClock(Clock clock);
+
+    /**
+     * Clock domain of event times.
+     */
+    Clock clock() const { return clock_; }
+
+    /**
+     * Is jitter correction enabled.
+     */
+    bool smoothing() const { return smoothing_; }
+
+    /**
+     * Map event time to CLOCK_MONOTONIC.
+     *
+     * @param eventTime Time the sample was taken, in the clock domain.
+     * @param arrival CLOCK_MONOTONIC time the sample was read.
+     * @return sample time, CLOCK_MONOTONIC nanoseconds.
+     */
+    quint64 map(quint64 eventTime, quint64 arrival);
+
+    /**
+     * Map event time and convert the result to microseconds for
+     * TimedData.
+     *
+     * @param eventTime Time the sample was taken, in the clock domain.
+     * @param arrival CLOCK_MONOTONIC time the sample was read.
+     * @return sample time, CLOCK_MONOTONIC microseconds.
+     */
+    quint64 mapToMicroseconds(quint64 eventTime, quint64 arrival)
+    {
+        return (map(eventTime, arrival) + 500) / 1000;
+    }
+
+    /**
+     * Map the read time of a sample which carries no event time. Read
+     * times are CLOCK_MONOTONIC already, so the clock domain of event
+     * times is not applied, only period tracking and smoothing.
+     *
+     * @param arrival CLOCK_MONOTONIC time the sample was read.
+     * @return sample time, CLOCK_MONOTONIC nanoseconds.
+     */
+    quint64 mapArrival(quint64 arrival);
+
+    /**
+     * Map read time and convert the result to microseconds for
+     * TimedData.
+     *
+     * @param arrival CLOCK_MONOTONIC time the sample was read.
+     * @return sample time, CLOCK_MONOTONIC microseconds.
+     */
+    quint64 mapArrivalToMicroseconds(quint64 arrival)
+    {
+        return (mapArrival(arrival) + 500) / 1000;
+    }
+
+    /**
+     * Current offset added to event times.
+     */
+    qint64 offset() const { return offset_; }
+
+    /**
+     * Estimated sample period, 0 if not known yet.
+     */
+    quint64 period() const { return period_; }
+
+    /**
+     * Mean deviation of mapped times from the expected ones.
+     */
+    quint64 jitter() const { return jitter_; }
+
+    /**
+     * Number of times the period tracking was resynchronized.
+     */
+    unsigned long resyncs() const { return resyncs_; }
+
+    /**
+     * Number of samples mapped.
+     */
+    unsigned long samples() const { return samples_; }
+
+    /**
+     * Clock domain from its configuration name.
+     *
+     * @param name Clock name.
+     * @param fallback Clock for unknown names.
+     */
+    static Clock clockFromName(const QString& name, Clock fallback);
+
+    /**
+     * Offset from a kernel clock to CLOCK_MONOTONIC, measured now.
+     *
+     * @param clock Kernel clock.
+     * @return CLOCK_MONOTONIC minus clock.
+     */
+    static qint64 kernelOffset(Clock clock);
+
+private:
+    qint64 estimateOffset(quint64 eventTime, quint64 arrival);
+    quint64 track(quint64 time, quint64 arrival);
+
+    Clock         clock_;       /**< clock domain of event times */
+    bool          smoothing_;   /**< correct jitter */
+    bool          offsetValid_; /**< offset_ has been set */
+    qint64        offset_;      /**< CLOCK_MONOTONIC minus event clock */
+    quint64       offsetTime_;  /**< arrival when offset_ was refreshed or window started */
+    qint64        windowMin_;   /**< smallest delay in current window */
+    quint64       last_;        /**< last output time */
+    quint64       lastRaw_;     /**< last mapped time before smoothing */
+    quint64       period_;      /**< estimated period */
+    quint64       jitter_;      /**< mean deviation */
+    int           outliers_;    /**< consecutive samples off the period */
+    unsigned long resyncs_;     /**< resynchronizations */
+    unsigned long samples_;     /**< samples mapped */
+};
+
+#endif // TIMESTAMPMAPPER_H
@@ -0,0 +1,262 @@
+/**
+   @file tracefile.cpp
+   @brief Binary trace files of adaptor output
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "tracefile.h"
+#include "logging.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char traceMagic[4] = { 'S', 'F', 'W', 'T' };
+
+static void copyName(char* dest, size_t size, const QString& name)
+{
+    QByteArray utf8(name.toUtf8());
+    strncpy(dest, utf8.constData(), size - 1);
+    dest[size - 1] = 0;
+}
+
+static QString readName(const char* src, size_t size)
+{
+    return QString::fromUtf8(src, strnlen(src, size));
+}
+
+/* ------------------------------------------------------------------------- *
+ * TraceWriter
+ * ------------------------------------------------------------------------- */
+
+TraceWriter::TraceWriter() :
+    fd_(-1),
+    header_(0),
+    mapSize_(0),
+    sampleSize_(0),
+    capacity_(0),
+    limit_(0),
+    dropped_(0)
+{
+}
+
+TraceWriter::~TraceWriter()
+{
+    close();
+}
+
+bool TraceWriter::open(const QString& path, const QString& type, unsigned sampleSize,
+                       const QString& adaptor, const QString& buffer, quint64 limit)
+{
+    close();
+
+    fd_ = ::open(path.toLocal8Bit().constData(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+        sensordLogW() << "Failed to create trace" << path << ":" << strerror(errno);
+        return false;
+    }
+
+    path_ = path;
+    sampleSize_ = sampleSize;
+    limit_ = limit;
+    dropped_ = 0;
+
+    // Header is written through the mapping like the samples
+    TraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, traceMagic, sizeof(header.magic));
+    header.version = TraceHeader::VERSION;
+    header.headerSize = sizeof(TraceHeader);
+    header.sampleSize = sampleSize;
+    copyName(header.type, sizeof(header.type), type);
+    copyName(header.adaptor, sizeof(header.adaptor), adaptor);
+    copyName(header.buffer, sizeof(header.buffer), buffer);
+
+    if (!grow(GROW_SAMPLES)) {
+        close();
+        return false;
+    }
+    memcpy(header_, &header, sizeof(header));
+    return true;
+}
+
+void TraceWriter::close()
+{
+    if (header_) {
+        size_t size = sizeof(TraceHeader) + header_->count * sampleSize_;
+        munmap(header_, mapSize_);
+        header_ = 0;
+        if (ftruncate(fd_, size) == -1)
+            sensordLogW() << "Failed to truncate trace" << path_ << ":" << strerror(errno);
+    }
+    if (fd_ != -1) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool TraceWriter::grow(quint64 capacity)
+{
+    size_t size = sizeof(TraceHeader) + capacity * sampleSize_;
+
+    if (ftruncate(fd_, size) == -1) {
+        sensordLogW() << "Failed to grow trace" << path_ << ":" << strerror(errno);
+        return false;
+    }
+
+    void* map = header_ ? mremap(header_, mapSize_, size, MREMAP_MAYMOVE)
+                        : mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED) {
+        sensordLogW() << "Failed to map trace" << path_ << ":" << strerror(errno);
+        return false;
+    }
+
+    header_ = static_cast<TraceHeader*>(map);
+    mapSize_ = size;
+    capacity_ = capacity;
+    return true;
+}
+
+bool TraceWriter::append(unsigned n, const void* samples)
+{
+    if (!header_)
+        return false;
+
+    quint64 count = header_->count;
+    unsigned take = n;
+    if (limit_ && count + take > limit_)
+        take = count < limit_ ? limit_ - count : 0;
+
+    if (count + take > capacity_ && !grow(qMax(capacity_ * 2, count + take + GROW_SAMPLES)))
+        take = 0;
+
+    dropped_ += n - take;
+    if (!take)
+        return false;
+
+    char* dest = reinterpret_cast<char*>(header_) + sizeof(TraceHeader) + count * sampleSize_;
+    memcpy(dest, samples, (size_t)take * sampleSize_);
+
+    // Every sample type starts with the TimedData timestamp
+    quint64 timestamp;
+    if (!count) {
+        memcpy(&timestamp, dest, sizeof(timestamp));
+        header_->first = timestamp;
+    }
+    memcpy(&timestamp, dest + (take - 1) * sampleSize_, sizeof(timestamp));
+    header_->last = timestamp;
+    header_->count = count + take;
+
+    return take == n;
+}
+
+/* ------------------------------------------------------------------------- *
+ * TraceReader
+ * ------------------------------------------------------------------------- */
+
+TraceReader::TraceReader() :
+    header_(0),
+    samples_(0),
+    mapSize_(0),
+    count_(0)
+{
+}
+
+TraceReader::~TraceReader()
+{
+    close();
+}
+
+bool TraceReader::fail(const QString& error)
+{
+    errorString_ = error;
+    close();
+    return false;
+}
+
+bool TraceReader::open(const QString& path)
+{
+    close();
+    errorString_.clear();
+
+    int fd = ::open(path.toLocal8Bit().constData(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        return fail(QString("can not open %1: %2").arg(path).arg(strerror(errno)));
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        ::close(fd);
+        return fail(QString("%1 is not a trace").arg(path));
+    }
+
+    void* map = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+        return fail(QString("can not map %1: %2").arg(path).arg(strerror(errno)));
+
+    header_ = static_cast<const TraceHeader*>(map);
+    mapSize_ = st.st_size;
+
+    if (memcmp(header_->magic, traceMagic, sizeof(traceMagic)))
+        return fail(QString("%1 is not a trace").arg(path));
+    if (header_->version != TraceHeader::VERSION)
+        return fail(QString("%1 has unsupported version %2").arg(path).arg(header_->version));
+    if (header_->headerSize < sizeof(TraceHeader) || header_->headerSize > mapSize_ ||
+        header_->sampleSize < sizeof(quint64))
+        return fail(QString("%1 has an invalid header").arg(path));
+
+    // A trace cut short is readable up to its last complete sample
+    count_ = qMin((quint64)header_->count,
+                  (quint64)(mapSize_ - header_->headerSize) / header_->sampleSize);
+    samples_ = reinterpret_cast<const char*>(header_) + header_->headerSize;
+    return true;
+}
+
+void TraceReader::close()
+{
+    if (header_)
+        munmap(const_cast<TraceHeader*>(header_), mapSize_);
+    header_ = 0;
+    samples_ = 0;
+    mapSize_ = 0;
+    count_ = 0;
+}
+
+QString TraceReader::typeName() const
+{
+    return header_ ? readName(header_->type, sizeof(header_->type)) : QString();
+}
+
+QString TraceReader::adaptor() const
+{
+    return header_ ? readName(header_->adaptor, sizeof(header_->adaptor)) : QString();
+}
+
+QString TraceReader::buffer() const
+{
+    return header_ ? readName(header_->buffer, sizeof(header_->buffer)) : QString();
+}
+
+quint64 TraceReader::timestamp(quint64 index) const
+{
+    quint64 value;
+    memcpy(&value, sample(index), sizeof(value));
+    return value;
+}
@@ -0,0 +1,192 @@
+/**
+   @file tracefile.h
+   @brief Binary trace files of adaptor output
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef TRACEFILE_H
+#define TRACEFILE_H
+
+#include <QtGlobal>
+#include <QString>
+
+/**
+ * Header at the start of a trace file. Samples follow at @c headerSize
+ * as the raw structures the adaptor wrote into its buffer, so a trace
+ * is only valid on the architecture it was recorded on. Every sample
+ * starts with the TimedData timestamp.
+ *
+ * The sample count is updated after every append, so a trace of a
+ * process which died while recording is readable up to the last sample.
+ */
+struct TraceHeader
+{
+    enum {
+        VERSION = 1
+    };
+
+    char    magic[4];     /**< "SFWT" */
+    quint32 version;      /**< format version */
+    quint32 headerSize;   /**< offset of the first sample */
+    quint32 sampleSize;   /**< size of one sample */
+    quint64 count;        /**< number of samples */
+    quint64 first;        /**< timestamp of the first sample, us */
+    quint64 last;         /**< timestamp of the last sample, us */
+    char    type[32];     /**< sample type name */
+    char    adaptor[64];  /**< id of the recorded adaptor */
+    char    buffer[64];   /**< name of the recorded buffer */
+};
+
+/**
+ * Appends samples to a memory mapped trace file. The file grows in
+ * steps, appending is a copy into the mapping.
+ */
+class TraceWriter
+{
+public:
+    enum {
+        GROW_SAMPLES = 4096 /**< initial capacity and minimum growth */
+    };
+
+    TraceWriter();
+    ~TraceWriter();
+
+    /**
+     * Create or truncate trace file.
+     *
+     * @param path File path.
+     * @param type Sample type name.
+     * @param sampleSize Size of one sample.
+     * @param adaptor Adaptor id.
+     * @param buffer Buffer name.
+     * @param limit Maximum number of samples, 0 for no limit.
+     * @return was the file created.
+     */
+    bool open(const QString& path, const QString& type, unsigned sampleSize,
+              const QString& adaptor, const QString& buffer, quint64 limit = 0);
+
+    /**
+     * Truncate the file to its contents and unmap it.
+     */
+    void close();
+
+    bool isOpen() const { return header_ != 0; }
+
+    /**
+     * Append samples. Samples beyond the limit are dropped.
+     *
+     * @param n Number of samples.
+     * @param samples Samples of the size given to open().
+     * @return false if some samples were dropped.
+     */
+    bool append(unsigned n, const void* samples);
+
+    /**
+     * Number of samples written.
+     */
+    quint64 count() const { return header_ ? header_->count : 0; }
+
+    /**
+     * Number of samples dropped because of the limit or an error.
+     */
+    quint64 dropped() const { return dropped_; }
+
+private:
+    Q_DISABLE_COPY(TraceWriter)
+
+    bool grow(quint64 capacity);
+
+    int          fd_;         /**< file */
+    TraceHeader* header_;     /**< mapping, header first */
+    size_t       mapSize_;    /**< size of mapping */
+    unsigned     sampleSize_; /**< size of one sample */
+    quint64      capacity_;   /**< samples which fit into the mapping */
+    quint64      limit_;      /**< maximum number of samples */
+    quint64      dropped_;    /**< samples not written */
+    QString      path_;       /**< file path */
+};
+
+/**
+ * Read-only memory mapped trace file.
+ */
+class TraceReader
+{
+public:
+    TraceReader();
+    ~TraceReader();
+
+    /**
+     * Map and validate trace file.
+     *
+     * @param path File path.
+     * @return is the trace valid.
+     */
+    bool open(const QString& path);
+
+    /**
+     * Unmap the file.
+     */
+    void close();
+
+    bool isOpen() const { return header_ != 0; }
+
+    /**
+     * Why open() failed.
+     */
+    const QString& errorString() const { return errorString_; }
+
+    quint64  count() const { return count_; }
+    unsigned sampleSize() const { return header_ ? header_->sampleSize : 0; }
+    quint64  firstTimestamp() const { return header_ ? header_->first : 0; }
+    quint64  lastTimestamp() const { return header_ ? header_->last : 0; }
+    QString  typeName() const;
+    QString  adaptor() const;
+    QString  buffer() const;
+
+    /**
+     * Samples, count() of them back to back.
+     */
+    const char* samples() const { return samples_; }
+
+    /**
+     * Sample at given index.
+     *
+     * @param index Index below count().
+     */
+    const char* sample(quint64 index) const { return samples_ + index * header_->sampleSize; }
+
+    /**
+     * Timestamp of sample at given index.
+     *
+     * @param index Index below count().
+     */
+    quint64 timestamp(quint64 index) const;
+
+private:
+    Q_DISABLE_COPY(TraceReader)
+
+    bool fail(const QString& error);
+
+    const TraceHeader* header_;      /**< mapping, header first */
+    const char*        samples_;     /**< first sample */
+    size_t             mapSize_;     /**< size of mapping */
+    quint64            count_;       /**< samples present in the file */
+    QString            errorString_; /**< reason of last failure */
+};
+
+#endif // TRACEFILE_H
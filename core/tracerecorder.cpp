@@ -0,0 +1,179 @@
+/**
+   @file tracerecorder.cpp
+   @brief Recording and replay of adaptor buffers
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "tracerecorder.h"
+#include "deviceadaptorringbuffer.h"
+#include "logging.h"
+#include "datatypes/orientationdata.h"
+#include "datatypes/posedata.h"
+#include "datatypes/liddata.h"
+#include "datatypes/tapdata.h"
+#include "datatypes/touchdata.h"
+#include <string.h>
+
+static bool sameSample(const TimedXyzData& a, const TimedXyzData& b)
+{
+    return a.timestamp_ == b.timestamp_ && a.x_ == b.x_ && a.y_ == b.y_ && a.z_ == b.z_;
+}
+
+static bool sameSample(const CalibratedMagneticFieldData& a, const CalibratedMagneticFieldData& b)
+{
+    return a.timestamp_ == b.timestamp_ && a.x_ == b.x_ && a.y_ == b.y_ && a.z_ == b.z_ &&
+           a.rx_ == b.rx_ && a.ry_ == b.ry_ && a.rz_ == b.rz_ && a.level_ == b.level_;
+}
+
+static bool sameSample(const CompassData& a, const CompassData& b)
+{
+    return a.timestamp_ == b.timestamp_ && a.degrees_ == b.degrees_ && a.rawDegrees_ == b.rawDegrees_ &&
+           a.correctedDegrees_ == b.correctedDegrees_ && a.level_ == b.level_;
+}
+
+static bool sameSample(const TimedUnsigned& a, const TimedUnsigned& b)
+{
+    return a.timestamp_ == b.timestamp_ && a.value_ == b.value_;
+}
+
+static bool sameSample(const ProximityData& a, const ProximityData& b)
+{
+    return sameSample(static_cast<const TimedUnsigned&>(a), static_cast<const TimedUnsigned&>(b)) &&
+           a.withinProximity_ == b.withinProximity_;
+}
+
+static bool sameSample(const PoseData& a, const PoseData& b)
+{
+    return a.timestamp_ == b.timestamp_ && a.orientation_ == b.orientation_;
+}
+
+static bool sameSample(const LidData& a, const LidData& b)
+{
+    return a.timestamp_ == b.timestamp_ && a.type_ == b.type_ && a.value_ == b.value_;
+}
+
+static bool sameSample(const TapData& a, const TapData& b)
+{
+    return a.timestamp_ == b.timestamp_ && a.direction_ == b.direction_ && a.type_ == b.type_;
+}
+
+static bool sameSample(const TouchData& a, const TouchData& b)
+{
+    return sameSample(static_cast<const TimedXyzData&>(a), static_cast<const TimedXyzData&>(b)) &&
+           a.object_ == b.object_ && a.state_ == b.state_;
+}
+
+template <class TYPE>
+struct TraceTypeOps
+{
+    static bool matches(RingBufferBase* buffer)
+    {
+        return dynamic_cast<RingBuffer<TYPE>*>(buffer) != 0;
+    }
+
+    static RingBufferReaderBase* createRecorder(TraceWriter* writer)
+    {
+        return new TraceRecorder<TYPE>(writer);
+    }
+
+    static RingBufferBase* createBuffer(unsigned size)
+    {
+        return new DeviceAdaptorRingBuffer<TYPE>(size);
+    }
+
+    static void replay(RingBufferBase* buffer, const char* samples, unsigned n, qint64 shift)
+    {
+        DeviceAdaptorRingBuffer<TYPE>* typed = static_cast<DeviceAdaptorRingBuffer<TYPE>*>(buffer);
+        for (unsigned i = 0; i < n; ++i) {
+            TYPE* slot = typed->nextSlot();
+            memcpy(static_cast<void*>(slot), samples + i * sizeof(TYPE), sizeof(TYPE));
+            slot->timestamp_ += shift;
+            typed->commit();
+        }
+        typed->wakeUpReaders();
+    }
+
+    static bool equal(const char* a, const char* b)
+    {
+        // Trace samples need not be aligned
+        TYPE first;
+        TYPE second;
+        memcpy(static_cast<void*>(&first), a, sizeof(TYPE));
+        memcpy(static_cast<void*>(&second), b, sizeof(TYPE));
+        return sameSample(first, second);
+    }
+};
+
+#define TRACE_TYPE(TYPE) \
+    { #TYPE, sizeof(TYPE), TraceTypeOps<TYPE>::matches, TraceTypeOps<TYPE>::createRecorder, \
+      TraceTypeOps<TYPE>::createBuffer, TraceTypeOps<TYPE>::replay, TraceTypeOps<TYPE>::equal }
+
+static const TraceType traceTypes[] = {
+    TRACE_TYPE(TimedXyzData),
+    TRACE_TYPE(CalibratedMagneticFieldData),
+    TRACE_TYPE(CompassData),
+    TRACE_TYPE(TimedUnsigned),
+    TRACE_TYPE(ProximityData),
+    TRACE_TYPE(PoseData),
+    TRACE_TYPE(LidData),
+    TRACE_TYPE(TapData),
+    TRACE_TYPE(TouchData),
+};
+
+const TraceType* TraceType::find(const QString& name)
+{
+    for (size_t i = 0; i < sizeof(traceTypes) / sizeof(traceTypes[0]); ++i) {
+        if (name == traceTypes[i].name)
+            return &traceTypes[i];
+    }
+    return 0;
+}
+
+const TraceType* TraceType::find(RingBufferBase* buffer)
+{
+    for (size_t i = 0; i < sizeof(traceTypes) / sizeof(traceTypes[0]); ++i) {
+        if (traceTypes[i].matches(buffer))
+            return &traceTypes[i];
+    }
+    return 0;
+}
+
+RingBufferReaderBase* TraceType::record(RingBufferBase* buffer, const QString& path,
+                                        const QString& adaptor, const QString& bufferName,
+                                        quint64 limit)
+{
+    const TraceType* type = find(buffer);
+    if (!type) {
+        sensordLogW() << "Buffer" << bufferName << "of" << adaptor << "can not be recorded";
+        return 0;
+    }
+
+    TraceWriter* writer = new TraceWriter;
+    if (!writer->open(path, type->name, type->sampleSize, adaptor, bufferName, limit)) {
+        delete writer;
+        return 0;
+    }
+
+    RingBufferReaderBase* recorder = type->createRecorder(writer);
+    if (!buffer->join(recorder)) {
+        delete static_cast<Pusher*>(recorder);
+        return 0;
+    }
+    sensordLogD() << "Recording" << adaptor << bufferName << "to" << path;
+    return recorder;
+}
@@ -0,0 +1,146 @@
+/**
+   @file tracerecorder.h
+   @brief Recording and replay of adaptor buffers
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include "ringbuffer.h"
+#include "tracefile.h"
+
+/**
+ * Buffer reader appending everything written into the buffer to a
+ * trace file. Runs on the writer thread from the wakeup, so recording
+ * costs a copy into the file mapping per sample and never blocks on
+ * the disk.
+ *
+ * @tparam TYPE Data type of entries in the buffer.
+ */
+template <class TYPE>
+class TraceRecorder : public RingBufferReader<TYPE>
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param writer Open trace file. Owned by the recorder.
+     */
+    TraceRecorder(TraceWriter* writer) :
+        writer_(writer)
+    {
+    }
+
+    ~TraceRecorder()
+    {
+        delete writer_;
+    }
+
+    void pushNewData()
+    {
+        RingBufferSpan<const TYPE> span;
+        while ((span = this->readContiguous(~0u)).size) {
+            writer_->append(span.size, span.data);
+            this->consume(span.size);
+        }
+    }
+
+    /**
+     * Trace file written.
+     */
+    const TraceWriter& writer() const { return *writer_; }
+
+private:
+    TraceWriter* writer_; /**< trace file */
+};
+
+/**
+ * Sample type which can be recorded and replayed. Buffers are
+ * templates, so traces identify their type by name and the operations
+ * on buffers of that type are looked up here.
+ */
+struct TraceType
+{
+    const char* name;       /**< type name stored in traces */
+    unsigned    sampleSize; /**< size of one sample */
+
+    /**
+     * Is the buffer of this type.
+     */
+    bool (*matches)(RingBufferBase* buffer);
+
+    /**
+     * New recorder of this type writing into given trace.
+     */
+    RingBufferReaderBase* (*createRecorder)(TraceWriter* writer);
+
+    /**
+     * New DeviceAdaptorRingBuffer of this type.
+     */
+    RingBufferBase* (*createBuffer)(unsigned size);
+
+    /**
+     * Write samples into a buffer of this type and wake up its readers.
+     *
+     * @param buffer Buffer created with createBuffer().
+     * @param samples Samples as stored in a trace.
+     * @param n Number of samples, at most the buffer capacity.
+     * @param shift Added to the timestamps, us.
+     */
+    void (*replay)(RingBufferBase* buffer, const char* samples, unsigned n, qint64 shift);
+
+    /**
+     * Are two samples as stored in traces equal. Fields are compared,
+     * padding bytes of the samples are indeterminate.
+     */
+    bool (*equal)(const char* a, const char* b);
+
+    /**
+     * Type of given name.
+     *
+     * @param name Type name.
+     * @return type or NULL if not known.
+     */
+    static const TraceType* find(const QString& name);
+
+    /**
+     * Type of given buffer.
+     *
+     * @param buffer Buffer.
+     * @return type or NULL if the buffer can not be recorded.
+     */
+    static const TraceType* find(RingBufferBase* buffer);
+
+    /**
+     * Start recording a buffer. The returned reader is joined to the
+     * buffer; unjoin it and delete it as a Pusher to stop.
+     *
+     * @param buffer Buffer to record.
+     * @param path Trace file to create.
+     * @param adaptor Adaptor id stored in the trace.
+     * @param bufferName Buffer name stored in the trace.
+     * @param limit Maximum number of samples, 0 for no limit.
+     * @return recorder or NULL on failure.
+     */
+    static RingBufferReaderBase* record(RingBufferBase* buffer, const QString& path,
+                                        const QString& adaptor, const QString& bufferName,
+                                        quint64 limit = 0);
+};
+
+#endif // TRACERECORDER_H
@@ -0,0 +1,67 @@
+/**
+   @file wakeupgrid.cpp
+   @brief Alignment of periodic wakeups
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "wakeupgrid.h"
+#include "logging.h"
+#include <sys/timerfd.h>
+#include <time.h>
+#include <errno.h>
+#include <string.h>
+
+unsigned int WakeupGrid::snapPeriod(unsigned int period, unsigned int grid)
+{
+    if (!grid || !period)
+        return period;
+    if (period >= grid)
+        return (period + grid - 1) / grid * grid;
+
+    // Largest subdivision count that still gives at least the requested
+    // period and divides the step evenly, so subdivisions stay on the grid
+    unsigned int parts = grid / period;
+    while (grid % parts)
+        --parts;
+    return grid / parts;
+}
+
+bool WakeupGrid::armTimer(int timerFd, unsigned int period)
+{
+    const qint64 NSEC_PER_SEC = 1000000000LL;
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+
+    if (period) {
+        const qint64 step = period * 1000000LL;
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        const qint64 next = ((now.tv_sec * NSEC_PER_SEC + now.tv_nsec) / step + 1) * step;
+
+        spec.it_value.tv_sec = next / NSEC_PER_SEC;
+        spec.it_value.tv_nsec = next % NSEC_PER_SEC;
+        spec.it_interval.tv_sec = step / NSEC_PER_SEC;
+        spec.it_interval.tv_nsec = step % NSEC_PER_SEC;
+    }
+
+    if (timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, 0) == -1) {
+        sensordLogW() << "timerfd_settime(): " << strerror(errno);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,70 @@
+/**
+   @file wakeupgrid.h
+   @brief Alignment of periodic wakeups
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef WAKEUPGRID_H
+#define WAKEUPGRID_H
+
+#include <QtGlobal>
+
+/**
+ * Helpers for timers which expire on a common grid. A timer with period
+ * P expires at multiples of P on the monotonic clock, so timers whose
+ * periods divide each other wake the CPU at the same instants.
+ *
+ * While the display is blanked sensord snaps polling and delivery
+ * periods to a grid with snapPeriod(), so every wakeup falls on a grid
+ * tick or an even subdivision of it. Covered are the polling timers of
+ * SysfsAdaptorReactor, the delay and batch latency programmed into
+ * android hals, the sample queue drain and buffered session writes.
+ * Evdev and buffered IIO devices run at their kernel configured rates;
+ * their samples are still only delivered on grid ticks. The grid timer
+ * itself only runs while sessions are running or deliveries wait for
+ * a tick.
+ */
+class WakeupGrid
+{
+public:
+    /**
+     * Round a period to the grid. Periods of at least one grid step are
+     * rounded up to a multiple of the step, shorter ones up to the
+     * nearest even subdivision of the step. The result is never shorter
+     * than the requested period. Grids which the period does not divide
+     * are subdivided by their largest divisor that fits. A period of 0
+     * is returned as is.
+     *
+     * @param period Requested period in milliseconds.
+     * @param grid Grid step in milliseconds, 0 for no grid.
+     * @return period to use in milliseconds.
+     */
+    static unsigned int snapPeriod(unsigned int period, unsigned int grid);
+
+    /**
+     * Arm a timerfd to expire periodically at multiples of the period on
+     * CLOCK_MONOTONIC.
+     *
+     * @param timerFd Descriptor from timerfd_create(CLOCK_MONOTONIC).
+     * @param period Period in milliseconds. 0 disarms the timer.
+     * @return was the timer set.
+     */
+    static bool armTimer(int timerFd, unsigned int period);
+};
+
+#endif // WAKEUPGRID_H
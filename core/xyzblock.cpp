@@ -0,0 +1,156 @@
+/**
+   @file xyzblock.cpp
+   @brief Structure-of-arrays sample blocks and vector kernels
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "xyzblock.h"
+
+#if !defined(SENSORFW_NO_SIMD) && defined(__SSE2__)
+#define XYZ_SSE2
+#include <emmintrin.h>
+#elif !defined(SENSORFW_NO_SIMD) && defined(__aarch64__)
+#define XYZ_NEON
+#include <arm_neon.h>
+#endif
+
+void XyzKernels::transform(const double matrix[3][3], unsigned n,
+                           const int* x, const int* y, const int* z,
+                           int* outX, int* outY, int* outZ)
+{
+    unsigned i = 0;
+
+#if defined(XYZ_SSE2)
+    const __m128d m00 = _mm_set1_pd(matrix[0][0]);
+    const __m128d m01 = _mm_set1_pd(matrix[0][1]);
+    const __m128d m02 = _mm_set1_pd(matrix[0][2]);
+    const __m128d m10 = _mm_set1_pd(matrix[1][0]);
+    const __m128d m11 = _mm_set1_pd(matrix[1][1]);
+    const __m128d m12 = _mm_set1_pd(matrix[1][2]);
+    const __m128d m20 = _mm_set1_pd(matrix[2][0]);
+    const __m128d m21 = _mm_set1_pd(matrix[2][1]);
+    const __m128d m22 = _mm_set1_pd(matrix[2][2]);
+
+    for (; i + 2 <= n; i += 2) {
+        __m128d vx = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(x + i)));
+        __m128d vy = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(y + i)));
+        __m128d vz = _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(z + i)));
+
+        __m128d rx = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m00, vx), _mm_mul_pd(m01, vy)), _mm_mul_pd(m02, vz));
+        __m128d ry = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m10, vx), _mm_mul_pd(m11, vy)), _mm_mul_pd(m12, vz));
+        __m128d rz = _mm_add_pd(_mm_add_pd(_mm_mul_pd(m20, vx), _mm_mul_pd(m21, vy)), _mm_mul_pd(m22, vz));
+
+        _mm_storel_epi64((__m128i*)(outX + i), _mm_cvttpd_epi32(rx));
+        _mm_storel_epi64((__m128i*)(outY + i), _mm_cvttpd_epi32(ry));
+        _mm_storel_epi64((__m128i*)(outZ + i), _mm_cvttpd_epi32(rz));
+    }
+#elif defined(XYZ_NEON)
+    const float64x2_t m00 = vdupq_n_f64(matrix[0][0]);
+    const float64x2_t m01 = vdupq_n_f64(matrix[0][1]);
+    const float64x2_t m02 = vdupq_n_f64(matrix[0][2]);
+    const float64x2_t m10 = vdupq_n_f64(matrix[1][0]);
+    const float64x2_t m11 = vdupq_n_f64(matrix[1][1]);
+    const float64x2_t m12 = vdupq_n_f64(matrix[1][2]);
+    const float64x2_t m20 = vdupq_n_f64(matrix[2][0]);
+    const float64x2_t m21 = vdupq_n_f64(matrix[2][1]);
+    const float64x2_t m22 = vdupq_n_f64(matrix[2][2]);
+
+    for (; i + 2 <= n; i += 2) {
+        float64x2_t vx = vcvtq_f64_s64(vmovl_s32(vld1_s32(x + i)));
+        float64x2_t vy = vcvtq_f64_s64(vmovl_s32(vld1_s32(y + i)));
+        float64x2_t vz = vcvtq_f64_s64(vmovl_s32(vld1_s32(z + i)));
+
+        // Separate multiply and add keep rounding identical to scalar code
+        float64x2_t rx = vaddq_f64(vaddq_f64(vmulq_f64(m00, vx), vmulq_f64(m01, vy)), vmulq_f64(m02, vz));
+        float64x2_t ry = vaddq_f64(vaddq_f64(vmulq_f64(m10, vx), vmulq_f64(m11, vy)), vmulq_f64(m12, vz));
+        float64x2_t rz = vaddq_f64(vaddq_f64(vmulq_f64(m20, vx), vmulq_f64(m21, vy)), vmulq_f64(m22, vz));
+
+        vst1_s32(outX + i, vmovn_s64(vcvtq_s64_f64(rx)));
+        vst1_s32(outY + i, vmovn_s64(vcvtq_s64_f64(ry)));
+        vst1_s32(outZ + i, vmovn_s64(vcvtq_s64_f64(rz)));
+    }
+#endif
+
+    for (; i < n; ++i) {
+        int tx = matrix[0][0] * x[i] + matrix[0][1] * y[i] + matrix[0][2] * z[i];
+        int ty = matrix[1][0] * x[i] + matrix[1][1] * y[i] + matrix[1][2] * z[i];
+        int tz = matrix[2][0] * x[i] + matrix[2][1] * y[i] + matrix[2][2] * z[i];
+        outX[i] = tx;
+        outY[i] = ty;
+        outZ[i] = tz;
+    }
+}
+
+void XyzKernels::sum(unsigned n, const int* x, const int* y, const int* z, qint64 result[3])
+{
+    unsigned i = 0;
+    qint64 sx = 0;
+    qint64 sy = 0;
+    qint64 sz = 0;
+
+#if defined(XYZ_SSE2)
+    // SSE2 lacks a widening add, doubles hold the sums exactly instead
+    __m128d ax = _mm_setzero_pd();
+    __m128d ay = _mm_setzero_pd();
+    __m128d az = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2) {
+        ax = _mm_add_pd(ax, _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(x + i))));
+        ay = _mm_add_pd(ay, _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(y + i))));
+        az = _mm_add_pd(az, _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*)(z + i))));
+    }
+    double lanes[2];
+    _mm_storeu_pd(lanes, ax);
+    sx = (qint64)lanes[0] + (qint64)lanes[1];
+    _mm_storeu_pd(lanes, ay);
+    sy = (qint64)lanes[0] + (qint64)lanes[1];
+    _mm_storeu_pd(lanes, az);
+    sz = (qint64)lanes[0] + (qint64)lanes[1];
+#elif defined(XYZ_NEON)
+    int64x2_t ax = vdupq_n_s64(0);
+    int64x2_t ay = vdupq_n_s64(0);
+    int64x2_t az = vdupq_n_s64(0);
+    for (; i + 4 <= n; i += 4) {
+        ax = vpadalq_s32(ax, vld1q_s32(x + i));
+        ay = vpadalq_s32(ay, vld1q_s32(y + i));
+        az = vpadalq_s32(az, vld1q_s32(z + i));
+    }
+    sx = vaddvq_s64(ax);
+    sy = vaddvq_s64(ay);
+    sz = vaddvq_s64(az);
+#endif
+
+    for (; i < n; ++i) {
+        sx += x[i];
+        sy += y[i];
+        sz += z[i];
+    }
+    result[0] = sx;
+    result[1] = sy;
+    result[2] = sz;
+}
+
+const char* XyzKernels::instructionSet()
+{
+#if defined(XYZ_SSE2)
+    return "sse2";
+#elif defined(XYZ_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
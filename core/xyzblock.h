@@ -0,0 +1,129 @@
+/**
+   @file xyzblock.h
+   @brief Structure-of-arrays sample blocks and vector kernels
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef XYZBLOCK_H
+#define XYZBLOCK_H
+
+#include <QtGlobal>
+#include "genericdata.h"
+
+/**
+ * Block of up to CAPACITY TimedXyzData samples stored as separate
+ * arrays per axis, so that kernels can process several samples with
+ * one instruction.
+ */
+class XyzBlock
+{
+public:
+    /**
+     * Largest number of samples in a block.
+     */
+    enum { CAPACITY = 64 };
+
+    XyzBlock() : size(0) {}
+
+    /**
+     * Fill block from samples.
+     *
+     * @param n Number of samples, at most CAPACITY.
+     * @param data Samples.
+     */
+    template <class TYPE>
+    void load(unsigned n, const TYPE* data)
+    {
+        size = n;
+        for (unsigned i = 0; i < n; ++i) {
+            timestamp[i] = data[i].timestamp_;
+            x[i] = data[i].x_;
+            y[i] = data[i].y_;
+            z[i] = data[i].z_;
+        }
+    }
+
+    /**
+     * Write block contents into samples.
+     *
+     * @param data Destination for size samples.
+     */
+    template <class TYPE>
+    void store(TYPE* data) const
+    {
+        for (unsigned i = 0; i < size; ++i) {
+            data[i].timestamp_ = timestamp[i];
+            data[i].x_ = x[i];
+            data[i].y_ = y[i];
+            data[i].z_ = z[i];
+        }
+    }
+
+    unsigned size;                   /**< samples in block */
+    quint64  timestamp[CAPACITY];    /**< sample timestamps */
+    int      x[CAPACITY];            /**< X values */
+    int      y[CAPACITY];            /**< Y values */
+    int      z[CAPACITY];            /**< Z values */
+};
+
+/**
+ * Kernels working on structure-of-arrays data. SSE2 is used on x86 and
+ * NEON on AArch64 unless SENSORFW_NO_SIMD is defined; other targets use
+ * plain loops. Arithmetic is done in double precision with separately
+ * rounded multiplies and adds; the tree is built with -ffp-contract=off
+ * so plain loops are not fused into FMA either, and all paths give
+ * identical results.
+ */
+class XyzKernels
+{
+public:
+    /**
+     * Multiply vectors with 3x3 matrix, truncating results to integers.
+     * Output arrays may be the input arrays.
+     *
+     * @param matrix Row major transformation matrix.
+     * @param n Number of vectors.
+     * @param x X values.
+     * @param y Y values.
+     * @param z Z values.
+     * @param outX Transformed X values.
+     * @param outY Transformed Y values.
+     * @param outZ Transformed Z values.
+     */
+    static void transform(const double matrix[3][3], unsigned n,
+                          const int* x, const int* y, const int* z,
+                          int* outX, int* outY, int* outZ);
+
+    /**
+     * Sum values of each axis.
+     *
+     * @param n Number of vectors.
+     * @param x X values.
+     * @param y Y values.
+     * @param z Z values.
+     * @param result Sums of X, Y and Z.
+     */
+    static void sum(unsigned n, const int* x, const int* y, const int* z, qint64 result[3]);
+
+    /**
+     * Name of the instruction set used by the kernels.
+     */
+    static const char* instructionSet();
+};
+
+#endif // XYZBLOCK_H
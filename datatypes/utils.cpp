@@ -78,3 +78,21 @@ quint64 Utils::getTimeStamp(const struct timeval *tp)
     data = tp->tv_usec + data;
     return data;
 }
+
+quint64 Utils::getTimeStampNs(clockid_t clock)
+{
+    timespec stamp;
+    clock_gettime(clock, &stamp);
+    quint64 data = stamp.tv_sec;
+    data = data * 1000000000;
+    data = stamp.tv_nsec + data;
+    return data;
+}
+
+quint64 Utils::getTimeStampNs(const struct timeval *tp)
+{
+    quint64 data = tp->tv_sec;
+    data = data * 1000000000;
+    data = tp->tv_usec * 1000ULL + data;
+    return data;
+}
@@ -28,6 +28,7 @@
 #ifndef UTILS_H
 #define UTILS_H
 #include <sys/time.h>
+#include <time.h>
 
 /**
  * Collection of static utility functions.
@@ -48,6 +49,21 @@ public:
      * @return timestamp.
      */
     static quint64 getTimeStamp(const struct timeval*);
+
+    /**
+     * Get time of given clock in nanosecs.
+     *
+     * @param clock Clock to read, CLOCK_MONOTONIC by default.
+     * @return timestamp.
+     */
+    static quint64 getTimeStampNs(clockid_t clock = CLOCK_MONOTONIC);
+
+    /**
+     * Convert given timeval struct into nanosecs.
+     *
+     * @return timestamp.
+     */
+    static quint64 getTimeStampNs(const struct timeval*);
 };
 
 #endif // UTILS_H
@@ -25,26 +25,39 @@
 AvgAccFilter::AvgAccFilter() :
     Filter<TimedXyzData, AvgAccFilter, TimedXyzData>(this, &AvgAccFilter::interpret),
     avgAccdata(0,0,0,0),
-    filterFactor(0.54)
+    filterFactor(0.54),
+    averageX(0),
+    averageY(0),
+    averageZ(0)
 {
 }
 
-void AvgAccFilter::interpret(unsigned, const TimedXyzData *data)
+void AvgAccFilter::interpret(unsigned n, const TimedXyzData *data)
 {
-    avgAccdata.x_ = data->x_ * filterFactor + averageX * (1.0f - filterFactor);
-    avgAccdata.y_ = data->y_ * filterFactor + averageY * (1.0f - filterFactor);
-    avgAccdata.z_ = data->z_ * filterFactor + averageZ * (1.0f - filterFactor);
+    // Each output depends on the previous one, so samples are handled
+    // in order and only the propagation is batched.
+    while (n) {
+        unsigned count = qMin(n, (unsigned)XyzBlock::CAPACITY);
 
-    TimedXyzData filteredData(data->timestamp_,
-                              avgAccdata.x_,
-                              avgAccdata.y_,
-                              avgAccdata.z_);
+        for (unsigned i = 0; i < count; ++i) {
+            avgAccdata.x_ = data[i].x_ * filterFactor + averageX * (1.0f - filterFactor);
+            avgAccdata.y_ = data[i].y_ * filterFactor + averageY * (1.0f - filterFactor);
+            avgAccdata.z_ = data[i].z_ * filterFactor + averageZ * (1.0f - filterFactor);
 
-    source_.propagate(1, &filteredData);
+            output[i] = TimedXyzData(data[i].timestamp_,
+                                     avgAccdata.x_,
+                                     avgAccdata.y_,
+                                     avgAccdata.z_);
 
-    averageX = avgAccdata.x_;
-    averageY = avgAccdata.y_;
-    averageZ = avgAccdata.z_;
+            averageX = avgAccdata.x_;
+            averageY = avgAccdata.y_;
+            averageZ = avgAccdata.z_;
+        }
+
+        source_.propagate(count, output);
+        data += count;
+        n -= count;
+    }
 }
 
 void AvgAccFilter::reset()
@@ -25,10 +25,12 @@
 
 #include "orientationdata.h"
 #include "filter.h"
+#include "xyzblock.h"
 
 class AvgAccFilter : public QObject, public Filter<TimedXyzData, AvgAccFilter, TimedXyzData>
 {
     Q_OBJECT
+    Q_PROPERTY(qreal factor READ factor WRITE setFactor)
 
 public:
     static FilterBase* factoryMethod()
@@ -44,7 +46,7 @@ private:
 
     AvgAccFilter();
 
-    void interpret(unsigned, const TimedXyzData*);
+    void interpret(unsigned n, const TimedXyzData* data);
 
     typedef QList<TimedXyzData> XyzAvgAccBuffer;
 
@@ -59,6 +61,8 @@ private:
 
     QList<TimedXyzData> avgAccelBuffer;
 
+    TimedXyzData output[XyzBlock::CAPACITY];
+
 };
 
 #endif // ROTATIONFILTER_H
@@ -31,15 +31,19 @@ CoordinateAlignFilter::CoordinateAlignFilter() :
 {
 }
 
-void CoordinateAlignFilter::filter(unsigned, const TimedXyzData* data)
+void CoordinateAlignFilter::filter(unsigned n, const TimedXyzData* data)
 {
-    TimedXyzData transformed;
-
-    transformed.timestamp_ = data->timestamp_;
-
-    transformed.x_ = matrix_.get(0,0)*data->x_ + matrix_.get(0,1)*data->y_ + matrix_.get(0,2)*data->z_;
-    transformed.y_ = matrix_.get(1,0)*data->x_ + matrix_.get(1,1)*data->y_ + matrix_.get(1,2)*data->z_;
-    transformed.z_ = matrix_.get(2,0)*data->x_ + matrix_.get(2,1)*data->y_ + matrix_.get(2,2)*data->z_;
-
-    source_.propagate(1, &transformed);
+    while (n) {
+        unsigned count = qMin(n, (unsigned)XyzBlock::CAPACITY);
+
+        block_.load(count, data);
+        XyzKernels::transform(matrix_.data_, count,
+                              block_.x, block_.y, block_.z,
+                              block_.x, block_.y, block_.z);
+        block_.store(output_);
+
+        source_.propagate(count, output_);
+        data += count;
+        n -= count;
+    }
 }
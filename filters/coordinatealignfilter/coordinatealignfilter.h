@@ -29,6 +29,8 @@
 
 #include "datatypes/orientationdata.h"
 #include "filter.h"
+#include "xyzblock.h"
+#include "parameterparser.h"
 
 /**
  * TMatrix holds a transformation matrix.
@@ -60,6 +62,16 @@ public:
         memcpy(data_, m, sizeof(double[DIM][DIM]));
     }
 
+    /**
+     * Parse matrix from nine comma separated cells in row order.
+     * Malformed strings give the identity matrix.
+     */
+    static TMatrix fromString(const QString& str) {
+        TMatrix matrix;
+        ParameterParser::parseMatrix(str, matrix.data_);
+        return matrix;
+    }
+
     double data_[DIM][DIM];
 };
 Q_DECLARE_METATYPE(TMatrix);
@@ -97,9 +109,11 @@ protected:
     CoordinateAlignFilter();
 
 private:
-    void filter(unsigned, const TimedXyzData*);
+    void filter(unsigned n, const TimedXyzData* data);
 
     TMatrix matrix_;
+    XyzBlock block_;                            /**< samples being transformed */
+    TimedXyzData output_[XyzBlock::CAPACITY];   /**< transformed samples */
 };
 
 #endif // COORDINATEALIGNFILTER_H
@@ -33,6 +33,10 @@ void CoordinateAlignFilterPlugin::Register(class Loader&)
     sensordLogD() << "registering coordinatealignfilter";
     SensorManager& sm = SensorManager::instance();
     sm.registerFilter<CoordinateAlignFilter>("coordinatealignfilter");
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+    // Lets configured pipelines set transMatrix from a string
+    QMetaType::registerConverter<QString, TMatrix>(TMatrix::fromString);
+#endif
 }
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
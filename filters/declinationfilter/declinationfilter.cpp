@@ -41,27 +41,30 @@ DeclinationFilter::DeclinationFilter() :
     loadSettings();
 }
 
-void DeclinationFilter::correct(unsigned, const CompassData* data)
+void DeclinationFilter::correct(unsigned n, const CompassData* data)
 {
-    CompassData newOrientation(*data);
-    if (newOrientation.timestamp_ - lastUpdate_ > updateInterval_) {
-        loadSettings();
-        lastUpdate_ = newOrientation.timestamp_;
-    }
+    // Heading arrives at low rate, samples are corrected one by one
+    for (unsigned i = 0; i < n; ++i) {
+        CompassData newOrientation(data[i]);
+        if (newOrientation.timestamp_ - lastUpdate_ > updateInterval_) {
+            loadSettings();
+            lastUpdate_ = newOrientation.timestamp_;
+        }
 
-    newOrientation.correctedDegrees_ = newOrientation.degrees_;
+        newOrientation.correctedDegrees_ = newOrientation.degrees_;
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
-    if (declinationCorrection_) {
-        newOrientation.correctedDegrees_ += declinationCorrection_;
+        if (declinationCorrection_) {
+            newOrientation.correctedDegrees_ += declinationCorrection_;
 #else
-    if (declinationCorrection_.loadAcquire() != 0) {
-        newOrientation.correctedDegrees_ += declinationCorrection_.loadAcquire();
+        if (declinationCorrection_.loadAcquire() != 0) {
+            newOrientation.correctedDegrees_ += declinationCorrection_.loadAcquire();
 #endif
-        newOrientation.correctedDegrees_ %= 360;
-//        sensordLogT() << "DeclinationFilter corrected degree " << newOrientation.degrees_ << " => " << newOrientation.correctedDegrees_ << ". Level: " << newOrientation.level_;
+            newOrientation.correctedDegrees_ %= 360;
+//            sensordLogT() << "DeclinationFilter corrected degree " << newOrientation.degrees_ << " => " << newOrientation.correctedDegrees_ << ". Level: " << newOrientation.level_;
+        }
+        orientation_ = newOrientation;
+        source_.propagate(1, &orientation_);
     }
-    orientation_ = newOrientation;
-    source_.propagate(1, &orientation_);
 }
 
 void DeclinationFilter::loadSettings()
@@ -59,7 +59,7 @@ public:
 private:
     DeclinationFilter();
 
-    void correct(unsigned, const CompassData*);
+    void correct(unsigned n, const CompassData* data);
 
     void loadSettings();
 
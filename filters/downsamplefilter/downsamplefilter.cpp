@@ -43,6 +43,7 @@ void DownsampleFilter::setBufferSize(unsigned int size)
 {
     sensordLogD() << "DownsampleFilter buffer size = " << size;
     bufferSize_ = size;
+    window_.setCapacity(size);
 }
 
 int DownsampleFilter::timeout() const
@@ -53,47 +54,37 @@ int DownsampleFilter::timeout() const
 void DownsampleFilter::setTimeout(int ms)
 {
     timeout_ = static_cast<long>(ms) * 1000;
+    window_.setMaxAge(timeout_ > 0 ? timeout_ : 0);
     sensordLogD() << "DownsampleFilter timeout = " << ms;
 }
 
-void DownsampleFilter::filter(unsigned, const TimedXyzData* data)
+void DownsampleFilter::filter(unsigned n, const TimedXyzData* data)
 {
-    buffer_.push_back(*data);
+    unsigned count = 0;
 
-    for(TimedXyzDownsampleBuffer::iterator it = buffer_.begin(); it != buffer_.end(); ++it)
+    for (unsigned i = 0; i < n; ++i)
     {
-        if(static_cast<unsigned int>(buffer_.size()) > bufferSize_ ||
-           (timeout_ && (data->timestamp_ - it->timestamp_ >
-                         static_cast<unsigned long>(timeout_))))
-        {
-            it = buffer_.erase(it);
-            if(it == buffer_.end())
-                break;
-        }
-        else
-            break;
-    }
+        const TimedXyzData& sample = data[i];
+        const int values[3] = { sample.x_, sample.y_, sample.z_ };
+        window_.push(sample.timestamp_, values);
 
-    if(static_cast<unsigned int>(buffer_.size()) < bufferSize_)
-        return;
+        if(window_.count() < bufferSize_)
+            continue;
 
-    long x = 0;
-    long y = 0;
-    long z = 0;
-    foreach(const TimedXyzData& data, buffer_)
-    {
-        x += data.x_;
-        y += data.y_;
-        z += data.z_;
-    }
-    int count = buffer_.count();
-    TimedXyzData downsampled(data->timestamp_,
-                             x / count,
-                             y / count,
-                             z / count);
+        int samples = window_.count();
+        output_[count++] = TimedXyzData(sample.timestamp_,
+                                        window_.sum(0) / samples,
+                                        window_.sum(1) / samples,
+                                        window_.sum(2) / samples);
+        window_.clear();
 
-//    sensordLogT() << "Downsampled: " << downsampled.x_ << ", " << downsampled.y_ << ", " << downsampled.z_;
+        if(count == XyzBlock::CAPACITY)
+        {
+            source_.propagate(count, output_);
+            count = 0;
+        }
+    }
 
-    source_.propagate(1, &downsampled);
-    buffer_.clear();
+    if(count)
+        source_.propagate(count, output_);
 }
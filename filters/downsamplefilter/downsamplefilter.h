@@ -26,10 +26,11 @@
 #ifndef DOWNSAMPLEFILTER_H
 #define DOWNSAMPLEFILTER_H
 
-#include <QList>
 #include <QObject>
 #include "datatypes/orientationdata.h"
 #include "filter.h"
+#include "xyzblock.h"
+#include "slidingwindow.h"
 
 /**
  * @brief Downsample filter.
@@ -93,14 +94,12 @@ private:
     /**
      * Callback for incoming data to be downsampled.
      */
-    void filter(unsigned, const TimedXyzData*);
-
-    /** Sample buffer type for TimedXyzData downsampling. */
-    typedef QList<TimedXyzData> TimedXyzDownsampleBuffer;
+    void filter(unsigned n, const TimedXyzData* data);
 
     unsigned int bufferSize_; /**< buffer size */
     long timeout_;   /**< timeout in milliseconds */
-    TimedXyzDownsampleBuffer buffer_; /**< downsample buffer */
+    SlidingWindow<int, 3> window_; /**< samples being averaged */
+    TimedXyzData output_[XyzBlock::CAPACITY]; /**< downsampled samples */
 };
 
 #endif // DOWNSAMPLEFILTER_H
@@ -31,21 +31,36 @@ MagCoordinateAlignFilter::MagCoordinateAlignFilter() :
 {
 }
 
-void MagCoordinateAlignFilter::filter(unsigned, const CalibratedMagneticFieldData* data)
+void MagCoordinateAlignFilter::filter(unsigned n, const CalibratedMagneticFieldData* data)
 {
-    CalibratedMagneticFieldData transformed;
+    while (n) {
+        unsigned count = qMin(n, (unsigned)XyzBlock::CAPACITY);
 
-    transformed.timestamp_ = data->timestamp_;
+        block_.load(count, data);
+        rawBlock_.size = count;
+        for (unsigned i = 0; i < count; ++i) {
+            rawBlock_.x[i] = data[i].rx_;
+            rawBlock_.y[i] = data[i].ry_;
+            rawBlock_.z[i] = data[i].rz_;
+        }
 
-    transformed.x_ = matrix_.get(0,0)*data->x_ + matrix_.get(0,1)*data->y_ + matrix_.get(0,2)*data->z_;
-    transformed.y_ = matrix_.get(1,0)*data->x_ + matrix_.get(1,1)*data->y_ + matrix_.get(1,2)*data->z_;
-    transformed.z_ = matrix_.get(2,0)*data->x_ + matrix_.get(2,1)*data->y_ + matrix_.get(2,2)*data->z_;
+        XyzKernels::transform(matrix_.data_, count,
+                              block_.x, block_.y, block_.z,
+                              block_.x, block_.y, block_.z);
+        XyzKernels::transform(matrix_.data_, count,
+                              rawBlock_.x, rawBlock_.y, rawBlock_.z,
+                              rawBlock_.x, rawBlock_.y, rawBlock_.z);
 
-    transformed.rx_ = matrix_.get(0,0)*data->rx_ + matrix_.get(0,1)*data->ry_ + matrix_.get(0,2)*data->rz_;
-    transformed.ry_ = matrix_.get(1,0)*data->rx_ + matrix_.get(1,1)*data->ry_ + matrix_.get(1,2)*data->rz_;
-    transformed.rz_ = matrix_.get(2,0)*data->rx_ + matrix_.get(2,1)*data->ry_ + matrix_.get(2,2)*data->rz_;
+        block_.store(output_);
+        for (unsigned i = 0; i < count; ++i) {
+            output_[i].rx_ = rawBlock_.x[i];
+            output_[i].ry_ = rawBlock_.y[i];
+            output_[i].rz_ = rawBlock_.z[i];
+            output_[i].level_ = data[i].level_;
+        }
 
-    transformed.level_ = data->level_;
-
-    source_.propagate(1, &transformed);
+        source_.propagate(count, output_);
+        data += count;
+        n -= count;
+    }
 }
@@ -29,6 +29,8 @@
 
 #include "datatypes/orientationdata.h"
 #include "filter.h"
+#include "xyzblock.h"
+#include "parameterparser.h"
 
 /**
  * TMagMatrix holds a transformation matrix.
@@ -60,6 +62,16 @@ public:
         memcpy(data_, m, sizeof(double[DIM][DIM]));
     }
 
+    /**
+     * Parse matrix from nine comma separated cells in row order.
+     * Malformed strings give the identity matrix.
+     */
+    static TMagMatrix fromString(const QString& str) {
+        TMagMatrix matrix;
+        ParameterParser::parseMatrix(str, matrix.data_);
+        return matrix;
+    }
+
     double data_[DIM][DIM];
 };
 Q_DECLARE_METATYPE(TMagMatrix)
@@ -97,9 +109,12 @@ protected:
     MagCoordinateAlignFilter();
 
 private:
-    void filter(unsigned, const CalibratedMagneticFieldData*);
+    void filter(unsigned n, const CalibratedMagneticFieldData* data);
 
     TMagMatrix matrix_;
+    XyzBlock block_;      /**< calibrated values being transformed */
+    XyzBlock rawBlock_;   /**< raw values being transformed */
+    CalibratedMagneticFieldData output_[XyzBlock::CAPACITY]; /**< transformed samples */
 };
 
 #endif // MagCoordinateAlignFilter_H
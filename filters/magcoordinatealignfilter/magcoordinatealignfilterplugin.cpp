@@ -33,6 +33,10 @@ void MagCoordinateAlignFilterPlugin::Register(class Loader&)
     sensordLogD() << "registering magcoordinatealignfilter";
     SensorManager& sm = SensorManager::instance();
     sm.registerFilter<MagCoordinateAlignFilter>("magcoordinatealignfilter");
+#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
+    // Lets configured pipelines set transMatrix from a string
+    QMetaType::registerConverter<QString, TMagMatrix>(TMagMatrix::fromString);
+#endif
 }
 
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
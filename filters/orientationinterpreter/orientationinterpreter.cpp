@@ -67,55 +67,49 @@ OrientationInterpreter::OrientationInterpreter() :
     discardTime = SensorFrameworkConfig::configuration()->value("orientation/discard_time", QVariant(DISCARD_TIME)).toUInt();
     maxBufferSize = SensorFrameworkConfig::configuration()->value("orientation/buffer_size", QVariant(AVG_BUFFER_MAX_SIZE)).toInt();
 
+    mathMode = FastMath::configuredMode("orientation");
+
+    dataBuffer.setCapacity(maxBufferSize);
+    dataBuffer.setMaxAge(discardTime);
+
     // Open the handle for boosting cpu on changes that affect orientation
     if (cpuBoostFile.exists()) {
             cpuBoostFile.open(QIODevice::WriteOnly);
       }
 }
 
-void OrientationInterpreter::accDataAvailable(unsigned, const AccelerationData* pdata)
+void OrientationInterpreter::accDataAvailable(unsigned n, const AccelerationData* pdata)
 {
-    data = *pdata;
-
-    // Check overflow
-    if (overFlowCheck())
+    for (unsigned i = 0; i < n; ++i)
     {
-        sensordLogT() << "Acc value discarded due to over/underflow";
-        return;
-    }
-
-    // Append new value to buffer
-    dataBuffer.append(data);
+        data = pdata[i];
 
-    // Clear old values from buffer.
-    while (dataBuffer.count() > maxBufferSize || (dataBuffer.count() > 1 && (data.timestamp_ - dataBuffer.first().timestamp_ > discardTime)))
-    {
-        dataBuffer.removeFirst();
-    }
+        // Check overflow
+        if (overFlowCheck())
+        {
+            sensordLogT() << "Acc value discarded due to over/underflow";
+            continue;
+        }
 
-    //Calculate average
-    long x = 0;
-    long y = 0;
-    long z = 0;
-    foreach (const AccelerationData& sample, dataBuffer)
-    {
-        x += sample.x_;
-        y += sample.y_;
-        z += sample.z_;
-    }
+        // Append new value to buffer, old values leave by count and age
+        const int values[3] = { data.x_, data.y_, data.z_ };
+        dataBuffer.push(data.timestamp_, values);
 
-    data.x_ = x / dataBuffer.count();
-    data.y_ = y / dataBuffer.count();
-    data.z_ = z / dataBuffer.count();
+        //Calculate average
+        int count = dataBuffer.count();
+        data.x_ = dataBuffer.sum(0) / count;
+        data.y_ = dataBuffer.sum(1) / count;
+        data.z_ = dataBuffer.sum(2) / count;
 
-    // calculate topedge
-    processTopEdge();
+        // calculate topedge
+        processTopEdge();
 
-    // calculate face
-    processFace();
+        // calculate face
+        processFace();
 
-    // calculate orientation
-    processOrientation();
+        // calculate orientation
+        processOrientation();
+    }
 }
 
 bool OrientationInterpreter::overFlowCheck()
@@ -127,9 +121,9 @@ bool OrientationInterpreter::overFlowCheck()
 int OrientationInterpreter::orientationCheck(const AccelerationData &data,  OrientationMode mode) const
 {
     if (mode == OrientationInterpreter::Landscape)
-        return round(atan((double)data.x_ / sqrt(data.y_ * data.y_ + data.z_ * data.z_)) * RADIANS_TO_DEGREES);
+        return round(FastMath::inclination(data.x_, data.y_, data.z_, mathMode) * RADIANS_TO_DEGREES);
     else
-        return round(atan((double)data.y_ / sqrt(data.x_ * data.x_ + data.z_ * data.z_)) * RADIANS_TO_DEGREES);
+        return round(FastMath::inclination(data.y_, data.x_, data.z_, mathMode) * RADIANS_TO_DEGREES);
 }
 
 PoseData OrientationInterpreter::rotateToPortrait(int rotation)
@@ -32,6 +32,8 @@
 #include <QObject>
 #include <QFile>
 #include "filter.h"
+#include "slidingwindow.h"
+#include "fastmath.h"
 #include <datatypes/orientationdata.h>
 #include <datatypes/posedata.h>
 
@@ -54,7 +56,7 @@ private:
     Source<PoseData> faceSource;
     Source<PoseData> orientationSource;
 
-    void accDataAvailable(unsigned, const AccelerationData*);
+    void accDataAvailable(unsigned n, const AccelerationData* pdata);
 
     bool overFlowCheck();
     void processTopEdge();
@@ -69,7 +71,7 @@ private:
     bool updatePreviousFace;
 
     AccelerationData data;
-    QList<AccelerationData> dataBuffer;
+    SlidingWindow<int, 3> dataBuffer;
 
     int minLimit;
     int maxLimit;
@@ -77,6 +79,7 @@ private:
     int angleThresholdLandscape;
     unsigned long discardTime;
     int maxBufferSize;
+    FastMath::Mode mathMode;
 
     PoseData orientationData;
 
@@ -30,41 +30,99 @@
 RotationFilter::RotationFilter() :
         accelerometerDataSink_(this, &RotationFilter::interpret),
         compassDataSink_(this, &RotationFilter::updateZvalue),
-        rotation_(0,0,0,0)
+        rotation_(0,0,0,0),
+        mathMode_(FastMath::configuredMode("rotation"))
 {
     addSink(&accelerometerDataSink_, "accelerometersink");
     addSink(&compassDataSink_, "compasssink");
     addSource(&source_, "source");
 }
 
-void RotationFilter::interpret(unsigned, const TimedXyzData* data)
+void RotationFilter::interpret(unsigned n, const TimedXyzData* data)
 {
     const int RADIANS_TO_DEGREES = 180/M_PI;
+    unsigned count = 0;
 
-    rotation_.timestamp_ = data->timestamp_;
+    if (mathMode_ == FastMath::Fast) {
+        interpretFast(n, data);
+        return;
+    }
+
+    for (unsigned i = 0; i < n; ++i) {
+        rotation_.timestamp_ = data[i].timestamp_;
+
+        // X-Rotation
+        rotation_.x_ = round(atan((double)data[i].y_ / sqrt(data[i].x_ * data[i].x_ + data[i].z_ * data[i].z_)) * RADIANS_TO_DEGREES);
+        rotation_.x_ = -rotation_.x_;
+
+        // Y-rotation
+        if (data[i].x_ == 0 && data[i].y_ == 0 && data[i].z_ > 0) {
+            rotation_.y_ = 180;
+        } else if (data[i].x_ == 0 && data[i].z_  == 0) {
+            rotation_.y_ = 0;
+        } else {
+            rotation_.y_ = round(atan((double)data[i].x_ / sqrt(data[i].y_ * data[i].y_ + data[i].z_ * data[i].z_)) * RADIANS_TO_DEGREES);
+
+            qreal theta = atan(sqrt(data[i].x_ * data[i].x_ + data[i].y_ * data[i].y_) / data[i].z_) * RADIANS_TO_DEGREES;
+            if (theta > 0) {
+                if (rotation_.y_ >= 0)
+                    rotation_.y_ = 180 - rotation_.y_;
+                else
+                    rotation_.y_ = -180 - rotation_.y_;
+            }
+        }
 
-    // X-Rotation
-    rotation_.x_ = round(atan((double)data->y_ / sqrt(data->x_ * data->x_ + data->z_ * data->z_)) * RADIANS_TO_DEGREES);
-    rotation_.x_ = -rotation_.x_;
-
-    // Y-rotation
-    if (data->x_ == 0 && data->y_ == 0 && data->z_ > 0) {
-        rotation_.y_ = 180;
-    } else if (data->x_ == 0 && data->z_  == 0) {
-        rotation_.y_ = 0;
-    } else {
-        rotation_.y_ = round(atan((double)data->x_ / sqrt(data->y_ * data->y_ + data->z_ * data->z_)) * RADIANS_TO_DEGREES);
-
-        qreal theta = atan(sqrt(data->x_ * data->x_ + data->y_ * data->y_) / data->z_) * RADIANS_TO_DEGREES;
-        if (theta > 0) {
-            if (rotation_.y_ >= 0)
-                rotation_.y_ = 180 - rotation_.y_;
-            else
-                rotation_.y_ = -180 - rotation_.y_;
+        output_[count++] = rotation_;
+        if (count == XyzBlock::CAPACITY) {
+            source_.propagate(count, output_);
+            count = 0;
         }
     }
 
-    source_.propagate(1, &rotation_);
+    if (count)
+        source_.propagate(count, output_);
+}
+
+void RotationFilter::interpretFast(unsigned n, const TimedXyzData* data)
+{
+    // Same truncated factor as the precise path to keep outputs equal
+    const float RADIANS_TO_DEGREES = (int)(180/M_PI);
+
+    while (n) {
+        unsigned count = qMin(n, (unsigned)XyzBlock::CAPACITY);
+        block_.load(count, data);
+        FastMath::inclination(count, block_.y, block_.x, block_.z, angleX_);
+        FastMath::inclination(count, block_.x, block_.y, block_.z, angleY_);
+
+        for (unsigned i = 0; i < count; ++i) {
+            const int x = block_.x[i];
+            const int y = block_.y[i];
+            const int z = block_.z[i];
+
+            rotation_.timestamp_ = block_.timestamp[i];
+            rotation_.x_ = -(int)roundf(angleX_[i] * RADIANS_TO_DEGREES);
+
+            if (x == 0 && y == 0 && z > 0) {
+                rotation_.y_ = 180;
+            } else if (x == 0 && z == 0) {
+                rotation_.y_ = 0;
+            } else {
+                rotation_.y_ = roundf(angleY_[i] * RADIANS_TO_DEGREES);
+                // atan(sqrt(x^2 + y^2) / z) > 0 without computing it
+                if (z >= 0 && (x || y)) {
+                    if (rotation_.y_ >= 0)
+                        rotation_.y_ = 180 - rotation_.y_;
+                    else
+                        rotation_.y_ = -180 - rotation_.y_;
+                }
+            }
+            output_[i] = rotation_;
+        }
+
+        source_.propagate(count, output_);
+        data += count;
+        n -= count;
+    }
 }
 
 double RotationFilter::vectorLength(const TimedXyzData& data)
@@ -72,8 +130,11 @@ double RotationFilter::vectorLength(const TimedXyzData& data)
     return sqrt(data.x_ * data.x_ + data.y_ * data.y_ + data.z_ * data.z_);
 }
 
-void RotationFilter::updateZvalue(unsigned, const CompassData* data)
+void RotationFilter::updateZvalue(unsigned n, const CompassData* data)
 {
+    // Only the latest heading matters
+    data += n - 1;
+
     rotation_.timestamp_ = data->timestamp_;
 
     /// Z-rotation
@@ -30,6 +30,8 @@
 
 #include "orientationdata.h"
 #include "filter.h"
+#include "xyzblock.h"
+#include "fastmath.h"
 
 /**
  * @brief Filter for calculating device axis rotations.
@@ -68,14 +70,24 @@ private:
     Sink<RotationFilter, CompassData> compassDataSink_;
     Source<TimedXyzData> source_;
 
-    void interpret(unsigned, const TimedXyzData*);
-    void updateZvalue(unsigned, const CompassData*);
+    void interpret(unsigned n, const TimedXyzData* data);
+
+    /**
+     * Fast mode version of interpret() working on blocks.
+     */
+    void interpretFast(unsigned n, const TimedXyzData* data);
+    void updateZvalue(unsigned n, const CompassData* data);
 
     inline int dotProduct(TimedXyzData a, TimedXyzData b) const {
         return (a.x_ * b.x_) + (a.y_ * b.y_) + (a.z_ * b.z_);
     }
 
     TimedXyzData rotation_;
+    TimedXyzData output_[XyzBlock::CAPACITY]; /**< rotations being propagated */
+    FastMath::Mode mathMode_;
+    XyzBlock block_;                          /**< input of fast mode */
+    float angleX_[XyzBlock::CAPACITY];        /**< X inclinations of block_ */
+    float angleY_[XyzBlock::CAPACITY];        /**< Y inclinations of block_ */
 };
 
 #endif // ROTATIONFILTER_H
@@ -0,0 +1,204 @@
+/**
+   @file latestsampletable.h
+   @brief Latest sample of every sensor channel in shared memory
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef LATEST_SAMPLE_TABLE_H
+#define LATEST_SAMPLE_TABLE_H
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Table of slots, each holding the newest sample of one sensor channel
+ * and the time it was stored. sensord writes, any number of clients
+ * read the same mapping.
+ *
+ * Slots are protected with a sequence lock: the sequence number is odd
+ * while a slot is being written, and a reader retries if it saw an odd
+ * number or the number changed while it copied the slot. Neither side
+ * ever blocks the other.
+ */
+class LatestSampleTable
+{
+public:
+    enum {
+        MAGIC = 0x4c574653,  /**< "SFWL" */
+        VERSION = 1,         /**< layout version */
+        SLOT_DATA_SIZE = 64, /**< largest sample */
+        READ_RETRIES = 16    /**< attempts before a reader gives up */
+    };
+
+    /**
+     * Start of the mapping.
+     */
+    struct Header
+    {
+        quint32 magic;          /**< MAGIC */
+        quint32 version;        /**< VERSION */
+        quint32 slotDataSize;   /**< SLOT_DATA_SIZE */
+        quint32 slotCount;      /**< number of slots */
+        char    pad[48];
+    };
+
+    /**
+     * Newest sample of a channel. Padded to two cache lines.
+     */
+    struct Slot
+    {
+        QAtomicInteger<quint32> seq;                  /**< odd while written, 0 if never written */
+        quint32                 size;                 /**< bytes used in data, 0 if slot is free */
+        quint64                 updated;              /**< store time, monotonic microseconds */
+        char                    data[SLOT_DATA_SIZE]; /**< sample */
+        char                    pad[48];
+    };
+
+    /**
+     * Bytes needed for a table.
+     *
+     * @param slotCount Number of slots.
+     * @return mapping size.
+     */
+    static size_t mappingSize(quint32 slotCount)
+    {
+        return sizeof(Header) + slotCount * sizeof(Slot);
+    }
+
+    /**
+     * Constructor.
+     *
+     * @param mapping Shared memory of mappingSize() bytes.
+     */
+    LatestSampleTable(void* mapping) :
+        header_(static_cast<Header*>(mapping)),
+        slots_(reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header))),
+        slotCount_(0)
+    {
+    }
+
+    /**
+     * Initialize fresh zeroed mapping. Writer side.
+     *
+     * @param slotCount Number of slots.
+     */
+    void initialize(quint32 slotCount)
+    {
+        header_->magic = MAGIC;
+        header_->version = VERSION;
+        header_->slotDataSize = SLOT_DATA_SIZE;
+        header_->slotCount = slotCount;
+        slotCount_ = slotCount;
+    }
+
+    /**
+     * Validate mapping created by the writer. Reader side.
+     *
+     * @param size Size of the mapping.
+     * @return can the table be used.
+     */
+    bool attach(size_t size)
+    {
+        if (size < sizeof(Header) ||
+            header_->magic != MAGIC ||
+            header_->version != VERSION ||
+            header_->slotDataSize != SLOT_DATA_SIZE ||
+            size < mappingSize(header_->slotCount))
+            return false;
+        slotCount_ = header_->slotCount;
+        return true;
+    }
+
+    /**
+     * Number of slots.
+     */
+    quint32 slotCount() const { return slotCount_; }
+
+    /**
+     * Replace the sample of a slot. Writer side. Concurrent writers of
+     * the same slot are serialized.
+     *
+     * @param slot Slot index.
+     * @param data Sample.
+     * @param size Sample size, at most SLOT_DATA_SIZE. 0 frees the slot.
+     * @param now Current monotonic time in microseconds.
+     */
+    void write(quint32 slot, const void* data, quint32 size, quint64 now)
+    {
+        if (slot >= slotCount_ || size > SLOT_DATA_SIZE)
+            return;
+        Slot& s = slots_[slot];
+        quint32 seq;
+        do {
+            seq = s.seq.loadAcquire() & ~1u;
+        } while (!s.seq.testAndSetAcquire(seq, seq + 1));
+        std::atomic_thread_fence(std::memory_order_release);
+        s.size = size;
+        s.updated = now;
+        if (size)
+            memcpy(s.data, data, size);
+        s.seq.storeRelease(seq + 2);
+    }
+
+    /**
+     * Copy the sample of a slot. Reader side.
+     *
+     * @param slot Slot index.
+     * @param dest Destination for the sample.
+     * @param capacity Size of dest.
+     * @param updated Set to the store time of the sample.
+     * @return sample size, or -1 if the slot holds no sample that fits
+     *         or it kept changing while read.
+     */
+    int read(quint32 slot, void* dest, quint32 capacity, quint64* updated) const
+    {
+        if (slot >= slotCount_)
+            return -1;
+        const Slot& s = slots_[slot];
+        for (int attempt = 0; attempt < READ_RETRIES; ++attempt) {
+            quint32 seq = s.seq.loadAcquire();
+            if (seq == 0)
+                return -1;
+            if (seq & 1)
+                continue;
+            quint32 size = s.size;
+            quint64 stamp = s.updated;
+            if (size <= capacity && size <= SLOT_DATA_SIZE)
+                memcpy(dest, s.data, size);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load() != seq)
+                continue;
+            if (size == 0 || size > capacity)
+                return -1;
+            if (updated)
+                *updated = stamp;
+            return size;
+        }
+        return -1;
+    }
+
+private:
+    Header*  header_;    /**< shared header */
+    Slot*    slots_;     /**< shared slots */
+    quint32  slotCount_; /**< number of slots */
+};
+
+#endif // LATEST_SAMPLE_TABLE_H
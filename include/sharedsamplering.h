@@ -0,0 +1,248 @@
+/**
+   @file sharedsamplering.h
+   @brief Shared memory sample ring between sensord and clients
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SHARED_SAMPLE_RING_H
+#define SHARED_SAMPLE_RING_H
+
+#include <QtGlobal>
+#include <QAtomicInteger>
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+
+/**
+ * Word written by the client after its session ID to ask for the shared
+ * memory transport.
+ */
+static const quint32 SHARED_MEMORY_REQUEST = 0x4d485346; // "FSHM"
+
+/**
+ * Ring of sample records in memory shared between sensord (single writer)
+ * and one client (single reader). Writer never waits for the reader; a
+ * reader which falls a full ring behind loses the oldest samples and
+ * counts them as dropped.
+ *
+ * Every slot carries the sequence number of the sample it holds, so the
+ * reader can detect a slot being rewritten while it copies it. The data
+ * socket is only used to wake up a reader which has announced that it is
+ * waiting.
+ */
+class SharedSampleRing
+{
+public:
+    enum {
+        MAGIC = 0x52574653,  /**< "SFWR" */
+        VERSION = 1,         /**< layout version */
+        SLOT_DATA_SIZE = 64  /**< largest sample */
+    };
+
+    /**
+     * Start of the mapping.
+     */
+    struct Header
+    {
+        quint32                 magic;          /**< MAGIC */
+        quint32                 version;        /**< VERSION */
+        quint32                 slotDataSize;   /**< SLOT_DATA_SIZE */
+        quint32                 slotCount;      /**< power of two */
+        QAtomicInteger<quint32> writeSeq;       /**< samples written, owned by sensord */
+        char                    pad[44];        /**< keep writer and reader apart */
+        QAtomicInteger<quint32> readSeq;        /**< samples consumed, owned by client */
+        QAtomicInteger<quint32> readerWaiting;  /**< client wants a wakeup */
+        QAtomicInteger<quint32> dropped;        /**< samples lost by client */
+        char                    pad2[52];
+    };
+
+    /**
+     * Sample record.
+     */
+    struct Slot
+    {
+        QAtomicInteger<quint32> seq;                  /**< sample number + 1 */
+        quint32                 size;                 /**< bytes used in data */
+        char                    data[SLOT_DATA_SIZE]; /**< sample */
+    };
+
+    /**
+     * Bytes needed for a ring.
+     *
+     * @param slotCount Number of slots.
+     * @return mapping size.
+     */
+    static size_t mappingSize(quint32 slotCount)
+    {
+        return sizeof(Header) + slotCount * sizeof(Slot);
+    }
+
+    /**
+     * Constructor.
+     *
+     * @param mapping Shared memory of mappingSize() bytes.
+     */
+    SharedSampleRing(void* mapping) :
+        header_(static_cast<Header*>(mapping)),
+        slots_(reinterpret_cast<Slot*>(static_cast<char*>(mapping) + sizeof(Header))),
+        mask_(0),
+        writeSeq_(0),
+        readSeq_(0)
+    {
+    }
+
+    /**
+     * Initialize fresh zeroed mapping. Writer side.
+     *
+     * @param slotCount Number of slots. Power of two, at least 2.
+     */
+    void initialize(quint32 slotCount)
+    {
+        header_->magic = MAGIC;
+        header_->version = VERSION;
+        header_->slotDataSize = SLOT_DATA_SIZE;
+        header_->slotCount = slotCount;
+        header_->readerWaiting.storeRelease(1);
+        mask_ = slotCount - 1;
+    }
+
+    /**
+     * Validate mapping created by the writer. Reader side.
+     *
+     * @param size Size of the mapping.
+     * @return can the ring be used.
+     */
+    bool attach(size_t size)
+    {
+        if (size < sizeof(Header) ||
+            header_->magic != MAGIC ||
+            header_->version != VERSION ||
+            header_->slotDataSize != SLOT_DATA_SIZE ||
+            header_->slotCount < 2 ||
+            (header_->slotCount & (header_->slotCount - 1)) ||
+            size < mappingSize(header_->slotCount))
+            return false;
+        mask_ = header_->slotCount - 1;
+        readSeq_ = header_->writeSeq.loadAcquire();
+        return true;
+    }
+
+    /**
+     * Append sample. Writer side.
+     *
+     * @param data Sample.
+     * @param size Sample size, at most SLOT_DATA_SIZE.
+     * @return true if the reader is waiting and must be woken up.
+     */
+    bool write(const void* data, quint32 size)
+    {
+        Slot& slot = slots_[writeSeq_ & mask_];
+        slot.seq.store(writeSeq_);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.size = size;
+        memcpy(slot.data, data, size);
+        slot.seq.storeRelease(writeSeq_ + 1);
+        ++writeSeq_;
+        header_->writeSeq.fetchAndStoreOrdered(writeSeq_);
+        return header_->readerWaiting.testAndSetOrdered(1, 0);
+    }
+
+    /**
+     * Number of samples waiting for the reader. Reader side.
+     */
+    int available() const
+    {
+        quint32 pending = header_->writeSeq.loadAcquire() - readSeq_;
+        return pending > mask_ ? mask_ + 1 : pending;
+    }
+
+    /**
+     * Copy samples out of the ring. Reader side.
+     *
+     * @param dest Destination for samples.
+     * @param size Expected sample size. Records of other size are skipped.
+     * @param maxCount Capacity of dest in samples.
+     * @return number of samples copied.
+     */
+    int read(void* dest, quint32 size, int maxCount)
+    {
+        int count = 0;
+        quint32 lost = 0;
+        while (count < maxCount) {
+            quint32 written = header_->writeSeq.loadAcquire();
+            if (written == readSeq_)
+                break;
+            if (written - readSeq_ > mask_ + 1) {
+                lost += written - readSeq_ - (mask_ + 1);
+                readSeq_ = written - (mask_ + 1);
+            }
+
+            const Slot& slot = slots_[readSeq_ & mask_];
+            bool valid = slot.seq.loadAcquire() == readSeq_ + 1 && slot.size == size;
+            if (valid) {
+                memcpy(static_cast<char*>(dest) + count * size, slot.data, size);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                valid = slot.seq.load() == readSeq_ + 1;
+            }
+            ++readSeq_;
+            if (valid)
+                ++count;
+            else
+                ++lost;
+        }
+        header_->readSeq.storeRelease(readSeq_);
+        if (lost)
+            header_->dropped.fetchAndAddRelaxed(lost);
+        return count;
+    }
+
+    /**
+     * Ask for a wakeup on the next write. Reader side.
+     *
+     * @return true if samples arrived meanwhile and should be read first.
+     */
+    bool arm()
+    {
+        header_->readerWaiting.fetchAndStoreOrdered(1);
+        return header_->writeSeq.fetchAndAddOrdered(0) != readSeq_;
+    }
+
+    /**
+     * Number of slots.
+     */
+    quint32 slotCount() const { return mask_ + 1; }
+
+    /**
+     * Samples written but not yet consumed as reported by the reader.
+     */
+    quint32 depth() const { return writeSeq_ - header_->readSeq.loadAcquire(); }
+
+    /**
+     * Samples the reader reported as lost.
+     */
+    quint32 dropped() const { return header_->dropped.load(); }
+
+private:
+    Header*  header_;   /**< shared header */
+    Slot*    slots_;    /**< shared slots */
+    quint32  mask_;     /**< slotCount - 1 */
+    quint32  writeSeq_; /**< private write cursor of writer */
+    quint32  readSeq_;  /**< private read cursor of reader */
+};
+
+#endif // SHARED_SAMPLE_RING_H
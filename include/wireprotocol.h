@@ -0,0 +1,118 @@
+/**
+   @file wireprotocol.h
+   @brief Framed data socket protocol between sensord and clients
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SENSORFW_WIRE_PROTOCOL_H
+#define SENSORFW_WIRE_PROTOCOL_H
+
+#include <stdint.h>
+
+/*
+ * Data socket protocols. sensord greets every new connection with a single
+ * byte, then the client writes either
+ *
+ * - its session ID (int): version 1. The connection carries the samples of
+ *   that session only, each frame being an unsigned sample count followed
+ *   by the samples.
+ *
+ * - a sensorfw_wire_hello_t: version 2. sensord answers with a hello
+ *   carrying the version it speaks. The connection is then shared by any
+ *   number of sessions of the client, attached and detached with
+ *   sensorfw_wire_request_t. Every frame starts with a
+ *   sensorfw_wire_frame_t telling the session it belongs to. An attach is
+ *   acknowledged with an empty frame of the session.
+ *
+ * - a sensorfw_wire_hello_t asking for version 3: version 2 with sample
+ *   timestamps in nanoseconds, see SENSORFW_WIRE_SAMPLE_NS.
+ *
+ * The header is plain C, it is shared by sensord and both client
+ * libraries. All fields are in host byte order.
+ */
+
+/** First word of a hello. High bit set, so never a valid session ID. */
+#define SENSORFW_WIRE_MAGIC 0x80574653u
+
+/** Highest protocol version. */
+#define SENSORFW_WIRE_VERSION 3
+
+/**
+ * Sample layout version 1: the TimedData layouts with timestamps in
+ * microseconds. Frames of version 2 connections carry it.
+ */
+#define SENSORFW_WIRE_SAMPLE_US 1
+
+/**
+ * Sample layout version 2: the version 1 layouts with the leading
+ * timestamp in nanoseconds of the same clock. Frames of version 3
+ * connections carry it, except for samples of unknown type which stay
+ * at version 1. Adaptors stamp samples in microseconds, so the times
+ * are exact to the microsecond.
+ */
+#define SENSORFW_WIRE_SAMPLE_NS 2
+
+/** Client request: start receiving frames of a session. */
+#define SENSORFW_WIRE_ATTACH 1
+
+/** Client request: stop receiving frames of a session. */
+#define SENSORFW_WIRE_DETACH 2
+
+/** Sample types carried in frames. */
+enum sensorfw_wire_sample_type {
+    SENSORFW_WIRE_SAMPLE_UNKNOWN = 0,
+    SENSORFW_WIRE_SAMPLE_XYZ,             /**< TimedXyzData */
+    SENSORFW_WIRE_SAMPLE_UNSIGNED,        /**< TimedUnsigned */
+    SENSORFW_WIRE_SAMPLE_COMPASS,         /**< CompassData */
+    SENSORFW_WIRE_SAMPLE_MAGNETIC_FIELD,  /**< CalibratedMagneticFieldData */
+    SENSORFW_WIRE_SAMPLE_PROXIMITY,       /**< ProximityData */
+    SENSORFW_WIRE_SAMPLE_POSE,            /**< PoseData */
+    SENSORFW_WIRE_SAMPLE_LID,             /**< LidData */
+    SENSORFW_WIRE_SAMPLE_TAP              /**< TapData */
+};
+
+/** Protocol negotiation, sent by both ends. */
+typedef struct {
+    uint32_t magic;    /**< SENSORFW_WIRE_MAGIC */
+    uint32_t version;  /**< client: highest version spoken, sensord: version used */
+} sensorfw_wire_hello_t;
+
+/** Request of a client. */
+typedef struct {
+    uint32_t op;       /**< SENSORFW_WIRE_ATTACH or SENSORFW_WIRE_DETACH */
+    int32_t  channel;  /**< session ID */
+} sensorfw_wire_request_t;
+
+/**
+ * Header of a frame. The samples follow at headerSize bytes from the
+ * start of the frame, so fields can be added without breaking readers.
+ */
+typedef struct sensorfw_wire_frame {
+    uint32_t size;           /**< bytes of the frame including the header */
+    uint16_t headerSize;     /**< bytes of the header */
+    uint16_t sampleType;     /**< sensorfw_wire_sample_type */
+    int32_t  channel;        /**< session ID */
+    uint32_t sequence;       /**< frame number of the session, from 0 */
+    uint32_t count;          /**< samples in the frame */
+    uint32_t dropped;        /**< samples of the session dropped by sensord so far */
+    uint16_t sampleSize;     /**< bytes per sample */
+    uint16_t sampleVersion;  /**< SENSORFW_WIRE_SAMPLE_US or SENSORFW_WIRE_SAMPLE_NS */
+    uint32_t reserved;       /**< zero */
+} sensorfw_wire_frame_t;
+
+#endif /* SENSORFW_WIRE_PROTOCOL_H */
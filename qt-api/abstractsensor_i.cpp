@@ -28,6 +28,9 @@
 
 #include "sensormanagerinterface.h"
 #include "abstractsensor_i.h"
+#include "latestsampletable.h"
+#include "datatypes/utils.h"
+#include <string.h>
 #ifdef SENSORFW_MCE_WATCHER
 #include "mcewatcher.h"
 #endif
@@ -54,6 +57,8 @@ struct AbstractSensorChannelInterface::AbstractSensorChannelInterfaceImpl : publ
     bool running_;
     bool standbyOverride_;
     bool downsampling_;
+    int latestSlot_;
+    const LatestSampleTable* latestSlotTable_; // table latestSlot_ was looked up in
 };
 
 AbstractSensorChannelInterface::AbstractSensorChannelInterfaceImpl::AbstractSensorChannelInterfaceImpl(QObject* parent, int sessionId, const QString& path, const char* interfaceName) :
@@ -67,7 +72,9 @@ AbstractSensorChannelInterface::AbstractSensorChannelInterfaceImpl::AbstractSens
     socketReader_(parent),
     running_(false),
     standbyOverride_(false),
-    downsampling_(true)
+    downsampling_(true),
+    latestSlot_(-1),
+    latestSlotTable_(0)
 {
 }
 
@@ -135,7 +142,7 @@ QDBusReply<void> AbstractSensorChannelInterface::start(int sessionId)
     }
     pimpl_->running_ = true;
 
-    connect(pimpl_->socketReader_.socket(), SIGNAL(readyRead()), this, SLOT(dataReceived()));
+    connect(&pimpl_->socketReader_, SIGNAL(readyRead()), this, SLOT(dataReceived()));
 
     QList<QVariant> argumentList;
     argumentList << qVariantFromValue(sessionId);
@@ -173,7 +180,7 @@ QDBusReply<void> AbstractSensorChannelInterface::stop(int sessionId)
     }
     pimpl_->running_ = false ;
 
-    disconnect(pimpl_->socketReader_.socket(), SIGNAL(readyRead()), this, SLOT(dataReceived()));
+    disconnect(&pimpl_->socketReader_, SIGNAL(readyRead()), this, SLOT(dataReceived()));
 
     QList<QVariant> argumentList;
     argumentList << qVariantFromValue(sessionId);
@@ -438,7 +445,12 @@ void AbstractSensorChannelInterface::dataReceived()
     {
         if(!dataReceivedImpl())
             return;
-    } while(pimpl_->socketReader_.socket()->bytesAvailable());
+    } while(pimpl_->socketReader_.hasPendingData());
+}
+
+unsigned long AbstractSensorChannelInterface::droppedSamples() const
+{
+    return pimpl_->socketReader_.droppedSamples();
 }
 
 bool AbstractSensorChannelInterface::read(void* buffer, int size)
@@ -503,6 +515,44 @@ bool AbstractSensorChannelInterface::isValid() const
     return pimpl_->isValid();
 }
 
+QByteArray AbstractSensorChannelInterface::latestSample(quint64 maxAge)
+{
+    const LatestSampleTable* table = SensorManagerInterface::instance().latestSampleTable();
+    if(table)
+    {
+        // A restarted sensord comes with a new table and new slots
+        if(pimpl_->latestSlotTable_ != table)
+        {
+            QDBusReply<int> reply(call(QDBus::Block, QLatin1String("latestSampleSlot")));
+            pimpl_->latestSlot_ = reply.isValid() ? reply.value() : -1;
+            pimpl_->latestSlotTable_ = table;
+        }
+
+        char data[LatestSampleTable::SLOT_DATA_SIZE];
+        quint64 updated = 0;
+        int size = pimpl_->latestSlot_ < 0 ? -1 : table->read(pimpl_->latestSlot_, data, sizeof(data), &updated);
+        if(size > 0 && (!maxAge || Utils::getTimeStamp() - updated <= maxAge))
+            return QByteArray(data, size);
+    }
+
+    QDBusReply<QByteArray> reply(call(QDBus::Block, QLatin1String("latestSample"), qVariantFromValue(maxAge)));
+    if(!reply.isValid())
+    {
+        qWarning() << "Failed to get latest sample from sensord: " << reply.error().message();
+        return QByteArray();
+    }
+    return reply.value();
+}
+
+bool AbstractSensorChannelInterface::copyLatest(void* dest, int size, quint64 maxAge)
+{
+    QByteArray sample(latestSample(maxAge));
+    if(sample.size() != size)
+        return false;
+    memcpy(dest, sample.constData(), size);
+    return true;
+}
+
 bool AbstractSensorChannelInterface::downsampling()
 {
     return pimpl_->downsampling_;
@@ -37,6 +37,7 @@
 #include "sfwerror.h"
 #include "serviceinfo.h"
 #include "socketreader.h"
+#include "framereader.h"
 #include "datatypes/datarange.h"
 
 /**
@@ -294,6 +295,26 @@ public:
      */
     bool isValid() const;
 
+    /**
+     * Latest sample output by the sensor, whether or not this session
+     * is started. Read from shared memory when sensor daemon shares its
+     * latest sample table and over D-Bus otherwise. If the sample is
+     * older than maxAge and the sensor is stopped, sensor daemon runs
+     * the sensor until it outputs a fresh sample.
+     *
+     * @param maxAge Accepted age in microseconds, 0 accepts any age.
+     * @return raw sample, empty if there is none.
+     */
+    QByteArray latestSample(quint64 maxAge = 0);
+
+    /**
+     * Number of samples of this session which sensor daemon has dropped
+     * because they were not read in time.
+     *
+     * @return dropped samples.
+     */
+    unsigned long droppedSamples() const;
+
 private:
     /**
      * Set error information.
@@ -411,6 +432,38 @@ protected:
     template<typename T>
     bool read(QVector<T>& values);
 
+    /**
+     * Read samples from socket into reused frame buffer.
+     *
+     * @tparam Type to which to convert raw data.
+     * @param reader Frame buffer. Its frame() holds the samples read.
+     * @return false if reading failed. Like read(), an empty frame is
+     *         not a failure.
+     */
+    template<typename T>
+    bool readFrame(FrameReader<T>& reader);
+
+    /**
+     * Read latest sample of the sensor, see latestSample().
+     *
+     * @tparam Type of the sample.
+     * @param value Set to the sample.
+     * @param maxAge Accepted age in microseconds, 0 accepts any age.
+     * @return was a sample of the expected size available.
+     */
+    template<typename T>
+    bool readLatest(T& value, quint64 maxAge);
+
+    /**
+     * Copy latest sample of the sensor, see readLatest().
+     *
+     * @param dest Destination for the sample.
+     * @param size Expected sample size.
+     * @param maxAge Accepted age in microseconds, 0 accepts any age.
+     * @return was a sample of the expected size available.
+     */
+    bool copyLatest(void* dest, int size, quint64 maxAge);
+
     /**
      * Callback for subclasses in which they must read their expected data
      * from socket.
@@ -495,6 +548,18 @@ bool AbstractSensorChannelInterface::read(QVector<T>& values)
     return getSocketReader().read(values);
 }
 
+template<typename T>
+bool AbstractSensorChannelInterface::readFrame(FrameReader<T>& reader)
+{
+    return reader.read(getSocketReader());
+}
+
+template<typename T>
+bool AbstractSensorChannelInterface::readLatest(T& value, quint64 maxAge)
+{
+    return copyLatest(&value, sizeof(T), maxAge);
+}
+
 template<typename T>
 T AbstractSensorChannelInterface::getAccessor(const char* name)
 {
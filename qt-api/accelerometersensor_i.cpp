@@ -36,7 +36,8 @@ AbstractSensorChannelInterface* AccelerometerSensorChannelInterface::factoryMeth
 
 AccelerometerSensorChannelInterface::AccelerometerSensorChannelInterface(const QString &path, int sessionId) :
     AbstractSensorChannelInterface(path, AccelerometerSensorChannelInterface::staticInterfaceName, sessionId),
-    frameAvailableConnected(false)
+    frameAvailableConnected(false),
+    frameSink_(0)
 {
 }
 
@@ -62,30 +63,50 @@ AccelerometerSensorChannelInterface* AccelerometerSensorChannelInterface::interf
 
 bool AccelerometerSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<AccelerationData> values;
-    if(!read<AccelerationData>(values))
+    if(!readFrame(frameReader_))
         return false;
-    if(!frameAvailableConnected || values.size() == 1)
+    SampleSpan<AccelerationData> frame(frameReader_.frame());
+    if(frame.isEmpty())
+        return true;
+    if(frameSink_)
     {
-        foreach(const AccelerationData& data, values)
-            emit dataAvailable(XYZ(data));
+        frameSink_->frameAvailable(frame);
+        return true;
+    }
+    if(!frameAvailableConnected || frame.size() == 1)
+    {
+        for(SampleSpan<AccelerationData>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+            emit dataAvailable(XYZ(*it));
     }
     else
     {
         QVector<XYZ> realValues;
-        realValues.reserve(values.size());
-        foreach(const AccelerationData& data, values)
-            realValues.push_back(XYZ(data));
+        realValues.reserve(frame.size());
+        for(SampleSpan<AccelerationData>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+            realValues.push_back(XYZ(*it));
         emit frameAvailable(realValues);
     }
     return true;
 }
 
+void AccelerometerSensorChannelInterface::setFrameSink(FrameSink<AccelerationData>* sink)
+{
+    frameSink_ = sink;
+}
+
 XYZ AccelerometerSensorChannelInterface::get()
 {
     return getAccessor<XYZ>("xyz");
 }
 
+XYZ AccelerometerSensorChannelInterface::latest(quint64 maxAge)
+{
+    AccelerationData data;
+    if(!readLatest(data, maxAge))
+        return XYZ();
+    return XYZ(data);
+}
+
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 void AccelerometerSensorChannelInterface::connectNotify(const char* signal)
 #else
@@ -63,6 +63,26 @@ public:
      */
     XYZ get();
 
+    /**
+     * Deliver samples to a sink instead of dataAvailable and
+     * frameAvailable signals. The sink is called directly when data
+     * arrives and gets the samples without QObject wrappers, so nothing
+     * is allocated per sample.
+     *
+     * @param sink sink, or NULL to use signals.
+     */
+    void setFrameSink(FrameSink<AccelerationData>* sink);
+
+    /**
+     * Get latest accelerometer reading kept by sensor daemon. Unlike
+     * get() this works without starting the sensor, see
+     * AbstractSensorChannelInterface::latestSample().
+     *
+     * @param maxAge Accepted age in microseconds, 0 accepts any age.
+     * @return accelerometer reading, all zero if there is none.
+     */
+    XYZ latest(quint64 maxAge = 0);
+
     /**
      * Constructor.
      *
@@ -108,6 +128,8 @@ virtual bool dataReceivedImpl();
 
 private:
     bool frameAvailableConnected; /**< has applicaiton connected slot for frameAvailable signal. */
+    FrameReader<AccelerationData> frameReader_; /**< reused sample buffer */
+    FrameSink<AccelerationData>* frameSink_; /**< receiver of samples instead of signals, or NULL */
 
 Q_SIGNALS:
     /**
@@ -64,11 +64,11 @@ ALSSensorChannelInterface* ALSSensorChannelInterface::interface(const QString& i
 
 bool ALSSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedUnsigned> values;
-    if(!read<TimedUnsigned>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(const TimedUnsigned& data, values)
-        emit ALSChanged(data);
+    SampleSpan<TimedUnsigned> frame(frameReader_.frame());
+    for(SampleSpan<TimedUnsigned>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+        emit ALSChanged(*it);
     return true;
 }
 
@@ -103,6 +103,9 @@ public:
 protected:
     virtual bool dataReceivedImpl();
 
+private:
+    FrameReader<TimedUnsigned> frameReader_; /**< reused sample buffer */
+
 Q_SIGNALS:
     /**
      * Sent when measured ambient light intensity has changed.
@@ -62,11 +62,11 @@ CompassSensorChannelInterface* CompassSensorChannelInterface::interface(const QS
 
 bool CompassSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<CompassData> values;
-    if(!read<CompassData>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(const CompassData& data, values)
-        emit dataAvailable(Compass(data, useDeclination_));
+    SampleSpan<CompassData> frame(frameReader_.frame());
+    for(SampleSpan<CompassData>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+        emit dataAvailable(Compass(*it, useDeclination_));
     return true;
 }
 
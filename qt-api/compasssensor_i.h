@@ -138,6 +138,7 @@ Q_SIGNALS:
 private:
 
     bool useDeclination_;
+    FrameReader<CompassData> frameReader_; /**< reused sample buffer */
 };
 
 namespace local {
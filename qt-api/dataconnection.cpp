@@ -0,0 +1,262 @@
+/**
+   @file dataconnection.cpp
+   @brief Data socket shared by the sensors of a client
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "dataconnection.h"
+#include "socketreader.h"
+#include <QThreadStorage>
+#include <QElapsedTimer>
+#include <QDebug>
+
+/**
+ * How long sensord may take to accept the connection or a session.
+ */
+static const int CONNECT_TIMEOUT_MS = 3000;
+
+/**
+ * Larger frames mean the stream is out of sync.
+ */
+static const quint32 MAX_FRAME_SIZE = 1 << 20;
+
+static QThreadStorage<QPointer<DataConnection> > connections;
+
+DataConnection* DataConnection::acquire()
+{
+    DataConnection* connection = connections.localData();
+    if (connection && connection->socket_->state() != QLocalSocket::ConnectedState) {
+        // sensord went away. Sessions on the old connection keep it
+        // until they release it, new ones connect anew.
+        connection->close();
+        connection = NULL;
+    }
+    if (!connection) {
+        connection = new DataConnection;
+        if (!connection->open()) {
+            delete connection;
+            return NULL;
+        }
+        connections.setLocalData(connection);
+    }
+    ++connection->users_;
+    return connection;
+}
+
+void DataConnection::release()
+{
+    if (--users_ > 0)
+        return;
+
+    // Later acquire() connects anew
+    if (connections.localData() == this)
+        connections.setLocalData(QPointer<DataConnection>());
+    socket_->disconnectFromServer();
+    deleteLater();
+}
+
+void DataConnection::close()
+{
+    if (connections.localData() == this)
+        connections.setLocalData(QPointer<DataConnection>());
+    socket_->abort();
+    headerRead_ = false;
+}
+
+QByteArray DataConnection::socketPath()
+{
+    QByteArray path("/var/run/sensord.sock");
+    QByteArray env = qgetenv("SENSORFW_SOCKET_PATH");
+    if (!env.isEmpty())
+        path.prepend(env);
+    return path;
+}
+
+DataConnection::DataConnection() :
+    socket_(NULL),
+    users_(0),
+    waiting_(false),
+    headerRead_(false)
+{
+}
+
+DataConnection::~DataConnection()
+{
+    delete socket_;
+}
+
+bool DataConnection::open()
+{
+    socket_ = new QLocalSocket(this);
+    socket_->connectToServer(QString::fromLocal8Bit(socketPath()), QIODevice::ReadWrite);
+    if (!socket_->waitForConnected(CONNECT_TIMEOUT_MS)) {
+        qDebug() << "[DATACONNECTION]:" << socket_->errorString();
+        return false;
+    }
+
+    sensorfw_wire_hello_t hello;
+    hello.magic = SENSORFW_WIRE_MAGIC;
+    // Qt API samples keep microsecond timestamps, so no version 3
+    hello.version = 2;
+    if (socket_->write((const char*)&hello, sizeof(hello)) != sizeof(hello)) {
+        qDebug() << "[DATACONNECTION]: Hello write failed: " << socket_->errorString();
+        return false;
+    }
+    socket_->flush();
+
+    // sensord greets with a byte before the reply. One not speaking
+    // version 2 closes the connection instead.
+    while (socket_->bytesAvailable() < (qint64)(1 + sizeof(hello))) {
+        if (!socket_->waitForReadyRead(CONNECT_TIMEOUT_MS))
+            return false;
+    }
+    char greeting;
+    socket_->read(&greeting, 1);
+    socket_->read((char*)&hello, sizeof(hello));
+    if (hello.magic != SENSORFW_WIRE_MAGIC || hello.version < 2)
+        return false;
+
+    connect(socket_, SIGNAL(readyRead()), this, SLOT(deliver()));
+    return true;
+}
+
+bool DataConnection::request(quint32 op, int sessionId)
+{
+    sensorfw_wire_request_t message;
+    message.op = op;
+    message.channel = sessionId;
+    if (socket_->write((const char*)&message, sizeof(message)) != sizeof(message)) {
+        qDebug() << "[DATACONNECTION]: Request write failed: " << socket_->errorString();
+        return false;
+    }
+    socket_->flush();
+    return true;
+}
+
+bool DataConnection::attach(int sessionId, SocketReader* reader)
+{
+    readers_.insert(sessionId, reader);
+    reader->acknowledged_ = false;
+    if (!request(SENSORFW_WIRE_ATTACH, sessionId)) {
+        readers_.remove(sessionId);
+        return false;
+    }
+
+    // Session is configured over D-Bus right after this, so sensord
+    // must know it first. Frames of other sessions arriving meanwhile
+    // are delivered from the event loop.
+    waiting_ = true;
+    QElapsedTimer timer;
+    timer.start();
+    while (!reader->acknowledged_) {
+        qint64 remaining = CONNECT_TIMEOUT_MS - timer.elapsed();
+        if (remaining <= 0 || !socket_->waitForReadyRead(remaining))
+            break;
+        deliver();
+    }
+    waiting_ = false;
+
+    if (!reader->acknowledged_) {
+        qWarning() << "[DATACONNECTION]: Session" << sessionId << "was not attached";
+        readers_.remove(sessionId);
+        return false;
+    }
+    return true;
+}
+
+void DataConnection::detach(int sessionId)
+{
+    if (readers_.remove(sessionId) && socket_->state() == QLocalSocket::ConnectedState)
+        request(SENSORFW_WIRE_DETACH, sessionId);
+}
+
+QLocalSocket* DataConnection::socket() const
+{
+    return socket_;
+}
+
+void DataConnection::deliver()
+{
+    QList<QPointer<SocketReader> > updated;
+    if (!readFrames(updated)) {
+        // Frame boundaries are lost for good. Readers see the connection
+        // drop and sessions opened later get a new one.
+        qWarning() << "[DATACONNECTION]: Invalid frame. Closing connection";
+        close();
+    }
+
+    // Readers may release the connection when notified
+    ++users_;
+    foreach (const QPointer<SocketReader>& reader, updated) {
+        if (!reader)
+            continue;
+        if (waiting_)
+            QMetaObject::invokeMethod(reader, "notify", Qt::QueuedConnection);
+        else
+            reader->notify();
+    }
+    release();
+}
+
+bool DataConnection::readFrames(QList<QPointer<SocketReader> >& updated)
+{
+    for (;;) {
+        if (!headerRead_) {
+            if (socket_->bytesAvailable() < (qint64)sizeof(header_))
+                return true;
+            socket_->read((char*)&header_, sizeof(header_));
+            if (header_.headerSize < sizeof(header_) ||
+                header_.size < header_.headerSize ||
+                header_.size > MAX_FRAME_SIZE ||
+                (quint64)header_.count * header_.sampleSize != header_.size - header_.headerSize)
+                return false;
+            headerRead_ = true;
+        }
+
+        // QLocalSocket buffers the rest of the frame until it is complete
+        if (socket_->bytesAvailable() < (qint64)(header_.size - sizeof(header_)))
+            return true;
+        headerRead_ = false;
+        discard(header_.headerSize - sizeof(header_));
+
+        SocketReader* reader = readers_.value(header_.channel);
+        if (!reader) {
+            discard(header_.size - header_.headerSize);
+            continue;
+        }
+        if (header_.count && header_.sampleVersion != SENSORFW_WIRE_SAMPLE_US) {
+            qWarning() << "[DATACONNECTION]: Unsupported sample version" << header_.sampleVersion;
+            discard(header_.size - header_.headerSize);
+            continue;
+        }
+        reader->receiveFrame(header_, socket_);
+        if (!updated.contains(reader))
+            updated.append(reader);
+    }
+}
+
+void DataConnection::discard(qint64 bytes)
+{
+    char buffer[256];
+    while (bytes > 0) {
+        qint64 n = socket_->read(buffer, qMin(bytes, (qint64)sizeof(buffer)));
+        if (n <= 0)
+            break;
+        bytes -= n;
+    }
+}
@@ -0,0 +1,149 @@
+/**
+   @file dataconnection.h
+   @brief Data socket shared by the sensors of a client
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef DATACONNECTION_H
+#define DATACONNECTION_H
+
+#include <QObject>
+#include <QLocalSocket>
+#include <QMap>
+#include <QList>
+#include <QPointer>
+#include "wireprotocol.h"
+
+class SocketReader;
+
+/**
+ * @brief Version 2 data connection to sensord
+ *
+ * All sessions of a thread share one socket. Frames carry the session
+ * they belong to and are handed to the SocketReader of that session.
+ * Frames of every session read in one socket wakeup are delivered before
+ * any reader is notified, so a client of several sensors handles the
+ * samples of a period together.
+ */
+class DataConnection : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(DataConnection)
+
+public:
+    /**
+     * Get connection of the calling thread, connecting on first use.
+     *
+     * @return connection or NULL if sensord does not speak version 2.
+     */
+    static DataConnection* acquire();
+
+    /**
+     * Give up connection got from acquire(). Connection is closed once
+     * every user has released it.
+     */
+    void release();
+
+    /**
+     * Path of the sensord data socket.
+     *
+     * @return socket path.
+     */
+    static QByteArray socketPath();
+
+    /**
+     * Receive frames of a session. Blocks until sensord has attached the
+     * session.
+     *
+     * @param sessionId Session ID.
+     * @param reader Reader of the session.
+     * @return was the session attached.
+     */
+    bool attach(int sessionId, SocketReader* reader);
+
+    /**
+     * Stop receiving frames of a session.
+     *
+     * @param sessionId Session ID.
+     */
+    void detach(int sessionId);
+
+    /**
+     * Socket of the connection.
+     *
+     * @return socket.
+     */
+    QLocalSocket* socket() const;
+
+private Q_SLOTS:
+    /**
+     * Read and deliver frames which have arrived.
+     */
+    void deliver();
+
+private:
+    DataConnection();
+    ~DataConnection();
+
+    /**
+     * Connect and negotiate protocol version.
+     *
+     * @return was version 2 accepted.
+     */
+    bool open();
+
+    /**
+     * Close the socket and stop handing the connection out, after
+     * sensord went away or the stream got out of sync. Users keep the
+     * object until they release it.
+     */
+    void close();
+
+    /**
+     * Send request to sensord.
+     *
+     * @param op Request.
+     * @param sessionId Session ID.
+     * @return was request written.
+     */
+    bool request(quint32 op, int sessionId);
+
+    /**
+     * Hand complete frames to their readers.
+     *
+     * @param updated Readers which received frames are appended.
+     * @return false if the stream is corrupted.
+     */
+    bool readFrames(QList<QPointer<SocketReader> >& updated);
+
+    /**
+     * Read and throw away bytes from the socket.
+     *
+     * @param bytes Number of bytes.
+     */
+    void discard(qint64 bytes);
+
+    QLocalSocket*              socket_;     /**< shared data socket */
+    QMap<int, SocketReader*>   readers_;    /**< readers by session ID */
+    int                        users_;      /**< acquire() references */
+    bool                       waiting_;    /**< attach() waits for sensord */
+    bool                       headerRead_; /**< header_ of next frame read */
+    sensorfw_wire_frame_t      header_;     /**< header of next frame */
+};
+
+#endif // DATACONNECTION_H
@@ -0,0 +1,169 @@
+/**
+   @file framereader.h
+   @brief Allocation free reading of sample frames from sensord
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef FRAMEREADER_H
+#define FRAMEREADER_H
+
+#include <QVector>
+#include "socketreader.h"
+
+/**
+ * Read-only view to consecutive samples. A view made of a QVector shares
+ * it, so the samples stay valid as long as the view even if the vector
+ * is written meanwhile. Other views do not own the samples; see the
+ * provider for how long they stay valid.
+ *
+ * @tparam T sample type.
+ */
+template <class T>
+class SampleSpan
+{
+public:
+    typedef const T* const_iterator;
+
+    /**
+     * Constructor.
+     *
+     * @param data First sample.
+     * @param size Number of samples.
+     */
+    SampleSpan(const T* data = 0, int size = 0) :
+        data_(data),
+        size_(size)
+    {
+    }
+
+    /**
+     * Constructor sharing sample storage.
+     *
+     * @param storage Samples.
+     * @param size Number of samples from the start of storage.
+     */
+    SampleSpan(const QVector<T>& storage, int size) :
+        storage_(storage),
+        data_(storage_.constData()),
+        size_(size)
+    {
+    }
+
+    const_iterator begin() const { return data_; }
+    const_iterator end() const { return data_ + size_; }
+
+    /**
+     * Number of samples.
+     */
+    int size() const { return size_; }
+
+    /**
+     * Is the view empty.
+     */
+    bool isEmpty() const { return size_ == 0; }
+
+    /**
+     * Sample at index.
+     */
+    const T& operator[](int i) const { return data_[i]; }
+
+    /**
+     * Oldest sample. View must not be empty.
+     */
+    const T& first() const { return data_[0]; }
+
+    /**
+     * Newest sample. View must not be empty.
+     */
+    const T& last() const { return data_[size_ - 1]; }
+
+private:
+    QVector<T> storage_; /**< shared storage, empty for plain views */
+    const T*   data_;    /**< first sample */
+    int        size_;    /**< number of samples */
+};
+
+/**
+ * Receiver of sample frames called directly from the data socket
+ * handler, without signals and without converting samples to their
+ * QObject wrappers.
+ *
+ * @tparam T sample type.
+ */
+template <class T>
+class FrameSink
+{
+public:
+    virtual ~FrameSink() {}
+
+    /**
+     * New samples are available.
+     *
+     * @param frame Samples, valid only during the call.
+     */
+    virtual void frameAvailable(const SampleSpan<T>& frame) = 0;
+};
+
+/**
+ * Reads sample frames from a SocketReader into a buffer which is kept
+ * between reads, so nothing is allocated once the buffer has grown to
+ * the largest frame. Frames share the buffer: a read made while a
+ * previous frame is still in use, e.g. from a slot spinning the event
+ * loop, detaches it and leaves that frame intact.
+ *
+ * @tparam T sample type.
+ */
+template <class T>
+class FrameReader
+{
+public:
+    FrameReader() :
+        count_(0)
+    {
+    }
+
+    /**
+     * Read pending samples. Replaces the previous frame.
+     *
+     * @param reader Data connection.
+     * @return false if reading failed. The frame may be empty otherwise.
+     */
+    bool read(SocketReader& reader)
+    {
+        count_ = reader.readFrame(storage_);
+        if (count_ < 0) {
+            count_ = 0;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Samples of the last read. They stay valid as long as the frame.
+     */
+    SampleSpan<T> frame() const
+    {
+        return SampleSpan<T>(storage_, count_);
+    }
+
+private:
+    QVector<T> storage_; /**< reused sample buffer */
+    int        count_;   /**< samples of last read */
+};
+
+#endif // FRAMEREADER_H
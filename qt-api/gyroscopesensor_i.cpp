@@ -39,7 +39,8 @@ AbstractSensorChannelInterface* GyroscopeSensorChannelInterface::factoryMethod(c
 
 GyroscopeSensorChannelInterface::GyroscopeSensorChannelInterface(const QString &path, int sessionId)
     : AbstractSensorChannelInterface(path, GyroscopeSensorChannelInterface::staticInterfaceName, sessionId),
-      frameAvailableConnected(false)
+      frameAvailableConnected(false),
+      frameSink_(0)
 {
 }
 
@@ -67,25 +68,37 @@ GyroscopeSensorChannelInterface* GyroscopeSensorChannelInterface::interface(cons
 
 bool GyroscopeSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedXyzData> values;
-    if(!read<TimedXyzData>(values))
+    if(!readFrame(frameReader_))
         return false;
-    if(!frameAvailableConnected || values.size() == 1)
+    SampleSpan<TimedXyzData> frame(frameReader_.frame());
+    if(frame.isEmpty())
+        return true;
+    if(frameSink_)
     {
-        foreach(const TimedXyzData& data, values)
-            emit dataAvailable(XYZ(data));
+        frameSink_->frameAvailable(frame);
+        return true;
+    }
+    if(!frameAvailableConnected || frame.size() == 1)
+    {
+        for(SampleSpan<TimedXyzData>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+            emit dataAvailable(XYZ(*it));
     }
     else
     {
         QVector<XYZ> realValues;
-        realValues.reserve(values.size());
-        foreach(const TimedXyzData& data, values)
-            realValues.push_back(XYZ(data));
+        realValues.reserve(frame.size());
+        for(SampleSpan<TimedXyzData>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+            realValues.push_back(XYZ(*it));
         emit frameAvailable(realValues);
     }
     return true;
 }
 
+void GyroscopeSensorChannelInterface::setFrameSink(FrameSink<TimedXyzData>* sink)
+{
+    frameSink_ = sink;
+}
+
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 void GyroscopeSensorChannelInterface::connectNotify(const char* signal)
 #else
@@ -62,11 +62,11 @@ HumiditySensorChannelInterface* HumiditySensorChannelInterface::interface(const
 
 bool HumiditySensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedUnsigned> values;
-    if(!read<TimedUnsigned>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(const TimedUnsigned& data, values)
-        emit relativeHumidityChanged(data);
+    SampleSpan<TimedUnsigned> frame(frameReader_.frame());
+    for(SampleSpan<TimedUnsigned>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+        emit relativeHumidityChanged(*it);
     return true;
 }
 
@@ -102,6 +102,9 @@ public:
 protected:
     virtual bool dataReceivedImpl();
 
+private:
+    FrameReader<TimedUnsigned> frameReader_; /**< reused sample buffer */
+
 Q_SIGNALS:
     /**
      * Sent when measured relative humidity has changed.
@@ -62,11 +62,11 @@ LidSensorChannelInterface* LidSensorChannelInterface::interface(const QString& i
 
 bool LidSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<LidData> values;
-    if (!read<LidData>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(const LidData &data, values)
-        emit lidChanged(data);
+    SampleSpan<LidData> frame(frameReader_.frame());
+    for(SampleSpan<LidData>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+        emit lidChanged(*it);
     return true;
 }
 
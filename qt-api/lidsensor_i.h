@@ -99,6 +99,9 @@ public:
 protected:
     virtual bool dataReceivedImpl();
 
+private:
+    FrameReader<LidData> frameReader_; /**< reused sample buffer */
+
 Q_SIGNALS:
     /**
      * Sent when measured ambient light intensity has changed.
@@ -37,7 +37,8 @@ AbstractSensorChannelInterface* MagnetometerSensorChannelInterface::factoryMetho
 
 MagnetometerSensorChannelInterface::MagnetometerSensorChannelInterface(const QString& path, int sessionId) :
     AbstractSensorChannelInterface(path, MagnetometerSensorChannelInterface::staticInterfaceName, sessionId),
-    frameAvailableConnected(false)
+    frameAvailableConnected(false),
+    frameSink_(0)
 {
 }
 
@@ -64,25 +65,37 @@ MagnetometerSensorChannelInterface* MagnetometerSensorChannelInterface::interfac
 
 bool MagnetometerSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<CalibratedMagneticFieldData> values;
-    if(!read<CalibratedMagneticFieldData>(values))
+    if(!readFrame(frameReader_))
         return false;
-    if(!frameAvailableConnected || values.size() == 1)
+    SampleSpan<CalibratedMagneticFieldData> frame(frameReader_.frame());
+    if(frame.isEmpty())
+        return true;
+    if(frameSink_)
     {
-        foreach(const CalibratedMagneticFieldData& data, values)
-            emit dataAvailable(MagneticField(data));
+        frameSink_->frameAvailable(frame);
+        return true;
+    }
+    if(!frameAvailableConnected || frame.size() == 1)
+    {
+        for(SampleSpan<CalibratedMagneticFieldData>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+            emit dataAvailable(MagneticField(*it));
     }
     else
     {
         QVector<MagneticField> realValues;
-        realValues.reserve(values.size());
-        foreach(const CalibratedMagneticFieldData& data, values)
-            realValues.push_back(MagneticField(data));
+        realValues.reserve(frame.size());
+        for(SampleSpan<CalibratedMagneticFieldData>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+            realValues.push_back(MagneticField(*it));
         emit frameAvailable(realValues);
     }
     return true;
 }
 
+void MagnetometerSensorChannelInterface::setFrameSink(FrameSink<CalibratedMagneticFieldData>* sink)
+{
+    frameSink_ = sink;
+}
+
 #if QT_VERSION < QT_VERSION_CHECK(5, 0, 0)
 void MagnetometerSensorChannelInterface::connectNotify(const char* signal)
 #else
@@ -65,6 +65,16 @@ public:
      */
     MagneticField magneticField();
 
+    /**
+     * Deliver samples to a sink instead of dataAvailable and
+     * frameAvailable signals. The sink is called directly when data
+     * arrives and gets the samples without QObject wrappers, so nothing
+     * is allocated per sample.
+     *
+     * @param sink sink, or NULL to use signals.
+     */
+    void setFrameSink(FrameSink<CalibratedMagneticFieldData>* sink);
+
     /**
      * Constructor.
      *
@@ -109,6 +119,8 @@ protected:
 
 private:
     bool frameAvailableConnected; /**< has applicaiton connected slot for frameAvailable signal. */
+    FrameReader<CalibratedMagneticFieldData> frameReader_; /**< reused sample buffer */
+    FrameSink<CalibratedMagneticFieldData>* frameSink_; /**< receiver of samples instead of signals, or NULL */
 
 public Q_SLOTS:
     /**
@@ -62,11 +62,11 @@ OrientationSensorChannelInterface* OrientationSensorChannelInterface::interface(
 
 bool OrientationSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedUnsigned> values;
-    if(!read<TimedUnsigned>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(const TimedUnsigned& data, values)
-        emit orientationChanged(data);
+    SampleSpan<TimedUnsigned> frame(frameReader_.frame());
+    for(SampleSpan<TimedUnsigned>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+        emit orientationChanged(*it);
     return true;
 }
 
@@ -118,6 +118,9 @@ public:
 protected:
     virtual bool dataReceivedImpl();
 
+private:
+    FrameReader<TimedUnsigned> frameReader_; /**< reused sample buffer */
+
 Q_SIGNALS:
     /**
      * Sent when device orientation has changed.
@@ -62,11 +62,11 @@ PressureSensorChannelInterface* PressureSensorChannelInterface::interface(const
 
 bool PressureSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedUnsigned> values;
-    if(!read<TimedUnsigned>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(const TimedUnsigned& data, values)
-        emit pressureChanged(data);
+    SampleSpan<TimedUnsigned> frame(frameReader_.frame());
+    for(SampleSpan<TimedUnsigned>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+        emit pressureChanged(*it);
     return true;
 }
 
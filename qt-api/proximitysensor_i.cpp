@@ -63,12 +63,12 @@ ProximitySensorChannelInterface* ProximitySensorChannelInterface::interface(cons
 
 bool ProximitySensorChannelInterface::dataReceivedImpl()
 {
-    QVector<ProximityData> values;
-    if(!read<ProximityData>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(const ProximityData& data, values)
+    SampleSpan<ProximityData> frame(frameReader_.frame());
+    for(SampleSpan<ProximityData>::const_iterator it = frame.begin(); it != frame.end(); ++it)
     {
-        Proximity proximity(data);
+        Proximity proximity(*it);
         emit dataAvailable(proximity);
         emit reflectanceDataAvailable(proximity);
     }
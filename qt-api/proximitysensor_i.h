@@ -112,6 +112,9 @@ public:
 protected:
     virtual bool dataReceivedImpl();
 
+private:
+    FrameReader<ProximityData> frameReader_; /**< reused sample buffer */
+
 Q_SIGNALS:
     /**
      * Sent when new measurement data has become available.
@@ -9,6 +9,7 @@ SOURCES += sensormanagerinterface.cpp \
     sensormanager_i.cpp \
     abstractsensor_i.cpp \
     socketreader.cpp \
+    dataconnection.cpp \
     compasssensor_i.cpp \
     orientationsensor_i.cpp \
     accelerometersensor_i.cpp \
@@ -28,6 +29,9 @@ HEADERS += sensormanagerinterface.h \
     sensormanager_i.h \
     abstractsensor_i.h \
     socketreader.h \
+    dataconnection.h \
+    ../include/wireprotocol.h \
+    framereader.h \
     compasssensor_i.h \
     orientationsensor_i.h \
     accelerometersensor_i.h \
@@ -67,6 +67,16 @@ public:
      */
     XYZ rotation();
 
+    /**
+     * Deliver samples to a sink instead of dataAvailable and
+     * frameAvailable signals. The sink is called directly when data
+     * arrives and gets the samples without QObject wrappers, so nothing
+     * is allocated per sample.
+     *
+     * @param sink sink, or NULL to use signals.
+     */
+    void setFrameSink(FrameSink<TimedXyzData>* sink);
+
     /**
      * Does reported readings include Z coordinate.
      *
@@ -119,6 +129,8 @@ protected:
 
 private:
     bool frameAvailableConnected; /**< has applicaiton connected slot for frameAvailable signal. */
+    FrameReader<TimedXyzData> frameReader_; /**< reused sample buffer */
+    FrameSink<TimedXyzData>* frameSink_; /**< receiver of samples instead of signals, or NULL */
 
 Q_SIGNALS:
     /**
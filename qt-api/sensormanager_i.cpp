@@ -144,3 +144,8 @@ void LocalSensorManagerInterface::releaseSensorFinished(QDBusPendingCallWatcher
     }
     Q_EMIT releaseSensorFinished();
 }
+
+QDBusReply<QDBusUnixFileDescriptor> LocalSensorManagerInterface::latestSampleMemory()
+{
+    return call(QDBus::Block, QLatin1String("latestSampleMemory"));
+}
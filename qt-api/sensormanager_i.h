@@ -106,6 +106,14 @@ public Q_SLOTS:
      */
     QDBusReply<bool> releaseSensor(const QString& id, int sessionId);
 
+    /**
+     * Request read-only descriptor of the latest sample table of sensor
+     * daemon.
+     *
+     * @return DBus reply.
+     */
+    QDBusReply<QDBusUnixFileDescriptor> latestSampleMemory();
+
 Q_SIGNALS:
 
     /**
@@ -28,13 +28,33 @@
 #include "serviceinfo.h"
 #include "idutils.h"
 #include "sensormanagerinterface.h"
+#include "latestsampletable.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 SensorManagerInterface* SensorManagerInterface::ifc_ = 0;
 QMutex SensorManagerInterface::mutex_;
 
 SensorManagerInterface::SensorManagerInterface()
-  : LocalSensorManagerInterface( SERVICE_NAME, OBJECT_PATH, QDBusConnection::systemBus() )
+  : LocalSensorManagerInterface( SERVICE_NAME, OBJECT_PATH, QDBusConnection::systemBus() ),
+    latestTable_(0),
+    latestMapping_(0),
+    latestMappingSize_(0),
+    latestMapTried_(false)
 {
+    QDBusServiceWatcher* watcher = new QDBusServiceWatcher(SERVICE_NAME, QDBusConnection::systemBus(),
+                                                           QDBusServiceWatcher::WatchForOwnerChange, this);
+    connect(watcher, SIGNAL(serviceOwnerChanged(QString,QString,QString)), this, SLOT(dropLatestSampleTable()));
+}
+
+SensorManagerInterface::~SensorManagerInterface()
+{
+    dropLatestSampleTable();
+    foreach ( const RetiredTable& retired, retiredTables_ )
+    {
+        delete retired.table;
+        munmap(retired.mapping, retired.mappingSize);
+    }
 }
 
 SensorManagerInterface& SensorManagerInterface::instance()
@@ -93,3 +113,53 @@ bool SensorManagerInterface::releaseInterface(const QString& id, int sessionId)
     }
     return reply.value();
 }
+
+const LatestSampleTable* SensorManagerInterface::latestSampleTable()
+{
+    QMutexLocker locker(&mutex_);
+    if ( latestMapTried_ )
+        return latestTable_;
+    latestMapTried_ = true;
+
+    QDBusReply<QDBusUnixFileDescriptor> reply = latestSampleMemory();
+    if ( !reply.isValid() || !reply.value().isValid() )
+    {
+        qDebug() << "Latest sample table not shared, using D-Bus";
+        return 0;
+    }
+
+    int fd = reply.value().fileDescriptor();
+    struct stat st;
+    if ( fstat(fd, &st) != 0 )
+        return 0;
+    void* mapping = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if ( mapping == MAP_FAILED )
+        return 0;
+
+    LatestSampleTable* table = new LatestSampleTable(mapping);
+    if ( !table->attach(st.st_size) )
+    {
+        qDebug() << "Incompatible latest sample table";
+        delete table;
+        munmap(mapping, st.st_size);
+        return 0;
+    }
+    latestTable_ = table;
+    latestMapping_ = mapping;
+    latestMappingSize_ = st.st_size;
+    return latestTable_;
+}
+
+void SensorManagerInterface::dropLatestSampleTable()
+{
+    QMutexLocker locker(&mutex_);
+    if ( latestTable_ )
+    {
+        RetiredTable retired = { latestTable_, latestMapping_, latestMappingSize_ };
+        retiredTables_.append(retired);
+    }
+    latestTable_ = 0;
+    latestMapping_ = 0;
+    latestMappingSize_ = 0;
+    latestMapTried_ = false;
+}
@@ -33,6 +33,8 @@
 #include "sensormanager_i.h"
 #include "abstractsensor_i.h"
 
+class LatestSampleTable;
+
 typedef AbstractSensorChannelInterface* (*SensorInterfaceFactoryMethod)(const QString& id, int sessionId);
 
 struct SensorInterfaceEntry {
@@ -55,12 +57,40 @@ public:
 
     bool registeredAndCorrectClassName(const QString& id, const QString& className ) const;
 
+    /**
+     * Latest sample table of sensor daemon, mapped read-only on first
+     * use.
+     *
+     * @return table, or NULL if sensor daemon does not share it.
+     */
+    const LatestSampleTable* latestSampleTable();
+
+private Q_SLOTS:
+    /**
+     * Forget the latest sample table when sensor daemon goes away or
+     * restarts, so that the next use maps the table of the new one.
+     */
+    void dropLatestSampleTable();
+
 protected:
     SensorManagerInterface();
-    virtual ~SensorManagerInterface() {}
+    virtual ~SensorManagerInterface();
 
     QMap<QString, SensorInterfaceEntry> sensorInterfaceMap_;
 
+    LatestSampleTable* latestTable_;       /**< mapped table or NULL */
+    void*              latestMapping_;     /**< table mapping */
+    size_t             latestMappingSize_; /**< size of table mapping */
+    bool               latestMapTried_;    /**< has mapping been tried */
+
+    struct RetiredTable {
+        LatestSampleTable* table;
+        void*              mapping;
+        size_t             mappingSize;
+    };
+    /** Tables of previous daemons. Kept mapped, readers may still use them. */
+    QList<RetiredTable> retiredTables_;
+
     static SensorManagerInterface* ifc_;
     static QMutex mutex_;
 };
@@ -25,45 +25,94 @@
  */
 
 #include "socketreader.h"
+#include "dataconnection.h"
+#include "sharedsamplering.h"
+#include "wireprotocol.h"
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
 
 const char* SocketReader::channelIDString = "_SENSORCHANNEL_";
 
 SocketReader::SocketReader(QObject* parent) :
     QObject(parent),
     socket_(NULL),
-    tagRead_(false)
+    connection_(NULL),
+    sessionId_(-1),
+    sampleSize_(0),
+    sequence_(0),
+    dropped_(0),
+    acknowledged_(false),
+    tagRead_(false),
+    ring_(NULL),
+    ringMapping_(NULL),
+    ringMappingSize_(0)
 {
+    // Emptying keeps reserved capacity, so steady streams do not allocate
+    pending_.reserve(1024);
 }
 
 SocketReader::~SocketReader()
 {
-    if (socket_) {
+    if (socket_ || connection_) {
         dropConnection();
     }
 }
 
 bool SocketReader::initiateConnection(int sessionId)
 {
-    if (socket_ != NULL) {
+    if (socket_ != NULL || connection_ != NULL) {
         qDebug() << "attempting to initiate connection on connected socket";
         return false;
     }
 
-    socket_ = new QLocalSocket(this);
-    const char* SOCKET_NAME = "/var/run/sensord.sock";
-    QByteArray env = qgetenv("SENSORFW_SOCKET_PATH");
-    if (!env.isEmpty()) {
-        env += SOCKET_NAME;
-        SOCKET_NAME = env;
+    // Shared memory needs a socket per session for its wakeups
+    if (qgetenv("SENSORFW_SHARED_MEMORY") != "1") {
+        connection_ = DataConnection::acquire();
+        if (connection_) {
+            // Stale samples of a previous session must not leak in
+            pending_.resize(0);
+            sampleSize_ = 0;
+            sequence_ = 0;
+            dropped_ = 0;
+            sessionId_ = sessionId;
+            if (connection_->attach(sessionId, this))
+                return true;
+            connection_->release();
+            connection_ = NULL;
+            sessionId_ = -1;
+            return false;
+        }
+        qDebug() << "[SOCKETREADER]: sensord does not share connections, using own socket";
     }
 
-    socket_->connectToServer(SOCKET_NAME, QIODevice::ReadWrite);
+    return connectSocket(sessionId);
+}
+
+bool SocketReader::connectSocket(int sessionId)
+{
+    socket_ = new QLocalSocket(this);
+    connect(socket_, SIGNAL(readyRead()), this, SIGNAL(readyRead()));
+    socket_->connectToServer(QString::fromLocal8Bit(DataConnection::socketPath()), QIODevice::ReadWrite);
 
     if (!(socket_->serverName().size())) {
         qDebug() << socket_->errorString();
         return false;
     }
 
+    if (qgetenv("SENSORFW_SHARED_MEMORY") == "1") {
+        // Tag is read first so that QLocalSocket has nothing buffered
+        // when the reply carrying the memory descriptor arrives.
+        readSocketTag();
+        if (!setupSharedMemory(sessionId))
+            qDebug() << "[SOCKETREADER]: Shared memory not available, using socket";
+        return true;
+    }
+
     if (socket_->write((const char*)&sessionId, sizeof(sessionId)) != sizeof(sessionId)) {
         qDebug() << "[SOCKETREADER]: SessionId write failed: " << socket_->errorString();
     }
@@ -75,6 +124,15 @@ bool SocketReader::initiateConnection(int sessionId)
 
 bool SocketReader::dropConnection()
 {
+    if (connection_) {
+        connection_->detach(sessionId_);
+        connection_->release();
+        connection_ = NULL;
+        sessionId_ = -1;
+        pending_.resize(0);
+        return true;
+    }
+
     if (!socket_)
         return false;
 
@@ -86,12 +144,80 @@ bool SocketReader::dropConnection()
 
     tagRead_ = false;
 
+    delete ring_;
+    ring_ = NULL;
+    if (ringMapping_) {
+        munmap(ringMapping_, ringMappingSize_);
+        ringMapping_ = NULL;
+    }
+
     return true;
 }
 
 QLocalSocket* SocketReader::socket()
 {
-    return socket_;
+    return connection_ ? connection_->socket() : socket_;
+}
+
+void SocketReader::notify()
+{
+    emit readyRead();
+}
+
+void SocketReader::receiveFrame(const sensorfw_wire_frame& header, QLocalSocket* socket)
+{
+    acknowledged_ = true;
+    if (header.sequence != sequence_)
+        qWarning() << "[SOCKETREADER]: Frames" << sequence_ << "to" << header.sequence << "of session" << sessionId_ << "missing";
+    sequence_ = header.sequence + 1;
+    if (header.dropped != dropped_) {
+        qWarning() << "[SOCKETREADER]: sensord dropped" << (quint32)(header.dropped - dropped_) << "sample(s) of session" << sessionId_;
+        dropped_ = header.dropped;
+    }
+    if (!header.count)
+        return;
+
+    // Samples of different size can not be read together
+    if (header.sampleSize != sampleSize_) {
+        pending_.resize(0);
+        sampleSize_ = header.sampleSize;
+    }
+    int bytes = header.size - header.headerSize;
+    int offset = pending_.size();
+    pending_.resize(offset + bytes);
+    socket->read(pending_.data() + offset, bytes);
+}
+
+int SocketReader::pendingSamples(int size)
+{
+    if (pending_.isEmpty())
+        return 0;
+    if (sampleSize_ != size) {
+        qWarning() << "[SOCKETREADER]: Expected samples of" << size << "bytes, received" << sampleSize_;
+        pending_.resize(0);
+        return 0;
+    }
+    return pending_.size() / size;
+}
+
+void SocketReader::takePendingSamples(void* buffer, int size, int count)
+{
+    memcpy(buffer, pending_.constData(), size * count);
+    pending_.remove(0, size * count);
+}
+
+bool SocketReader::hasPendingData() const
+{
+    if (connection_)
+        return !pending_.isEmpty();
+    return socket_ && socket_->bytesAvailable() > 0;
+}
+
+unsigned long SocketReader::droppedSamples() const
+{
+    if (ring_)
+        return ring_->dropped();
+    return dropped_;
 }
 
 bool SocketReader::readSocketTag()
@@ -104,11 +230,19 @@ bool SocketReader::readSocketTag()
 
 bool SocketReader::read(void* buffer, int size)
 {
+    if (connection_) {
+        if (pending_.size() < size)
+            return false;
+        memcpy(buffer, pending_.constData(), size);
+        pending_.remove(0, size);
+        return true;
+    }
+
     int bytesRead = 0;
     int retry = 100;
     while(bytesRead < size)
     {
-        int bytes = socket_->read((char *)buffer + bytesRead, size);
+        int bytes = socket_->read((char *)buffer + bytesRead, size - bytesRead);
         if(bytes == 0)
         {
             if(!retry)
@@ -129,5 +263,125 @@ bool SocketReader::read(void* buffer, int size)
 
 bool SocketReader::isConnected()
 {
-    return (socket_ && socket_->isValid() && socket_->state() == QLocalSocket::ConnectedState);
+    QLocalSocket* current = socket();
+    return (current && current->isValid() && current->state() == QLocalSocket::ConnectedState);
+}
+
+bool SocketReader::isSharedMemory() const
+{
+    return ring_ != NULL;
+}
+
+bool SocketReader::setupSharedMemory(int sessionId)
+{
+    quint32 request[2] = { (quint32)sessionId, SHARED_MEMORY_REQUEST };
+    if (socket_->write((const char*)request, sizeof(request)) != sizeof(request)) {
+        qDebug() << "[SOCKETREADER]: SessionId write failed: " << socket_->errorString();
+        return false;
+    }
+    socket_->flush();
+
+    // Reply is received directly from the descriptor, QLocalSocket would
+    // drop the passed file descriptor.
+    int fd = socket_->socketDescriptor();
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, 3000) <= 0) {
+        qDebug() << "[SOCKETREADER]: No reply to shared memory request";
+        return false;
+    }
+
+    char status = 0;
+    struct iovec iov;
+    iov.iov_base = &status;
+    iov.iov_len = 1;
+
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    if (recvmsg(fd, &msg, MSG_CMSG_CLOEXEC) != 1)
+        return false;
+
+    int memfd = -1;
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        memcpy(&memfd, CMSG_DATA(cmsg), sizeof(int));
+    if (!status || memfd < 0) {
+        if (memfd >= 0)
+            close(memfd);
+        return false;
+    }
+
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if (fstat(memfd, &st) == 0)
+        mapping = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    close(memfd);
+    if (mapping == MAP_FAILED) {
+        qWarning() << "[SOCKETREADER]: Failed to map shared memory: " << strerror(errno);
+        return false;
+    }
+
+    SharedSampleRing* ring = new SharedSampleRing(mapping);
+    if (!ring->attach(st.st_size)) {
+        qWarning() << "[SOCKETREADER]: Incompatible shared memory ring";
+        delete ring;
+        munmap(mapping, st.st_size);
+        return false;
+    }
+
+    ring_ = ring;
+    ringMapping_ = mapping;
+    ringMappingSize_ = st.st_size;
+    return true;
+}
+
+int SocketReader::sharedMemoryAvailable() const
+{
+    return ring_->available();
+}
+
+int SocketReader::readSharedMemory(void* buffer, int size, int maxCount)
+{
+    return ring_->read(buffer, size, maxCount);
+}
+
+bool SocketReader::armSharedMemory()
+{
+    return ring_->arm();
+}
+
+void SocketReader::discardWakeups()
+{
+    char discard[64];
+    while (socket_->read(discard, sizeof(discard)) > 0)
+        ;
+}
+
+int SocketReader::readFrameCount()
+{
+    unsigned int count;
+    if(!read((void*)&count, sizeof(unsigned int)))
+    {
+        socket_->readAll();
+        return -1;
+    }
+    if(count > 1000)
+    {
+        qWarning() << "Too many samples waiting in socket. Flushing it to empty";
+        socket_->readAll();
+        return -1;
+    }
+    return count;
 }
@@ -30,6 +30,11 @@
 #include <QObject>
 #include <QLocalSocket>
 #include <QVector>
+#include <QByteArray>
+
+class SharedSampleRing;
+class DataConnection;
+struct sensorfw_wire_frame;
 
 /**
  * @brief Helper class for reading socket datachannel from sensord
@@ -37,6 +42,10 @@
  * SocketReader provides common handler for all sensors using socket
  * data channel. It is used by AbstractSensorChannelInterface to maintain
  * the socket connection to the server.
+ *
+ * Sessions share the DataConnection of their thread when sensord speaks
+ * protocol version 2, see wireprotocol.h. Otherwise, and with shared
+ * memory transport, every session has a socket of its own.
  */
 class SocketReader : public QObject
 {
@@ -58,7 +67,8 @@ public:
     ~SocketReader();
 
     /**
-     * Initiates new data socket connection.
+     * Initiates new data socket connection or attaches the session to
+     * the shared one.
      *
      * @param sessionId ID for the current session.
      * @return was the connection established successfully.
@@ -72,7 +82,8 @@ public:
     bool dropConnection();
 
     /**
-     * Provides access to the internal QLocalSocket for direct reading.
+     * Provides access to the internal QLocalSocket. With a shared
+     * connection the socket carries samples of other sessions as well.
      *
      * @return Pointer to the internal QLocalSocket. Pointer can be \c NULL
      *         if \c initiateConnection() has not been called successfully.
@@ -102,6 +113,35 @@ public:
     template<typename T>
     bool read(QVector<T>& values);
 
+    /**
+     * Read pending objects to the start of a buffer. The buffer is grown
+     * when a frame does not fit but never shrunk, so a buffer reused
+     * between calls stops being reallocated.
+     *
+     * @param storage Buffer for objects. Its size is the capacity, not
+     *                the number of objects read.
+     * @tparam T type of expected object in the stream.
+     * @return number of objects read, -1 on error.
+     */
+    template<typename T>
+    int readFrame(QVector<T>& storage);
+
+    /**
+     * Are there received samples or socket data left to read.
+     *
+     * @return is there something to read.
+     */
+    bool hasPendingData() const;
+
+    /**
+     * Number of samples sensord has dropped because the client did not
+     * keep up. Only known with a shared connection; samples lost in
+     * shared memory are counted there.
+     *
+     * @return dropped samples.
+     */
+    unsigned long droppedSamples() const;
+
     /**
      * Returns whether the socket is currently connected.
      *
@@ -109,7 +149,109 @@ public:
      */
     bool isConnected();
 
+    /**
+     * Returns whether samples are received through shared memory. The
+     * transport is requested by setting SENSORFW_SHARED_MEMORY=1 in the
+     * environment.
+     *
+     * @return is shared memory used.
+     */
+    bool isSharedMemory() const;
+
+Q_SIGNALS:
+    /**
+     * Samples of the session have arrived.
+     */
+    void readyRead();
+
+private Q_SLOTS:
+    /**
+     * Emit readyRead() for samples received by the shared connection.
+     */
+    void notify();
+
 private:
+    friend class DataConnection;
+
+    /**
+     * Open socket of the session's own.
+     *
+     * @param sessionId ID for the current session.
+     * @return was the connection established successfully.
+     */
+    bool connectSocket(int sessionId);
+
+    /**
+     * Append frame from the shared connection to the received samples.
+     *
+     * @param header Frame header.
+     * @param socket Socket positioned at the samples.
+     */
+    void receiveFrame(const sensorfw_wire_frame& header, QLocalSocket* socket);
+
+    /**
+     * Received samples of the shared connection.
+     *
+     * @param size Expected sample size. Samples of other size are
+     *             thrown away.
+     * @return number of samples.
+     */
+    int pendingSamples(int size);
+
+    /**
+     * Copy out received samples of the shared connection.
+     *
+     * @param buffer Destination.
+     * @param size Size of single sample.
+     * @param count Number of samples, at most pendingSamples().
+     */
+    void takePendingSamples(void* buffer, int size, int count);
+
+    /**
+     * Ask sensord for shared memory transport and map the ring.
+     *
+     * @param sessionId ID for the current session.
+     * @return was shared memory set up.
+     */
+    bool setupSharedMemory(int sessionId);
+
+    /**
+     * Samples available in shared memory ring.
+     *
+     * @return number of samples.
+     */
+    int sharedMemoryAvailable() const;
+
+    /**
+     * Copy samples out of the shared memory ring.
+     *
+     * @param buffer Destination.
+     * @param size Size of single sample.
+     * @param maxCount Capacity of buffer in samples.
+     * @return number of samples copied.
+     */
+    int readSharedMemory(void* buffer, int size, int maxCount);
+
+    /**
+     * Request wakeup for new samples in shared memory ring.
+     *
+     * @return true if samples arrived meanwhile.
+     */
+    bool armSharedMemory();
+
+    /**
+     * Discard wakeup bytes of shared memory transport from the socket
+     * without allocating.
+     */
+    void discardWakeups();
+
+    /**
+     * Read sample count of the next frame from the socket.
+     *
+     * @return sample count, -1 on error.
+     */
+    int readFrameCount();
+
     /**
      * Prefix text needed to be written to the sensor daemon socket connection
      * when establishing new session.
@@ -121,37 +263,105 @@ private:
      */
     bool readSocketTag();
 
-    QLocalSocket* socket_; /**< socket data connection to sensord */
+    QLocalSocket* socket_; /**< own socket data connection to sensord */
+    DataConnection* connection_; /**< shared data connection or NULL */
+    int sessionId_; /**< session attached to connection_ */
+    QByteArray pending_; /**< samples received by connection_ */
+    int sampleSize_; /**< size of samples in pending_ */
+    quint32 sequence_; /**< expected sequence number of next frame */
+    unsigned long dropped_; /**< samples dropped by sensord */
+    bool acknowledged_; /**< sensord has attached the session */
     bool tagRead_; /**< is initial magic byte read from the socket */
+    SharedSampleRing* ring_; /**< shared memory ring or NULL */
+    void* ringMapping_; /**< mapping of the ring */
+    size_t ringMappingSize_; /**< size of ring mapping */
 };
 
 template<typename T>
 bool SocketReader::read(QVector<T>& values)
 {
+    if (connection_) {
+        int count = pendingSamples(sizeof(T));
+        if (!count)
+            return false;
+        int first = values.size();
+        values.resize(first + count);
+        takePendingSamples((void*)(values.data() + first), sizeof(T), count);
+        return true;
+    }
+
     if (!socket_) {
         return false;
     }
 
-    unsigned int count;
-    if(!read((void*)&count, sizeof(unsigned int)))
-    {
-        socket_->readAll();
-        return false;
+    if (ring_) {
+        // Socket only carries wakeups.
+        discardWakeups();
+        int first = values.size();
+        int start = first;
+        do {
+            int available = sharedMemoryAvailable();
+            values.resize(start + available);
+            start += readSharedMemory((void*)(values.data() + start), sizeof(T), available);
+            values.resize(start);
+        } while (armSharedMemory());
+        return start > first;
     }
-    if(count > 1000)
+
+    int count = readFrameCount();
+    if(count < 0)
+        return false;
+    int first = values.size();
+    values.resize(first + count);
+    if(!read((void*)(values.data() + first), sizeof(T) * count))
     {
-        qWarning() << "Too many samples waiting in socket. Flushing it to empty";
+        qWarning() << "Error occured while reading data from socket: " << socket_->errorString();
         socket_->readAll();
+        values.resize(first);
         return false;
     }
-    values.resize(values.size() + count);
-    if(!read((void*)values.data(), sizeof(T) * count))
+    return true;
+}
+
+template<typename T>
+int SocketReader::readFrame(QVector<T>& storage)
+{
+    if (connection_) {
+        int count = pendingSamples(sizeof(T));
+        if (storage.size() < count)
+            storage.resize(count);
+        takePendingSamples((void*)storage.data(), sizeof(T), count);
+        return count;
+    }
+
+    if (!socket_) {
+        return -1;
+    }
+
+    if (ring_) {
+        discardWakeups();
+        int count = 0;
+        do {
+            int available = sharedMemoryAvailable();
+            if (storage.size() < count + available)
+                storage.resize(count + available);
+            count += readSharedMemory((void*)(storage.data() + count), sizeof(T), available);
+        } while (armSharedMemory());
+        return count;
+    }
+
+    int count = readFrameCount();
+    if(count <= 0)
+        return count;
+    if(storage.size() < count)
+        storage.resize(count);
+    if(!read((void*)storage.data(), sizeof(T) * count))
     {
         qWarning() << "Error occured while reading data from socket: " << socket_->errorString();
         socket_->readAll();
-        return false;
+        return -1;
     }
-    return true;
+    return count;
 }
 
 #endif // SOCKETREADER_H
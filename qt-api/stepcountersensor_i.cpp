@@ -66,11 +66,11 @@ StepCounterSensorChannelInterface* StepCounterSensorChannelInterface::interface(
 
 bool StepCounterSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedUnsigned> values;
-    if(!read<TimedUnsigned>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(const TimedUnsigned& data, values)
-        emit StepCounterChanged(data);
+    SampleSpan<TimedUnsigned> frame(frameReader_.frame());
+    for(SampleSpan<TimedUnsigned>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+        emit StepCounterChanged(*it);
     return true;
 }
 
@@ -105,6 +105,9 @@ public:
 protected:
     virtual bool dataReceivedImpl();
 
+private:
+    FrameReader<TimedUnsigned> frameReader_; /**< reused sample buffer */
+
 Q_SIGNALS:
     /**
      * Sent when measured step count has changed.
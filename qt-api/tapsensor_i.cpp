@@ -66,10 +66,11 @@ TapSensorChannelInterface* TapSensorChannelInterface::interface(const QString& i
 
 bool TapSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TapData> values;
-    if(!read<TapData>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(TapData value, values) {
+    SampleSpan<TapData> frame(frameReader_.frame());
+    for(SampleSpan<TapData>::const_iterator it = frame.begin(); it != frame.end(); ++it) {
+        TapData value(*it);
         if (type_ == Single) {
             emit dataAvailable(Tap(value));
         } else if (timer_->isActive()) {
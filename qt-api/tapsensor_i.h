@@ -137,6 +137,7 @@ private:
     QList<TapData> tapValues_; /**< buffer of received tap values. */
     TapSelection type_; /**< tap type to listen for. */
     QTimer *timer_; /**< timer for doubletap detection. */
+    FrameReader<TapData> frameReader_; /**< reused sample buffer */
     static const int doubleClickInteval = 500; /**< doubletap recognition window */
 };
 
@@ -62,11 +62,11 @@ TemperatureSensorChannelInterface* TemperatureSensorChannelInterface::interface(
 
 bool TemperatureSensorChannelInterface::dataReceivedImpl()
 {
-    QVector<TimedUnsigned> values;
-    if(!read<TimedUnsigned>(values))
+    if(!readFrame(frameReader_))
         return false;
-    foreach(const TimedUnsigned& data, values)
-        emit temperatureChanged(data);
+    SampleSpan<TimedUnsigned> frame(frameReader_.frame());
+    for(SampleSpan<TimedUnsigned>::const_iterator it = frame.begin(); it != frame.end(); ++it)
+        emit temperatureChanged(*it);
     return true;
 }
 
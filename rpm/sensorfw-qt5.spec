@@ -19,6 +19,7 @@ BuildRequires:  pkgconfig(Qt5Core)
 BuildRequires:  pkgconfig(Qt5DBus)
 BuildRequires:  pkgconfig(Qt5Network)
 BuildRequires:  pkgconfig(Qt5Test)
+BuildRequires:  pkgconfig(dbus-1)
 BuildRequires:  pkgconfig(mlite5)
 BuildRequires:  pkgconfig(libsystemd)
 BuildRequires:  pkgconfig(ssu-sysinfo)
@@ -155,8 +156,6 @@ systemctl daemon-reload || :
 %defattr(-,root,root,-)
 %{_libdir}/libsensorfakeopen*.so
 %{_libdir}/libsensorfakeopen*.so.*
-%dir %{_libdir}/sensord-qt5/testing
-%{_libdir}/sensord-qt5/testing/*
 %dir %{_datadir}/sensorfw-tests
 %attr(755,root,root)%{_datadir}/sensorfw-tests/*.p*
 %attr(644,root,root)%{_datadir}/sensorfw-tests/*.xml
@@ -165,12 +164,14 @@ systemctl daemon-reload || :
 %attr(755,root,root)%{_bindir}/sensoradaptors-test
 %attr(755,root,root)%{_bindir}/sensorapi-test
 %attr(755,root,root)%{_bindir}/sensorbenchmark-test
+%attr(755,root,root)%{_bindir}/sensorcapi-test
 %attr(755,root,root)%{_bindir}/sensorchains-test
 %attr(755,root,root)%{_bindir}/sensordataflow-test
 %attr(755,root,root)%{_bindir}/sensord-deadclient
 %attr(755,root,root)%{_bindir}/sensordiverter.sh
 %attr(755,root,root)%{_bindir}/sensordriverpoll-test
 %attr(755,root,root)%{_bindir}/sensordummyclient-qt5
+%attr(755,root,root)%{_bindir}/sensorpipeline-benchmark
 #%attr(755,root,root)%{_bindir}/sensorexternal-test
 %attr(755,root,root)%{_bindir}/sensorfilters-test
 %attr(755,root,root)%{_bindir}/sensormetadata-test
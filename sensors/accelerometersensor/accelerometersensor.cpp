@@ -67,6 +67,7 @@ AccelerometerSensorChannel::AccelerometerSensorChannel(const QString& id) :
 
     // Set MetaData
     setDescription("x, y, and z axes accelerations in mG");
+    setSampleType(SENSORFW_WIRE_SAMPLE_XYZ);
     setRangeSource(accelerometerChain_);
     addStandbyOverrideSource(accelerometerChain_);
     setIntervalSource(accelerometerChain_);
@@ -87,6 +87,7 @@ ALSSensorChannel::ALSSensorChannel(const QString& id) :
 #endif
 
     setDescription("ambient light intensity in lux");
+    setSampleType(SENSORFW_WIRE_SAMPLE_UNSIGNED);
     setRangeSource(alsAdaptor_);
     addStandbyOverrideSource(alsAdaptor_);
     setIntervalSource(alsAdaptor_);
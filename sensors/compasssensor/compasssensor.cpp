@@ -65,6 +65,7 @@ CompassSensorChannel::CompassSensorChannel(const QString& id) :
     outputBuffer_->join(this);
 
     setDescription("compass north in degrees");
+    setSampleType(SENSORFW_WIRE_SAMPLE_COMPASS);
     addStandbyOverrideSource(compassChain_);
     setIntervalSource(compassChain_);
     setRangeSource(compassChain_);
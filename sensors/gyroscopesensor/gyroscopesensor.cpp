@@ -64,6 +64,7 @@ GyroscopeSensorChannel::GyroscopeSensorChannel(const QString& id) :
 
     // Set MetaData
     setDescription("x, y, and z axes angular velocity in mdps");
+    setSampleType(SENSORFW_WIRE_SAMPLE_XYZ);
     setRangeSource(gyroscopeAdaptor_);
     addStandbyOverrideSource(gyroscopeAdaptor_);
     setIntervalSource(gyroscopeAdaptor_);
@@ -65,6 +65,7 @@ HumiditySensorChannel::HumiditySensorChannel(const QString& id) :
 
 
     setDescription("relative humidity in percentage");
+    setSampleType(SENSORFW_WIRE_SAMPLE_UNSIGNED);
     setRangeSource(humidityAdaptor_);
     addStandbyOverrideSource(humidityAdaptor_);
     setIntervalSource(humidityAdaptor_);
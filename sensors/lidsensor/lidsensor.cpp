@@ -65,6 +65,7 @@ LidSensorChannel::LidSensorChannel(const QString& id) :
     outputBuffer_->join(this);
 
     setDescription("lid closed");
+    setSampleType(SENSORFW_WIRE_SAMPLE_LID);
     setRangeSource(lidAdaptor_);
     addStandbyOverrideSource(lidAdaptor_);
     setIntervalSource(lidAdaptor_);
@@ -107,6 +107,7 @@ MagnetometerSensorChannel::MagnetometerSensorChannel(const QString& id) :
     }
 
     setDescription("magnetic flux density in nT");
+    setSampleType(SENSORFW_WIRE_SAMPLE_MAGNETIC_FIELD);
     addStandbyOverrideSource(magChain_);
     setIntervalSource(magChain_);
 }
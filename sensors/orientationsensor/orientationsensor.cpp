@@ -66,6 +66,7 @@ OrientationSensorChannel::OrientationSensorChannel(const QString& id) :
     outputBuffer_->join(this);
 
     setDescription("orientation of the device screen as 6 pre-defined positions");
+    setSampleType(SENSORFW_WIRE_SAMPLE_POSE);
     setRangeSource(orientationChain_);
     addStandbyOverrideSource(orientationChain_);
     setIntervalSource(orientationChain_);
@@ -63,6 +63,7 @@ PressureSensorChannel::PressureSensorChannel(const QString& id) :
     outputBuffer_->join(this);
 
     setDescription("ambient pressure in pascals");
+    setSampleType(SENSORFW_WIRE_SAMPLE_UNSIGNED);
     setRangeSource(pressureAdaptor_);
     addStandbyOverrideSource(pressureAdaptor_);
     setIntervalSource(pressureAdaptor_);
@@ -66,6 +66,7 @@ ProximitySensorChannel::ProximitySensorChannel(const QString& id) :
     setValid(true);
 
     setDescription("whether an object is close to device screen");
+    setSampleType(SENSORFW_WIRE_SAMPLE_PROXIMITY);
     setRangeSource(proximityAdaptor_);
     addStandbyOverrideSource(proximityAdaptor_);
     setIntervalSource(proximityAdaptor_);
@@ -93,6 +93,7 @@ RotationSensorChannel::RotationSensorChannel(const QString& id) :
     outputBuffer_->join(this);
 
     setDescription("x, y, and z axes rotation in degrees");
+    setSampleType(SENSORFW_WIRE_SAMPLE_XYZ);
     introduceAvailableDataRange(DataRange(-179, 180, 1));
     addStandbyOverrideSource(accelerometerChain_);
 
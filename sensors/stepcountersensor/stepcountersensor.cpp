@@ -66,6 +66,7 @@ StepCounterSensorChannel::StepCounterSensorChannel(const QString& id) :
     outputBuffer_->join(this);
 
     setDescription("steps since boot");
+    setSampleType(SENSORFW_WIRE_SAMPLE_UNSIGNED);
     setRangeSource(stepcounterAdaptor_);
     addStandbyOverrideSource(stepcounterAdaptor_);
     setIntervalSource(stepcounterAdaptor_);
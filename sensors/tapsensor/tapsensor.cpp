@@ -65,6 +65,7 @@ TapSensorChannel::TapSensorChannel(const QString& id) :
     setValid(true);
 
     setDescription("either single or double device taps, and tap axis");
+    setSampleType(SENSORFW_WIRE_SAMPLE_TAP);
     setRangeSource(tapAdaptor_);
     setIntervalSource(tapAdaptor_);
 
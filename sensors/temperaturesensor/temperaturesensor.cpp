@@ -64,6 +64,7 @@ TemperatureSensorChannel::TemperatureSensorChannel(const QString& id) :
     outputBuffer_->join(this);
 
     setDescription("ambient temperature in celsius");
+    setSampleType(SENSORFW_WIRE_SAMPLE_UNSIGNED);
     setRangeSource(temperatureAdaptor_);
     addStandbyOverrideSource(temperatureAdaptor_);
     setIntervalSource(temperatureAdaptor_);
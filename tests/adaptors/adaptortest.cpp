@@ -40,9 +40,13 @@
 #include "proximityadaptor.h"
 #include "gyroscopeadaptor.h"
 #include "lidsensoradaptor-evdev.h"
+#include "iioscandecoder.h"
 
 #include "config.h"
 
+#include <string.h>
+#include <unistd.h>
+
 void AdaptorTest::initTestCase()
 {
     SensorFrameworkConfig::loadConfig("/etc/sensorfw/sensord.conf", "/etc/sensorfw/sensord.conf.d");
@@ -170,4 +174,53 @@ void AdaptorTest::testLidSensorAdaptor()
     adaptor->stopAdaptor();
 }
 
+void AdaptorTest::testIioScanDecoder()
+{
+    IioScanDecoder decoder;
+    QVERIFY(decoder.addChannel("in_accel_y", 1, "le:s12/16>>4"));
+    QVERIFY(decoder.addChannel("in_accel_x", 0, "le:s16/16>>0"));
+    QVERIFY(decoder.addChannel("in_accel_z", 2, "be:u10/16>>0"));
+    QVERIFY(decoder.addChannel("in_timestamp", 3, "le:s64/64>>0"));
+    QVERIFY(!decoder.addChannel("in_accel_w", 4, "garbage"));
+    decoder.finalize();
+
+    // Timestamp is aligned to 8 bytes
+    QCOMPARE(decoder.scanSize(), 16);
+    QCOMPARE(decoder.channel(3).offset, 8);
+    QCOMPARE(decoder.findChannel("_x"), 0);
+    QCOMPARE(decoder.findChannel("_timestamp"), 3);
+
+    unsigned char scan[16];
+    memset(scan, 0, sizeof(scan));
+    qint16 x = -1234;
+    memcpy(scan, &x, sizeof(x));
+    quint16 y = (quint16)((-5 & 0xfff) << 4);
+    memcpy(scan + 2, &y, sizeof(y));
+    scan[4] = 0x03;
+    scan[5] = 0xff;
+    qint64 timestamp = 123456789012LL;
+    memcpy(scan + 8, &timestamp, sizeof(timestamp));
+
+    // Pipe stands in for the character device; the second scan arrives
+    // in two parts
+    int fds[2];
+    QCOMPARE(pipe(fds), 0);
+    QCOMPARE(write(fds[1], scan, sizeof(scan)), (ssize_t)sizeof(scan));
+    QCOMPARE(write(fds[1], scan, 10), (ssize_t)10);
+    QCOMPARE(decoder.readScans(fds[0], 4), 1);
+    QCOMPARE(decoder.value(decoder.scan(0), 0), (qint64)-1234);
+    QCOMPARE(decoder.value(decoder.scan(0), 1), (qint64)-5);
+    QCOMPARE(decoder.value(decoder.scan(0), 2), (qint64)1023);
+    QCOMPARE(decoder.value(decoder.scan(0), 3), timestamp);
+
+    QCOMPARE(write(fds[1], scan + 10, 6), (ssize_t)6);
+    QCOMPARE(write(fds[1], scan, sizeof(scan)), (ssize_t)sizeof(scan));
+    QCOMPARE(decoder.readScans(fds[0], 4), 2);
+    QCOMPARE(decoder.value(decoder.scan(0), 0), (qint64)-1234);
+    QCOMPARE(decoder.value(decoder.scan(1), 3), timestamp);
+
+    close(fds[0]);
+    close(fds[1]);
+}
+
 QTEST_MAIN(AdaptorTest)
@@ -58,6 +58,7 @@ private slots:
     void testTouchAdaptor();
     void testGyroscopeAdaptor();
     void testLidSensorAdaptor();
+    void testIioScanDecoder();
 
 };
 
@@ -61,90 +61,6 @@ void BenchmarkTest::testIdleMemCpu()
     // Memory use limits could be set and verified
 }
 
-void BenchmarkTest::testThroughput()
-{
-    SignalDump signalDump;
-    int DELAY = 10; // in seconds
-    int MEMSPLITS = 4; // this + 1 = number of mem measurements
-
-    // get sensord PID
-    QProcess* process = new QProcess(this);
-    process->start(QString("pidof sensord"));
-    process->waitForReadyRead(1000);
-    int sensordPid = atoi(process->readLine());
-    process->close();
-    process->waitForFinished();
-    delete process;
-
-    qDebug() << "Detected sensord PID:" << sensordPid;
-
-    QString sensorName("alssensor");
-    SensorManagerInterface& sm = SensorManagerInterface::instance();
-    QVERIFY( sm.isValid() );
-
-    ALSSensorChannelInterface* sensorIfc = const_cast<ALSSensorChannelInterface*>(ALSSensorChannelInterface::interface(sensorName));
-    QVERIFY2(sensorIfc && sensorIfc->isValid(), "Failed to get session");
-
-    qDebug() << "Connecting to sensor data for" << DELAY << "seconds";
-
-    // get mem
-    signalDump.recordMemUsage(sensordPid);
-
-    QDBusReply<void> reply = sensorIfc->start();
-    connect(sensorIfc, SIGNAL(ALSChanged(const Unsigned&)), &signalDump, SLOT(counterSlot(const Unsigned&)));
-
-    signalDump.getCpuUsage(sensordPid);
-
-    // Run with few breaks for measuring memory usage.
-    for (int i = 1; i < MEMSPLITS; i++) {
-        QTest::qWait((DELAY*1000)/MEMSPLITS);
-        signalDump.recordMemUsage(sensordPid);
-    }
-    QTest::qWait((DELAY*1000)/MEMSPLITS);
-
-    double cpuUsage = signalDump.getCpuUsage(sensordPid);
-
-    disconnect(sensorIfc, SIGNAL(ALSChanged(const Unsigned&)), &signalDump, SLOT(counterSlot(const Unsigned&)));
-    reply = sensorIfc->stop();
-
-    // get mem
-    signalDump.recordMemUsage(sensordPid);
-
-    /// Sample rate
-    double sampleRate = signalDump.cnt/(double)DELAY;
-    qDebug() << "[Sample Rate]:" << sampleRate << "s/sec";
-
-    /// Cpu usage
-    qDebug() << "[CPU usage  ]:" << cpuUsage*100 << "%";
-
-    /// Memory usage
-    int cleanMin = -1;
-    int cleanMax = 0;
-    int cleanAvg = 0;
-    foreach (int value, signalDump.memoryClean) {
-        if (value > cleanMax) cleanMax = value;
-        if ( value < cleanMin || cleanMin == -1) cleanMin = value;
-        cleanAvg += value;
-    }
-    cleanAvg = cleanAvg / signalDump.memoryClean.size();
-
-    int dirtyMin = -1;
-    int dirtyMax = 0;
-    int dirtyAvg = 0;
-    foreach (int value, signalDump.memoryDirty) {
-        if (value > dirtyMax) dirtyMax = value;
-        if ( value < dirtyMin || dirtyMin == -1) dirtyMin = value;
-        dirtyAvg += value;
-    }
-    dirtyAvg = dirtyAvg / signalDump.memoryDirty.size();
-
-    qDebug() << "[MEM        ]: Average Min Max" ;
-    qDebug() << "[      Clean]:" << cleanAvg << cleanMin << cleanMax;
-    qDebug() << "[      Dirty]:" << dirtyAvg << dirtyMin << dirtyMax;
-
-    delete sensorIfc;
-}
-
 void BenchmarkTest::testSessionLeaks()
 {
     int ITERATIONS = 30;
@@ -41,7 +41,6 @@ private slots:
 
     // Tests
     void testIdleMemCpu();
-    void testThroughput();
     void testSessionLeaks();
     void testLostSessionLeaks();
 };
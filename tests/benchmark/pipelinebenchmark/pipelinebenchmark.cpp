@@ -0,0 +1,650 @@
+/**
+   @file pipelinebenchmark.cpp
+   @brief In-process benchmark of sensor chains
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "pipelinebenchmark.h"
+#include "syntheticadaptor.h"
+#include "sessiontap.h"
+#include "replayadaptor.h"
+#include "tracerecorder.h"
+
+#include "sensormanager.h"
+#include "abstractchain.h"
+#include "config.h"
+#include "datatypes/utils.h"
+#include "datatypes/posedata.h"
+
+#include "accelerometerchain.h"
+#include "magcalibrationchain.h"
+#include "compasschain.h"
+#include "orientationchain.h"
+#include "coordinatealignfilter.h"
+#include "magcoordinatealignfilter.h"
+#include "calibrationfilter.h"
+#include "compassfilter.h"
+#include "orientationfilter.h"
+#include "declinationfilter.h"
+#include "downsamplefilter.h"
+#include "avgaccfilter.h"
+#include "orientationinterpreter.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QVector>
+#include <algorithm>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+/*
+ * Every heap allocation in the process goes through these, including
+ * operator new and Qt containers. The glibc entry points do the work.
+ */
+static QAtomicInteger<quint64> allocations;
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size)
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_realloc(ptr, size);
+}
+}
+
+namespace {
+
+template <class TYPE>
+RingBufferReaderBase* createTap(SampleQueueSet* queues, int id)
+{
+    return new SessionTap<TYPE>(queues, id);
+}
+
+/**
+ * Chain and the output buffer sessions read.
+ */
+struct ChainSpec
+{
+    const char* name;
+    const char* buffer;
+    RingBufferReaderBase* (*tap)(SampleQueueSet*, int);
+};
+
+const ChainSpec chainSpecs[] = {
+    { "accelerometerchain",  "accelerometer",              createTap<AccelerationData> },
+    { "magcalibrationchain", "calibratedmagnetometerdata", createTap<CalibratedMagneticFieldData> },
+    { "compasschain",        "truenorth",                  createTap<CompassData> },
+    { "orientationchain",    "orientation",                createTap<PoseData> }
+};
+
+const ChainSpec* findSpec(const QString& name)
+{
+    for (unsigned i = 0; i < sizeof(chainSpecs) / sizeof(chainSpecs[0]); ++i) {
+        if (name == chainSpecs[i].name)
+            return &chainSpecs[i];
+    }
+    return NULL;
+}
+
+/* Counter of syscall entries in this and later created threads. */
+int openSyscallCounter()
+{
+    const char* paths[] = {
+        "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id",
+        "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"
+    };
+    for (unsigned i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i) {
+        QFile file(paths[i]);
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+        bool ok = false;
+        quint64 id = file.readAll().trimmed().toULongLong(&ok);
+        if (!ok)
+            continue;
+
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_TRACEPOINT;
+        attr.size = sizeof(attr);
+        attr.config = id;
+        attr.inherit = 1;
+        int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+        if (fd != -1)
+            return fd;
+    }
+    qWarning() << "Syscall tracepoint not available, syscalls are not counted";
+    return -1;
+}
+
+}
+
+PipelineBenchmark::PipelineBenchmark() :
+    queues_(1024),
+    syscallFd_(openSyscallCounter()),
+    latencies_(0),
+    capacity_(0),
+    count_(0),
+    delivered_(0)
+{
+    SensorManager& sm = SensorManager::instance();
+
+    // Traces replace the generators, chains missing a trace fail to set up
+    replayed_ = ReplayAdaptor::registerTraces();
+    if (replayed_.isEmpty()) {
+        sm.registerDeviceAdaptor<SyntheticAccelerometerAdaptor>("accelerometeradaptor");
+        sm.registerDeviceAdaptor<SyntheticMagnetometerAdaptor>("magnetometeradaptor");
+    }
+
+    sm.registerFilter<CoordinateAlignFilter>("coordinatealignfilter");
+    sm.registerFilter<MagCoordinateAlignFilter>("magcoordinatealignfilter");
+    sm.registerFilter<CalibrationFilter>("calibrationfilter");
+    sm.registerFilter<CompassFilter>("compassfilter");
+    sm.registerFilter<OrientationFilter>("orientationfilter");
+    sm.registerFilter<DeclinationFilter>("declinationfilter");
+    sm.registerFilter<DownsampleFilter>("downsamplefilter");
+    sm.registerFilter<AvgAccFilter>("avgaccfilter");
+    sm.registerFilter<OrientationInterpreter>("orientationinterpreter");
+
+    sm.registerChain<AccelerometerChain>("accelerometerchain");
+    sm.registerChain<MagCalibrationChain>("magcalibrationchain");
+    sm.registerChain<CompassChain>("compasschain");
+    sm.registerChain<OrientationChain>("orientationchain");
+}
+
+PipelineBenchmark::~PipelineBenchmark()
+{
+    closeSessions();
+    delete[] latencies_;
+    if (syscallFd_ != -1)
+        close(syscallFd_);
+}
+
+QStringList PipelineBenchmark::chains()
+{
+    QStringList names;
+    for (unsigned i = 0; i < sizeof(chainSpecs) / sizeof(chainSpecs[0]); ++i)
+        names << chainSpecs[i].name;
+    return names;
+}
+
+quint64 PipelineBenchmark::syscallCount() const
+{
+    quint64 value = 0;
+    if (syscallFd_ == -1 || read(syscallFd_, &value, sizeof(value)) != sizeof(value))
+        return 0;
+    return value;
+}
+
+quint64 PipelineBenchmark::queueDrops() const
+{
+    quint64 drops = 0;
+    for (int i = 0; i < queues_.count(); ++i)
+        drops += queues_.queue(i)->drops();
+    foreach (const SessionClient* client, clients_)
+        drops += client->droppedSamples();
+    return drops;
+}
+
+void PipelineBenchmark::closeSessions()
+{
+    qDeleteAll(clients_);
+    clients_.clear();
+}
+
+void PipelineBenchmark::drain(quint64 deadline, bool record)
+{
+    QVector<struct pollfd> pfds(clients_.size() + 1);
+    pfds[0].fd = queues_.notifyFd();
+    pfds[0].events = POLLIN;
+    for (int i = 0; i < clients_.size(); ++i) {
+        pfds[i + 1].fd = clients_.at(i)->fd();
+        pfds[i + 1].events = POLLIN;
+    }
+
+    forever {
+        quint64 now = Utils::getTimeStamp();
+        if (now >= deadline)
+            break;
+        int timeout = (deadline - now + 999) / 1000;
+        if (poll(pfds.data(), pfds.size(), timeout) <= 0)
+            continue;
+
+        // Main thread side, as in SensorManager::sensorDataHandler()
+        if (pfds[0].revents & POLLIN) {
+            queues_.clearNotification();
+            for (int i = 0; i < queues_.count(); ++i) {
+                SampleQueue* queue = queues_.queue(i);
+                const SampleQueue::Slot* slot;
+                while ((slot = queue->front())) {
+                    SessionClient* client = clients_.value(slot->id);
+                    if (client)
+                        client->write(slot->payload, slot->size);
+                    queue->pop();
+                }
+            }
+            foreach (SessionClient* client, clients_)
+                client->flush();
+        }
+
+        // Client side
+        now = Utils::getTimeStamp();
+        bool pending = false;
+        for (int i = 0; i < clients_.size(); ++i) {
+            SessionClient* client = clients_.at(i);
+            if (pfds[i + 1].revents & POLLIN) {
+                unsigned received = client->receive(now, record ? latencies_ : NULL, count_, capacity_);
+                if (record)
+                    delivered_ += received;
+            }
+            pending |= client->hasPendingData();
+        }
+
+        // Sessions which filled their socket continue from the write notifier
+        if (pending)
+            QCoreApplication::processEvents();
+    }
+}
+
+bool PipelineBenchmark::run(const QString& chainName, unsigned rate, int sessions, double duration, Result& result)
+{
+    const ChainSpec* spec = findSpec(chainName);
+    if (!spec) {
+        qWarning() << "Unknown chain" << chainName;
+        return false;
+    }
+
+    SyntheticAdaptor::setRate(rate);
+
+    SensorManager& sm = SensorManager::instance();
+    AbstractChain* chain = sm.requestChain(chainName);
+    if (!chain || !chain->isValid()) {
+        qWarning() << "Failed to set up" << chainName;
+        if (chain)
+            sm.releaseChain(chainName);
+        return false;
+    }
+
+    RingBufferBase* buffer = chain->findBuffer(spec->buffer);
+    if (!buffer) {
+        qWarning() << chainName << "has no buffer" << spec->buffer;
+        sm.releaseChain(chainName);
+        return false;
+    }
+    for (int i = 0; i < sessions; ++i) {
+        SessionClient* client = new SessionClient(i);
+        clients_ << client;
+        if (!client->isValid()) {
+            closeSessions();
+            sm.releaseChain(chainName);
+            return false;
+        }
+    }
+    QList<RingBufferReaderBase*> taps;
+    for (int i = 0; i < sessions; ++i) {
+        RingBufferReaderBase* tap = spec->tap(&queues_, i);
+        buffer->join(tap);
+        taps << tap;
+    }
+
+    // Compass is fed by two adaptors, leave room for both
+    unsigned needed = (unsigned)(rate * duration * sessions * 2) + 1024;
+    if (needed > capacity_) {
+        delete[] latencies_;
+        latencies_ = new quint32[needed];
+        capacity_ = needed;
+    }
+    count_ = 0;
+    delivered_ = 0;
+
+    chain->start();
+    drain(Utils::getTimeStamp() + 200000, false);
+
+    quint64 begin = Utils::getTimeStamp();
+    quint64 generated = SyntheticAdaptor::generated();
+    quint64 sleeps = SyntheticAdaptor::sleeps();
+    quint64 allocs = allocations.load();
+    quint64 syscalls = syscallCount();
+    quint64 drops = queueDrops();
+
+    drain(begin + (quint64)(duration * 1000000), true);
+
+    quint64 end = Utils::getTimeStamp();
+    result.generated = SyntheticAdaptor::generated() - generated;
+    sleeps = SyntheticAdaptor::sleeps() - sleeps;
+    allocs = allocations.load() - allocs;
+    syscalls = syscallCount() - syscalls;
+    result.dropped = queueDrops() - drops;
+
+    chain->stop();
+    foreach (RingBufferReaderBase* tap, taps) {
+        buffer->unjoin(tap);
+        delete tap;
+    }
+    sm.releaseChain(chainName);
+    drain(Utils::getTimeStamp() + 10000, false);
+    closeSessions();
+
+    result.chain = chainName;
+    result.replay = false;
+    result.rate = rate;
+    result.sessions = sessions;
+    result.duration = (end - begin) / 1000000.0;
+    result.delivered = delivered_;
+
+    std::sort(latencies_, latencies_ + count_);
+    result.p50 = count_ ? latencies_[count_ / 2] : 0;
+    result.p99 = count_ ? latencies_[qMin(count_ - 1, (unsigned)(count_ * 0.99))] : 0;
+    result.max = count_ ? latencies_[count_ - 1] : 0;
+
+    double samples = result.generated ? result.generated : 1;
+    result.allocations = allocs / samples;
+    result.syscalls = syscallFd_ == -1 ? -1 : (syscalls > sleeps ? syscalls - sleeps : 0) / samples;
+    return true;
+}
+
+bool PipelineBenchmark::replay(const QString& chainName, const QString& record, Result& result)
+{
+    const ChainSpec* spec = findSpec(chainName);
+    if (!spec) {
+        qWarning() << "Unknown chain" << chainName;
+        return false;
+    }
+
+    // Nothing is written until every adaptor of the chain has started,
+    // so their samples interleave the same way on every run
+    ReplayPlayer& player = ReplayPlayer::instance();
+    player.setRealtime(false);
+    player.setLoop(false);
+    player.setHeld(true);
+
+    SensorManager& sm = SensorManager::instance();
+    AbstractChain* chain = sm.requestChain(chainName);
+    if (!chain || !chain->isValid()) {
+        qWarning() << "Failed to set up" << chainName;
+        if (chain)
+            sm.releaseChain(chainName);
+        return false;
+    }
+
+    RingBufferBase* buffer = chain->findBuffer(spec->buffer);
+    RingBufferReaderBase* recorder = buffer ? TraceType::record(buffer, record, chainName, spec->buffer) : 0;
+    if (!recorder) {
+        qWarning() << "Failed to record" << chainName << "output to" << record;
+        sm.releaseChain(chainName);
+        return false;
+    }
+
+    chain->start();
+
+    quint64 replayed = player.replayed();
+    quint64 allocs = allocations.load();
+    quint64 syscalls = syscallCount();
+    quint64 polls = 0;
+    quint64 begin = Utils::getTimeStamp();
+
+    player.setHeld(false);
+    while (!player.isIdle()) {
+        usleep(1000);
+        ++polls;
+    }
+
+    quint64 end = Utils::getTimeStamp();
+    allocs = allocations.load() - allocs;
+    syscalls = syscallCount() - syscalls;
+    result.generated = player.replayed() - replayed;
+
+    chain->stop();
+    buffer->unjoin(recorder);
+    delete static_cast<Pusher*>(recorder);
+    sm.releaseChain(chainName);
+
+    if (!result.generated) {
+        qWarning() << "No traces replayed through" << chainName;
+        return false;
+    }
+
+    TraceReader output;
+    output.open(record);
+
+    result.chain = chainName;
+    result.replay = true;
+    result.rate = 0;
+    result.sessions = 1;
+    result.duration = (end - begin) / 1000000.0;
+    result.delivered = output.count();
+    result.dropped = 0;
+    result.p50 = result.p99 = result.max = 0;
+    result.allocations = (double)allocs / result.generated;
+    // Polling the player takes a few syscalls each
+    result.syscalls = syscallFd_ == -1 ? -1 : (syscalls > 2 * polls ? syscalls - 2 * polls : 0) / (double)result.generated;
+    return true;
+}
+
+bool PipelineBenchmark::compareTraces(const QString& path, const QString& reference)
+{
+    TraceReader trace;
+    TraceReader expected;
+    if (!trace.open(path) || !expected.open(reference)) {
+        qWarning() << "Can not compare" << path << "with" << reference << ":"
+                   << trace.errorString() << expected.errorString();
+        return false;
+    }
+    if (trace.typeName() != expected.typeName() || trace.sampleSize() != expected.sampleSize()) {
+        qWarning() << path << "has samples of type" << trace.typeName() << "instead of" << expected.typeName();
+        return false;
+    }
+    const TraceType* type = TraceType::find(trace.typeName());
+    if (!type) {
+        qWarning() << "Can not compare samples of type" << trace.typeName();
+        return false;
+    }
+
+    quint64 count = qMin(trace.count(), expected.count());
+    for (quint64 i = 0; i < count; ++i) {
+        if (!type->equal(trace.sample(i), expected.sample(i))) {
+            qWarning() << path << "differs from" << reference << "at sample" << i
+                       << "timestamp" << expected.timestamp(i);
+            return false;
+        }
+    }
+    if (trace.count() != expected.count()) {
+        qWarning() << path << "has" << trace.count() << "samples instead of" << expected.count();
+        return false;
+    }
+    return true;
+}
+
+QByteArray PipelineBenchmark::toJson(const QList<Result>& results)
+{
+    QString json("{\n  \"benchmark\": \"sensorfw-pipeline\",\n  \"version\": 1,\n  \"runs\": [");
+    for (int i = 0; i < results.size(); ++i) {
+        const Result& r = results.at(i);
+        json.append(i ? ",\n" : "\n");
+        json.append(QString("    { \"chain\": \"%1\", \"mode\": \"%12\", \"rate_hz\": %2, \"sessions\": %3, \"duration_s\": %4,"
+                            " \"generated\": %5, \"delivered\": %6, \"dropped\": %7,"
+                            " \"samples_per_second\": %8,"
+                            " \"latency_us\": { \"p50\": %9, \"p99\": %10, \"max\": %11 },")
+                    .arg(r.chain).arg(r.rate).arg(r.sessions).arg(r.duration, 0, 'f', 3)
+                    .arg(r.generated).arg(r.delivered).arg(r.dropped)
+                    .arg(r.delivered / r.duration, 0, 'f', 1)
+                    .arg(r.p50).arg(r.p99).arg(r.max)
+                    .arg(r.replay ? "replay" : "synthetic"));
+        json.append(QString(" \"allocations_per_sample\": %1, \"syscalls_per_sample\": %2 }")
+                    .arg(r.allocations, 0, 'f', 3)
+                    .arg(r.syscalls < 0 ? QString("null") : QString::number(r.syscalls, 'f', 3)));
+    }
+    json.append("\n  ]\n}\n");
+    return json.toUtf8();
+}
+
+static QList<unsigned> parseList(const QString& value)
+{
+    QList<unsigned> list;
+    foreach (const QString& item, value.split(',', QString::SkipEmptyParts))
+        list << item.toUInt();
+    return list;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList chains = PipelineBenchmark::chains();
+    QList<unsigned> rates = QList<unsigned>() << 100 << 500 << 1000 << 2000;
+    QList<unsigned> sessions = QList<unsigned>() << 1 << 4;
+    double duration = 1.0;
+    QString config;
+    QString output;
+    QString replayDir;
+    QString recordDir;
+    QString compareDir;
+
+    QStringList args = app.arguments();
+    for (int i = 1; i < args.size(); ++i) {
+        QString arg = args.at(i);
+        QString value = i + 1 < args.size() ? args.at(i + 1) : QString();
+        if (arg == "--chains") {
+            chains = value.split(',', QString::SkipEmptyParts);
+        } else if (arg == "--rates") {
+            rates = parseList(value);
+        } else if (arg == "--sessions") {
+            sessions = parseList(value);
+        } else if (arg == "--duration") {
+            duration = value.toDouble();
+        } else if (arg == "--config") {
+            config = value;
+        } else if (arg == "--output") {
+            output = value;
+        } else if (arg == "--replay") {
+            replayDir = value;
+        } else if (arg == "--record") {
+            recordDir = value;
+        } else if (arg == "--compare") {
+            compareDir = value;
+        } else {
+            qWarning("Usage: %s [--chains a,b] [--rates hz,hz] [--sessions n,n] [--duration s] [--config file] [--output file]\n"
+                     "       [--replay tracedir [--record outdir] [--compare refdir]]",
+                     qPrintable(args.at(0)));
+            qWarning("Chains: %s", qPrintable(PipelineBenchmark::chains().join(", ")));
+            return 1;
+        }
+        ++i;
+    }
+
+    // Keep away from the socket of a running sensord
+    QString runtimeDir = QString("%1/sensorfw-benchmark-%2").arg(QDir::tempPath()).arg(getpid());
+    QDir().mkpath(runtimeDir + "/var/run");
+    qputenv("SENSORFW_SOCKET_PATH", runtimeDir.toLocal8Bit());
+
+    // Replay settings go to a config.d of our own, --config overrides them
+    QString configDir;
+    if (!replayDir.isEmpty()) {
+        configDir = runtimeDir + "/conf.d";
+        QDir().mkpath(configDir);
+        QFile replayConfig(configDir + "/replay.conf");
+        if (!replayConfig.open(QIODevice::WriteOnly) ||
+            replayConfig.write(QString("[trace]\nreplay=%1\nreplay_realtime=false\n")
+                               .arg(QDir(replayDir).absolutePath()).toUtf8()) < 0) {
+            qWarning() << "Failed to write" << replayConfig.fileName();
+            return 1;
+        }
+    }
+    if (recordDir.isEmpty())
+        recordDir = runtimeDir;
+    else
+        QDir().mkpath(recordDir);
+
+    SensorFrameworkConfig::loadConfig(config, configDir);
+
+    QList<PipelineBenchmark::Result> results;
+    bool mismatch = false;
+    {
+        PipelineBenchmark benchmark;
+        if (!replayDir.isEmpty()) {
+            if (benchmark.replayedAdaptors().isEmpty()) {
+                qWarning() << "No traces in" << replayDir;
+                return 1;
+            }
+            foreach (const QString& chain, chains) {
+                QString record = QString("%1/%2.trace").arg(recordDir).arg(chain);
+                PipelineBenchmark::Result result;
+                if (benchmark.replay(chain, record, result)) {
+                    results << result;
+                    if (!compareDir.isEmpty() &&
+                        !PipelineBenchmark::compareTraces(record, QString("%1/%2.trace").arg(compareDir).arg(chain)))
+                        mismatch = true;
+                }
+                if (recordDir == runtimeDir)
+                    QFile::remove(record);
+            }
+        } else {
+            foreach (const QString& chain, chains) {
+                foreach (unsigned rate, rates) {
+                    foreach (unsigned n, sessions) {
+                        PipelineBenchmark::Result result;
+                        if (benchmark.run(chain, rate, n, duration, result))
+                            results << result;
+                    }
+                }
+            }
+        }
+    }
+
+    QByteArray json = PipelineBenchmark::toJson(results);
+    if (output.isEmpty()) {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    } else {
+        QFile file(output);
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            qWarning() << "Failed to write" << output;
+            return 1;
+        }
+    }
+
+    QFile::remove(runtimeDir + "/var/run/sensord.sock");
+    QDir(runtimeDir).rmpath("var/run");
+    if (!configDir.isEmpty()) {
+        QFile::remove(configDir + "/replay.conf");
+        QDir().rmdir(configDir);
+    }
+    QDir().rmdir(runtimeDir);
+    if (mismatch)
+        return 2;
+    return results.isEmpty() ? 1 : 0;
+}
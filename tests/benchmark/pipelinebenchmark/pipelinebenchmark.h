@@ -0,0 +1,166 @@
+/**
+   @file pipelinebenchmark.h
+   @brief In-process benchmark of sensor chains
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef PIPELINEBENCHMARK_H
+#define PIPELINEBENCHMARK_H
+
+#include "samplequeue.h"
+#include "sessionclient.h"
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QList>
+
+/**
+ * Runs real chains against synthetic adaptors inside this process and
+ * measures what reaches simulated sessions. No D-Bus or running sensord
+ * is needed.
+ *
+ * Each run feeds the chain at a fixed rate, taps the chain output with
+ * N sessions which hand samples to the main thread over a SampleQueueSet
+ * like SensorManager does. The main thread writes them to SessionData of
+ * each session, which encodes and sends them over a socket to a
+ * simulated client, see SessionClient. Each run records:
+ * - samples read by the clients per second over all sessions
+ * - p50/p99/max latency from sample timestamp to the client reading it
+ * - heap allocations per generated sample in the whole process
+ * - syscalls per generated sample in the whole process, excluding the
+ *   sleeps of the generator. Needs the raw_syscalls tracepoint.
+ *
+ * When "trace/replay" is configured, adaptors with a trace there are
+ * ReplayAdaptors instead and replay() runs a chain over the recorded
+ * samples as fast as it can take them. The chain output is recorded,
+ * and as the replay is deterministic it can be compared with the output
+ * of an earlier build.
+ */
+class PipelineBenchmark
+{
+public:
+    /**
+     * Outcome of one run.
+     */
+    struct Result
+    {
+        QString chain;             /**< chain name */
+        bool replay;               /**< fed by traces instead of generators */
+        unsigned rate;             /**< input rate, Hz */
+        int sessions;              /**< simulated sessions */
+        double duration;           /**< measured seconds */
+        quint64 generated;         /**< samples fed to adaptors */
+        quint64 delivered;         /**< samples read by clients */
+        quint64 dropped;           /**< samples lost in session queues and sockets */
+        quint32 p50;               /**< median latency, us */
+        quint32 p99;               /**< 99th percentile latency, us */
+        quint32 max;               /**< worst latency, us */
+        double allocations;        /**< allocations per generated sample */
+        double syscalls;           /**< syscalls per generated sample, -1 if unknown */
+    };
+
+    PipelineBenchmark();
+    ~PipelineBenchmark();
+
+    /**
+     * Names of chains which can be benchmarked.
+     */
+    static QStringList chains();
+
+    /**
+     * Benchmark one configuration.
+     *
+     * @param chain Chain name.
+     * @param rate Input rate in Hz.
+     * @param sessions Number of sessions reading the chain output.
+     * @param duration Seconds to measure.
+     * @param result Filled on success.
+     * @return false if the chain could not be set up.
+     */
+    bool run(const QString& chain, unsigned rate, int sessions, double duration, Result& result);
+
+    /**
+     * Replay traces through a chain as fast as possible.
+     *
+     * @param chain Chain name.
+     * @param record Trace file to record the chain output into.
+     * @param result Filled on success. Latencies are not measured.
+     * @return false if the chain could not be set up or replays nothing.
+     */
+    bool replay(const QString& chain, const QString& record, Result& result);
+
+    /**
+     * Adaptors replayed from traces.
+     */
+    const QStringList& replayedAdaptors() const { return replayed_; }
+
+    /**
+     * Compare two traces sample by sample.
+     *
+     * @param path Trace to check.
+     * @param reference Expected trace.
+     * @return are the samples identical.
+     */
+    static bool compareTraces(const QString& path, const QString& reference);
+
+    /**
+     * Format results as JSON.
+     *
+     * @param results Results of runs.
+     * @return JSON document.
+     */
+    static QByteArray toJson(const QList<Result>& results);
+
+private:
+    Q_DISABLE_COPY(PipelineBenchmark)
+
+    /**
+     * Write samples to the sessions and read them on the clients until
+     * deadline, and account them.
+     *
+     * @param deadline Monotonic time in microseconds.
+     * @param record Record latencies of samples read by the clients.
+     */
+    void drain(quint64 deadline, bool record);
+
+    /**
+     * Current syscall count of the process, or 0 if not available.
+     */
+    quint64 syscallCount() const;
+
+    /**
+     * Samples dropped in session queues and by sessions so far.
+     */
+    quint64 queueDrops() const;
+
+    /**
+     * Close the sessions of the last run.
+     */
+    void closeSessions();
+
+    SampleQueueSet        queues_;    /**< sessions to main thread */
+    QList<SessionClient*> clients_;   /**< sessions of the run, by ID */
+    int                   syscallFd_; /**< perf counter or -1 */
+    quint32*              latencies_; /**< recorded latencies */
+    unsigned              capacity_;  /**< size of latencies_ */
+    unsigned              count_;     /**< used part of latencies_ */
+    quint64               delivered_; /**< samples read by clients */
+    QStringList           replayed_;  /**< adaptors replayed from traces */
+};
+
+#endif
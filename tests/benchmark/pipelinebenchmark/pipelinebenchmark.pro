@@ -0,0 +1,75 @@
+QT += dbus network
+QT -= gui
+
+include(../../common-install.pri)
+
+CONFIG += debug
+TEMPLATE = app
+TARGET = sensorpipeline-benchmark
+
+HEADERS += pipelinebenchmark.h \
+    syntheticadaptor.h \
+    sessiontap.h \
+    sessionclient.h \
+    ../../../adaptors/replayadaptor/replayadaptor.h \
+    ../../../chains/accelerometerchain/accelerometerchain.h \
+    ../../../chains/magcalibrationchain/magcalibrationchain.h \
+    ../../../chains/magcalibrationchain/calibrationfilter.h \
+    ../../../chains/compasschain/compasschain.h \
+    ../../../chains/compasschain/compassfilter.h \
+    ../../../chains/compasschain/orientationfilter.h \
+    ../../../chains/orientationchain/orientationchain.h \
+    ../../../filters/coordinatealignfilter/coordinatealignfilter.h \
+    ../../../filters/magcoordinatealignfilter/magcoordinatealignfilter.h \
+    ../../../filters/declinationfilter/declinationfilter.h \
+    ../../../filters/downsamplefilter/downsamplefilter.h \
+    ../../../filters/avgaccfilter/avgaccfilter.h \
+    ../../../filters/orientationinterpreter/orientationinterpreter.h
+
+SOURCES += pipelinebenchmark.cpp \
+    syntheticadaptor.cpp \
+    sessionclient.cpp \
+    ../../../adaptors/replayadaptor/replayadaptor.cpp \
+    ../../../chains/accelerometerchain/accelerometerchain.cpp \
+    ../../../chains/magcalibrationchain/magcalibrationchain.cpp \
+    ../../../chains/magcalibrationchain/calibrationfilter.cpp \
+    ../../../chains/compasschain/compasschain.cpp \
+    ../../../chains/compasschain/compassfilter.cpp \
+    ../../../chains/compasschain/orientationfilter.cpp \
+    ../../../chains/orientationchain/orientationchain.cpp \
+    ../../../filters/coordinatealignfilter/coordinatealignfilter.cpp \
+    ../../../filters/magcoordinatealignfilter/magcoordinatealignfilter.cpp \
+    ../../../filters/declinationfilter/declinationfilter.cpp \
+    ../../../filters/downsamplefilter/downsamplefilter.cpp \
+    ../../../filters/avgaccfilter/avgaccfilter.cpp \
+    ../../../filters/orientationinterpreter/orientationinterpreter.cpp
+
+SENSORFW_INCLUDEPATHS = ../../../include \
+                        ../../../core \
+                        ../../../datatypes \
+                        ../../../filters \
+                        ../../../adaptors/replayadaptor \
+                        ../../../chains/accelerometerchain \
+                        ../../../chains/magcalibrationchain \
+                        ../../../chains/compasschain \
+                        ../../../chains/orientationchain \
+                        ../../../filters/coordinatealignfilter \
+                        ../../../filters/magcoordinatealignfilter \
+                        ../../../filters/declinationfilter \
+                        ../../../filters/downsamplefilter \
+                        ../../../filters/avgaccfilter \
+                        ../../../filters/orientationinterpreter \
+                        ../../..
+
+DEPENDPATH += $$SENSORFW_INCLUDEPATHS
+INCLUDEPATH += $$SENSORFW_INCLUDEPATHS
+
+QMAKE_LIBDIR_FLAGS += -L../../../datatypes \
+                      -L../../../core
+
+equals(QT_MAJOR_VERSION, 4):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes -lsensorfw
+}
+equals(QT_MAJOR_VERSION, 5):{
+    QMAKE_LIBDIR_FLAGS += -lsensordatatypes-qt5 -lsensorfw-qt5
+}
@@ -0,0 +1,127 @@
+/**
+   @file sessionclient.cpp
+   @brief Simulated client session connected to sensord over a socket
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "sessionclient.h"
+#include "sockethandler.h"
+#include "wireprotocol.h"
+
+#include <QDebug>
+#include <QLocalSocket>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+SessionClient::SessionClient(int id) :
+    fd_(-1),
+    connection_(0),
+    session_(0),
+    inbox_(new char[INBOX_SIZE]),
+    fill_(0)
+{
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds) == -1) {
+        qWarning() << "socketpair():" << strerror(errno);
+        return;
+    }
+
+    QLocalSocket* socket = new QLocalSocket;
+    if (!socket->setSocketDescriptor(fds[0], QLocalSocket::ConnectedState, QIODevice::WriteOnly)) {
+        qWarning() << "Failed to wrap session socket:" << socket->errorString();
+        delete socket;
+        close(fds[0]);
+        close(fds[1]);
+        return;
+    }
+    fd_ = fds[1];
+    connection_ = new ClientConnection(socket, 2);
+    session_ = new SessionData(connection_, id);
+}
+
+SessionClient::~SessionClient()
+{
+    delete session_;
+    delete connection_;
+    if (fd_ != -1)
+        close(fd_);
+    delete[] inbox_;
+}
+
+bool SessionClient::write(const void* source, int size)
+{
+    return session_->write(source, size);
+}
+
+void SessionClient::flush()
+{
+    session_->flush();
+}
+
+bool SessionClient::hasPendingData() const
+{
+    return session_->hasPendingData();
+}
+
+unsigned long SessionClient::droppedSamples() const
+{
+    return session_->getDroppedSamples();
+}
+
+unsigned SessionClient::receive(quint64 now, quint32* latencies, unsigned& count, unsigned capacity)
+{
+    unsigned received = 0;
+    forever {
+        ssize_t bytes = read(fd_, inbox_ + fill_, INBOX_SIZE - fill_);
+        if (bytes <= 0)
+            break;
+        fill_ += bytes;
+
+        unsigned offset = 0;
+        sensorfw_wire_frame_t header;
+        while (fill_ - offset >= sizeof(header)) {
+            memcpy(&header, inbox_ + offset, sizeof(header));
+            if (header.headerSize < sizeof(header) || header.size > INBOX_SIZE ||
+                header.size < header.headerSize + header.count * header.sampleSize ||
+                (header.count && header.sampleSize < sizeof(quint64))) {
+                qWarning() << "Malformed frame of session" << header.channel;
+                fill_ = 0;
+                return received;
+            }
+            if (fill_ - offset < header.size)
+                break;
+
+            // Every sample type starts with the TimedData timestamp
+            const char* sample = inbox_ + offset + header.headerSize;
+            for (unsigned i = 0; i < header.count; ++i, sample += header.sampleSize) {
+                if (latencies && count < capacity) {
+                    quint64 timestamp;
+                    memcpy(&timestamp, sample, sizeof(timestamp));
+                    latencies[count++] = now > timestamp ? now - timestamp : 0;
+                }
+            }
+            received += header.count;
+            offset += header.size;
+        }
+        fill_ -= offset;
+        memmove(inbox_, inbox_ + offset, fill_);
+    }
+    return received;
+}
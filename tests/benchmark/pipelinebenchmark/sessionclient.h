@@ -0,0 +1,105 @@
+/**
+   @file sessionclient.h
+   @brief Simulated client session connected to sensord over a socket
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SESSIONCLIENT_H
+#define SESSIONCLIENT_H
+
+#include <QtGlobal>
+
+class ClientConnection;
+class SessionData;
+
+/**
+ * Session of SocketHandler together with the client reading it. The
+ * session writes through its own version 2 ClientConnection into one end
+ * of a socket pair, so samples are encoded, queued and sent exactly like
+ * for a real client. The client end decodes the frames.
+ */
+class SessionClient
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param id Session ID.
+     */
+    explicit SessionClient(int id);
+    ~SessionClient();
+
+    /**
+     * Was the socket pair set up.
+     */
+    bool isValid() const { return session_ != 0; }
+
+    /**
+     * Client end of the socket, readable when frames have arrived.
+     */
+    int fd() const { return fd_; }
+
+    /**
+     * Write a sample to the session like SocketHandler::write() does.
+     *
+     * @param source Sample.
+     * @param size Bytes of the sample.
+     * @return was the sample queued.
+     */
+    bool write(const void* source, int size);
+
+    /**
+     * Send queued frames like SocketHandler::flush() does.
+     */
+    void flush();
+
+    /**
+     * Are frames waiting for the socket to become writable.
+     */
+    bool hasPendingData() const;
+
+    /**
+     * Samples the session has dropped because the client fell behind.
+     */
+    unsigned long droppedSamples() const;
+
+    /**
+     * Read arrived frames on the client end.
+     *
+     * @param now Monotonic time of arrival in microseconds.
+     * @param latencies Where to append the latency of every sample, or
+     *                  NULL to not record them.
+     * @param count Used part of latencies, updated.
+     * @param capacity Size of latencies.
+     * @return samples received.
+     */
+    unsigned receive(quint64 now, quint32* latencies, unsigned& count, unsigned capacity);
+
+private:
+    Q_DISABLE_COPY(SessionClient)
+
+    static const unsigned INBOX_SIZE = 65536;
+
+    int               fd_;         /**< client end of the socket pair */
+    ClientConnection* connection_; /**< sensord end of the socket pair */
+    SessionData*      session_;    /**< session writing to connection_ */
+    char*             inbox_;      /**< bytes read but not yet decoded */
+    unsigned          fill_;       /**< used part of inbox_ */
+};
+
+#endif
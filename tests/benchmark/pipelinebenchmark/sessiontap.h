@@ -0,0 +1,66 @@
+/**
+   @file sessiontap.h
+   @brief Sensor channel side of a simulated session
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SESSIONTAP_H
+#define SESSIONTAP_H
+
+#include "ringbuffer.h"
+#include "samplequeue.h"
+
+/**
+ * Reads a chain output buffer like a sensor channel does and hands each
+ * sample to the main thread through a SampleQueueSet, like
+ * SensorManager::write() does for real sessions.
+ *
+ * @tparam TYPE Data type of the buffer.
+ */
+template <class TYPE>
+class SessionTap : public RingBufferReader<TYPE>
+{
+public:
+    /**
+     * Constructor.
+     *
+     * @param queues Queues drained by the main thread.
+     * @param id Session ID written with every sample.
+     */
+    SessionTap(SampleQueueSet* queues, int id) :
+        queues_(queues),
+        id_(id)
+    {
+    }
+
+    void pushNewData()
+    {
+        RingBufferSpan<const TYPE> span;
+        while ((span = this->readContiguous(64)).size) {
+            for (unsigned i = 0; i < span.size; ++i)
+                queues_->push(id_, &span.data[i], sizeof(TYPE));
+            this->consume(span.size);
+        }
+    }
+
+private:
+    SampleQueueSet* queues_; /**< handoff to main thread */
+    int             id_;     /**< session ID */
+};
+
+#endif
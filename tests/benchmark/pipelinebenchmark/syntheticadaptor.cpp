@@ -0,0 +1,162 @@
+/**
+   @file syntheticadaptor.cpp
+   @brief Adaptors generating samples at a fixed rate for benchmarking
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#include "syntheticadaptor.h"
+#include "datatypes/utils.h"
+#include <time.h>
+#include <math.h>
+
+QAtomicInteger<unsigned> SyntheticAdaptor::rate_(100);
+QAtomicInteger<quint64>  SyntheticAdaptor::generated_(0);
+QAtomicInteger<quint64>  SyntheticAdaptor::sleeps_(0);
+
+SyntheticAdaptorThread::SyntheticAdaptorThread(SyntheticAdaptor* adaptor) :
+    running(0),
+    adaptor_(adaptor)
+{
+}
+
+void SyntheticAdaptorThread::run()
+{
+    const quint64 period = 1000000000ULL / SyntheticAdaptor::rate();
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (quint64 index = 0; running.load(); ++index) {
+        adaptor_->generate(Utils::getTimeStamp(), index);
+        SyntheticAdaptor::generated_.fetchAndAddRelaxed(1);
+
+        quint64 ns = next.tv_nsec + period;
+        next.tv_sec += ns / 1000000000ULL;
+        next.tv_nsec = ns % 1000000000ULL;
+
+        // Catch up without sleeping when behind schedule
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec < next.tv_sec || (now.tv_sec == next.tv_sec && now.tv_nsec < next.tv_nsec)) {
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+            SyntheticAdaptor::sleeps_.fetchAndAddRelaxed(1);
+        }
+    }
+}
+
+SyntheticAdaptor::SyntheticAdaptor(const QString& id) :
+    DeviceAdaptor(id),
+    starts_(0)
+{
+    thread_ = new SyntheticAdaptorThread(this);
+}
+
+SyntheticAdaptor::~SyntheticAdaptor()
+{
+    delete thread_;
+}
+
+void SyntheticAdaptor::setRate(unsigned hz)
+{
+    rate_.store(hz ? hz : 1);
+}
+
+unsigned SyntheticAdaptor::rate()
+{
+    return rate_.load();
+}
+
+quint64 SyntheticAdaptor::generated()
+{
+    return generated_.load();
+}
+
+quint64 SyntheticAdaptor::sleeps()
+{
+    return sleeps_.load();
+}
+
+bool SyntheticAdaptor::startSensor()
+{
+    if (starts_++ == 0) {
+        thread_->running.store(1);
+        thread_->start();
+    }
+    return true;
+}
+
+void SyntheticAdaptor::stopSensor()
+{
+    if (starts_ > 0 && --starts_ == 0) {
+        thread_->running.store(0);
+        thread_->wait();
+    }
+}
+
+SyntheticAccelerometerAdaptor::SyntheticAccelerometerAdaptor(const QString& id) :
+    SyntheticAdaptor(id)
+{
+    buffer_ = new DeviceAdaptorRingBuffer<AccelerationData>(1024);
+    setAdaptedSensor("accelerometer", "Synthetic accelerometer", buffer_);
+}
+
+SyntheticAccelerometerAdaptor::~SyntheticAccelerometerAdaptor()
+{
+    stopSensor();
+    delete buffer_;
+}
+
+void SyntheticAccelerometerAdaptor::generate(quint64 timestamp, quint64 index)
+{
+    // One turn in ten seconds at any rate
+    double angle = 2 * M_PI * index / (10.0 * rate());
+
+    AccelerationData* d = buffer_->nextSlot();
+    d->timestamp_ = timestamp;
+    d->x_ = (int)(981 * sin(angle));
+    d->y_ = (int)(981 * cos(angle));
+    d->z_ = (int)(index % 7) - 3;
+    buffer_->commit();
+    buffer_->wakeUpReaders();
+}
+
+SyntheticMagnetometerAdaptor::SyntheticMagnetometerAdaptor(const QString& id) :
+    SyntheticAdaptor(id)
+{
+    buffer_ = new DeviceAdaptorRingBuffer<CalibratedMagneticFieldData>(1024);
+    setAdaptedSensor("calibratedmagneticfield", "Synthetic magnetometer", buffer_);
+}
+
+SyntheticMagnetometerAdaptor::~SyntheticMagnetometerAdaptor()
+{
+    stopSensor();
+    delete buffer_;
+}
+
+void SyntheticMagnetometerAdaptor::generate(quint64 timestamp, quint64 index)
+{
+    double angle = 2 * M_PI * index / (10.0 * rate());
+
+    CalibratedMagneticFieldData* d = buffer_->nextSlot();
+    d->timestamp_ = timestamp;
+    d->rx_ = d->x_ = (int)(300 * cos(angle));
+    d->ry_ = d->y_ = (int)(300 * sin(angle));
+    d->rz_ = d->z_ = -400;
+    d->level_ = 3;
+    buffer_->commit();
+    buffer_->wakeUpReaders();
+}
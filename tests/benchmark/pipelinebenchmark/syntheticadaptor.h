@@ -0,0 +1,154 @@
+/**
+   @file syntheticadaptor.h
+   @brief Adaptors generating samples at a fixed rate for benchmarking
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+ */
+
+#ifndef SYNTHETICADAPTOR_H
+#define SYNTHETICADAPTOR_H
+
+#include "deviceadaptor.h"
+#include "deviceadaptorringbuffer.h"
+#include "datatypes/orientationdata.h"
+#include <QThread>
+#include <QAtomicInteger>
+
+class SyntheticAdaptor;
+
+/**
+ * Thread writing samples into a SyntheticAdaptor on an absolute
+ * schedule, so the rate does not drift with processing time.
+ */
+class SyntheticAdaptorThread : public QThread
+{
+    Q_OBJECT;
+public:
+    SyntheticAdaptorThread(SyntheticAdaptor* adaptor);
+    void run();
+
+    QAtomicInt running; /**< keep generating */
+
+private:
+    SyntheticAdaptor* adaptor_;
+};
+
+/**
+ * Adaptor which generates samples itself at the rate set with setRate().
+ * Samples are committed and readers woken up on the generator thread,
+ * exactly like real adaptors do on their reader threads.
+ */
+class SyntheticAdaptor : public DeviceAdaptor
+{
+    Q_OBJECT;
+public:
+    /**
+     * Set sample rate used by adaptors started after the call.
+     *
+     * @param hz Samples per second.
+     */
+    static void setRate(unsigned hz);
+
+    /**
+     * Sample rate.
+     */
+    static unsigned rate();
+
+    /**
+     * Samples generated by all synthetic adaptors.
+     */
+    static quint64 generated();
+
+    /**
+     * Sleeps done by all generator threads. Each one is a syscall which
+     * is not part of the pipeline being measured.
+     */
+    static quint64 sleeps();
+
+    bool startAdaptor() { return true; }
+    void stopAdaptor() {}
+    bool startSensor();
+    void stopSensor();
+    void init() {}
+
+protected:
+    SyntheticAdaptor(const QString& id);
+    virtual ~SyntheticAdaptor();
+
+    /**
+     * Write one sample into the adaptor buffer and wake up readers.
+     *
+     * @param timestamp Monotonic time in microseconds.
+     * @param index Running sample number.
+     */
+    virtual void generate(quint64 timestamp, quint64 index) = 0;
+
+private:
+    friend class SyntheticAdaptorThread;
+
+    SyntheticAdaptorThread*        thread_;   /**< generator */
+    int                            starts_;   /**< startSensor() nesting */
+
+    static QAtomicInteger<unsigned> rate_;      /**< samples per second */
+    static QAtomicInteger<quint64>  generated_; /**< samples written */
+    static QAtomicInteger<quint64>  sleeps_;    /**< generator sleeps */
+};
+
+/**
+ * Accelerometer whose gravity vector rotates slowly around the z axis,
+ * so that orientation changes now and then.
+ */
+class SyntheticAccelerometerAdaptor : public SyntheticAdaptor
+{
+    Q_OBJECT;
+public:
+    static DeviceAdaptor* factoryMethod(const QString& id)
+    {
+        return new SyntheticAccelerometerAdaptor(id);
+    }
+
+protected:
+    SyntheticAccelerometerAdaptor(const QString& id);
+    ~SyntheticAccelerometerAdaptor();
+    void generate(quint64 timestamp, quint64 index);
+
+private:
+    DeviceAdaptorRingBuffer<AccelerationData>* buffer_;
+};
+
+/**
+ * Magnetometer reporting a slowly rotating field.
+ */
+class SyntheticMagnetometerAdaptor : public SyntheticAdaptor
+{
+    Q_OBJECT;
+public:
+    static DeviceAdaptor* factoryMethod(const QString& id)
+    {
+        return new SyntheticMagnetometerAdaptor(id);
+    }
+
+protected:
+    SyntheticMagnetometerAdaptor(const QString& id);
+    ~SyntheticMagnetometerAdaptor();
+    void generate(quint64 timestamp, quint64 index);
+
+private:
+    DeviceAdaptorRingBuffer<CalibratedMagneticFieldData>* buffer_;
+};
+
+#endif
@@ -0,0 +1,15 @@
+QT += testlib
+QT -= gui
+
+include(../common-install.pri)
+
+CONFIG += debug
+TEMPLATE = app
+TARGET = sensorcapi-test
+HEADERS += capitest.h
+SOURCES += capitest.cpp
+
+INCLUDEPATH += ../../c-api \
+               ../../include
+
+QMAKE_LIBDIR_FLAGS += -L../../c-api -lsensorfw-c
@@ -0,0 +1,175 @@
+/**
+   @file capitest.cpp
+   @brief Automatic tests for the C client library
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#include "capitest.h"
+#include "sensorfw-c.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <QAtomicInt>
+#include <poll.h>
+
+static const char* SENSOR = "accelerometersensor";
+
+/* Keeps calling the accessors of a session until it is closed under it. */
+class SessionUser : public QThread
+{
+public:
+    SessionUser(int sessionId) : sessionId_(sessionId), calls_(0) {}
+
+    int calls() const { return calls_.load(); }
+
+protected:
+    void run()
+    {
+        sensorfw_xyz_t samples[16];
+        while (sensorfw_get_sample_size(sessionId_)) {
+            sensorfw_get_interval(sessionId_);
+            sensorfw_read(sessionId_, samples, 16);
+            sensorfw_get_dropped(sessionId_);
+            calls_.ref();
+        }
+    }
+
+private:
+    int sessionId_;
+    QAtomicInt calls_;
+};
+
+int CApiTest::waitSamples(int sessionId, int wanted, int timeout)
+{
+    sensorfw_xyz_t samples[16];
+    struct pollfd pfd;
+    QElapsedTimer timer;
+    int count = 0;
+
+    pfd.fd = sensorfw_get_fd(sessionId);
+    pfd.events = POLLIN;
+    timer.start();
+    while (count < wanted && timer.elapsed() < timeout) {
+        int n = sensorfw_read(sessionId, samples, 16);
+        if (n < 0)
+            return -1;
+        count += n;
+        if (n < 16)
+            poll(&pfd, 1, 100);
+    }
+    return count;
+}
+
+void CApiTest::initTestCase()
+{
+    QVERIFY(sensorfw_init(SENSOR));
+}
+
+void CApiTest::testInvalidSession()
+{
+    sensorfw_xyz_t sample;
+    char* text = 0;
+
+    QVERIFY(!sensorfw_close_session(-1));
+    QVERIFY(!sensorfw_start_sensor(-1));
+    QVERIFY(!sensorfw_stop_sensor(-1));
+    QVERIFY(!sensorfw_running(-1));
+    QCOMPARE(sensorfw_get_interval(-1), -1);
+    QVERIFY(!sensorfw_set_interval(-1, 100));
+    QVERIFY(!sensorfw_get_description(-1, &text));
+    QCOMPARE(sensorfw_get_fd(-1), -1);
+    QCOMPARE(sensorfw_get_sample_size(-1), (size_t)0);
+    QCOMPARE(sensorfw_read(-1, &sample, 1), -1);
+    QCOMPARE(sensorfw_get_dropped(-1), 0ul);
+    QCOMPARE(sensorfw_last_error(-1, &text), -1);
+    QCOMPARE(sensorfw_open_session("nosuchsensor"), -1);
+}
+
+void CApiTest::testOpenClose()
+{
+    sensorfw_xyz_t sample;
+    char* description = 0;
+    int id = sensorfw_open_session(SENSOR);
+
+    QVERIFY(id >= 0);
+    QCOMPARE(sensorfw_get_sample_size(id), sizeof(sensorfw_xyz_t));
+    QVERIFY(sensorfw_get_fd(id) >= 0);
+    QVERIFY(sensorfw_get_description(id, &description));
+    QVERIFY(description);
+    QVERIFY(!sensorfw_running(id));
+    QVERIFY(sensorfw_close_session(id));
+
+    // Closed sessions behave like unknown ones
+    QVERIFY(!sensorfw_close_session(id));
+    QCOMPARE(sensorfw_get_sample_size(id), (size_t)0);
+    QCOMPARE(sensorfw_read(id, &sample, 1), -1);
+}
+
+void CApiTest::testReadSamples()
+{
+    int id = sensorfw_open_session(SENSOR);
+
+    QVERIFY(id >= 0);
+    QVERIFY(sensorfw_set_interval(id, 20));
+    QVERIFY(sensorfw_start_sensor(id));
+    QVERIFY(sensorfw_running(id));
+    QVERIFY(waitSamples(id, 10, 5000) >= 10);
+    QVERIFY(sensorfw_stop_sensor(id));
+    QVERIFY(!sensorfw_running(id));
+    QVERIFY(sensorfw_close_session(id));
+}
+
+void CApiTest::testSharedConnection()
+{
+    int first = sensorfw_open_session(SENSOR);
+    int second = sensorfw_open_session(SENSOR);
+
+    QVERIFY(first >= 0);
+    QVERIFY(second >= 0);
+    QCOMPARE(sensorfw_get_fd(first), sensorfw_get_fd(second));
+
+    // Samples of the unread session are kept for it meanwhile
+    QVERIFY(sensorfw_set_interval(first, 20));
+    QVERIFY(sensorfw_set_interval(second, 20));
+    QVERIFY(sensorfw_start_sensor(first));
+    QVERIFY(sensorfw_start_sensor(second));
+    QVERIFY(waitSamples(first, 10, 5000) >= 10);
+    QVERIFY(waitSamples(second, 1, 100) >= 1);
+
+    QVERIFY(sensorfw_close_session(first));
+    QVERIFY(waitSamples(second, 5, 5000) >= 5);
+    QVERIFY(sensorfw_close_session(second));
+}
+
+void CApiTest::testCloseWhileInUse()
+{
+    for (int i = 0; i < 10; ++i) {
+        int id = sensorfw_open_session(SENSOR);
+        QVERIFY(id >= 0);
+        QVERIFY(sensorfw_start_sensor(id));
+
+        SessionUser user(id);
+        user.start();
+        QTest::qWait(50);
+        QVERIFY(sensorfw_close_session(id));
+        QVERIFY(user.wait(5000));
+        QVERIFY(user.calls() > 0);
+    }
+}
+
+QTEST_MAIN(CApiTest)
@@ -0,0 +1,44 @@
+/**
+   @file capitest.h
+   @brief Automatic tests for the C client library
+
+   <p>
+   This file is part of Sensord.
+
+   Sensord is free software; you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License
+   version 2.1 as published by the Free Software Foundation.
+
+   Sensord is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+   Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public
+   License along with Sensord.  If not, see <http://www.gnu.org/licenses/>.
+   </p>
+*/
+
+#ifndef C_API_TEST_H
+#define C_API_TEST_H
+
+#include <QTest>
+
+class CApiTest : public QObject
+{
+    Q_OBJECT;
+
+private:
+    static int waitSamples(int sessionId, int wanted, int timeout);
+
+private slots:
+    void initTestCase();
+
+    void testInvalidSession();
+    void testOpenClose();
+    void testReadSamples();
+    void testSharedConnection();
+    void testCloseWhileInUse();
+};
+
+#endif // C_API_TEST_H
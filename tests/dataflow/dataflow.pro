@@ -7,8 +7,11 @@ TARGET = sensordataflow-test
 
 CONFIG += testcase
 
-HEADERS += dataflowtests.h
-SOURCES += dataflowtests.cpp
+HEADERS += dataflowtests.h \
+    ../../chains/compasschain/compassfilter.h
+
+SOURCES += dataflowtests.cpp \
+    ../../chains/compasschain/compassfilter.cpp
 
 INCLUDEPATH += ../../include \
     ../../chains \
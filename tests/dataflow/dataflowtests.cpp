@@ -28,22 +28,47 @@
 #include <QtDebug>
 #include <QTest>
 #include <QVariant>
+#include <QDir>
+#include <QTemporaryFile>
+#include <QFile>
+#include <QCoreApplication>
+#include <QSignalSpy>
 
 #include <typeinfo>
+#include <new>
 #include "sensormanager.h"
 #include "bin.h"
+#include "nodebase.h"
 #include "bufferreader.h"
 #include "filter.h"
 #include "config.h"
 #include "dataflowtests.h"
 #include "loader.h"
 #include "plugin.h"
+#include "samplequeue.h"
+#include "deviceadaptorringbuffer.h"
+#include "pipelinechain.h"
+#include "timestampmapper.h"
+#include "wakeupgrid.h"
+#include "datatypes/utils.h"
+#include "tracerecorder.h"
+#include "sockethandler.h"
+#include "wireprotocol.h"
+#include "slidingwindow.h"
+#include "downsampler.h"
+#include "fastmath.h"
+#include "latestsampletable.h"
 #include <accelerometeradaptor/accelerometeradaptor.h>
 #include <accelerometerchain/accelerometerchain.h>
+#include <compasschain/compassfilter.h>
 #include <coordinatealignfilter/coordinatealignfilter.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 void DataFlowTest::initTestCase()
 {
@@ -188,6 +213,857 @@ void DataFlowTest::testChainSharing()
     sm.releaseChain("accelerometerchain");
     // check that does not exist
 }
+
+void DataFlowTest::testSampleQueue()
+{
+    SampleQueue queue(3);
+    QCOMPARE(queue.capacity(), 4u);
+    QVERIFY(queue.front() == NULL);
+
+    for (int i = 0; i < 4; ++i)
+        QVERIFY(queue.push(i, &i, sizeof(i)));
+
+    // Full queue and oversized samples are dropped
+    int value = 4;
+    QVERIFY(!queue.push(4, &value, sizeof(value)));
+    char large[SampleQueue::SLOT_PAYLOAD_SIZE + 1];
+    QVERIFY(!queue.push(5, large, sizeof(large)));
+    QCOMPARE(queue.drops(), 2u);
+    QCOMPARE(queue.depth(), 4u);
+    QCOMPARE(queue.highWatermark(), 4u);
+
+    for (int i = 0; i < 4; ++i) {
+        const SampleQueue::Slot* slot = queue.front();
+        QVERIFY(slot);
+        QCOMPARE(slot->id, i);
+        QCOMPARE(slot->size, (int)sizeof(int));
+        QCOMPARE(*reinterpret_cast<const int*>(slot->payload), i);
+        queue.pop();
+    }
+    QVERIFY(queue.front() == NULL);
+    QCOMPARE(queue.depth(), 0u);
+
+    // Set hands out queue per thread and wakes up through the eventfd
+    SampleQueueSet set(8);
+    QVERIFY(set.isValid());
+    QVERIFY(set.push(1, &value, sizeof(value)));
+    QVERIFY(set.push(2, &value, sizeof(value)));
+    QCOMPARE(set.count(), 1);
+    QCOMPARE(set.queue(0)->depth(), 2u);
+
+    quint64 wakeups = 0;
+    QCOMPARE(read(set.notifyFd(), &wakeups, sizeof(wakeups)), (ssize_t)sizeof(wakeups));
+    QCOMPARE(wakeups, (quint64)1);
+}
+
+namespace {
+
+struct BenchSample
+{
+    quint64 timestamp;
+    int     x, y, z;
+};
+
+/**
+ * Reader which copies data out of the buffer in chunks, like readers
+ * did before span access.
+ */
+template <class TYPE>
+class CopyingReader : public RingBufferReader<TYPE>
+{
+public:
+    CopyingReader() : count_(0) {}
+
+    void pushNewData()
+    {
+        TYPE chunk[16];
+        unsigned n;
+        while ((n = this->read(16, chunk)))
+            count_ += n;
+    }
+
+    using RingBufferReader<TYPE>::read;
+
+    unsigned count_;
+};
+
+/**
+ * Reader which processes data in place.
+ */
+template <class TYPE>
+class SpanReader : public RingBufferReader<TYPE>
+{
+public:
+    SpanReader() : count_(0) {}
+
+    void pushNewData()
+    {
+        RingBufferSpan<const TYPE> span;
+        while ((span = this->readContiguous(16)).size) {
+            count_ += span.size;
+            this->consume(span.size);
+        }
+    }
+
+    using RingBufferReader<TYPE>::readContiguous;
+    using RingBufferReader<TYPE>::consume;
+
+    unsigned count_;
+};
+
+const int BENCH_SAMPLES = 4096;
+
+}
+
+void DataFlowTest::testRingBuffer()
+{
+    DeviceAdaptorRingBuffer<int> buffer(5);
+    QCOMPARE(buffer.capacity(), 8u);
+
+    CopyingReader<int> reader;
+    QVERIFY(buffer.join(&reader));
+
+    int values[20];
+    for (int i = 0; i < 20; ++i)
+        values[i] = i;
+
+    // Span crossing the end of the buffer memory is split in two
+    for (int i = 0; i < 6; ++i) {
+        *buffer.nextSlot() = values[i];
+        buffer.commit();
+    }
+    int out[20];
+    QCOMPARE(reader.read(20, out), 6u);
+    RingBufferSpan<int> span = buffer.writeContiguous(5);
+    QCOMPARE(span.size, 2u);
+    span.data[0] = 6;
+    span.data[1] = 7;
+    buffer.commit(2);
+    QCOMPARE(reader.read(20, out), 2u);
+    QCOMPARE(out[1], 7);
+
+    // Writer overruns the reader by four objects
+    for (int i = 0; i < 12; ++i) {
+        *buffer.nextSlot() = values[i];
+        buffer.commit();
+    }
+    QCOMPARE(reader.read(20, out), 8u);
+    QCOMPARE(out[0], 4);
+    QCOMPARE(out[7], 11);
+    QCOMPARE(reader.lapped(), 1u);
+    QCOMPARE(reader.lost(), 4u);
+    QCOMPARE(buffer.lappedReaders(), 1u);
+
+    // Readers see data in place
+    SpanReader<int> spanReader;
+    QVERIFY(buffer.join(&spanReader));
+    for (int i = 0; i < 3; ++i) {
+        *buffer.nextSlot() = values[i];
+        buffer.commit();
+    }
+    RingBufferSpan<const int> readSpan = spanReader.readContiguous(20);
+    QCOMPARE(readSpan.size, 3u);
+    QCOMPARE(readSpan.data[2], 2);
+    QVERIFY(spanReader.consume(readSpan.size));
+    QCOMPARE(spanReader.readContiguous(20).size, 0u);
+
+    QVERIFY(buffer.unjoin(&reader));
+    QVERIFY(buffer.unjoin(&spanReader));
+}
+
+void DataFlowTest::benchmarkRingBufferElementwise()
+{
+    DeviceAdaptorRingBuffer<BenchSample> buffer(256);
+    CopyingReader<BenchSample> reader;
+    buffer.join(&reader);
+    BenchSample sample = { 0, 1, 2, 3 };
+
+    QBENCHMARK {
+        for (int i = 0; i < BENCH_SAMPLES; ++i) {
+            *buffer.nextSlot() = sample;
+            buffer.commit();
+            buffer.wakeUpReaders();
+        }
+    }
+    QVERIFY(reader.count_ >= (unsigned)BENCH_SAMPLES);
+    buffer.unjoin(&reader);
+}
+
+void DataFlowTest::benchmarkRingBufferSpans()
+{
+    DeviceAdaptorRingBuffer<BenchSample> buffer(256);
+    SpanReader<BenchSample> reader;
+    buffer.join(&reader);
+    BenchSample sample = { 0, 1, 2, 3 };
+
+    QBENCHMARK {
+        int left = BENCH_SAMPLES;
+        while (left) {
+            RingBufferSpan<BenchSample> span = buffer.writeContiguous(qMin(left, 64));
+            for (unsigned i = 0; i < span.size; ++i)
+                span.data[i] = sample;
+            buffer.commit(span.size);
+            buffer.wakeUpReaders();
+            left -= span.size;
+        }
+    }
+    QVERIFY(reader.count_ >= (unsigned)BENCH_SAMPLES);
+    buffer.unjoin(&reader);
+}
+
+/**
+ * Node counting interval writes, which can be made to fail.
+ */
+class IntervalCountingNode : public NodeBase
+{
+public:
+    IntervalCountingNode() : NodeBase("intervalcountingnode"), applied(0), writes(0), fail(false)
+    {
+        introduceAvailableInterval(DataRange(10, 1000, 0));
+    }
+
+    unsigned int interval() const { return applied; }
+
+    bool setInterval(unsigned int value, int sessionId)
+    {
+        Q_UNUSED(sessionId);
+        ++writes;
+        if (fail)
+            return false;
+        applied = value;
+        return true;
+    }
+
+    RingBufferBase* findBuffer(const QString& name) const
+    {
+        Q_UNUSED(name);
+        return 0;
+    }
+
+    unsigned int applied;
+    int writes;
+    bool fail;
+};
+
+void DataFlowTest::testIntervalRequests()
+{
+    IntervalCountingNode node;
+    QSignalSpy changes(&node, SIGNAL(propertyChanged(const QString&)));
+
+    // Requests are applied right away, the smallest one winning
+    QVERIFY(node.setIntervalRequest(1, 100));
+    QCOMPARE(node.writes, 1);
+    QCOMPARE(node.applied, 100u);
+    QVERIFY(node.setIntervalRequest(2, 50));
+    QCOMPARE(node.writes, 2);
+    QCOMPARE(node.applied, 50u);
+    QCOMPARE(changes.count(), 2);
+
+    // Invalid requests and ones not changing the winner are not written
+    QVERIFY(!node.setIntervalRequest(4, 5000));
+    QVERIFY(node.setIntervalRequest(3, 200));
+    QVERIFY(node.setIntervalRequest(3, 150));
+    QCOMPARE(node.writes, 2);
+
+    // Ties go to the lower session ID, the value is unchanged
+    QVERIFY(node.setIntervalRequest(1, 50));
+    QCOMPARE(node.writes, 3);
+    QCOMPARE(changes.count(), 2);
+
+    // Removing winners falls back to the next smallest request
+    node.removeIntervalRequest(1);
+    node.removeIntervalRequest(2);
+    QCOMPARE(node.writes, 5);
+    QCOMPARE(node.applied, 150u);
+    QCOMPARE(changes.count(), 3);
+
+    // An interval set behind the node's back is not taken as applied
+    node.setInterval(500, 0);
+    QVERIFY(node.setIntervalRequest(6, 300));
+    QCOMPARE(node.writes, 7);
+    QCOMPARE(node.applied, 150u);
+    QCOMPARE(changes.count(), 4);
+
+    // Failures are reported and not cached but retried with the next request
+    node.fail = true;
+    QVERIFY(!node.setIntervalRequest(4, 20));
+    QCOMPARE(node.writes, 8);
+    QCOMPARE(node.applied, 150u);
+    node.fail = false;
+    QVERIFY(node.setIntervalRequest(5, 500));
+    QCOMPARE(node.writes, 9);
+    QCOMPARE(node.applied, 20u);
+    QCOMPARE(changes.count(), 5);
+}
+
+void DataFlowTest::testPipelineDescription()
+{
+    PipelineDescription pipeline;
+
+    // Compass graph: one source feeds an output and a filter
+    QVERIFY(pipeline.parse(QStringList() << "acc:accelerometerchain/accelerometer"
+                                         << "mag:magcalibrationchain/calibratedmagnetometerdata",
+                           QStringList() << "avg:avgaccfilter" << "compass:compassfilter"
+                                         << "decl:declinationfilter",
+                           QStringList() << "acc>avg" << "avg>compass.accsink"
+                                         << "mag>compass.magsink" << "compass.magnorthangle>decl",
+                           QStringList() << "magneticnorth:compass.magnorthangle"
+                                         << "truenorth:decl"));
+    QCOMPARE(pipeline.inputs().size(), 2);
+    QCOMPARE(pipeline.inputs().at(1).provider, QString("magcalibrationchain"));
+    QCOMPARE(pipeline.inputs().at(1).buffer, QString("calibratedmagnetometerdata"));
+    QCOMPARE(pipeline.links().at(1).to.port, QString("accsink"));
+    QCOMPARE(pipeline.links().at(0).from.port, QString("source"));
+    QCOMPARE(pipeline.fanOut(pipeline.links().at(3).from), 2);
+    QCOMPARE(pipeline.directLinks(), 3);
+
+    QStringList inputs = QStringList() << "acc:accelerometeradaptor/accelerometer";
+    QStringList filters = QStringList() << "a:avgaccfilter" << "b:downsamplefilter";
+    QStringList outputs = QStringList() << "out:b";
+
+    QVERIFY(!pipeline.parse(inputs, filters, QStringList() << "acc>a" << "a>b" << "b>a", outputs));
+    QVERIFY(!pipeline.parse(inputs, filters, QStringList() << "acc>a", outputs));
+    QVERIFY(!pipeline.parse(inputs, filters, QStringList() << "acc>a" << "x>b", outputs));
+    QVERIFY(!pipeline.parse(inputs, filters, QStringList() << "acc>a" << "a>acc", outputs));
+    QVERIFY(!pipeline.parse(inputs, filters, QStringList() << "acc>a" << "a>b", QStringList()));
+    QVERIFY(!pipeline.parse(inputs, QStringList() << "acc:avgaccfilter", QStringList() << "acc>acc", outputs));
+    QVERIFY(!pipeline.parse(QStringList() << "acc:accelerometeradaptor", filters, QStringList(), outputs));
+    QVERIFY(pipeline.parse(inputs, filters, QStringList() << "acc>a" << "a>b", outputs));
+}
+
+void DataFlowTest::testPipelineChain()
+{
+    // One consumer of the input takes the single sink path of Source,
+    // the filter feeding two outputs walks its sink set.
+    QTemporaryFile file(QDir::tempPath() + "/pipelinetestXXXXXX.conf");
+    QVERIFY(file.open());
+    file.write("[pipelinetestchain]\n"
+               "plugins = coordinatealignfilter\n"
+               "inputs = acc:pipelinetestadaptor/accelerometer\n"
+               "filters = align:coordinatealignfilter\n"
+               "links = acc>align\n"
+               "outputs = accelerometer:align, mirror:align\n"
+               "align/transMatrix = \"0,1,0,-1,0,0,0,0,1\"\n");
+    file.close();
+    QVERIFY(SensorFrameworkConfig::loadConfig(file.fileName(), ""));
+
+    SensorManager& sm = SensorManager::instance();
+    sm.registerDeviceAdaptor<PipelineTestAdaptor>("pipelinetestadaptor");
+    sm.registerChain<PipelineChain>("pipelinetestchain");
+
+    AbstractChain* chain = sm.requestChain("pipelinetestchain");
+    QVERIFY(chain);
+    QVERIFY(chain->isValid());
+    RingBuffer<TimedXyzData>* output = dynamic_cast<RingBuffer<TimedXyzData>*>(chain->findBuffer("accelerometer"));
+    RingBuffer<TimedXyzData>* mirror = dynamic_cast<RingBuffer<TimedXyzData>*>(chain->findBuffer("mirror"));
+    QVERIFY(output);
+    QVERIFY(mirror);
+
+    CopyingReader<TimedXyzData> reader;
+    CopyingReader<TimedXyzData> mirrorReader;
+    QVERIFY(output->join(&reader));
+    QVERIFY(mirror->join(&mirrorReader));
+
+    PipelineTestAdaptor* adaptor = dynamic_cast<PipelineTestAdaptor*>(sm.requestDeviceAdaptor("pipelinetestadaptor"));
+    QVERIFY(adaptor);
+    QVERIFY(chain->start());
+    for (int i = 0; i < 10; ++i)
+        adaptor->push(1000 + i, i, 100 + i, -i);
+
+    // Matrix from the configuration turns (x, y, z) into (y, -x, z)
+    TimedXyzData out[16];
+    QCOMPARE(reader.read(16, out), 10u);
+    for (int i = 0; i < 10; ++i) {
+        QCOMPARE(out[i].timestamp_, (quint64)(1000 + i));
+        QCOMPARE(out[i].x_, 100 + i);
+        QCOMPARE(out[i].y_, -i);
+        QCOMPARE(out[i].z_, -i);
+    }
+    QCOMPARE(mirrorReader.read(16, out), 10u);
+    QCOMPARE(out[9].x_, 109);
+
+    QVERIFY(chain->stop());
+    QVERIFY(output->unjoin(&reader));
+    QVERIFY(mirror->unjoin(&mirrorReader));
+    sm.releaseDeviceAdaptor("pipelinetestadaptor");
+    sm.releaseChain("pipelinetestchain");
+}
+
+void DataFlowTest::testTimestampMapper()
+{
+    const quint64 ms = 1000000;
+    const quint64 base = 1000 * ms;
+    const quint64 skew = 400 * ms;
+
+    // Unknown clock: offset is the lower envelope of arrival - event
+    TimestampMapper estimated(TimestampMapper::Estimated);
+    QCOMPARE(estimated.map(base, base + skew + 3 * ms), base + skew + 3 * ms);
+    QCOMPARE(estimated.map(base + 10 * ms, base + skew + 11 * ms), base + skew + 11 * ms);
+    QCOMPARE(estimated.offset(), (qint64)(skew + 1 * ms));
+    QCOMPARE(estimated.map(base + 20 * ms, base + skew + 25 * ms), base + skew + 21 * ms);
+    QCOMPARE(estimated.offset(), (qint64)(skew + 1 * ms));
+
+    // Read times alternating 0 and 1 ms late: period and jitter are
+    // estimated and the output intervals are regularized
+    TimestampMapper smoothed(TimestampMapper::Monotonic, true);
+    quint64 previous = 0;
+    quint64 worst = 0;
+    for (int i = 0; i < 400; ++i) {
+        quint64 arrival = base + i * 10 * ms + (i % 2 ? 1 * ms : 0);
+        quint64 time = smoothed.map(arrival, arrival);
+        QVERIFY(time <= arrival);
+        QVERIFY(time > previous);
+        if (i >= 300)
+            worst = qMax(worst, (quint64)qAbs((qint64)(time - previous) - (qint64)(10 * ms)));
+        previous = time;
+    }
+    QVERIFY(worst < ms / 4);
+    QVERIFY(qAbs((qint64)smoothed.period() - (qint64)(10 * ms)) < (qint64)(ms / 20));
+    QVERIFY(smoothed.jitter() > 0);
+    QCOMPARE(smoothed.resyncs(), 0ul);
+
+    // Gap resynchronizes to the raw time
+    quint64 arrival = base + 405 * 10 * ms;
+    QCOMPARE(smoothed.map(arrival, arrival), arrival);
+    QCOMPARE(smoothed.resyncs(), 1ul);
+
+    // Read times skip the clock of event times: a realtime mapper fed
+    // with monotonic read times must not shift them to the epoch
+    TimestampMapper realtime(TimestampMapper::Realtime);
+    quint64 now = Utils::getTimeStampNs();
+    QCOMPARE(realtime.mapArrival(now), now);
+    QCOMPARE(realtime.mapArrival(now + 10 * ms), now + 10 * ms);
+    QCOMPARE(realtime.mapArrivalToMicroseconds(now + 20 * ms), (now + 20 * ms + 500) / 1000);
+
+    // Event times of the same mapper are still moved from the epoch
+    TimestampMapper kernel(TimestampMapper::Realtime);
+    quint64 arrived = Utils::getTimeStampNs();
+    quint64 mapped = kernel.map(Utils::getTimeStampNs(CLOCK_REALTIME) - 5 * ms, arrived + 1 * ms);
+    QVERIFY(mapped + 10 * ms > arrived && mapped <= arrived + 1 * ms);
+}
+
+void DataFlowTest::testWakeupGrid()
+{
+    // No grid and no period are left alone
+    QCOMPARE(WakeupGrid::snapPeriod(30, 0), 30u);
+    QCOMPARE(WakeupGrid::snapPeriod(0, 100), 0u);
+
+    // Periods of a step or more round up to multiples of the step
+    QCOMPARE(WakeupGrid::snapPeriod(100, 100), 100u);
+    QCOMPARE(WakeupGrid::snapPeriod(101, 100), 200u);
+    QCOMPARE(WakeupGrid::snapPeriod(250, 100), 300u);
+
+    // Shorter ones round up to even subdivisions of the step
+    QCOMPARE(WakeupGrid::snapPeriod(20, 100), 20u);
+    QCOMPARE(WakeupGrid::snapPeriod(30, 100), 50u);
+    QCOMPARE(WakeupGrid::snapPeriod(40, 100), 50u);
+    QCOMPARE(WakeupGrid::snapPeriod(1, 100), 1u);
+    QCOMPARE(WakeupGrid::snapPeriod(3, 7), 7u);
+
+    // Never shorter than requested and always on the grid
+    const unsigned grids[] = { 7, 60, 100 };
+    for (unsigned g = 0; g < sizeof(grids) / sizeof(grids[0]); ++g) {
+        for (unsigned period = 1; period <= 3 * grids[g]; ++period) {
+            unsigned snapped = WakeupGrid::snapPeriod(period, grids[g]);
+            QVERIFY(snapped >= period);
+            QVERIFY(snapped % grids[g] == 0 || grids[g] % snapped == 0);
+        }
+    }
+}
+
+void DataFlowTest::testTraceFile()
+{
+    QString path = QString("%1/sensorfw-trace-%2.trace").arg(QDir::tempPath()).arg(getpid());
+    QString replayPath = QString("%1/sensorfw-replay-%2.trace").arg(QDir::tempPath()).arg(getpid());
+
+    // Everything written into the buffer ends up in the trace
+    DeviceAdaptorRingBuffer<TimedXyzData> buffer(16);
+    RingBufferReaderBase* recorder = TraceType::record(&buffer, path, "accelerometeradaptor", "accelerometer");
+    QVERIFY(recorder);
+    for (int i = 0; i < 40; ++i) {
+        *buffer.nextSlot() = TimedXyzData(1000 + i * 10000, i, -i, 2 * i);
+        buffer.commit();
+        if (i % 3 == 2)
+            buffer.wakeUpReaders();
+    }
+    buffer.wakeUpReaders();
+    QVERIFY(buffer.unjoin(recorder));
+    delete static_cast<Pusher*>(recorder);
+
+    TraceReader trace;
+    QVERIFY2(trace.open(path), qPrintable(trace.errorString()));
+    QCOMPARE(trace.count(), (quint64)40);
+    QCOMPARE(trace.typeName(), QString("TimedXyzData"));
+    QCOMPARE(trace.adaptor(), QString("accelerometeradaptor"));
+    QCOMPARE(trace.buffer(), QString("accelerometer"));
+    QCOMPARE(trace.firstTimestamp(), (quint64)1000);
+    QCOMPARE(trace.lastTimestamp(), (quint64)(1000 + 39 * 10000));
+    const TimedXyzData* last = reinterpret_cast<const TimedXyzData*>(trace.sample(39));
+    QCOMPARE(last->x_, 39);
+    QCOMPARE(last->z_, 78);
+
+    // Replay into a buffer of the recorded type shifts the timestamps only
+    const TraceType* type = TraceType::find(trace.typeName());
+    QVERIFY(type);
+    RingBufferBase* replayBuffer = type->createBuffer(64);
+    QCOMPARE(TraceType::find(replayBuffer), type);
+    recorder = TraceType::record(replayBuffer, replayPath, "replay", "accelerometer");
+    QVERIFY(recorder);
+    type->replay(replayBuffer, trace.samples(), trace.count(), 500);
+    QVERIFY(replayBuffer->unjoin(recorder));
+    delete static_cast<Pusher*>(recorder);
+    delete replayBuffer;
+
+    TraceReader replayed;
+    QVERIFY2(replayed.open(replayPath), qPrintable(replayed.errorString()));
+    QCOMPARE(replayed.count(), trace.count());
+    for (quint64 i = 0; i < trace.count(); ++i) {
+        const TimedXyzData* a = reinterpret_cast<const TimedXyzData*>(trace.sample(i));
+        const TimedXyzData* b = reinterpret_cast<const TimedXyzData*>(replayed.sample(i));
+        QCOMPARE(b->timestamp_, a->timestamp_ + 500);
+        QCOMPARE(b->y_, a->y_);
+    }
+
+    // Samples are compared by fields, whatever is in their padding
+    quint64 first[(sizeof(TimedXyzData) + 7) / 8];
+    quint64 second[(sizeof(TimedXyzData) + 7) / 8];
+    memset(first, 0, sizeof(first));
+    memset(second, 0xff, sizeof(second));
+    new (first) TimedXyzData(1000, 1, 2, 3);
+    new (second) TimedXyzData(1000, 1, 2, 3);
+    QVERIFY(type->equal((const char*)first, (const char*)second));
+    new (second) TimedXyzData(1000, 1, 2, 4);
+    QVERIFY(!type->equal((const char*)first, (const char*)second));
+
+    // Files which are not traces are rejected
+    QVERIFY(!trace.open(QCoreApplication::applicationFilePath()));
+    QVERIFY(!trace.errorString().isEmpty());
+
+    replayed.close();
+    QFile::remove(path);
+    QFile::remove(replayPath);
+}
+
+/**
+ * Read bytes written to the other end of a socket pair, flushing the
+ * connection feeding it meanwhile.
+ */
+static bool readSocket(int fd, ClientConnection& connection, void* dest, size_t bytes)
+{
+    char* to = static_cast<char*>(dest);
+    while (bytes) {
+        connection.flush();
+        QCoreApplication::processEvents();
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (poll(&pfd, 1, 1000) != 1)
+            return false;
+        ssize_t n = recv(fd, to, bytes, MSG_DONTWAIT);
+        if (n <= 0)
+            return false;
+        to += n;
+        bytes -= n;
+    }
+    return true;
+}
+
+void DataFlowTest::testWireProtocol()
+{
+    int fds[2];
+    QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    QLocalSocket* socket = new QLocalSocket;
+    QVERIFY(socket->setSocketDescriptor(fds[0]));
+    ClientConnection connection(socket, 2);
+    SessionData session(&connection, 7);
+    session.setSampleType(SENSORFW_WIRE_SAMPLE_XYZ);
+    sensorfw_wire_frame_t header;
+    TimedXyzData sample(1000, 1, 2, 3);
+
+    // Attach is acknowledged with an empty frame of the session
+    session.acknowledge();
+    QVERIFY(readSocket(fds[1], connection, &header, sizeof(header)));
+    QCOMPARE(header.channel, 7);
+    QCOMPARE(header.size, (quint32)sizeof(header));
+    QCOMPARE(header.count, 0u);
+    QCOMPARE(header.sequence, 0u);
+
+    QVERIFY(session.write(&sample, sizeof(sample)));
+    QVERIFY(readSocket(fds[1], connection, &header, sizeof(header)));
+    QCOMPARE(header.headerSize, (quint16)sizeof(header));
+    QCOMPARE(header.size, (quint32)(sizeof(header) + sizeof(sample)));
+    QCOMPARE(header.sampleType, (quint16)SENSORFW_WIRE_SAMPLE_XYZ);
+    QCOMPARE(header.sampleSize, (quint16)sizeof(sample));
+    QCOMPARE(header.sampleVersion, (quint16)SENSORFW_WIRE_SAMPLE_US);
+    QCOMPARE(header.sequence, 1u);
+    QCOMPARE(header.count, 1u);
+    QCOMPARE(header.dropped, 0u);
+    TimedXyzData received;
+    QVERIFY(readSocket(fds[1], connection, &received, sizeof(received)));
+    QCOMPARE(received.timestamp_, sample.timestamp_);
+    QCOMPARE(received.z_, sample.z_);
+
+    // Samples not fitting in the backlog are counted in the next frame
+    unsigned queued = 0;
+    while (session.write(&sample, sizeof(sample)))
+        ++queued;
+    QVERIFY(!session.write(&sample, sizeof(sample)));
+    QCOMPARE(session.getDroppedSamples(), 2ul);
+    for (unsigned i = 0; i < queued; ++i) {
+        QVERIFY(readSocket(fds[1], connection, &header, sizeof(header)));
+        QCOMPARE(header.sequence, 2 + i);
+        QVERIFY(readSocket(fds[1], connection, &received, sizeof(received)));
+    }
+    QVERIFY(session.write(&sample, sizeof(sample)));
+    QVERIFY(readSocket(fds[1], connection, &header, sizeof(header)));
+    QCOMPARE(header.sequence, 2 + queued);
+    QCOMPARE(header.dropped, 2u);
+
+    close(fds[1]);
+
+    // Version 3 connections get nanoseconds, followers on version 2 do not
+    int nsFds[2];
+    QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM, 0, nsFds), 0);
+    QLocalSocket* nsSocket = new QLocalSocket;
+    QVERIFY(nsSocket->setSocketDescriptor(nsFds[0]));
+    ClientConnection nsConnection(nsSocket, 3);
+    QCOMPARE(nsConnection.sampleVersion(), SENSORFW_WIRE_SAMPLE_NS);
+    int usFds[2];
+    QCOMPARE(socketpair(AF_UNIX, SOCK_STREAM, 0, usFds), 0);
+    QLocalSocket* usSocket = new QLocalSocket;
+    QVERIFY(usSocket->setSocketDescriptor(usFds[0]));
+    ClientConnection usConnection(usSocket, 2);
+
+    SessionData nsSession(&nsConnection, 8);
+    nsSession.setSampleType(SENSORFW_WIRE_SAMPLE_XYZ);
+    SessionData usSession(&usConnection, 9);
+    usSession.setSampleType(SENSORFW_WIRE_SAMPLE_XYZ);
+    nsSession.setFollowers(QList<SessionData*>() << &usSession);
+
+    QVERIFY(nsSession.write(&sample, sizeof(sample)));
+    QVERIFY(readSocket(nsFds[1], nsConnection, &header, sizeof(header)));
+    QCOMPARE(header.sampleVersion, (quint16)SENSORFW_WIRE_SAMPLE_NS);
+    QVERIFY(readSocket(nsFds[1], nsConnection, &received, sizeof(received)));
+    QCOMPARE(received.timestamp_, sample.timestamp_ * 1000);
+    QCOMPARE(received.x_, sample.x_);
+    QVERIFY(readSocket(usFds[1], usConnection, &header, sizeof(header)));
+    QCOMPARE(header.sampleVersion, (quint16)SENSORFW_WIRE_SAMPLE_US);
+    QVERIFY(readSocket(usFds[1], usConnection, &received, sizeof(received)));
+    QCOMPARE(received.timestamp_, sample.timestamp_);
+
+    // Unknown sample types are left alone
+    nsSession.setFollowers(QList<SessionData*>());
+    nsSession.setSampleType(SENSORFW_WIRE_SAMPLE_UNKNOWN);
+    QVERIFY(nsSession.write(&sample, sizeof(sample)));
+    QVERIFY(readSocket(nsFds[1], nsConnection, &header, sizeof(header)));
+    QCOMPARE(header.sampleVersion, (quint16)SENSORFW_WIRE_SAMPLE_US);
+    QVERIFY(readSocket(nsFds[1], nsConnection, &received, sizeof(received)));
+    QCOMPARE(received.timestamp_, sample.timestamp_);
+
+    close(nsFds[1]);
+    close(usFds[1]);
+}
+
+/**
+ * Running statistics must match statistics computed from the samples
+ * which are expected to remain in the window after each push.
+ */
+void DataFlowTest::testSlidingWindow()
+{
+    const int capacity = 5;
+    const quint64 maxAge = 35;
+    SlidingWindow<int, 2> window(capacity, maxAge);
+
+    QList<quint64> times;
+    QList<int> values;
+    quint64 timestamp = 0;
+    for (int i = 0; i < 200; ++i) {
+        // Irregular spacing makes the age limit kick in now and then
+        timestamp += (i % 7 == 0) ? 40 : 3 + i % 5;
+        int value = (i * 7919) % 201 - 100;
+        const int sample[2] = { value, -value };
+        window.push(timestamp, sample);
+
+        times.append(timestamp);
+        values.append(value);
+        while (values.count() > capacity || (values.count() > 1 && timestamp - times.first() > maxAge)) {
+            times.removeFirst();
+            values.removeFirst();
+        }
+
+        qint64 sum = 0;
+        int min = values.first();
+        int max = values.first();
+        foreach (int v, values) {
+            sum += v;
+            min = qMin(min, v);
+            max = qMax(max, v);
+        }
+
+        QCOMPARE((int)window.count(), values.count());
+        QCOMPARE(window.oldestTimestamp(), times.first());
+        QCOMPARE(window.sum(0), sum);
+        QCOMPARE(window.sum(1), -sum);
+        QCOMPARE(window.min(0), min);
+        QCOMPARE(window.max(0), max);
+        QCOMPARE(window.min(1), -max);
+        QCOMPARE(window.max(1), -min);
+    }
+
+    // Shrinking keeps the newest samples
+    window.setCapacity(2);
+    QCOMPARE((int)window.count(), qMin(2, values.count()));
+    QCOMPARE(window.sum(0), (qint64)values[values.count() - 1] + values[values.count() - 2]);
+
+    window.clear();
+    QVERIFY(window.isEmpty());
+    QCOMPARE(window.sum(0), (qint64)0);
+}
+
+/**
+ * Sessions with the same factor share one group, box output averages
+ * the inputs since the previous output and the polyphase low-pass keeps
+ * constant input unchanged while removing content above its cutoff.
+ */
+void DataFlowTest::testDownsampler()
+{
+    QMap<unsigned, QList<int> > factors;
+    factors[0].append(1);
+    factors[1].append(2);
+    factors[4].append(3);
+    factors[4].append(4);
+
+    Downsampler<TimedXyzData> box;
+    box.setGroups(1, 10, factors);
+    QVERIFY(box.isCurrent(1, 10));
+    QVERIFY(!box.isCurrent(1, 20));
+    QCOMPARE(box.groupCount(), 2);
+    QCOMPARE(box.factor(0), 1u);
+    QCOMPARE(box.sessions(0).count(), 2);
+    QCOMPARE(box.factor(1), 4u);
+    QCOMPARE(box.sessions(1).count(), 2);
+
+    int outputs = 0;
+    for (int i = 0; i < 12; ++i) {
+        TimedXyzData sample(i * 10, i, -i, 2 * i);
+        QCOMPARE(box.push(0, sample)->x_, i);
+        const TimedXyzData* output = box.push(1, sample);
+        if (!output)
+            continue;
+        ++outputs;
+        QCOMPARE(i % 4, 3);
+        QCOMPARE(output->timestamp_, sample.timestamp_);
+        QCOMPARE(output->x_, (4 * i - 6) / 4);
+        QCOMPARE(output->z_, 2 * (4 * i - 6) / 4);
+    }
+    QCOMPARE(outputs, 3);
+
+    factors.clear();
+    factors[4].append(1);
+    Downsampler<TimedXyzData> lowPass(DownsamplerBase::Polyphase);
+    lowPass.setGroups(1, 10, factors);
+    for (int i = 0; i < 200; ++i) {
+        int alternating = (i & 1) ? 1000 : -1000;
+        const TimedXyzData* output = lowPass.push(0, TimedXyzData(i, 500, alternating, 0));
+        if (output && i >= 64) {
+            QCOMPARE(output->x_, 500);
+            QVERIFY(qAbs(output->y_) <= 1);
+        }
+    }
+
+    QCOMPARE(DownsamplerBase::filterFromName("Decimate", DownsamplerBase::Box), DownsamplerBase::Decimate);
+    QCOMPARE(DownsamplerBase::filterFromName("bogus", DownsamplerBase::Box), DownsamplerBase::Box);
+}
+
+/**
+ * Fast mode must stay within one degree of the precise outputs of the
+ * orientation, rotation and compass computations.
+ */
+void DataFlowTest::testFastMath()
+{
+    double worst = 0;
+    for (int y = -2000; y <= 2000; y += 7) {
+        for (int x = -2000; x <= 2000; x += 13)
+            worst = qMax(worst, qAbs(FastMath::atan2((float)y, (float)x) - atan2((double)y, (double)x)));
+    }
+    QVERIFY2(worst < 2e-5, qPrintable(QString("atan2 error %1").arg(worst)));
+
+    float ys[3] = { 1, -1, 0 };
+    float xs[3] = { 0, -1, 0 };
+    float angles[3];
+    FastMath::atan2(3, ys, xs, angles);
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(angles[i], FastMath::atan2(ys[i], xs[i]));
+
+    double worstHeading = 0;
+    for (int ax = -1000; ax <= 1000; ax += 50) {
+        for (int ay = -1000; ay <= 1000; ay += 50) {
+            for (int az = -1000; az <= 1000; az += 125) {
+                if (!ax && !ay && !az)
+                    continue;
+
+                // Inclinations are rounded to degrees by the filters
+                const int v[3] = { ax, ay, az };
+                for (int a = 0; a < 3; ++a) {
+                    const int b = v[(a + 1) % 3];
+                    const int c = v[(a + 2) % 3];
+                    int precise = round(FastMath::inclination(v[a], b, c, FastMath::Precise) * 180 / M_PI);
+                    int fast = round(FastMath::inclination(v[a], b, c, FastMath::Fast) * 180 / M_PI);
+                    QVERIFY(qAbs(precise - fast) <= 1);
+                }
+
+                for (int k = 0; k < 8; ++k) {
+                    qreal mx = 0.3 * cos(k * 0.8);
+                    qreal my = 0.3 * sin(k * 0.8);
+                    qreal mz = 0.2 - 0.05 * k;
+                    qreal precise = CompassFilter::heading(mx, my, mz, ax * .001f, ay * .001f, -az * .001f);
+                    qreal fast = CompassFilter::fastHeading(mx, my, mz, ax * .001f, ay * .001f, -az * .001f);
+                    qreal diff = qAbs(precise - fast);
+                    worstHeading = qMax(worstHeading, diff > 180 ? 360 - diff : diff);
+                }
+            }
+        }
+    }
+    QVERIFY2(worstHeading < 0.01, qPrintable(QString("heading error %1").arg(worstHeading)));
+}
+
+/**
+ * Latest sample table must return the newest sample of a slot with its
+ * store time, and nothing for slots which are empty, freed or hold a
+ * sample larger than the reader expects.
+ */
+void DataFlowTest::testLatestSampleTable()
+{
+    const quint32 slots = 4;
+    QByteArray memory(LatestSampleTable::mappingSize(slots), 0);
+    LatestSampleTable writer(memory.data());
+    writer.initialize(slots);
+
+    LatestSampleTable reader(memory.data());
+    QVERIFY(reader.attach(memory.size()));
+    QCOMPARE(reader.slotCount(), slots);
+    QVERIFY(!LatestSampleTable(memory.data()).attach(memory.size() - 1));
+
+    TimedXyzData sample;
+    quint64 updated = 0;
+    QCOMPARE(reader.read(1, &sample, sizeof(sample), &updated), -1);
+
+    TimedXyzData first(10, 1, 2, 3);
+    TimedXyzData second(20, 4, 5, 6);
+    writer.write(1, &first, sizeof(first), 100);
+    writer.write(1, &second, sizeof(second), 200);
+    QCOMPARE(reader.read(1, &sample, sizeof(sample), &updated), (int)sizeof(TimedXyzData));
+    QCOMPARE(updated, (quint64)200);
+    QCOMPARE(sample.timestamp_, (quint64)20);
+    QCOMPARE(sample.x_, 4);
+    QCOMPARE(sample.z_, 6);
+
+    QCOMPARE(reader.read(1, &sample, sizeof(sample) - 1, &updated), -1);
+    QCOMPARE(reader.read(0, &sample, sizeof(sample), &updated), -1);
+    QCOMPARE(reader.read(slots, &sample, sizeof(sample), &updated), -1);
+
+    writer.write(1, 0, 0, 300);
+    QCOMPARE(reader.read(1, &sample, sizeof(sample), &updated), -1);
+}
+
 QList<QString> DataFlowTest::getKeys(const SensorManager &that)
 {
     return that.getAdaptorTypes();
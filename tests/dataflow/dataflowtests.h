@@ -29,6 +29,46 @@
 
 #include <QTest>
 #include "sensormanager.h"
+#include "deviceadaptor.h"
+#include "deviceadaptorringbuffer.h"
+#include "datatypes/orientationdata.h"
+
+/**
+ * Adaptor whose samples are written by the test itself.
+ */
+class PipelineTestAdaptor : public DeviceAdaptor
+{
+    Q_OBJECT;
+public:
+    static DeviceAdaptor* factoryMethod(const QString& id)
+    {
+        return new PipelineTestAdaptor(id);
+    }
+
+    bool startAdaptor() { return true; }
+    void stopAdaptor() {}
+    bool startSensor() { return true; }
+    void stopSensor() {}
+    void init() {}
+
+    void push(quint64 timestamp, int x, int y, int z)
+    {
+        *buffer_.nextSlot() = AccelerationData(timestamp, x, y, z);
+        buffer_.commit();
+        buffer_.wakeUpReaders();
+    }
+
+protected:
+    PipelineTestAdaptor(const QString& id) :
+        DeviceAdaptor(id),
+        buffer_(64)
+    {
+        setAdaptedSensor("accelerometer", "Test accelerometer", &buffer_);
+    }
+
+private:
+    DeviceAdaptorRingBuffer<AccelerationData> buffer_;
+};
 
 class DataFlowTest : public QObject
 {
@@ -45,6 +85,21 @@ private slots:
 
     void testAdaptorSharing();
     void testChainSharing();
+    void testSampleQueue();
+    void testRingBuffer();
+    void benchmarkRingBufferElementwise();
+    void benchmarkRingBufferSpans();
+    void testIntervalRequests();
+    void testPipelineDescription();
+    void testPipelineChain();
+    void testTimestampMapper();
+    void testWakeupGrid();
+    void testTraceFile();
+    void testWireProtocol();
+    void testSlidingWindow();
+    void testDownsampler();
+    void testFastMath();
+    void testLatestSampleTable();
 
     void cleanup() {};
     void cleanupTestCase();
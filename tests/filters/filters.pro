@@ -11,7 +11,7 @@ HEADERS += filtertests.h \
     ../../filters/orientationinterpreter/orientationinterpreter.h \
     ../../filters/coordinatealignfilter/coordinatealignfilter.h \
     ../../filters/declinationfilter/declinationfilter.h \
-    ../../filters/rotationfilter/rotationfilter.h 
+    ../../filters/rotationfilter/rotationfilter.h
 
     
 SOURCES += filtertests.cpp \
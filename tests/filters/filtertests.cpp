@@ -38,9 +38,11 @@
 #include "orientationinterpreter.h"
 #include "declinationfilter.h"
 #include "rotationfilter.h"
+#include "xyzblock.h"
 #include "filtertests.h"
 #include "config.h"
 #include <QSettings>
+#include <math.h>
 
 void FilterApiTest::initTestCase()
 {
@@ -488,4 +490,108 @@ void FilterApiTest::testRotationFilter()
     delete rotationFilter;
 }
 
+/**
+ * Vector kernels must give exactly the results of plain per sample code,
+ * including the leftover samples which do not fill a vector.
+ */
+void FilterApiTest::testXyzKernels()
+{
+    double matrix[3][3] = {
+        { 0.5,  -1.25, 0   },
+        { 1,     0.3, -2.7 },
+        {-0.01,  0,    1   }
+    };
+
+    const unsigned n = 67;
+    int x[n], y[n], z[n];
+    int tx[n], ty[n], tz[n];
+    for (unsigned i = 0; i < n; ++i) {
+        x[i] = (int)(i * 7919) % 20001 - 10000;
+        y[i] = (int)(i * 104729) % 2000001 - 1000000;
+        z[i] = (i & 1) ? -(int)i * 31 : (int)i * 977;
+    }
+
+    XyzKernels::transform(matrix, n, x, y, z, tx, ty, tz);
+    for (unsigned i = 0; i < n; ++i) {
+        QCOMPARE(tx[i], (int)(matrix[0][0] * x[i] + matrix[0][1] * y[i] + matrix[0][2] * z[i]));
+        QCOMPARE(ty[i], (int)(matrix[1][0] * x[i] + matrix[1][1] * y[i] + matrix[1][2] * z[i]));
+        QCOMPARE(tz[i], (int)(matrix[2][0] * x[i] + matrix[2][1] * y[i] + matrix[2][2] * z[i]));
+    }
+
+    // In place
+    XyzKernels::transform(matrix, n, x, y, z, x, y, z);
+    for (unsigned i = 0; i < n; ++i) {
+        QCOMPARE(x[i], tx[i]);
+        QCOMPARE(y[i], ty[i]);
+        QCOMPARE(z[i], tz[i]);
+    }
+
+    qint64 sum[3];
+    XyzKernels::sum(n, tx, ty, tz, sum);
+    qint64 expected[3] = { 0, 0, 0 };
+    for (unsigned i = 0; i < n; ++i) {
+        expected[0] += tx[i];
+        expected[1] += ty[i];
+        expected[2] += tz[i];
+    }
+    QCOMPARE(sum[0], expected[0]);
+    QCOMPARE(sum[1], expected[1]);
+    QCOMPARE(sum[2], expected[2]);
+}
+
+/**
+ * A block larger than XyzBlock::CAPACITY must come out complete and in
+ * order when given to the filter with a single call.
+ */
+void FilterApiTest::testCoordinateAlignFilterBlock()
+{
+    double hconv[3][3] = {
+        { 0, 0,-1},
+        {-1, 0, 0},
+        { 0, 1, 0}
+    };
+
+    const int numInputs = XyzBlock::CAPACITY + 13;
+    TimedXyzData inputData[numInputs];
+    TimedXyzData expectedResult[numInputs];
+    for (int i = 0; i < numInputs; ++i) {
+        inputData[i] = TimedXyzData(i, i, -2 * i, 3 * i + 1);
+        expectedResult[i] = TimedXyzData(i, -(3 * i + 1), -i, -2 * i);
+    }
+
+    Bin filterBin;
+    DummyAdaptor<TimedXyzData> dummyAdaptor;
+
+    FilterBase* coordAlignFilter = CoordinateAlignFilter::factoryMethod();
+    ((CoordinateAlignFilter*)coordAlignFilter)->setProperty("transMatrix", QVariant::fromValue(TMatrix(hconv)));
+
+    RingBuffer<TimedXyzData> outputBuffer(128);
+    filterBin.add(&dummyAdaptor, "adapter");
+    filterBin.add(coordAlignFilter, "coordfilter");
+    filterBin.add(&outputBuffer, "buffer");
+
+    filterBin.join("adapter", "source", "coordfilter", "sink");
+    filterBin.join("coordfilter", "source", "buffer", "sink");
+
+    DummyDataEmitter<TimedXyzData> dbusEmitter;
+    Bin marshallingBin;
+    marshallingBin.add(&dbusEmitter, "testdataemitter");
+    outputBuffer.join(&dbusEmitter);
+
+    dummyAdaptor.setTestData(numInputs, inputData);
+    dbusEmitter.setExpectedData(numInputs, expectedResult);
+
+    marshallingBin.start();
+    filterBin.start();
+
+    dummyAdaptor.pushAllData();
+
+    filterBin.stop();
+    marshallingBin.stop();
+
+    QCOMPARE(dbusEmitter.numSamplesReceived(), numInputs);
+
+    delete coordAlignFilter;
+}
+
 QTEST_MAIN(FilterApiTest)
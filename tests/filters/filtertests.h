@@ -51,6 +51,8 @@ private slots:
     void testDeclinationFilter();
     void testOrientationInterpretationFilter();
     void testRotationFilter();
+    void testXyzKernels();
+    void testCoordinateAlignFilterBlock();
 
     void cleanup() {}
     void cleanupTestCase() {}
@@ -90,6 +92,17 @@ public:
         ++counter_;
     }
 
+    /**
+     * Propagate all remaining values with a single call.
+     */
+    void pushAllData() {
+        int count = datacount_ - index_;
+        source_.propagate(count, &(data_[index_]));
+
+        index_ += count;
+        counter_ += count;
+    }
+
     int getDataCount() { return counter_; }
 
 private:
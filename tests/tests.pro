@@ -5,6 +5,7 @@ SUBDIRS = filters\
           adaptors \
           chains \
           client \
+          capi \
           testapp \
           dataflow \
           benchmark \